@@ -40,6 +40,7 @@
 #include "../driver.h"
 #include "../configuration.h"
 #include "../retroarch.h"
+#include "../performance_counters.h"
 #include "../verbosity.h"
 #include "../list_special.h"
 
@@ -624,6 +625,8 @@ static void audio_driver_flush(const int16_t *data, size_t samples)
 		   !audio_driver_output_samples_buf)
       return;
 
+   performance_section_begin(PERF_SECTION_AUDIO_FLUSH);
+
    convert_s16_to_float(audio_driver_input_data, data, samples,
          audio_volume_gain);
 
@@ -720,6 +723,8 @@ static void audio_driver_flush(const int16_t *data, size_t samples)
    if (current_audio->write(audio_driver_context_audio_data,
             output_data, output_frames * 2) < 0)
       audio_driver_active = false;
+
+   performance_section_end(PERF_SECTION_AUDIO_FLUSH);
 }
 
 /**
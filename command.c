@@ -129,12 +129,25 @@ static bool command_read_ram(const char *arg);
 static bool command_write_ram(const char *arg);
 #endif
 
+#ifdef HAVE_COMMAND
+#if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
+static bool command_perf_stats(const char *arg);
+#endif
+static bool command_perf_trace(const char *arg);
+#endif
+
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER",      command_set_shader,  "<shader path>" },
 #if defined(HAVE_COMMAND) && defined(HAVE_CHEEVOS)
    { "READ_CORE_RAM",   command_read_ram,    "<address> <number of bytes>" },
    { "WRITE_CORE_RAM",  command_write_ram,   "<address> <byte1> <byte2> ..." },
 #endif
+#ifdef HAVE_COMMAND
+#if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
+   { "PERF_STATS",      command_perf_stats,  "<section name or all>" },
+#endif
+   { "PERF_TRACE",      command_perf_trace,  "<trace file name>" },
+#endif
 };
 
 static const struct cmd_map map[] = {
@@ -188,7 +201,7 @@ static struct sockaddr_storage lastcmd_net_source;
 static socklen_t lastcmd_net_source_len;
 #endif
 
-#ifdef HAVE_CHEEVOS
+#ifdef HAVE_COMMAND
 #if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
 static bool command_reply(const char * data, size_t len)
 {
@@ -301,6 +314,87 @@ static bool command_write_ram(const char *arg)
 }
 #endif
 
+#ifdef HAVE_COMMAND
+#if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
+static bool command_perf_stats(const char *arg)
+{
+   char report[1024];
+   char reply[1536];
+   const char *line = report;
+   size_t reply_len = 0;
+
+   report[0]        = '\0';
+   reply[0]         = '\0';
+
+   if (!performance_sections_report(report, sizeof(report), arg))
+   {
+      snprintf(reply, sizeof(reply), "PERF_STATS %s -1\n", arg);
+      command_reply(reply, strlen(reply));
+      return false;
+   }
+
+   /* One "PERF_STATS <section> <key>=<value>..." line per section. */
+   while (*line)
+   {
+      const char *end = strchr(line, '\n');
+      size_t len      = end ? (size_t)(end - line + 1) : strlen(line);
+
+      reply_len      += snprintf(reply + reply_len, sizeof(reply) - reply_len,
+            "PERF_STATS %.*s", (int)len, line);
+      if (reply_len >= sizeof(reply))
+      {
+         reply_len    = sizeof(reply) - 1;
+         break;
+      }
+
+      line           += len;
+   }
+
+   command_reply(reply, reply_len);
+   return true;
+}
+#endif
+
+/* Commands can come in over the network, so the trace only takes
+ * a file name and always goes to the cache directory, or to the
+ * config directory if that is unset. */
+static bool command_perf_trace(const char *arg)
+{
+   char dir[PATH_MAX_LENGTH];
+   char path[PATH_MAX_LENGTH];
+   settings_t *settings = config_get_ptr();
+
+   dir[0]  = '\0';
+   path[0] = '\0';
+
+   if (     string_is_empty(arg)
+         || strpbrk(arg, "/\\:")
+         || string_is_equal(arg, ".")
+         || string_is_equal(arg, ".."))
+   {
+      RARCH_ERR("[PERF]: Trace name \"%s\" is not a plain file name.\n",
+            arg ? arg : "");
+      return false;
+   }
+
+   if (settings && !string_is_empty(settings->paths.directory_cache))
+      strlcpy(dir, settings->paths.directory_cache, sizeof(dir));
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+      fill_pathname_basedir(dir, path_get(RARCH_PATH_CONFIG), sizeof(dir));
+
+   if (string_is_empty(dir))
+      return false;
+
+   fill_pathname_join(path, dir, arg, sizeof(path));
+
+   if (!performance_sections_write_trace(path))
+      return false;
+
+   RARCH_LOG("[PERF]: Wrote trace to \"%s\".\n", path);
+   return true;
+}
+#endif
+
 static bool command_get_arg(const char *tok,
       const char **arg, unsigned *index)
 {
@@ -17,6 +17,8 @@
 
 #include "glslang/glslang/Public/ShaderLang.h"
 #include "glslang/SPIRV/GlslangToSpv.h"
+#include "glslang/OGLCompilersDLL/InitializeDll.h"
+#include "glslang/glslang/Include/PoolAlloc.h"
 #include <vector>
 #include <iostream>
 #include <cstring>
@@ -386,3 +388,12 @@ bool glslang::compile_spirv(const string &source, Stage stage, std::vector<uint3
    return true;
 }
 
+
+void glslang::finalize_thread()
+{
+   /* TShader and TProgram leave the thread pool allocator
+    * pointing at their own pool, which they delete again.
+    * Hand DetachThread() a valid one to free. */
+   SetThreadPoolAllocator(*new TPoolAllocator());
+   DetachThread();
+}
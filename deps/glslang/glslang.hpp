@@ -18,6 +18,11 @@ namespace glslang
     };
 
     bool compile_spirv(const std::string &source, Stage stage, std::vector<uint32_t> *spirv);
+
+    /* Frees the per-thread compiler state. Must be called by
+     * worker threads that used compile_spirv() before they exit,
+     * and only by those: other threads have no state to free. */
+    void finalize_thread();
 }
 
 #endif
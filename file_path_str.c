@@ -41,6 +41,9 @@ const char *file_path_str(enum file_path_enum enum_idx)
       case FILE_PATH_LUTRO_PLAYLIST:
          str = "Lutro.lpl";
          break;
+      case FILE_PATH_CONTENT_CRC_CACHE:
+         str = "content_crc.cache";
+         break;
       case FILE_PATH_NUL:
          str = "nul";
          break;
@@ -35,6 +35,7 @@
 
 #include "../driver.h"
 #include "../paths.h"
+#include "../performance_counters.h"
 #include "../retroarch.h"
 
 /* griffin hack */
@@ -70,6 +71,7 @@ void main_exit(void *args)
    rarch_ctl(RARCH_CTL_MAIN_DEINIT, NULL);
 
    command_event(CMD_EVENT_PERFCNT_REPORT_FRONTEND_LOG, NULL);
+   performance_sections_clear();
 
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
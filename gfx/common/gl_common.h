@@ -230,6 +230,13 @@ struct gl_renderchain_driver
          const char *context_ident,
          const video_info_t *video);
    const char *ident;
+   /* Copies the current viewport into readback slot 'slot'
+    * without waiting for the GPU. */
+   bool (*queue_readback)(gl_t *gl, void *chain_data, unsigned slot);
+   enum video_readback_status (*fetch_readback)(gl_t *gl,
+         void *chain_data, unsigned slot, uint8_t *buffer,
+         unsigned width, unsigned height);
+   void (*readback_free)(gl_t *gl, void *chain_data);
 };
 
 struct gl
@@ -290,6 +297,7 @@ struct gl
    unsigned base_size; /* 2 or 4 */
    unsigned overlays;
    unsigned pbo_readback_index;
+   unsigned readback_queued; /* Bitmask of async readback slots. */
    unsigned last_width[GFX_MAX_TEXTURES];
    unsigned last_height[GFX_MAX_TEXTURES];
 
@@ -333,6 +333,7 @@ static bool d3d10_gfx_set_shader(void* data,
       goto error;
 
    video_shader_resolve_relative(d3d10->shader_preset, path);
+   slang_precompile(d3d10->shader_preset);
 
    source = &d3d10->frame.texture[0];
    for (i = 0; i < d3d10->shader_preset->passes; source = &d3d10->pass[i++].rt)
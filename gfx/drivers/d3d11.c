@@ -347,6 +347,7 @@ static bool d3d11_gfx_set_shader(void* data, enum rarch_shader_type type, const
       goto error;
 
    video_shader_resolve_relative(d3d11->shader_preset, path);
+   slang_precompile(d3d11->shader_preset);
 
    source = &d3d11->frame.texture[0];
    for (i = 0; i < d3d11->shader_preset->passes; source = &d3d11->pass[i++].rt)
@@ -356,6 +356,7 @@ static bool d3d12_gfx_set_shader(void* data, enum rarch_shader_type type, const
       goto error;
 
    video_shader_resolve_relative(d3d12->shader_preset, path);
+   slang_precompile(d3d12->shader_preset);
 
    source = &d3d12->frame.texture[0];
    for (i = 0; i < d3d12->shader_preset->passes; source = &d3d12->pass[i++].rt)
@@ -1185,6 +1185,17 @@ static bool gl_frame(void *data, const void *frame,
 #endif
             gl_pbo_async_readback(gl);
 
+   /* Asynchronous viewport readbacks. */
+   if (gl->readback_queued)
+   {
+      unsigned i;
+      for (i = 0; i < VIDEO_READBACK_SLOTS; i++)
+         if (gl->readback_queued & (1 << i))
+            gl->renderchain_driver->queue_readback(gl,
+                  gl->renderchain_data, i);
+      gl->readback_queued = 0;
+   }
+
    /* emscripten has to do black frame insertion in its main loop */
 #ifndef EMSCRIPTEN
    /* Disable BFI during fast forward, slow-motion,
@@ -1307,6 +1318,8 @@ static void gl_free(void *data)
          gl->renderchain_driver->free_vao(gl, gl->renderchain_data);
    }
 
+   if (gl->renderchain_driver->readback_free)
+      gl->renderchain_driver->readback_free(gl, gl->renderchain_data);
    if (gl->renderchain_driver->free)
       gl->renderchain_driver->free(gl, gl->renderchain_data);
    gl_deinit_chain(gl);
@@ -2241,6 +2254,41 @@ static bool gl_read_viewport(void *data, uint8_t *buffer, bool is_idle)
          buffer, is_idle);
 }
 
+static bool gl_queue_readback(void *data, unsigned slot)
+{
+   gl_t *gl             = (gl_t*)data;
+
+   /* GPU recording already streams every frame through
+    * the pbo_readback ring, see gl_pbo_async_readback(). */
+   if (     gl->pbo_readback_enable
+         || !gl->renderchain_driver
+         || !gl->renderchain_driver->queue_readback
+         || !gl->renderchain_driver->fetch_readback)
+      return false;
+
+   /* The copy is issued by gl_frame() once the next frame
+    * has been rendered into the back buffer. */
+   gl->readback_queued |= 1 << slot;
+   return true;
+}
+
+static enum video_readback_status gl_fetch_readback(void *data,
+      unsigned slot, uint8_t *buffer, unsigned width, unsigned height)
+{
+   enum video_readback_status ret;
+   gl_t *gl             = (gl_t*)data;
+
+   if (gl->readback_queued & (1 << slot))
+      return VIDEO_READBACK_PENDING;
+
+   context_bind_hw_render(false);
+   ret = gl->renderchain_driver->fetch_readback(gl,
+         gl->renderchain_data, slot, buffer, width, height);
+   context_bind_hw_render(true);
+
+   return ret;
+}
+
 #if 0
 #define READ_RAW_GL_FRAME_TEST
 #endif
@@ -2665,4 +2713,6 @@ video_driver_t video_gl = {
 #endif
    gl_get_poke_interface,
    gl_wrap_type_to_enum,
+   gl_queue_readback,
+   gl_fetch_readback,
 };
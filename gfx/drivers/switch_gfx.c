@@ -28,6 +28,7 @@
 #include "../../driver.h"
 
 #include "../../retroarch.h"
+#include "../../performance_counters.h"
 #include "../../verbosity.h"
 
 #include "../common/switch_common.h"
@@ -439,7 +440,11 @@ static bool switch_frame(void *data, const void *frame,
       gfxFlushBuffers();
       gfxSwapBuffers();
       if (sw->vsync)
+      {
+            performance_section_begin(PERF_SECTION_VSYNC_WAIT);
             gfxWaitForVsync();
+            performance_section_end(PERF_SECTION_VSYNC_WAIT);
+      }
 
       return true;
 }
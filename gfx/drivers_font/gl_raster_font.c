@@ -42,22 +42,68 @@
 
 #define MAX_MSG_LEN_CHUNK 64
 
+/* Menus draw a few hundred labels per frame, so the run cache
+ * is set associative to keep them from evicting each other.
+ * The number of sets must be a power of two. */
+#define GL_RASTER_FONT_RUN_CACHE_SETS 128
+#define GL_RASTER_FONT_RUN_CACHE_WAYS 4
+#define GL_RASTER_FONT_RUN_CACHE_SIZE (GL_RASTER_FONT_RUN_CACHE_SETS * GL_RASTER_FONT_RUN_CACHE_WAYS)
+
+typedef struct
+{
+   uint32_t code;
+   int off_x, off_y;
+   int tex_x, tex_y;
+   int width, height;
+   int delta_x, delta_y;
+} gl_raster_glyph_t;
+
+/* A laid out line of text. Static labels are drawn with the same
+ * text every frame, so keep the glyph layout around instead of
+ * walking the string and looking up every glyph again.
+ * The buffers are kept when the slot is reused for another
+ * line and only grow. */
+typedef struct
+{
+   char *msg;
+   unsigned msg_len;
+   unsigned msg_cap;
+   unsigned generation;
+   unsigned last_used;
+   unsigned count;
+   int width;
+   gl_raster_glyph_t *glyphs;
+} gl_raster_run_t;
+
 typedef struct
 {
    gl_t *gl;
    GLuint tex;
    unsigned tex_width, tex_height;
+   GLenum tex_format;
+   unsigned tex_components;
 
    const font_renderer_driver_t *font_driver;
    void *font_data;
    struct font_atlas *atlas;
 
    video_font_raster_block_t *block;
+
+   unsigned run_clock;
+   gl_raster_run_t runs[GL_RASTER_FONT_RUN_CACHE_SIZE];
 } gl_raster_t;
 
+static void gl_raster_font_free_run(gl_raster_run_t *run)
+{
+   free(run->msg);
+   free(run->glyphs);
+   memset(run, 0, sizeof(*run));
+}
+
 static void gl_raster_font_free_font(void *data,
       bool is_threaded)
 {
+   unsigned i;
    gl_raster_t *font = (gl_raster_t*)data;
    if (!font)
       return;
@@ -70,6 +116,9 @@ static void gl_raster_font_free_font(void *data,
 
    glDeleteTextures(1, &font->tex);
 
+   for (i = 0; i < GL_RASTER_FONT_RUN_CACHE_SIZE; i++)
+      gl_raster_font_free_run(&font->runs[i]);
+
    free(font);
 }
 
@@ -164,6 +213,51 @@ static bool gl_raster_font_upload_atlas(gl_raster_t *font)
 
    free(tmp);
 
+   font->tex_format     = gl_format;
+   font->tex_components = (unsigned)ncomponents;
+
+   return true;
+}
+
+/* Uploads only the atlas region that changed since the last
+ * upload, instead of the whole texture. */
+static bool gl_raster_font_upload_atlas_rect(gl_raster_t *font)
+{
+   unsigned i, j;
+   unsigned x             = font->atlas->dirty_x;
+   unsigned y             = font->atlas->dirty_y;
+   unsigned width         = font->atlas->dirty_width;
+   unsigned height        = font->atlas->dirty_height;
+   unsigned ncomponents   = font->tex_components;
+   uint8_t *tmp           = (uint8_t*)malloc(width * height * ncomponents);
+
+   if (!tmp)
+      return false;
+
+   for (i = 0; i < height; ++i)
+   {
+      const uint8_t *src = &font->atlas->buffer[(y + i) * font->atlas->width + x];
+      uint8_t       *dst = &tmp[i * width * ncomponents];
+
+      if (ncomponents == 1)
+         memcpy(dst, src, width);
+      else
+      {
+         for (j = 0; j < width; ++j)
+         {
+            *dst++ = 0xff;
+            *dst++ = *src++;
+         }
+      }
+   }
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height,
+         font->tex_format, GL_UNSIGNED_BYTE, tmp);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   free(tmp);
+
    return true;
 }
 
@@ -252,7 +346,9 @@ static void gl_raster_font_draw_vertices(gl_raster_t *font,
 
    if (font->atlas->dirty)
    {
-      gl_raster_font_upload_atlas(font);
+      if (!font->atlas->dirty_width || !font->atlas->dirty_height ||
+            !gl_raster_font_upload_atlas_rect(font))
+         gl_raster_font_upload_atlas(font);
       font->atlas->dirty   = false;
    }
 
@@ -267,61 +363,241 @@ static void gl_raster_font_draw_vertices(gl_raster_t *font,
    glDrawArrays(GL_TRIANGLES, 0, coords->vertices);
 }
 
+/**
+ * gl_raster_font_layout_run:
+ * @font                  : GL raster font handle.
+ * @run                   : Run to lay out.
+ *
+ * Looks up every glyph of @run's text and records where it is
+ * drawn from and to.
+ **/
+static void gl_raster_font_layout_run(gl_raster_t *font,
+      gl_raster_run_t *run)
+{
+   const char *msg      = run->msg;
+   const char *msg_end  = msg + run->msg_len;
+   int delta_x          = 0;
+   int delta_y          = 0;
+
+   run->count           = 0;
+
+   while (msg < msg_end)
+   {
+      gl_raster_glyph_t *out         = NULL;
+      unsigned                  code = utf8_walk(&msg);
+      const struct font_glyph *glyph = font->font_driver->get_glyph(
+            font->font_data, code);
+
+      if (!glyph) /* Do something smarter here ... */
+      {
+         code  = '?';
+         glyph = font->font_driver->get_glyph(font->font_data, code);
+      }
+
+      if (!glyph)
+         continue;
+
+      out          = &run->glyphs[run->count++];
+      out->code    = code;
+      out->off_x   = glyph->draw_offset_x;
+      out->off_y   = glyph->draw_offset_y;
+      out->tex_x   = glyph->atlas_offset_x;
+      out->tex_y   = glyph->atlas_offset_y;
+      out->width   = glyph->width;
+      out->height  = glyph->height;
+      out->delta_x = delta_x;
+      out->delta_y = delta_y;
+
+      delta_x     += glyph->advance_x;
+      delta_y     -= glyph->advance_y;
+   }
+
+   run->width      = delta_x;
+}
+
+/**
+ * gl_raster_font_revalidate_run:
+ * @font                  : GL raster font handle.
+ * @run                   : Cached run.
+ *
+ * Called when the atlas changed since @run was laid out. Looks
+ * its glyphs up again, which also keeps them at the front of
+ * the renderer's LRU, and checks that none of them moved.
+ *
+ * Returns: true if @run can still be drawn as is.
+ **/
+static bool gl_raster_font_revalidate_run(gl_raster_t *font,
+      const gl_raster_run_t *run)
+{
+   unsigned i;
+
+   for (i = 0; i < run->count; i++)
+   {
+      const gl_raster_glyph_t *cached = &run->glyphs[i];
+      const struct font_glyph *glyph  = font->font_driver->get_glyph(
+            font->font_data, cached->code);
+
+      if (     !glyph
+            || glyph->atlas_offset_x != cached->tex_x
+            || glyph->atlas_offset_y != cached->tex_y)
+         return false;
+   }
+
+   return true;
+}
+
+/**
+ * gl_raster_font_get_run:
+ * @font                  : GL raster font handle.
+ * @msg                   : Line of text (not NUL-terminated).
+ * @msg_len               : Length of @msg in bytes.
+ *
+ * Looks up the glyph layout of @msg in the run cache, laying it
+ * out again if it is missing or one of its glyphs was evicted
+ * from the atlas since.
+ *
+ * Returns: layout of @msg, or NULL on allocation failure.
+ **/
+static const gl_raster_run_t *gl_raster_font_get_run(
+      gl_raster_t *font, const char *msg, unsigned msg_len)
+{
+   unsigned i;
+   gl_raster_run_t *set  = NULL;
+   gl_raster_run_t *run  = NULL;
+   uint32_t hash         = 5381;
+   bool hit              = false;
+
+   for (i = 0; i < msg_len; i++)
+      hash = (hash << 5) + hash + (uint8_t)msg[i];
+
+   set = &font->runs[(hash & (GL_RASTER_FONT_RUN_CACHE_SETS - 1))
+      * GL_RASTER_FONT_RUN_CACHE_WAYS];
+
+   font->run_clock++;
+
+   for (i = 0; i < GL_RASTER_FONT_RUN_CACHE_WAYS; i++)
+   {
+      gl_raster_run_t *way = &set[i];
+
+      if (     way->msg
+            && way->msg_len == msg_len
+            && !memcmp(way->msg, msg, msg_len))
+      {
+         run = way;
+         hit = true;
+         break;
+      }
+
+      /* Otherwise replace the least recently used way. */
+      if (!run || way->last_used < run->last_used)
+         run = way;
+   }
+
+   if (hit)
+   {
+      unsigned generation = font->atlas->generation;
+
+      run->last_used = font->run_clock;
+
+      if (run->generation == generation)
+         return run;
+
+      if (gl_raster_font_revalidate_run(font, run))
+      {
+         /* Only if looking the glyphs up didn't change the atlas
+          * again, otherwise check once more next time. */
+         if (font->atlas->generation == generation)
+            run->generation = generation;
+         return run;
+      }
+   }
+   else
+   {
+      /* A line never has more glyphs than bytes. */
+      if (!run->msg || run->msg_cap < msg_len + 1)
+      {
+         char *new_msg               = (char*)
+            realloc(run->msg, msg_len + 1);
+         gl_raster_glyph_t *glyphs   = NULL;
+
+         if (new_msg)
+         {
+            run->msg                 = new_msg;
+            glyphs                   = (gl_raster_glyph_t*)realloc(
+                  run->glyphs, (msg_len + 1) * sizeof(*run->glyphs));
+         }
+
+         if (!glyphs)
+         {
+            gl_raster_font_free_run(run);
+            return NULL;
+         }
+
+         run->glyphs                 = glyphs;
+         run->msg_cap                = msg_len + 1;
+      }
+
+      memcpy(run->msg, msg, msg_len);
+      run->msg_len   = msg_len;
+      run->last_used = font->run_clock;
+   }
+
+   gl_raster_font_layout_run(font, run);
+
+   /* Taken last, since looking up glyphs above may change the atlas. */
+   run->generation = font->atlas->generation;
+
+   return run;
+}
+
 static void gl_raster_font_render_line(
       gl_raster_t *font, const char *msg, unsigned msg_len,
       GLfloat scale, const GLfloat color[4], GLfloat pos_x,
       GLfloat pos_y, unsigned text_align,
       video_frame_info_t *video_info)
 {
-   unsigned i;
+   unsigned i, j;
    struct video_coords coords;
    GLfloat font_tex_coords[2 * 6 * MAX_MSG_LEN_CHUNK];
    GLfloat font_vertex[2 * 6 * MAX_MSG_LEN_CHUNK];
    GLfloat font_color[4 * 6 * MAX_MSG_LEN_CHUNK];
    GLfloat font_lut_tex_coord[2 * 6 * MAX_MSG_LEN_CHUNK];
    gl_t      *gl        = font->gl;
-   const char* msg_end  = msg + msg_len;
    int x                = roundf(pos_x * gl->vp.width);
    int y                = roundf(pos_y * gl->vp.height);
-   int delta_x          = 0;
-   int delta_y          = 0;
    float inv_tex_size_x = 1.0f / font->tex_width;
    float inv_tex_size_y = 1.0f / font->tex_height;
    float inv_win_width  = 1.0f / font->gl->vp.width;
    float inv_win_height = 1.0f / font->gl->vp.height;
+   const gl_raster_run_t *run = gl_raster_font_get_run(font, msg, msg_len);
+
+   if (!run)
+      return;
 
    switch (text_align)
    {
       case TEXT_ALIGN_RIGHT:
-         x -= gl_get_message_width(font, msg, msg_len, scale);
+         x -= (int)(run->width * scale);
          break;
       case TEXT_ALIGN_CENTER:
-         x -= gl_get_message_width(font, msg, msg_len, scale) / 2.0;
+         x -= (int)(run->width * scale) / 2.0;
          break;
    }
 
-   while (msg < msg_end)
+   for (j = 0; j < run->count; )
    {
       i = 0;
-      while ((i < MAX_MSG_LEN_CHUNK) && (msg < msg_end))
+      while ((i < MAX_MSG_LEN_CHUNK) && (j < run->count))
       {
-         int off_x, off_y, tex_x, tex_y, width, height;
-         unsigned                  code = utf8_walk(&msg);
-         const struct font_glyph *glyph = font->font_driver->get_glyph(
-               font->font_data, code);
-
-         if (!glyph) /* Do something smarter here ... */
-            glyph = font->font_driver->get_glyph(font->font_data, '?');
-
-         if (!glyph)
-            continue;
-
-         off_x  = glyph->draw_offset_x;
-         off_y  = glyph->draw_offset_y;
-         tex_x  = glyph->atlas_offset_x;
-         tex_y  = glyph->atlas_offset_y;
-         width  = glyph->width;
-         height = glyph->height;
+         const gl_raster_glyph_t *glyph = &run->glyphs[j++];
+         int off_x   = glyph->off_x;
+         int off_y   = glyph->off_y;
+         int tex_x   = glyph->tex_x;
+         int tex_y   = glyph->tex_y;
+         int width   = glyph->width;
+         int height  = glyph->height;
+         int delta_x = glyph->delta_x;
+         int delta_y = glyph->delta_y;
 
          gl_raster_font_emit(0, 0, 1); /* Bottom-left */
          gl_raster_font_emit(1, 1, 1); /* Bottom-right */
@@ -332,9 +608,6 @@ static void gl_raster_font_render_line(
          gl_raster_font_emit(5, 1, 1); /* Bottom-right */
 
          i++;
-
-         delta_x += glyph->advance_x;
-         delta_y -= glyph->advance_y;
       }
 
       coords.tex_coord     = font_tex_coords;
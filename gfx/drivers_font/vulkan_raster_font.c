@@ -108,11 +108,26 @@ static INLINE void vulkan_raster_font_update_glyph(vulkan_raster_t *font, const
    if(font->atlas->dirty)
    {
       unsigned row;
-      for (row = glyph->atlas_offset_y; row < (glyph->atlas_offset_y + glyph->height); row++)
+      unsigned x      = font->atlas->dirty_x;
+      unsigned y      = font->atlas->dirty_y;
+      unsigned width  = font->atlas->dirty_width;
+      unsigned height = font->atlas->dirty_height;
+
+      /* Copy everything written since the last update,
+       * or the whole atlas if the renderer gave no region. */
+      if (!width || !height)
       {
-         uint8_t *src = font->atlas->buffer + row * font->atlas->width + glyph->atlas_offset_x;
-         uint8_t *dst = (uint8_t*)font->texture.mapped + row * font->texture.stride + glyph->atlas_offset_x;
-         memcpy(dst, src, glyph->width);
+         x      = 0;
+         y      = 0;
+         width  = font->atlas->width;
+         height = font->atlas->height;
+      }
+
+      for (row = y; row < (y + height); row++)
+      {
+         uint8_t *src = font->atlas->buffer + row * font->atlas->width + x;
+         uint8_t *dst = (uint8_t*)font->texture.mapped + row * font->texture.stride + x;
+         memcpy(dst, src, width);
       }
 
       font->atlas->dirty = false;
@@ -40,8 +40,10 @@ typedef struct freetype_atlas_slot
 {
    struct font_glyph glyph;
    unsigned charcode;
-   unsigned last_used;
    struct freetype_atlas_slot* next;
+   /* LRU list, most recently used first. */
+   struct freetype_atlas_slot* lru_prev;
+   struct freetype_atlas_slot* lru_next;
 }freetype_atlas_slot_t;
 
 typedef struct freetype_renderer
@@ -51,7 +53,8 @@ typedef struct freetype_renderer
    struct font_atlas atlas;
    freetype_atlas_slot_t atlas_slots[FT_ATLAS_SIZE];
    freetype_atlas_slot_t* uc_map[0x100];
-   unsigned usage_counter;
+   freetype_atlas_slot_t* lru_head;
+   freetype_atlas_slot_t* lru_tail;
 } ft_font_renderer_t;
 
 static struct font_atlas *font_renderer_ft_get_atlas(void *data)
@@ -77,29 +80,49 @@ static void font_renderer_ft_free(void *data)
    free(handle);
 }
 
-static freetype_atlas_slot_t* font_renderer_get_slot(ft_font_renderer_t *handle)
+static void font_renderer_ft_lru_touch(ft_font_renderer_t *handle,
+      freetype_atlas_slot_t *slot)
 {
-   int i, map_id;
-   unsigned oldest = 0;
+   if (handle->lru_head == slot)
+      return;
+
+   /* unlink */
+   if (slot->lru_prev)
+      slot->lru_prev->lru_next = slot->lru_next;
+   if (slot->lru_next)
+      slot->lru_next->lru_prev = slot->lru_prev;
+   else if (handle->lru_tail == slot)
+      handle->lru_tail = slot->lru_prev;
+
+   /* push to the front */
+   slot->lru_prev   = NULL;
+   slot->lru_next   = handle->lru_head;
+   if (handle->lru_head)
+      handle->lru_head->lru_prev = slot;
+   handle->lru_head = slot;
+   if (!handle->lru_tail)
+      handle->lru_tail = slot;
+}
 
-   for (i = 1; i < FT_ATLAS_SIZE; i++)
-      if((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
+static freetype_atlas_slot_t* font_renderer_get_slot(ft_font_renderer_t *handle)
+{
+   int map_id;
+   freetype_atlas_slot_t *oldest = handle->lru_tail;
 
    /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if(handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
+   map_id = oldest->charcode & 0xFF;
+   if(handle->uc_map[map_id] == oldest)
+      handle->uc_map[map_id] = oldest->next;
    else if (handle->uc_map[map_id])
    {
       freetype_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while(ptr->next && ptr->next != &handle->atlas_slots[oldest])
+      while(ptr->next && ptr->next != oldest)
          ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
+      if (ptr->next == oldest)
+         ptr->next = oldest->next;
    }
 
-   return &handle->atlas_slots[oldest];
+   return oldest;
 }
 
 static const struct font_glyph *font_renderer_ft_get_glyph(
@@ -121,7 +144,7 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
    {
       if(atlas_slot->charcode == charcode)
       {
-         atlas_slot->last_used = handle->usage_counter++;
+         font_renderer_ft_lru_touch(handle, atlas_slot);
          return &atlas_slot->glyph;
       }
       atlas_slot = atlas_slot->next;
@@ -160,8 +183,10 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
             dst[c] = src[c];
    }
 
-   handle->atlas.dirty = true;
-   atlas_slot->last_used = handle->usage_counter++;
+   font_atlas_mark_dirty(&handle->atlas,
+         atlas_slot->glyph.atlas_offset_x, atlas_slot->glyph.atlas_offset_y,
+         atlas_slot->glyph.width, atlas_slot->glyph.height);
+   font_renderer_ft_lru_touch(handle, atlas_slot);
    return &atlas_slot->glyph;
 }
 
@@ -194,6 +219,7 @@ static bool font_renderer_create_atlas(ft_font_renderer_t *handle, float font_si
       {
          slot->glyph.atlas_offset_x = x * max_width;
          slot->glyph.atlas_offset_y = y * max_height;
+         font_renderer_ft_lru_touch(handle, slot);
          slot++;
       }
    }
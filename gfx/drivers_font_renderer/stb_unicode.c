@@ -46,8 +46,10 @@ typedef struct stb_unicode_atlas_slot
 {
    struct font_glyph glyph;
    unsigned charcode;
-   unsigned last_used;
    struct stb_unicode_atlas_slot* next;
+   /* LRU list, most recently used first. */
+   struct stb_unicode_atlas_slot* lru_prev;
+   struct stb_unicode_atlas_slot* lru_next;
 }stb_unicode_atlas_slot_t;
 
 typedef struct
@@ -63,7 +65,8 @@ typedef struct
    struct font_atlas atlas;
    stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_ATLAS_SIZE];
    stb_unicode_atlas_slot_t* uc_map[0x100];
-   unsigned usage_counter;
+   stb_unicode_atlas_slot_t* lru_head;
+   stb_unicode_atlas_slot_t* lru_tail;
 } stb_unicode_font_renderer_t;
 
 static struct font_atlas *font_renderer_stb_unicode_get_atlas(void *data)
@@ -81,29 +84,49 @@ static void font_renderer_stb_unicode_free(void *data)
    free(self);
 }
 
-static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
+static void font_renderer_stb_unicode_lru_touch(
+      stb_unicode_font_renderer_t *handle, stb_unicode_atlas_slot_t *slot)
 {
-   int i, map_id;
-   unsigned oldest = 0;
+   if (handle->lru_head == slot)
+      return;
+
+   /* unlink */
+   if (slot->lru_prev)
+      slot->lru_prev->lru_next = slot->lru_next;
+   if (slot->lru_next)
+      slot->lru_next->lru_prev = slot->lru_prev;
+   else if (handle->lru_tail == slot)
+      handle->lru_tail = slot->lru_prev;
+
+   /* push to the front */
+   slot->lru_prev   = NULL;
+   slot->lru_next   = handle->lru_head;
+   if (handle->lru_head)
+      handle->lru_head->lru_prev = slot;
+   handle->lru_head = slot;
+   if (!handle->lru_tail)
+      handle->lru_tail = slot;
+}
 
-   for (i = 1; i < STB_UNICODE_ATLAS_SIZE; i++)
-      if((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
+static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
+{
+   int map_id;
+   stb_unicode_atlas_slot_t *oldest = handle->lru_tail;
 
    /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if(handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
+   map_id = oldest->charcode & 0xFF;
+   if(handle->uc_map[map_id] == oldest)
+      handle->uc_map[map_id] = oldest->next;
    else if (handle->uc_map[map_id])
    {
       stb_unicode_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while(ptr->next && ptr->next != &handle->atlas_slots[oldest])
+      while(ptr->next && ptr->next != oldest)
          ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
+      if (ptr->next == oldest)
+         ptr->next = oldest->next;
    }
 
-   return &handle->atlas_slots[oldest];
+   return oldest;
 }
 
 static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
@@ -129,7 +152,7 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
    {
       if(atlas_slot->charcode == charcode)
       {
-         atlas_slot->last_used = self->usage_counter++;
+         font_renderer_stb_unicode_lru_touch(self, atlas_slot);
          return &atlas_slot->glyph;
       }
       atlas_slot = atlas_slot->next;
@@ -160,8 +183,10 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
    atlas_slot->glyph.draw_offset_y  = -y1 * self->scale_factor;
 
 
-   self->atlas.dirty = true;
-   atlas_slot->last_used = self->usage_counter++;
+   font_atlas_mark_dirty(&self->atlas,
+         atlas_slot->glyph.atlas_offset_x, atlas_slot->glyph.atlas_offset_y,
+         atlas_slot->glyph.width, atlas_slot->glyph.height);
+   font_renderer_stb_unicode_lru_touch(self, atlas_slot);
    return &atlas_slot->glyph;
 
 }
@@ -192,6 +217,7 @@ static bool font_renderer_stb_unicode_create_atlas(
       {
          slot->glyph.atlas_offset_x = x * self->max_glyph_width;
          slot->glyph.atlas_offset_y = y * self->max_glyph_height;
+         font_renderer_stb_unicode_lru_touch(self, slot);
          slot++;
       }
    }
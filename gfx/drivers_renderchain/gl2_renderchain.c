@@ -67,6 +67,18 @@ typedef struct __GLsync *GLsync;
 #endif
 #endif
 
+struct gl2_readback_slot
+{
+   bool captured;
+   unsigned polls;
+   unsigned width;
+   unsigned height;
+   GLuint pbo;
+#ifdef HAVE_GL_SYNC
+   GLsync fence;
+#endif
+};
+
 typedef struct gl2_renderchain
 {
    bool egl_images;
@@ -89,6 +101,7 @@ typedef struct gl2_renderchain
 #endif
 
    struct gfx_fbo_scale fbo_scale[GFX_MAX_SHADERS];
+   struct gl2_readback_slot readback[VIDEO_READBACK_SLOTS];
 } gl2_renderchain_t;
 
 #if (!defined(HAVE_OPENGLES) || defined(HAVE_OPENGLES3))
@@ -1418,6 +1431,132 @@ static void gl2_renderchain_readback(
          (GLenum)fmt, (GLenum)type, (GLvoid*)src);
 }
 
+#ifdef HAVE_GL_ASYNC_READBACK
+static bool gl2_renderchain_queue_readback(gl_t *gl,
+      void *chain_data, unsigned slot)
+{
+   gl2_renderchain_t *chain      = (gl2_renderchain_t*)chain_data;
+   struct gl2_readback_slot *rb  = NULL;
+
+   if (!chain || slot >= VIDEO_READBACK_SLOTS)
+      return false;
+
+   rb = &chain->readback[slot];
+
+   if (!rb->pbo)
+      glGenBuffers(1, &rb->pbo);
+
+   rb->width    = gl->vp.width;
+   rb->height   = gl->vp.height;
+   rb->polls    = 0;
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+   glBufferData(GL_PIXEL_PACK_BUFFER,
+         rb->width * rb->height * sizeof(uint32_t),
+         NULL, GL_STREAM_READ);
+   gl2_renderchain_readback(gl, chain, 4, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+#ifdef HAVE_GL_SYNC
+   if (rb->fence)
+      glDeleteSync(rb->fence);
+   rb->fence    = gl->have_sync
+      ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : NULL;
+#endif
+
+   rb->captured = true;
+   return true;
+}
+
+static enum video_readback_status gl2_renderchain_fetch_readback(
+      gl_t *gl, void *chain_data, unsigned slot, uint8_t *buffer,
+      unsigned width, unsigned height)
+{
+   const uint8_t *ptr            = NULL;
+   gl2_renderchain_t *chain      = (gl2_renderchain_t*)chain_data;
+   struct gl2_readback_slot *rb  = NULL;
+
+   if (!chain || slot >= VIDEO_READBACK_SLOTS)
+      return VIDEO_READBACK_FAILED;
+
+   rb = &chain->readback[slot];
+
+   if (!rb->captured || rb->width != width || rb->height != height)
+      return VIDEO_READBACK_FAILED;
+
+#ifdef HAVE_GL_SYNC
+   if (rb->fence)
+   {
+      /* Only poll the fence, never wait on it. The first poll
+       * flushes so the fence is guaranteed to signal. */
+      GLenum ret = glClientWaitSync(rb->fence,
+            rb->polls ? 0 : GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+      rb->polls++;
+
+      if (ret == GL_TIMEOUT_EXPIRED)
+         return VIDEO_READBACK_PENDING;
+
+      glDeleteSync(rb->fence);
+      rb->fence = NULL;
+   }
+   else
+#endif
+   /* Without fences, give the GPU a frame to finish the copy
+    * before mapping the buffer. */
+   if (rb->polls++ < 1)
+      return VIDEO_READBACK_PENDING;
+
+   rb->captured = false;
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+#ifdef HAVE_OPENGLES3
+   ptr = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+         0, width * height * sizeof(uint32_t), GL_MAP_READ_BIT);
+#else
+   ptr = (const uint8_t*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+#endif
+
+   if (!ptr)
+   {
+      RARCH_ERR("[GL]: Failed to map pixel pack buffer.\n");
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      return VIDEO_READBACK_FAILED;
+   }
+
+   video_frame_convert_rgba_to_bgr(ptr, buffer, width * height);
+
+   glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   return VIDEO_READBACK_DONE;
+}
+
+static void gl2_renderchain_readback_free(gl_t *gl, void *chain_data)
+{
+   unsigned i;
+   gl2_renderchain_t *chain = (gl2_renderchain_t*)chain_data;
+
+   if (!chain)
+      return;
+
+   for (i = 0; i < VIDEO_READBACK_SLOTS; i++)
+   {
+      struct gl2_readback_slot *rb = &chain->readback[i];
+
+#ifdef HAVE_GL_SYNC
+      if (rb->fence)
+         glDeleteSync(rb->fence);
+      rb->fence    = NULL;
+#endif
+      if (rb->pbo)
+         glDeleteBuffers(1, &rb->pbo);
+      rb->pbo      = 0;
+      rb->captured = false;
+   }
+}
+#endif
+
 #ifndef HAVE_OPENGLES
 static void gl2_renderchain_fence_iterate(
       void *data,
@@ -1566,4 +1705,13 @@ gl_renderchain_driver_t gl2_renderchain = {
    gl2_renderchain_render,
    gl2_renderchain_resolve_extensions,
    "gl2",
+#ifdef HAVE_GL_ASYNC_READBACK
+   gl2_renderchain_queue_readback,
+   gl2_renderchain_fetch_readback,
+   gl2_renderchain_readback_free,
+#else
+   NULL,
+   NULL,
+   NULL,
+#endif
 };
@@ -24,15 +24,27 @@
 #include <streams/file_stream.h>
 #include <lists/string_list.h>
 #include <string/stdstring.h>
+#include <compat/strl.h>
+#include <rhash.h>
+#include <features/features_cpu.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <unordered_map>
+#include <rthreads/rthreads.h>
+#endif
+
 #include "glslang_util.h"
 #if defined(HAVE_GLSLANG)
 #include <glslang.hpp>
+#include <glslang/Include/revision.h>
 #endif
+#include "../video_shader_parse.h"
+#include "../../configuration.h"
+#include "../../paths.h"
 #include "../../verbosity.h"
 
 using namespace std;
@@ -370,37 +382,363 @@ bool glslang_parse_meta(const vector<string> &lines, glslang_meta *meta)
 
 
 #if defined(HAVE_GLSLANG)
-bool glslang_compile_shader(const char *shader_path, glslang_output *output)
+/* Bump whenever the cache file layout or the way
+ * SPIR-V is generated from the source changes. */
+#define GLSLANG_CACHE_VERSION 1
+#define GLSLANG_CACHE_MAGIC   0x56505352 /* "RSPV" */
+#define GLSLANG_CACHE_HEADER  4
+
+struct glslang_spirv
 {
-   vector<string> lines;
+   vector<uint32_t> vertex;
+   vector<uint32_t> fragment;
+};
 
-   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+#ifdef HAVE_THREADS
+/* SPIR-V compiled ahead of time by glslang_precompile_shaders(),
+ * waiting to be picked up by glslang_compile_shader(). */
+static slock_t *glslang_cache_lock = NULL;
+static unordered_map<string, glslang_spirv> glslang_cache;
+#endif
 
-   if (!glslang_read_shader_file(shader_path, &lines, true))
+/**
+ * glslang_cache_key:
+ * @lines                  : Shader source with all includes resolved.
+ * @key                    : Output, hex string of at least 65 bytes.
+ *
+ * Hashes the preprocessed source together with the compiler
+ * revision, so a glslang update invalidates old entries.
+ **/
+static void glslang_cache_key(const vector<string> &lines, char *key)
+{
+   string src;
+
+   src  = GLSLANG_REVISION;
+   src += '\n';
+   src += to_string(GLSLANG_CACHE_VERSION);
+   src += '\n';
+
+   for (auto &line : lines)
+   {
+      src += line;
+      src += '\n';
+   }
+
+   sha256_hash(key, (const uint8_t*)src.data(), src.size());
+}
+
+/**
+ * glslang_cache_path:
+ * @key                    : Cache key from glslang_cache_key().
+ * @path                   : Output, path of the cache entry.
+ * @len                    : Size of @path.
+ *
+ * Entries live in <cache directory>/slang. The cache directory
+ * is unset by default on desktop, so fall back to
+ * <config directory>/cache/slang in that case.
+ *
+ * Returns: true if the cache directory exists or was created.
+ **/
+static bool glslang_cache_path(const char *key, char *path, size_t len)
+{
+   char dir[PATH_MAX_LENGTH];
+   settings_t *settings = config_get_ptr();
+
+   dir[0] = '\0';
+
+   if (settings && !string_is_empty(settings->paths.directory_cache))
+      fill_pathname_join(dir, settings->paths.directory_cache,
+            "slang", sizeof(dir));
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+   {
+      char base[PATH_MAX_LENGTH];
+
+      base[0] = '\0';
+
+      fill_pathname_basedir(base, path_get(RARCH_PATH_CONFIG), sizeof(base));
+      fill_pathname_join(dir, base, "cache", sizeof(dir));
+      fill_pathname_join(dir, dir, "slang", sizeof(dir));
+   }
+
+   if (string_is_empty(dir))
       return false;
 
-   if (!glslang_parse_meta(lines, &output->meta))
+   if (!path_is_directory(dir) && !path_mkdir(dir) && !path_is_directory(dir))
       return false;
 
+   fill_pathname_join(path, dir, key, len);
+   strlcat(path, ".spv", len);
+   return true;
+}
+
+static bool glslang_cache_load(const char *key, glslang_spirv *spirv)
+{
+   uint32_t header[GLSLANG_CACHE_HEADER];
+   char path[PATH_MAX_LENGTH];
+   void *buf   = NULL;
+   int64_t len = 0;
+   bool ret    = false;
+
+   path[0]     = '\0';
+
+   if (!glslang_cache_path(key, path, sizeof(path)) || !filestream_exists(path))
+      return false;
+
+   if (!filestream_read_file(path, &buf, &len))
+      return false;
+
+   if (len >= (int64_t)sizeof(header))
+   {
+      const uint32_t *words = (const uint32_t*)buf + GLSLANG_CACHE_HEADER;
+
+      memcpy(header, buf, sizeof(header));
+
+      if (     header[0] == GLSLANG_CACHE_MAGIC
+            && header[1] == GLSLANG_CACHE_VERSION
+            && header[2] && header[3]
+            && len == (int64_t)(sizeof(header) +
+               ((uint64_t)header[2] + header[3]) * sizeof(uint32_t)))
+      {
+         spirv->vertex.assign(words, words + header[2]);
+         spirv->fragment.assign(words + header[2],
+               words + header[2] + header[3]);
+         ret = true;
+      }
+   }
+
+   free(buf);
+
+   if (!ret)
+      RARCH_WARN("[slang]: Ignoring invalid cache entry \"%s\".\n", path);
+
+   return ret;
+}
+
+static void glslang_cache_save(const char *key, const glslang_spirv *spirv)
+{
+   vector<uint32_t> data;
+   char path[PATH_MAX_LENGTH];
+   char tmp[PATH_MAX_LENGTH];
+
+   path[0] = tmp[0] = '\0';
+
+   if (!glslang_cache_path(key, path, sizeof(path)))
+      return;
+
+   data.reserve(GLSLANG_CACHE_HEADER
+         + spirv->vertex.size() + spirv->fragment.size());
+   data.push_back(GLSLANG_CACHE_MAGIC);
+   data.push_back(GLSLANG_CACHE_VERSION);
+   data.push_back((uint32_t)spirv->vertex.size());
+   data.push_back((uint32_t)spirv->fragment.size());
+   data.insert(data.end(), spirv->vertex.begin(), spirv->vertex.end());
+   data.insert(data.end(), spirv->fragment.begin(), spirv->fragment.end());
+
+   /* Write to a temporary file first so that another instance
+    * never sees a partially written entry. */
+   snprintf(tmp, sizeof(tmp), "%s.%p.tmp", path, (const void*)spirv);
+
+   if (!filestream_write_file(tmp, data.data(),
+            data.size() * sizeof(uint32_t)))
+      return;
+
+   if (filestream_rename(tmp, path) != 0)
+      filestream_delete(tmp);
+}
+
+/**
+ * glslang_compile_spirv_cached:
+ * @lines                  : Shader source with all includes resolved.
+ * @spirv                  : Output.
+ * @precompile             : Keep the result in memory for a later
+ *                           glslang_compile_shader() call.
+ * @compiled               : Set to true if glslang ran on this thread.
+ *
+ * Looks the source up in the SPIR-V cache and only runs glslang
+ * on a cache miss.
+ *
+ * Returns: true on success, false if the shader failed to compile.
+ **/
+static bool glslang_compile_spirv_cached(const vector<string> &lines,
+      glslang_spirv *spirv, bool precompile, bool *compiled)
+{
+   char key[65];
+
+   glslang_cache_key(lines, key);
+
+#ifdef HAVE_THREADS
+   if (glslang_cache_lock)
+   {
+      bool found = false;
+
+      slock_lock(glslang_cache_lock);
+      auto itr = glslang_cache.find(key);
+      if (itr != glslang_cache.end())
+      {
+         if (!precompile)
+         {
+            *spirv = move(itr->second);
+            glslang_cache.erase(itr);
+         }
+         found = true;
+      }
+      slock_unlock(glslang_cache_lock);
+
+      if (found)
+         return true;
+   }
+#endif
+
+   if (glslang_cache_load(key, spirv))
+      return true;
+
+   *compiled = true;
+
    if (    !glslang::compile_spirv(build_stage_source(lines, "vertex"),
-            glslang::StageVertex, &output->vertex))
+            glslang::StageVertex, &spirv->vertex))
    {
       RARCH_ERR("Failed to compile vertex shader stage.\n");
       return false;
    }
 
    if (    !glslang::compile_spirv(build_stage_source(lines, "fragment"),
-            glslang::StageFragment, &output->fragment))
+            glslang::StageFragment, &spirv->fragment))
    {
       RARCH_ERR("Failed to compile fragment shader stage.\n");
       return false;
    }
 
+   glslang_cache_save(key, spirv);
+
+#ifdef HAVE_THREADS
+   if (precompile && glslang_cache_lock)
+   {
+      slock_lock(glslang_cache_lock);
+      glslang_cache[key] = *spirv;
+      slock_unlock(glslang_cache_lock);
+   }
+#endif
+
    return true;
 }
+
+bool glslang_compile_shader(const char *shader_path, glslang_output *output)
+{
+   glslang_spirv spirv;
+   vector<string> lines;
+   bool compiled = false;
+
+   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+
+   if (!glslang_read_shader_file(shader_path, &lines, true))
+      return false;
+
+   if (!glslang_parse_meta(lines, &output->meta))
+      return false;
+
+   if (!glslang_compile_spirv_cached(lines, &spirv, false, &compiled))
+      return false;
+
+   output->vertex   = move(spirv.vertex);
+   output->fragment = move(spirv.fragment);
+   return true;
+}
+
+#ifdef HAVE_THREADS
+struct glslang_precompile_state
+{
+   const char **paths;
+   unsigned count;
+   unsigned next;
+   slock_t *lock;
+};
+
+static void glslang_precompile_thread(void *data)
+{
+   glslang_precompile_state *state = (glslang_precompile_state*)data;
+   bool compiled                   = false;
+
+   for (;;)
+   {
+      glslang_spirv spirv;
+      vector<string> lines;
+      unsigned index;
+
+      slock_lock(state->lock);
+      index = state->next++;
+      slock_unlock(state->lock);
+
+      if (index >= state->count)
+         break;
+
+      /* Errors are reported again by the glslang_compile_shader()
+       * call that follows, so just skip failing passes here. */
+      if (glslang_read_shader_file(state->paths[index], &lines, true))
+         glslang_compile_spirv_cached(lines, &spirv, true, &compiled);
+   }
+
+   /* The thread's pool only exists if glslang ran on it, which
+    * it doesn't when every pass came from the disk cache. */
+   if (compiled)
+      glslang::finalize_thread();
+}
+#endif
+
+void glslang_precompile_shaders(const char **paths, unsigned count)
+{
+#ifdef HAVE_THREADS
+   unsigned i;
+   glslang_precompile_state state;
+   sthread_t *threads[GFX_MAX_SHADERS];
+   unsigned num_threads = cpu_features_get_core_amount();
+
+   if (num_threads > count)
+      num_threads = count;
+   if (num_threads > GFX_MAX_SHADERS)
+      num_threads = GFX_MAX_SHADERS;
+
+   /* Not worth spinning up threads for a single pass. */
+   if (num_threads < 2)
+      return;
+
+   if (!glslang_cache_lock)
+      glslang_cache_lock = slock_new();
+   if (!glslang_cache_lock)
+      return;
+
+   /* Drop anything left over from a preset that failed to load. */
+   slock_lock(glslang_cache_lock);
+   glslang_cache.clear();
+   slock_unlock(glslang_cache_lock);
+
+   state.paths = paths;
+   state.count = count;
+   state.next  = 0;
+   state.lock  = slock_new();
+
+   if (!state.lock)
+      return;
+
+   RARCH_LOG("[slang]: Compiling %u passes on %u threads.\n",
+         count, num_threads);
+
+   for (i = 0; i < num_threads; i++)
+      threads[i] = sthread_create(glslang_precompile_thread, &state);
+
+   for (i = 0; i < num_threads; i++)
+      if (threads[i])
+         sthread_join(threads[i]);
+
+   slock_free(state.lock);
+#endif
+}
 #else
 bool glslang_compile_shader(const char *shader_path, glslang_output *output)
 {
    return false;
 }
+
+void glslang_precompile_shaders(const char **paths, unsigned count)
+{
+}
 #endif
@@ -105,6 +105,11 @@ struct glslang_output
 
 bool glslang_compile_shader(const char *shader_path, glslang_output *output);
 
+/* Compiles the given shaders on worker threads, so that the
+ * glslang_compile_shader() calls that follow only have to pick
+ * up the results. */
+void glslang_precompile_shaders(const char **paths, unsigned count);
+
 /* Helpers for internal use. */
 bool glslang_read_shader_file(const char *path, std::vector<std::string> *output, bool root_file);
 bool glslang_parse_meta(const std::vector<std::string> &lines, glslang_meta *meta);
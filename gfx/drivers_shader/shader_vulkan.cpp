@@ -2825,6 +2825,13 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
 
    shader->num_parameters = 0;
 
+   {
+      const char *paths[GFX_MAX_SHADERS];
+      for (i = 0; i < shader->passes; i++)
+         paths[i] = shader->pass[i].source.path;
+      glslang_precompile_shaders(paths, shader->passes);
+   }
+
    for (i = 0; i < shader->passes; i++)
    {
       glslang_output output;
@@ -338,6 +338,17 @@ static bool slang_process_reflection(
    return true;
 }
 
+void slang_precompile(const video_shader *shader_info)
+{
+   unsigned i;
+   const char *paths[GFX_MAX_SHADERS];
+
+   for (i = 0; i < shader_info->passes; i++)
+      paths[i] = shader_info->pass[i].source.path;
+
+   glslang_precompile_shaders(paths, shader_info->passes);
+}
+
 bool slang_process(
       video_shader*          shader_info,
       unsigned               pass_number,
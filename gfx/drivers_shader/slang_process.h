@@ -84,6 +84,10 @@ typedef struct
 
 RETRO_BEGIN_DECLS
 
+/* Compiles all passes of a preset in parallel ahead of the
+ * slang_process() calls. */
+void slang_precompile(const struct video_shader *shader_info);
+
 bool slang_process(
       struct video_shader*   shader_info,
       unsigned               pass_number,
@@ -16,6 +16,8 @@
 
 #include <stdlib.h>
 
+#include <retro_miscellaneous.h>
+
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
 #endif
@@ -81,6 +83,55 @@ int font_renderer_create_default(const void **data, void **handle,
    return 0;
 }
 
+/**
+ * font_atlas_mark_dirty:
+ * @atlas                 : Font atlas.
+ * @x                     : Left edge of the written region.
+ * @y                     : Top edge of the written region.
+ * @width                 : Width of the written region.
+ * @height                : Height of the written region.
+ *
+ * Flags the atlas dirty and grows its dirty rectangle to cover
+ * the given region, so drivers can upload only what changed.
+ * Also bumps the atlas generation, invalidating cached layouts.
+ **/
+void font_atlas_mark_dirty(struct font_atlas *atlas,
+      unsigned x, unsigned y, unsigned width, unsigned height)
+{
+   unsigned x1, y1;
+
+   if (!atlas)
+      return;
+
+   /* Even a blank glyph may have taken over another glyph's slot. */
+   atlas->generation++;
+
+   if (!width || !height)
+      return;
+
+   if (!atlas->dirty)
+   {
+      atlas->dirty_x      = x;
+      atlas->dirty_y      = y;
+      atlas->dirty_width  = width;
+      atlas->dirty_height = height;
+      atlas->dirty        = true;
+      return;
+   }
+
+   /* A zero-sized rectangle already covers the whole atlas. */
+   if (!atlas->dirty_width || !atlas->dirty_height)
+      return;
+
+   x1 = MAX(atlas->dirty_x + atlas->dirty_width,  x + width);
+   y1 = MAX(atlas->dirty_y + atlas->dirty_height, y + height);
+
+   atlas->dirty_x      = MIN(atlas->dirty_x, x);
+   atlas->dirty_y      = MIN(atlas->dirty_y, y);
+   atlas->dirty_width  = x1 - atlas->dirty_x;
+   atlas->dirty_height = y1 - atlas->dirty_y;
+}
+
 #ifdef HAVE_D3D8
 static const font_renderer_t *d3d8_font_backends[] = {
 #if defined(_XBOX1)
@@ -842,6 +893,19 @@ static char* font_driver_reshape_msg(const char* msg)
 
    return (char*)buffer;
 }
+
+/* Reshaping only ever touches RTL runs, so messages without
+ * any can be drawn as-is without copying them first. */
+static bool font_driver_msg_needs_reshape(const char *msg)
+{
+   const unsigned char *src = (const unsigned char*)msg;
+
+   for (; *src; src++)
+      if (IS_RTL(src))
+         return true;
+
+   return false;
+}
 #endif
 
 void font_driver_render_msg(
@@ -856,7 +920,8 @@ void font_driver_render_msg(
    if (msg && *msg && font && font->renderer && font->renderer->render_msg)
    {
 #ifdef HAVE_LANGEXTRA
-      char *new_msg = font_driver_reshape_msg(msg);
+      bool  reshape = font_driver_msg_needs_reshape(msg);
+      char *new_msg = reshape ? font_driver_reshape_msg(msg) : (char*)msg;
 #else
       char *new_msg = (char*)msg;
 #endif
@@ -864,7 +929,8 @@ void font_driver_render_msg(
       font->renderer->render_msg(video_info,
             font->renderer_data, new_msg, params);
 #ifdef HAVE_LANGEXTRA
-      free(new_msg);
+      if (reshape)
+         free(new_msg);
 #endif
    }
 }
@@ -58,6 +58,15 @@ struct font_atlas
    uint8_t *buffer; /* Alpha channel. */
    unsigned width;
    unsigned height;
+   /* Bounding box of the texels written since dirty was
+    * last cleared. A zero-sized box means the whole atlas. */
+   unsigned dirty_x;
+   unsigned dirty_y;
+   unsigned dirty_width;
+   unsigned dirty_height;
+   /* Bumped whenever atlas contents change, so cached
+    * glyph layouts know when they have gone stale. */
+   unsigned generation;
    bool dirty;
 };
 
@@ -127,6 +136,9 @@ typedef struct
 int font_renderer_create_default(const void **driver,
       void **handle, const char *font_path, unsigned font_size);
 
+void font_atlas_mark_dirty(struct font_atlas *atlas,
+      unsigned x, unsigned y, unsigned width, unsigned height);
+
 void font_driver_render_msg(video_frame_info_t *video_info,
       void *font_data, const char *msg, const struct font_params *params);
 
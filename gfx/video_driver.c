@@ -65,6 +65,7 @@
 #include "../core.h"
 #include "../command.h"
 #include "../msg_hash.h"
+#include "../performance_counters.h"
 #include "../verbosity.h"
 
 #define MEASURE_FRAME_TIME_SAMPLES_COUNT (2 * 1024)
@@ -208,6 +209,21 @@ static bool video_driver_cache_context                   = false;
 static bool video_driver_cache_context_ack               = false;
 static uint8_t *video_driver_record_gpu_buffer           = NULL;
 
+struct video_readback
+{
+   video_readback_cb_t cb;
+   void *userdata;
+   uint8_t *buffer;
+   unsigned width;
+   unsigned height;
+};
+
+/* FIFO of asynchronous viewport readbacks. Entry i is stored in
+ * driver slot (video_driver_readback_head + i) % VIDEO_READBACK_SLOTS. */
+static struct video_readback video_driver_readbacks[VIDEO_READBACK_SLOTS];
+static unsigned video_driver_readback_head               = 0;
+static unsigned video_driver_readback_count              = 0;
+
 #ifdef HAVE_THREADS
 static slock_t *display_lock                             = NULL;
 static slock_t *context_lock                             = NULL;
@@ -828,6 +844,73 @@ static void video_driver_pixel_converter_free(void)
    video_driver_scaler_ptr             = NULL;
 }
 
+/**
+ * video_driver_readback_pop:
+ * @status                 : Result of the readback at the head
+ *                           of the queue.
+ *
+ * Removes the oldest readback from the queue and hands its
+ * result to the completion callback.
+ **/
+static void video_driver_readback_pop(enum video_readback_status status)
+{
+   struct video_readback rb =
+      video_driver_readbacks[video_driver_readback_head];
+
+   /* Update the queue first so the callback may queue another
+    * readback right away. */
+   memset(&video_driver_readbacks[video_driver_readback_head], 0,
+         sizeof(rb));
+   video_driver_readback_head  =
+      (video_driver_readback_head + 1) % VIDEO_READBACK_SLOTS;
+   video_driver_readback_count--;
+
+   if (status != VIDEO_READBACK_DONE)
+   {
+      free(rb.buffer);
+      rb.buffer = NULL;
+   }
+
+   rb.cb(rb.userdata, rb.buffer, rb.width, rb.height, rb.width * 3);
+}
+
+/**
+ * video_driver_readback_poll:
+ *
+ * Delivers every asynchronous readback the GPU has finished,
+ * in the order they were queued. Never blocks.
+ **/
+static void video_driver_readback_poll(void)
+{
+   while (video_driver_readback_count)
+   {
+      struct video_readback *rb  =
+         &video_driver_readbacks[video_driver_readback_head];
+      enum video_readback_status status =
+         current_video->fetch_readback(video_driver_data,
+               video_driver_readback_head, rb->buffer,
+               rb->width, rb->height);
+
+      if (status == VIDEO_READBACK_PENDING)
+         break;
+
+      video_driver_readback_pop(status);
+   }
+}
+
+/**
+ * video_driver_readback_cancel:
+ *
+ * Cancels all pending asynchronous readbacks, calling their
+ * completion callbacks with a NULL buffer.
+ **/
+static void video_driver_readback_cancel(void)
+{
+   while (video_driver_readback_count)
+      video_driver_readback_pop(VIDEO_READBACK_FAILED);
+   video_driver_readback_head = 0;
+}
+
 static void video_driver_free_internal(void)
 {
 #ifdef HAVE_THREADS
@@ -845,6 +928,8 @@ static void video_driver_free_internal(void)
       )
       input_driver_deinit();
 
+   video_driver_readback_cancel();
+
    if (
          !video_driver_data_own
          && video_driver_data
@@ -2010,6 +2095,50 @@ bool video_driver_read_viewport(uint8_t *buffer, bool is_idle)
    return false;
 }
 
+bool video_driver_read_viewport_async(video_readback_cb_t cb,
+      void *userdata)
+{
+   unsigned slot;
+   struct video_viewport vp;
+   struct video_readback *rb = NULL;
+
+   if (     !cb
+         || !current_video
+         || !current_video->queue_readback
+         || !current_video->fetch_readback
+         || video_driver_readback_count >= VIDEO_READBACK_SLOTS)
+      return false;
+
+   vp.width  = 0;
+   vp.height = 0;
+
+   if (!video_driver_get_viewport_info(&vp) || !vp.width || !vp.height)
+      return false;
+
+   slot      = (video_driver_readback_head + video_driver_readback_count)
+      % VIDEO_READBACK_SLOTS;
+   rb        = &video_driver_readbacks[slot];
+
+   rb->buffer = (uint8_t*)malloc(vp.width * vp.height * 3);
+   if (!rb->buffer)
+      return false;
+
+   if (!current_video->queue_readback(video_driver_data, slot))
+   {
+      free(rb->buffer);
+      rb->buffer = NULL;
+      return false;
+   }
+
+   rb->cb       = cb;
+   rb->userdata = userdata;
+   rb->width    = vp.width;
+   rb->height   = vp.height;
+
+   video_driver_readback_count++;
+   return true;
+}
+
 
 bool video_driver_frame_filter_alive(void)
 {
@@ -2427,6 +2556,11 @@ void video_driver_frame(const void *data, unsigned width,
          (MEASURE_FRAME_TIME_SAMPLES_COUNT - 1);
       frame_time                                   = new_time - fps_time;
       video_driver_frame_time_samples[write_index] = frame_time;
+
+      if (video_info.is_perfcnt_enable)
+         performance_section_add(PERF_SECTION_FRAME_TIME,
+               fps_time, new_time - fps_time);
+
       fps_time                                     = new_time;
 
       if (video_driver_frame_count == 1)
@@ -2593,6 +2727,22 @@ void video_driver_frame(const void *data, unsigned width,
             av_info->timing.fps,
             av_info->timing.sample_rate);
 
+#ifdef HAVE_MENU
+      if (video_info.menu_is_alive)
+      {
+         char menu_stats[128];
+         menu_display_draw_stats_t draw_stats;
+
+         menu_display_get_draw_stats(&draw_stats);
+
+         snprintf(menu_stats, sizeof(menu_stats),
+               "Menu Statistics:\n -Draws: %u\n -Draw calls: %u\n",
+               draw_stats.draws, draw_stats.draw_calls);
+         strlcat(video_info.stat_text, menu_stats,
+               sizeof(video_info.stat_text));
+      }
+#endif
+
       /* TODO/FIXME - add OSD chat text here */
 #if 0
       snprintf(video_info.chat_text, sizeof(video_info.chat_text),
@@ -2600,13 +2750,20 @@ void video_driver_frame(const void *data, unsigned width,
 #endif
    }
 
+   performance_section_begin(PERF_SECTION_VIDEO_FRAME);
+
    video_driver_active = current_video->frame(
          video_driver_data, data, width, height,
          video_driver_frame_count,
          (unsigned)pitch, video_driver_msg, &video_info);
 
+   performance_section_end(PERF_SECTION_VIDEO_FRAME);
+
    video_driver_frame_count++;
 
+   if (video_driver_readback_count)
+      video_driver_readback_poll();
+
    /* Display the FPS, with a higher priority. */
    if (video_info.fps_show)
       runloop_msg_queue_push(video_info.fps_text, 2, 1, true);
@@ -2703,6 +2860,13 @@ static bool video_driver_cb_set_coords(void *handle_data,
    return true;
 }
 
+static void video_driver_swap_buffers(void *data, void *video_info)
+{
+   performance_section_begin(PERF_SECTION_VSYNC_WAIT);
+   current_video_context.swap_buffers(data, video_info);
+   performance_section_end(PERF_SECTION_VSYNC_WAIT);
+}
+
 void video_driver_build_info(video_frame_info_t *video_info)
 {
    bool is_perfcnt_enable            = false;
@@ -2806,7 +2970,8 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->shader_data            = current_shader_data;
 
    video_info->cb_update_window_title = current_video_context.update_window_title;
-   video_info->cb_swap_buffers        = current_video_context.swap_buffers;
+   video_info->cb_swap_buffers        = current_video_context.swap_buffers ?
+      video_driver_swap_buffers : NULL;
    video_info->cb_get_metrics         = current_video_context.get_metrics;
    video_info->cb_set_resize          = current_video_context.set_resize;
 
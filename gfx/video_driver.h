@@ -457,7 +457,7 @@ typedef struct video_frame_info
    float xmb_alpha_factor;
 
    char fps_text[128];
-   char stat_text[512];
+   char stat_text[1024];
    char chat_text[256];
 
    uint64_t frame_count;
@@ -750,6 +750,25 @@ typedef bool (*video_driver_frame_t)(void *data,
       unsigned height, uint64_t frame_count,
       unsigned pitch, const char *msg, video_frame_info_t *video_info);
 
+/* Number of asynchronous viewport readbacks that can be
+ * in flight at the same time. */
+#define VIDEO_READBACK_SLOTS 4
+
+enum video_readback_status
+{
+   VIDEO_READBACK_PENDING = 0,
+   VIDEO_READBACK_DONE,
+   VIDEO_READBACK_FAILED
+};
+
+/* Completion callback for video_driver_read_viewport_async().
+ * On success, bgr24 points to a bottom-up BGR24 image (the same
+ * layout video_driver_read_viewport() produces) which is owned
+ * by the callback and must be passed to free().
+ * On failure or cancellation bgr24 is NULL. */
+typedef void (*video_readback_cb_t)(void *userdata, uint8_t *bgr24,
+      unsigned width, unsigned height, unsigned pitch);
+
 typedef struct video_driver
 {
    /* Should the video driver act as an input driver as well?
@@ -823,6 +842,19 @@ typedef struct video_driver
 #endif
    void (*poke_interface)(void *data, const video_poke_interface_t **iface);
    unsigned (*wrap_type_to_enum)(enum gfx_wrap_type type);
+
+   /* Optional. Schedules a copy of the viewport of the next
+    * rendered frame into readback slot 'slot' without waiting
+    * for the GPU. */
+   bool (*queue_readback)(void *data, unsigned slot);
+
+   /* Optional. Polls readback slot 'slot'. Returns
+    * VIDEO_READBACK_PENDING while the GPU is still busy,
+    * otherwise converts the result into buffer
+    * (BGR24, bottom-up) and releases the slot. */
+   enum video_readback_status (*fetch_readback)(void *data,
+         unsigned slot, uint8_t *buffer,
+         unsigned width, unsigned height);
 } video_driver_t;
 
 
@@ -862,6 +894,23 @@ void video_driver_set_nonblock_state(bool toggle);
 bool video_driver_find_driver(void);
 void video_driver_apply_state_changes(void);
 bool video_driver_read_viewport(uint8_t *buffer, bool is_idle);
+
+/**
+ * video_driver_read_viewport_async:
+ * @cb                     : Completion callback.
+ * @userdata               : User data passed to @cb.
+ *
+ * Queues a readback of the viewport of the next rendered frame.
+ * @cb is invoked from the main thread a few frames later, once
+ * the GPU has finished the copy, so the pipeline never stalls.
+ *
+ * Returns: true if the readback was queued, false if the
+ * driver has no asynchronous readback support or all slots
+ * are busy. The caller should then fall back to
+ * video_driver_read_viewport().
+ **/
+bool video_driver_read_viewport_async(video_readback_cb_t cb,
+      void *userdata);
 bool video_driver_cached_frame(void);
 bool video_driver_frame_filter_alive(void);
 bool video_driver_frame_filter_is_32bit(void);
@@ -59,6 +59,7 @@
 #include "../retroarch.h"
 #include "../movie.h"
 #include "../list_special.h"
+#include "../performance_counters.h"
 #include "../verbosity.h"
 #include "../tasks/tasks_internal.h"
 #include "../command.h"
@@ -407,6 +408,32 @@ static bool input_driver_data_own                 = false;
 static float input_driver_axis_threshold          = 0.0f;
 static unsigned input_driver_max_users            = 0;
 
+/* Per-port joypad and analog results of input_state(), resolved
+ * at most once between two calls to input_poll(). Turbo and BSV
+ * recording still run on every query. */
+typedef struct input_state_cache
+{
+   uint16_t joypad_valid;
+   uint8_t  analog_valid;
+   int16_t  joypad[RETRO_DEVICE_ID_JOYPAD_R3 + 1];
+   int16_t  analog[2][2];
+} input_state_cache_t;
+
+static input_state_cache_t input_driver_state_cache[MAX_USERS];
+
+/* Binds that have at least one physical source (key, mouse
+ * button, joypad button or axis), per user bind set and per
+ * autoconfig slot. Rebuilt lazily after binds change, so that
+ * hotkey scans only query the driver for binds that can fire. */
+static input_bits_t input_driver_config_bound[MAX_USERS];
+static input_bits_t input_driver_autoconf_bound[MAX_USERS];
+/* Bumped after binds are written, possibly from the task thread
+ * while autoconfiguring. A rebuild records the generation it
+ * started from, so a write that lands during the rebuild is
+ * picked up by the next one. */
+static unsigned input_driver_binds_generation     = 1;
+static unsigned input_driver_bound_generation     = 0;
+
 #ifdef HAVE_HID
 static const void *hid_data                       = NULL;
 #endif
@@ -586,7 +613,11 @@ void input_poll(void)
    settings_t *settings           = config_get_ptr();
    uint8_t max_users              = (uint8_t)input_driver_max_users;
 
+   performance_section_begin(PERF_SECTION_INPUT_POLL);
    current_input->poll(current_input_data);
+   performance_section_end(PERF_SECTION_INPUT_POLL);
+
+   input_driver_state_cache_invalidate();
 
    input_driver_turbo_btns.count++;
 
@@ -637,19 +668,19 @@ void input_poll(void)
 }
 
 /**
- * input_state:
+ * input_state_resolve:
  * @port                 : user number.
  * @device               : device identifier of user.
  * @idx                  : index value of user.
  * @id                   : identifier of key pressed by user.
  *
- * Input state callback function.
+ * Runs the remap, overlay, network gamepad, driver and
+ * mapper chain for one input, before turbo is applied.
  *
- * Returns: Non-zero if the given key (identified by @id)
- * was pressed by the user (assigned to @port).
+ * Returns: resolved state of the given input.
  **/
-int16_t input_state(unsigned port, unsigned device,
-      unsigned idx, unsigned id)
+static int16_t input_state_resolve(settings_t *settings,
+      unsigned port, unsigned device, unsigned idx, unsigned id)
 {
    int16_t res = 0, res_overlay = 0;
 
@@ -657,84 +688,177 @@ int16_t input_state(unsigned port, unsigned device,
       is in action for that button*/
    bool reset_state  = false;
 
-   device &= RETRO_DEVICE_MASK;
-
-   if (bsv_movie_is_playback_on())
+   if (settings->bools.input_remap_binds_enable)
    {
-      int16_t bsv_result;
-      if (bsv_movie_get_input(&bsv_result))
-         return bsv_result;
-
-      bsv_movie_ctl(BSV_MOVIE_CTL_SET_END, NULL);
-   }
-
-   if (     !input_driver_flushing_input
-         && !input_driver_block_libretro_input)
-   {
-      settings_t *settings = config_get_ptr();
-
-      if (settings->bools.input_remap_binds_enable)
+      switch (device)
       {
-         switch (device)
-         {
-            case RETRO_DEVICE_JOYPAD:
-               if (id != settings->uints.input_remap_ids[port][id])
+         case RETRO_DEVICE_JOYPAD:
+            if (id != settings->uints.input_remap_ids[port][id])
+               reset_state = true;
+            break;
+         case RETRO_DEVICE_ANALOG:
+            if (idx < 2 && id < 2)
+            {
+               unsigned offset = RARCH_FIRST_CUSTOM_BIND + (idx * 4) + (id * 2);
+               if (settings->uints.input_remap_ids[port][offset]   != offset)
                   reset_state = true;
-               break;
-            case RETRO_DEVICE_ANALOG:
-               if (idx < 2 && id < 2)
-               {
-                  unsigned offset = RARCH_FIRST_CUSTOM_BIND + (idx * 4) + (id * 2);
-                  if (settings->uints.input_remap_ids[port][offset]   != offset)
-                     reset_state = true;
-                  if (settings->uints.input_remap_ids[port][offset+1] != (offset+1))
-                     reset_state = true;
-               }
-               break;
-         }
+               if (settings->uints.input_remap_ids[port][offset+1] != (offset+1))
+                  reset_state = true;
+            }
+            break;
       }
+   }
 
 #ifdef HAVE_OVERLAY
-      if (overlay_ptr)
-         input_state_overlay(overlay_ptr, &res_overlay, port, device, idx, id);
+   if (overlay_ptr)
+      input_state_overlay(overlay_ptr, &res_overlay, port, device, idx, id);
 #endif
 
 #ifdef HAVE_NETWORKGAMEPAD
-      if (input_driver_remote)
-         input_remote_state(&res, port, device, idx, id);
+   if (input_driver_remote)
+      input_remote_state(&res, port, device, idx, id);
 #endif
 
-      if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
+   if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
+   {
+      bool bind_valid = libretro_input_binds[port] && libretro_input_binds[port][id].valid;
+
+      if (bind_valid || device == RETRO_DEVICE_KEYBOARD)
       {
-         bool bind_valid = libretro_input_binds[port] && libretro_input_binds[port][id].valid;
+         rarch_joypad_info_t joypad_info;
+         joypad_info.axis_threshold = input_driver_axis_threshold;
+         joypad_info.joy_idx        = settings->uints.input_joypad_map[port];
+         joypad_info.auto_binds     = input_autoconf_binds[joypad_info.joy_idx];
 
-         if (bind_valid || device == RETRO_DEVICE_KEYBOARD)
+         if (!reset_state)
          {
-            rarch_joypad_info_t joypad_info;
-            joypad_info.axis_threshold = input_driver_axis_threshold;
-            joypad_info.joy_idx        = settings->uints.input_joypad_map[port];
-            joypad_info.auto_binds     = input_autoconf_binds[joypad_info.joy_idx];
-
-            if (!reset_state)
-            {
-               res = current_input->input_state(
-                     current_input_data, joypad_info, libretro_input_binds, port, device, idx, id);
+            res = current_input->input_state(
+                  current_input_data, joypad_info, libretro_input_binds, port, device, idx, id);
 
 #ifdef HAVE_OVERLAY
-               if (input_overlay_is_alive(overlay_ptr) && port == 0)
-                  res |= res_overlay;
+            if (input_overlay_is_alive(overlay_ptr) && port == 0)
+               res |= res_overlay;
 #endif
-            }
-            else
-               res = 0;
          }
+         else
+            res = 0;
       }
+   }
 
-      if (settings->bools.input_remap_binds_enable && input_driver_mapper)
-         input_mapper_state(input_driver_mapper,
-               &res, port, device, idx, id);
+   if (settings->bools.input_remap_binds_enable && input_driver_mapper)
+      input_mapper_state(input_driver_mapper,
+            &res, port, device, idx, id);
 
+   return res;
+}
 
+/**
+ * input_state_cached:
+ * @port                 : user number.
+ * @device               : device identifier of user.
+ * @idx                  : index value of user.
+ * @id                   : identifier of key pressed by user.
+ *
+ * Serves RetroPad buttons and analog sticks from the per-poll
+ * snapshot, resolving each entry on its first query after
+ * input_poll(). Other devices are always resolved.
+ *
+ * Returns: resolved state of the given input.
+ **/
+static int16_t input_state_cached(settings_t *settings,
+      unsigned port, unsigned device, unsigned idx, unsigned id)
+{
+   input_state_cache_t *cache = NULL;
+
+   if (port >= MAX_USERS)
+      return input_state_resolve(settings, port, device, idx, id);
+
+   cache = &input_driver_state_cache[port];
+
+   switch (device)
+   {
+      case RETRO_DEVICE_JOYPAD:
+         if (id <= RETRO_DEVICE_ID_JOYPAD_R3)
+         {
+            uint16_t bit = (uint16_t)(1 << id);
+            if (!(cache->joypad_valid & bit))
+            {
+               cache->joypad[id]    = input_state_resolve(
+                     settings, port, device, idx, id);
+               cache->joypad_valid |= bit;
+            }
+            return cache->joypad[id];
+         }
+         break;
+      case RETRO_DEVICE_ANALOG:
+         if (idx < 2 && id < 2)
+         {
+            uint8_t bit = (uint8_t)(1 << ((idx << 1) | id));
+            if (!(cache->analog_valid & bit))
+            {
+               cache->analog[idx][id] = input_state_resolve(
+                     settings, port, device, idx, id);
+               cache->analog_valid   |= bit;
+            }
+            return cache->analog[idx][id];
+         }
+         break;
+   }
+
+   return input_state_resolve(settings, port, device, idx, id);
+}
+
+/**
+ * input_driver_state_cache_invalidate:
+ *
+ * Drops the per-poll input snapshot, so that the next
+ * input_state() queries go back to the input driver.
+ **/
+void input_driver_state_cache_invalidate(void)
+{
+   unsigned i;
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      input_driver_state_cache[i].joypad_valid = 0;
+      input_driver_state_cache[i].analog_valid = 0;
+   }
+}
+
+/**
+ * input_state:
+ * @port                 : user number.
+ * @device               : device identifier of user.
+ * @idx                  : index value of user.
+ * @id                   : identifier of key pressed by user.
+ *
+ * Input state callback function.
+ *
+ * Returns: Non-zero if the given key (identified by @id)
+ * was pressed by the user (assigned to @port).
+ **/
+int16_t input_state(unsigned port, unsigned device,
+      unsigned idx, unsigned id)
+{
+   int16_t res = 0;
+
+   device &= RETRO_DEVICE_MASK;
+
+   if (bsv_movie_is_playback_on())
+   {
+      int16_t bsv_result;
+      if (bsv_movie_get_input(&bsv_result))
+         return bsv_result;
+
+      bsv_movie_ctl(BSV_MOVIE_CTL_SET_END, NULL);
+   }
+
+   if (     !input_driver_flushing_input
+         && !input_driver_block_libretro_input)
+   {
+      settings_t *settings = config_get_ptr();
+
+      res = input_state_cached(settings, port, device, idx, id);
 
       /* Don't allow turbo for D-pad. */
       if (device == RETRO_DEVICE_JOYPAD && (id < RETRO_DEVICE_ID_JOYPAD_UP ||
@@ -834,6 +958,61 @@ void state_tracker_update_input(uint16_t *input1, uint16_t *input2)
    }
 }
 
+/**
+ * input_config_binds_changed:
+ *
+ * Flags the bound bind tables for a rebuild. Called by
+ * everything that writes to input_config_binds or
+ * input_autoconf_binds outside of analog D-pad emulation,
+ * after the write.
+ **/
+void input_config_binds_changed(void)
+{
+   input_driver_binds_generation++;
+}
+
+static void input_driver_bound_rebuild(void)
+{
+   unsigned i, j;
+   unsigned generation = input_driver_binds_generation;
+
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      BIT256_CLEAR_ALL(input_driver_config_bound[i]);
+      BIT256_CLEAR_ALL(input_driver_autoconf_bound[i]);
+
+      for (j = 0; j < RARCH_BIND_LIST_END; j++)
+      {
+         const struct retro_keybind *bind      = &input_config_binds[i][j];
+         const struct retro_keybind *auto_bind = &input_autoconf_binds[i][j];
+
+         if (     bind->key     != RETROK_UNKNOWN
+               || bind->mbutton != NO_BTN
+               || bind->joykey  != NO_BTN
+               || bind->joyaxis != AXIS_NONE)
+            BIT256_SET(input_driver_config_bound[i], j);
+
+         if (     auto_bind->key     != RETROK_UNKNOWN
+               || auto_bind->joykey  != NO_BTN
+               || auto_bind->joyaxis != AXIS_NONE)
+            BIT256_SET(input_driver_autoconf_bound[i], j);
+      }
+
+      /* Analog D-pad emulation rewrites these every frame. */
+      for (j = RETRO_DEVICE_ID_JOYPAD_UP; j <= RETRO_DEVICE_ID_JOYPAD_RIGHT; j++)
+      {
+         BIT256_SET(input_driver_config_bound[i], j);
+         BIT256_SET(input_driver_autoconf_bound[i], j);
+      }
+   }
+
+   input_driver_bound_generation = generation;
+}
+
+#define input_driver_bind_is_bound(port, joy_idx, i) \
+   (BIT256_GET(input_driver_config_bound[(port)], (i)) \
+    || BIT256_GET(input_driver_autoconf_bound[(joy_idx)], (i)))
+
 static INLINE bool input_keys_pressed_iterate(unsigned i,
       input_bits_t* p_new_state)
 {
@@ -884,6 +1063,8 @@ void input_menu_keys_pressed(void *data, input_bits_t *p_new_state)
 {
    unsigned i, port;
    rarch_joypad_info_t joypad_info;
+   const input_device_driver_t *first           = NULL;
+   const input_device_driver_t *sec             = NULL;
    const struct retro_keybind *binds[MAX_USERS] = {NULL};
    settings_t     *settings                     = (settings_t*)data;
    uint8_t max_users                            = (uint8_t)input_driver_max_users;
@@ -937,6 +1118,14 @@ void input_menu_keys_pressed(void *data, input_bits_t *p_new_state)
       }
    }
 
+   if (input_driver_bound_generation != input_driver_binds_generation)
+      input_driver_bound_rebuild();
+
+   first = current_input->get_joypad_driver
+      ? current_input->get_joypad_driver(current_input_data) : NULL;
+   sec   = current_input->get_sec_joypad_driver
+      ? current_input->get_sec_joypad_driver(current_input_data) : NULL;
+
    for (i = 0; i < RARCH_BIND_LIST_END; i++)
    {
       bool bit_pressed    = false;
@@ -946,11 +1135,6 @@ void input_menu_keys_pressed(void *data, input_bits_t *p_new_state)
             || !input_driver_block_hotkey
          )
       {
-         const input_device_driver_t *first = current_input->get_joypad_driver
-            ? current_input->get_joypad_driver(current_input_data) : NULL;
-         const input_device_driver_t *sec   = current_input->get_sec_joypad_driver
-            ? current_input->get_sec_joypad_driver(current_input_data) : NULL;
-
          for (port = 0; port < port_max; port++)
          {
             uint64_t              joykey      = 0;
@@ -961,6 +1145,10 @@ void input_menu_keys_pressed(void *data, input_bits_t *p_new_state)
                continue;
 
             joypad_info.joy_idx               = settings->uints.input_joypad_map[port];
+
+            if (!input_driver_bind_is_bound(port, joypad_info.joy_idx, i))
+               continue;
+
             joypad_info.auto_binds            = input_autoconf_binds[joypad_info.joy_idx];
             joypad_info.axis_threshold        = input_driver_axis_threshold;
 
@@ -1139,6 +1327,9 @@ void input_keys_pressed(void *data, input_bits_t *p_new_state)
       }
    }
 
+   if (input_driver_bound_generation != input_driver_binds_generation)
+      input_driver_bound_rebuild();
+
    for (i = 0; i < RARCH_BIND_LIST_END; i++)
    {
       bool bit_pressed = false;
@@ -1146,7 +1337,9 @@ void input_keys_pressed(void *data, input_bits_t *p_new_state)
       if (
             ((!input_driver_block_libretro_input && ((i < RARCH_FIRST_META_KEY)))
              || !input_driver_block_hotkey) &&
-            binds[i].valid && current_input->input_state(current_input_data,
+            binds[i].valid &&
+            input_driver_bind_is_bound(0, joypad_info.joy_idx, i) &&
+            current_input->input_state(current_input_data,
                joypad_info, &binds,
                0, RETRO_DEVICE_JOYPAD, 0, i)
          )
@@ -1235,6 +1428,7 @@ void input_driver_deinit(void)
    if (current_input && current_input->free)
       current_input->free(current_input_data);
    current_input_data = NULL;
+   input_driver_state_cache_invalidate();
 }
 
 void input_driver_destroy_data(void)
@@ -2341,6 +2535,8 @@ void input_config_parse_key(void *data,
 
    if (config_get_array(conf, key, tmp, sizeof(tmp)))
       bind->key = input_config_translate_str_to_rk(tmp);
+
+   input_config_binds_changed();
 }
 
 const char *input_config_get_prefix(unsigned user, bool meta)
@@ -2486,6 +2682,8 @@ void input_config_parse_joy_button(void *data, const char *prefix,
       }
    }
 
+   input_config_binds_changed();
+
    if (bind && config_get_string(conf, key_label, &tmp_a))
    {
       if (!string_is_empty(bind->joykey_label))
@@ -2532,6 +2730,8 @@ void input_config_parse_joy_axis(void *data, const char *prefix,
       bind->orig_joyaxis = bind->joyaxis;
    }
 
+   input_config_binds_changed();
+
    if (config_get_string(conf, key_label, &tmp_a))
    {
       if (bind->joyaxis_label &&
@@ -2608,6 +2808,8 @@ void input_config_parse_mouse_button(void *data, const char *prefix,
          }
       }
    }
+
+   input_config_binds_changed();
 }
 
 static void input_config_get_bind_string_joykey(
@@ -2939,4 +3141,6 @@ void input_config_reset(void)
       for (j = 0; j < 64; j++)
          input_device_names[i][j] = 0;
    }
+
+   input_config_binds_changed();
 }
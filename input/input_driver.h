@@ -314,6 +314,15 @@ void input_poll(void);
 int16_t input_state(unsigned port, unsigned device,
       unsigned idx, unsigned id);
 
+/**
+ * input_driver_state_cache_invalidate:
+ *
+ * Drops the input state resolved since the last input_poll().
+ * Must be called whenever binds, remaps or the input driver
+ * change outside of input_poll().
+ **/
+void input_driver_state_cache_invalidate(void);
+
 void input_keys_pressed(void *data, input_bits_t* new_state);
 
 #ifdef HAVE_MENU
@@ -793,6 +802,14 @@ uint16_t input_config_get_vid(unsigned port);
 
 void input_config_reset(void);
 
+/**
+ * input_config_binds_changed:
+ *
+ * Must be called after writing to input_config_binds or
+ * input_autoconf_binds, so hotkey scans pick up the new binds.
+ **/
+void input_config_binds_changed(void);
+
 void set_connection_listener(pad_connection_listener_t *listener);
 void fire_connection_listener(unsigned port, input_device_driver_t *driver);
 
@@ -38,6 +38,10 @@
 #define OVERLAY_SET_KEY(state, key) (state)->keys[(key) / 32] |= 1 << ((key) % 32)
 
 #define MAX_VISIBILITY 32
+
+/* Cells per axis of the overlay hit-test grid. */
+#define OVERLAY_GRID_DIM   8
+#define OVERLAY_GRID_CELLS (OVERLAY_GRID_DIM * OVERLAY_GRID_DIM)
 static enum overlay_visibility* visibility = NULL;
 
 typedef struct input_overlay_state
@@ -279,6 +283,12 @@ void input_overlay_free_overlay(struct overlay *overlay)
    if (overlay->load_images)
       free(overlay->load_images);
    overlay->load_images = NULL;
+   if (overlay->grid_start)
+      free(overlay->grid_start);
+   overlay->grid_start  = NULL;
+   if (overlay->grid_descs)
+      free(overlay->grid_descs);
+   overlay->grid_descs  = NULL;
    if (overlay->descs)
       free(overlay->descs);
    overlay->descs       = NULL;
@@ -371,6 +381,104 @@ static bool inside_hitbox(const struct overlay_desc *desc, float x, float y)
    return false;
 }
 
+static unsigned input_overlay_grid_cell(float v)
+{
+   if (!(v > 0.0f))
+      return 0;
+   if (v >= 1.0f)
+      return OVERLAY_GRID_DIM - 1;
+   return (unsigned)(v * OVERLAY_GRID_DIM);
+}
+
+/**
+ * input_overlay_grid_bounds:
+ * @desc                  : Overlay descriptor handle.
+ * @x0, @y0, @x1, @y1     : Inclusive range of grid cells.
+ *
+ * Gets the grid cells covered by the largest hitbox @desc
+ * can have, i.e. including the pressed state range modifier.
+ * Points outside of the overlay map to the border cells.
+ **/
+static void input_overlay_grid_bounds(const struct overlay_desc *desc,
+      unsigned *x0, unsigned *y0, unsigned *x1, unsigned *y1)
+{
+   float range_mod = desc->range_mod > 1.0f ? desc->range_mod : 1.0f;
+   /* Pad a little so float rounding at the hitbox edges
+    * can never select a cell the descriptor is missing from. */
+   float range_x   = desc->range_x * range_mod + 0.001f;
+   float range_y   = desc->range_y * range_mod + 0.001f;
+
+   *x0             = input_overlay_grid_cell(desc->x - range_x);
+   *y0             = input_overlay_grid_cell(desc->y - range_y);
+   *x1             = input_overlay_grid_cell(desc->x + range_x);
+   *y1             = input_overlay_grid_cell(desc->y + range_y);
+}
+
+/**
+ * input_overlay_build_grid:
+ * @ol                    : Overlay handle.
+ *
+ * Buckets the descriptors of @ol into a uniform grid so that
+ * polling only hit-tests the descriptors near each touch point.
+ * Hitboxes live in the overlay's normalized space, so the grid
+ * does not depend on the overlay scale and is built once.
+ **/
+static void input_overlay_build_grid(struct overlay *ol)
+{
+   size_t i;
+   unsigned x, y, total = 0;
+   unsigned *start      = NULL;
+   unsigned *descs      = NULL;
+
+   if (!ol || ol->grid_start || !ol->size)
+      return;
+
+   start = (unsigned*)calloc(OVERLAY_GRID_CELLS + 1, sizeof(*start));
+   if (!start)
+      return;
+
+   /* Count descriptors per cell. */
+   for (i = 0; i < ol->size; i++)
+   {
+      unsigned x0, y0, x1, y1;
+      input_overlay_grid_bounds(&ol->descs[i], &x0, &y0, &x1, &y1);
+
+      for (y = y0; y <= y1; y++)
+         for (x = x0; x <= x1; x++)
+            start[y * OVERLAY_GRID_DIM + x + 1]++;
+   }
+
+   for (i = 1; i <= OVERLAY_GRID_CELLS; i++)
+      start[i] += start[i - 1];
+   total = start[OVERLAY_GRID_CELLS];
+
+   descs = (unsigned*)malloc((total ? total : 1) * sizeof(*descs));
+   if (!descs)
+   {
+      free(start);
+      return;
+   }
+
+   /* Fill cells in descriptor order, using start[c] as the
+    * write cursor of cell c - 1 and shifting back afterwards. */
+   for (i = 0; i < ol->size; i++)
+   {
+      unsigned x0, y0, x1, y1;
+      input_overlay_grid_bounds(&ol->descs[i], &x0, &y0, &x1, &y1);
+
+      for (y = y0; y <= y1; y++)
+         for (x = x0; x <= x1; x++)
+            descs[start[y * OVERLAY_GRID_DIM + x]++] = (unsigned)i;
+   }
+
+   for (i = OVERLAY_GRID_CELLS; i > 0; i--)
+      start[i] = start[i - 1];
+   start[0]       = 0;
+
+   ol->grid_start = start;
+   ol->grid_descs = descs;
+}
+
 /**
  * input_overlay_poll:
  * @out                   : Polled output data.
@@ -387,7 +495,8 @@ static void input_overlay_poll(
       input_overlay_state_t *out,
       int16_t norm_x, int16_t norm_y)
 {
-   size_t i;
+   size_t i, first, last;
+   const unsigned *cell = NULL;
 
    /* norm_x and norm_y is in [-0x7fff, 0x7fff] range,
     * like RETRO_DEVICE_POINTER. */
@@ -399,10 +508,23 @@ static void input_overlay_poll(
    x /= ol->active->mod_w;
    y /= ol->active->mod_h;
 
-   for (i = 0; i < ol->active->size; i++)
+   first = 0;
+   last  = ol->active->size;
+
+   if (ol->active->grid_start)
+   {
+      unsigned c = input_overlay_grid_cell(y) * OVERLAY_GRID_DIM
+         + input_overlay_grid_cell(x);
+
+      first      = ol->active->grid_start[c];
+      last       = ol->active->grid_start[c + 1];
+      cell       = ol->active->grid_descs;
+   }
+
+   for (i = first; i < last; i++)
    {
       float x_dist, y_dist;
-      struct overlay_desc *desc = &ol->active->descs[i];
+      struct overlay_desc *desc = &ol->active->descs[cell ? cell[i] : i];
 
       if (!inside_hitbox(desc, x, y))
          continue;
@@ -630,6 +752,9 @@ void input_overlay_loaded(void *task_data, void *user_data, const char *err)
    ol->iface      = iface;
    ol->iface_data = video_driver_get_ptr(true);
 
+   for (i = 0; i < ol->size; i++)
+      input_overlay_build_grid(&ol->overlays[i]);
+
    input_overlay_load_active(ol, data->overlay_opacity);
    input_overlay_enable(ol, data->overlay_enable);
 
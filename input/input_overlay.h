@@ -115,6 +115,13 @@ struct overlay
    struct overlay_desc *descs;
    struct texture_image *load_images;
 
+   /* Uniform grid over the overlay's normalized space, used to
+    * find the descriptors a touch point can hit. Cell c holds
+    * grid_descs[grid_start[c] .. grid_start[c + 1]), in
+    * descriptor order. NULL if no grid was built. */
+   unsigned *grid_start;
+   unsigned *grid_descs;
+
    struct texture_image image;
 
    char name[64];
@@ -3186,7 +3186,7 @@ MSG_HASH(MENU_ENUM_SUBLABEL_PLAYLIST_DIRECTORY,
       "Save all collections to this directory.")
 MSG_HASH(
       MENU_ENUM_SUBLABEL_CACHE_DIRECTORY,
-      "If set to a directory, content which is temporarily extracted (e.g. from archives) will be extracted to this directory."
+      "If set to a directory, content which is temporarily extracted (e.g. from archives) will be extracted to this directory. Compiled slang shaders are cached in its 'slang' subdirectory, or in 'cache/slang' next to the config file if unset."
       )
 MSG_HASH(MENU_ENUM_SUBLABEL_CURSOR_DIRECTORY,
       "Saved queries are stored to this directory.")
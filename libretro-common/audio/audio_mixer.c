@@ -25,6 +25,8 @@
 
 #include <formats/rwav.h>
 #include <memalign.h>
+#include <retro_inline.h>
+#include <retro_math.h>
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
@@ -35,6 +37,12 @@
 #include <string.h>
 #include <math.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
 #endif
@@ -65,6 +73,14 @@
 #define AUDIO_MIXER_MAX_VOICES      8
 #define AUDIO_MIXER_TEMP_BUFFER 8192
 
+/* How many decoded chunks fit in the ring of a streamed voice. */
+#define AUDIO_MIXER_RING_CHUNKS     3
+
+/* While a streamed voice is playing, the decoder thread also
+ * wakes up on its own this often (in us), in case the mixer
+ * isn't running. Otherwise it sleeps until woken. */
+#define AUDIO_MIXER_DECODER_TIMEOUT 20000
+
 struct audio_mixer_sound
 {
    enum audio_mixer_type type;
@@ -124,6 +140,21 @@ struct audio_mixer_voice
    audio_mixer_sound_t *sound;
    audio_mixer_stop_cb_t stop_cb;
 
+   /* Streamed voices (everything but WAV) are decoded ahead of
+    * time into this ring, at the output rate, so that mixing
+    * them is a plain multiply-accumulate. */
+   struct
+   {
+      float   *data;
+      unsigned size;     /* In samples, power of two. */
+      unsigned chunk;    /* Largest decoded chunk, in samples. */
+      unsigned read;
+      unsigned write;
+      unsigned repeats;  /* Pending AUDIO_MIXER_SOUND_REPEATED. */
+      unsigned decoder;  /* Type whose decoder state is in types. */
+      bool     finished; /* Decoder reached the end of the sound. */
+   } ring;
+
    union
    {
       struct
@@ -134,8 +165,6 @@ struct audio_mixer_voice
 #ifdef HAVE_STB_VORBIS
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -148,8 +177,6 @@ struct audio_mixer_voice
 #ifdef HAVE_DR_FLAC
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -162,8 +189,6 @@ struct audio_mixer_voice
 #ifdef HAVE_DR_MP3
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -176,10 +201,10 @@ struct audio_mixer_voice
 #ifdef HAVE_IBXM
       struct
       {
-         unsigned    		position;
-         unsigned    		samples;
          unsigned    		buf_samples;
          int*               buffer;
+         float*             pcm;
+         struct module*     module;
          struct replay*		stream;
       } mod;
 #endif
@@ -190,7 +215,18 @@ static struct audio_mixer_voice s_voices[AUDIO_MIXER_MAX_VOICES];
 static unsigned s_rate = 0;
 
 #ifdef HAVE_THREADS
-static slock_t* s_locker = NULL;
+/* Lock order: s_decode_locker, then s_locker.
+ * s_locker guards the voice state and rings and is only ever
+ * held briefly. s_decode_locker is held by the decoder thread
+ * while it decodes, so that voices can't be reinitialized or
+ * their sounds destroyed under its feet. */
+static slock_t* s_locker          = NULL;
+static slock_t* s_decode_locker   = NULL;
+static slock_t* s_decoder_lock    = NULL;
+static scond_t* s_decoder_cond    = NULL;
+static sthread_t* s_decoder       = NULL;
+static bool s_decoder_wake        = false;
+static bool s_decoder_quit        = false;
 #endif
 
 static bool wav2float(const rwav_t* wav, float** pcm, size_t samples_out)
@@ -306,6 +342,421 @@ static bool one_shot_resample(const float* in, size_t samples_in,
    return true;
 }
 
+/**
+ * audio_mixer_mac:
+ * @dst                : Destination buffer.
+ * @src                : Source samples.
+ * @samples            : Number of samples.
+ * @volume             : Gain applied to @src.
+ *
+ * Adds @src, scaled by @volume, to @dst.
+ **/
+static void audio_mixer_mac(float *dst, const float *src,
+      size_t samples, float volume)
+{
+   size_t i = 0;
+#if defined(__SSE2__)
+   __m128 vol = _mm_set1_ps(volume);
+
+   for (; i + 8 <= samples; i += 8)
+   {
+      __m128 a = _mm_loadu_ps(dst + i);
+      __m128 b = _mm_loadu_ps(dst + i + 4);
+      a        = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(src + i),     vol));
+      b        = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(src + i + 4), vol));
+      _mm_storeu_ps(dst + i,     a);
+      _mm_storeu_ps(dst + i + 4, b);
+   }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   float32x4_t vol = vdupq_n_f32(volume);
+
+   for (; i + 8 <= samples; i += 8)
+   {
+      vst1q_f32(dst + i,
+            vmlaq_f32(vld1q_f32(dst + i),     vld1q_f32(src + i),     vol));
+      vst1q_f32(dst + i + 4,
+            vmlaq_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4), vol));
+   }
+#endif
+
+   for (; i < samples; i++)
+      dst[i] += src[i] * volume;
+}
+
+/**
+ * audio_mixer_clamp:
+ * @buffer             : Samples.
+ * @samples            : Number of samples.
+ *
+ * Clamps @buffer to [-1.0, 1.0].
+ **/
+static void audio_mixer_clamp(float *buffer, size_t samples)
+{
+   size_t i = 0;
+#if defined(__SSE2__)
+   __m128 lo = _mm_set1_ps(-1.0f);
+   __m128 hi = _mm_set1_ps( 1.0f);
+
+   for (; i + 4 <= samples; i += 4)
+      _mm_storeu_ps(buffer + i,
+            _mm_min_ps(_mm_max_ps(_mm_loadu_ps(buffer + i), lo), hi));
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   float32x4_t lo = vdupq_n_f32(-1.0f);
+   float32x4_t hi = vdupq_n_f32( 1.0f);
+
+   for (; i + 4 <= samples; i += 4)
+      vst1q_f32(buffer + i,
+            vminq_f32(vmaxq_f32(vld1q_f32(buffer + i), lo), hi));
+#endif
+
+   for (; i < samples; i++)
+   {
+      if (buffer[i] < -1.0f)
+         buffer[i] = -1.0f;
+      else if (buffer[i] > 1.0f)
+         buffer[i] = 1.0f;
+   }
+}
+
+static INLINE unsigned audio_mixer_ring_avail(const audio_mixer_voice_t *voice)
+{
+   return voice->ring.write - voice->ring.read;
+}
+
+static void audio_mixer_ring_write(audio_mixer_voice_t *voice,
+      const float *pcm, unsigned samples)
+{
+   unsigned pos   = voice->ring.write & (voice->ring.size - 1);
+   unsigned first = voice->ring.size - pos;
+
+   if (first > samples)
+      first = samples;
+
+   memcpy(voice->ring.data + pos, pcm, first * sizeof(float));
+   memcpy(voice->ring.data, pcm + first, (samples - first) * sizeof(float));
+
+   voice->ring.write += samples;
+}
+
+static void audio_mixer_ring_mix(float *buffer,
+      audio_mixer_voice_t *voice, unsigned samples, float volume)
+{
+   unsigned pos   = voice->ring.read & (voice->ring.size - 1);
+   unsigned first = voice->ring.size - pos;
+
+   if (first > samples)
+      first = samples;
+
+   audio_mixer_mac(buffer, voice->ring.data + pos, first, volume);
+   audio_mixer_mac(buffer + first, voice->ring.data, samples - first, volume);
+
+   voice->ring.read += samples;
+}
+
+#if defined(HAVE_STB_VORBIS) || defined(HAVE_DR_FLAC) || defined(HAVE_DR_MP3)
+static unsigned audio_mixer_resample(const retro_resampler_t *resampler,
+      void *resampler_data, float ratio,
+      float *in, unsigned samples, float *out, const float **pcm)
+{
+   struct resampler_data info;
+
+   if (!resampler)
+   {
+      *pcm               = in;
+      return samples;
+   }
+
+   info.data_in          = in;
+   info.data_out         = out;
+   info.input_frames     = samples / 2;
+   info.output_frames    = 0;
+   info.ratio            = ratio;
+
+   resampler->process(resampler_data, &info);
+
+   *pcm                  = out;
+   return (unsigned)info.output_frames * 2;
+}
+#endif
+
+/**
+ * audio_mixer_decode:
+ * @voice              : Streamed voice.
+ * @temp               : Scratch buffer of AUDIO_MIXER_TEMP_BUFFER samples.
+ * @pcm                : Set to the decoded samples.
+ *
+ * Decodes the next chunk of @voice and converts it to the output rate.
+ *
+ * Returns: number of samples in @pcm, 0 at the end of the sound.
+ **/
+static unsigned audio_mixer_decode(audio_mixer_voice_t *voice,
+      float *temp, const float **pcm)
+{
+   unsigned samples = 0;
+
+   switch (voice->ring.decoder)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         samples = stb_vorbis_get_samples_float_interleaved(
+               voice->types.ogg.stream, 2, temp,
+               AUDIO_MIXER_TEMP_BUFFER) * 2;
+         if (samples)
+            return audio_mixer_resample(voice->types.ogg.resampler,
+                  voice->types.ogg.resampler_data, voice->types.ogg.ratio,
+                  temp, samples, voice->types.ogg.buffer, pcm);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         samples = (unsigned)drflac_read_f32(voice->types.flac.stream,
+               AUDIO_MIXER_TEMP_BUFFER, temp);
+         if (samples)
+            return audio_mixer_resample(voice->types.flac.resampler,
+                  voice->types.flac.resampler_data, voice->types.flac.ratio,
+                  temp, samples, voice->types.flac.buffer, pcm);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         samples = (unsigned)drmp3_read_f32(&voice->types.mp3.stream,
+               AUDIO_MIXER_TEMP_BUFFER / 2, temp) * 2;
+         if (samples)
+            return audio_mixer_resample(voice->types.mp3.resampler,
+                  voice->types.mp3.resampler_data, voice->types.mp3.ratio,
+                  temp, samples, voice->types.mp3.buffer, pcm);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         {
+            unsigned i;
+            const int *in = voice->types.mod.buffer;
+            float *out    = voice->types.mod.pcm;
+
+            samples       = replay_get_audio(
+                  voice->types.mod.stream, voice->types.mod.buffer) * 2;
+
+            for (i = 0; i < samples; i++)
+               out[i] = (float)(in[i] + 32768) / 65535.0f * 2.0f - 1.0f;
+
+            *pcm          = out;
+         }
+#endif
+         break;
+      default:
+         break;
+   }
+
+   return samples;
+}
+
+static void audio_mixer_rewind(audio_mixer_voice_t *voice)
+{
+   switch (voice->ring.decoder)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         stb_vorbis_seek_start(voice->types.ogg.stream);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         drflac_seek_to_sample(voice->types.flac.stream, 0);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         drmp3_seek_to_frame(&voice->types.mp3.stream, 0);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         replay_seek(voice->types.mod.stream, 0);
+#endif
+         break;
+      default:
+         break;
+   }
+}
+
+/**
+ * audio_mixer_voice_fill:
+ * @voice              : Streamed voice.
+ * @temp               : Scratch buffer of AUDIO_MIXER_TEMP_BUFFER samples.
+ * @locked             : Whether the caller already holds s_locker.
+ *
+ * Decodes one chunk of @voice into its ring. The ring must have
+ * room for ring.chunk samples.
+ **/
+static void audio_mixer_voice_fill(audio_mixer_voice_t *voice,
+      float *temp, bool locked)
+{
+   const float *pcm = NULL;
+   bool rewound     = false;
+   unsigned samples = audio_mixer_decode(voice, temp, &pcm);
+
+   if (!samples && voice->repeat)
+   {
+      audio_mixer_rewind(voice);
+      rewound = true;
+      samples = audio_mixer_decode(voice, temp, &pcm);
+   }
+
+   if (samples > voice->ring.chunk)
+      samples = voice->ring.chunk;
+
+#ifdef HAVE_THREADS
+   if (!locked)
+      slock_lock(s_locker);
+#endif
+
+   if (rewound)
+      voice->ring.repeats++;
+
+   if (samples)
+      audio_mixer_ring_write(voice, pcm, samples);
+   else
+      voice->ring.finished = true;
+
+#ifdef HAVE_THREADS
+   if (!locked)
+      slock_unlock(s_locker);
+#endif
+}
+
+static void audio_mixer_voice_fill_inline(audio_mixer_voice_t *voice)
+{
+   float temp[AUDIO_MIXER_TEMP_BUFFER];
+   audio_mixer_voice_fill(voice, temp, true);
+}
+
+/**
+ * audio_mixer_voice_release:
+ * @voice              : Voice.
+ *
+ * Frees the decoder state of a voice that is no longer playing.
+ **/
+static void audio_mixer_voice_release(audio_mixer_voice_t *voice)
+{
+   switch (voice->ring.decoder)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         stb_vorbis_close(voice->types.ogg.stream);
+         if (voice->types.ogg.resampler)
+            voice->types.ogg.resampler->free(voice->types.ogg.resampler_data);
+         memalign_free(voice->types.ogg.buffer);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         drflac_close(voice->types.flac.stream);
+         if (voice->types.flac.resampler)
+            voice->types.flac.resampler->free(voice->types.flac.resampler_data);
+         memalign_free(voice->types.flac.buffer);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         drmp3_uninit(&voice->types.mp3.stream);
+         if (voice->types.mp3.resampler)
+            voice->types.mp3.resampler->free(voice->types.mp3.resampler_data);
+         memalign_free(voice->types.mp3.buffer);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         dispose_replay(voice->types.mod.stream);
+         dispose_module(voice->types.mod.module);
+         memalign_free(voice->types.mod.buffer);
+         memalign_free(voice->types.mod.pcm);
+#endif
+         break;
+      default:
+         break;
+   }
+
+   if (voice->ring.data)
+      memalign_free(voice->ring.data);
+
+   memset(&voice->ring, 0, sizeof(voice->ring));
+   memset(&voice->types, 0, sizeof(voice->types));
+}
+
+#ifdef HAVE_THREADS
+static void audio_mixer_decoder_wake(void)
+{
+   slock_lock(s_decoder_lock);
+   s_decoder_wake = true;
+   scond_signal(s_decoder_cond);
+   slock_unlock(s_decoder_lock);
+}
+
+/**
+ * audio_mixer_decoder_thread:
+ *
+ * Keeps the rings of all streamed voices topped up, so that
+ * audio_mixer_mix() never has to decode.
+ **/
+static void audio_mixer_decoder_thread(void *data)
+{
+   float temp[AUDIO_MIXER_TEMP_BUFFER];
+
+   for (;;)
+   {
+      unsigned i;
+      bool quit      = false;
+      bool busy      = false;
+      bool streaming = false;
+
+      slock_lock(s_decode_locker);
+
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+      {
+         audio_mixer_voice_t *voice = &s_voices[i];
+         bool needs_data            = false;
+
+         slock_lock(s_locker);
+         if (     voice->type != AUDIO_MIXER_TYPE_NONE
+               && voice->ring.data
+               && !voice->ring.finished)
+         {
+            streaming  = true;
+            needs_data = voice->ring.size - audio_mixer_ring_avail(voice)
+               >= voice->ring.chunk;
+         }
+         slock_unlock(s_locker);
+
+         if (needs_data)
+         {
+            audio_mixer_voice_fill(voice, temp, false);
+            busy = true;
+         }
+      }
+
+      slock_unlock(s_decode_locker);
+
+      slock_lock(s_decoder_lock);
+      /* audio_mixer_play() wakes us for new voices. */
+      if (!busy && !s_decoder_wake && !s_decoder_quit)
+      {
+         if (streaming)
+            scond_wait_timeout(s_decoder_cond, s_decoder_lock,
+                  AUDIO_MIXER_DECODER_TIMEOUT);
+         else
+            scond_wait(s_decoder_cond, s_decoder_lock);
+      }
+      s_decoder_wake = false;
+      quit           = s_decoder_quit;
+      slock_unlock(s_decoder_lock);
+
+      if (quit)
+         break;
+   }
+}
+#endif
+
 void audio_mixer_init(unsigned rate)
 {
    unsigned i;
@@ -313,10 +764,23 @@ void audio_mixer_init(unsigned rate)
    s_rate = rate;
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
+      memset(&s_voices[i], 0, sizeof(s_voices[i]));
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
+   }
 
 #ifdef HAVE_THREADS
-   s_locker = slock_new();
+   s_locker        = slock_new();
+   s_decode_locker = slock_new();
+   s_decoder_lock  = slock_new();
+   s_decoder_cond  = scond_new();
+   s_decoder_wake  = false;
+   s_decoder_quit  = false;
+
+   /* Without the thread, streamed voices are decoded by
+    * audio_mixer_mix() itself. */
+   if (s_decode_locker && s_decoder_lock && s_decoder_cond)
+      s_decoder    = sthread_create(audio_mixer_decoder_thread, NULL);
 #endif
 }
 
@@ -325,13 +789,33 @@ void audio_mixer_done(void)
    unsigned i;
 
 #ifdef HAVE_THREADS
+   if (s_decoder)
+   {
+      slock_lock(s_decoder_lock);
+      s_decoder_quit = true;
+      scond_signal(s_decoder_cond);
+      slock_unlock(s_decoder_lock);
+
+      sthread_join(s_decoder);
+      s_decoder = NULL;
+   }
+
    /* Dont call audio mixer functions after this point */
    slock_free(s_locker);
-   s_locker = NULL;
+   slock_free(s_decode_locker);
+   slock_free(s_decoder_lock);
+   scond_free(s_decoder_cond);
+   s_locker        = NULL;
+   s_decode_locker = NULL;
+   s_decoder_lock  = NULL;
+   s_decoder_cond  = NULL;
 #endif
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
+      audio_mixer_voice_release(&s_voices[i]);
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
+   }
 }
 
 audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size)
@@ -546,11 +1030,12 @@ static bool audio_mixer_play_ogg(
 
    samples                         = (unsigned)(AUDIO_MIXER_TEMP_BUFFER * ratio);
    ogg_buffer                      = (float*)memalign_alloc(16,
-         ((samples + 15) & ~15) * sizeof(float));
+         ((samples + 16 + 15) & ~15) * sizeof(float));
 
    if (!ogg_buffer)
    {
-      resamp->free(resampler_data);
+      if (resamp)
+         resamp->free(resampler_data);
       goto error;
    }
 
@@ -560,8 +1045,8 @@ static bool audio_mixer_play_ogg(
    voice->types.ogg.buf_samples    = samples;
    voice->types.ogg.ratio          = ratio;
    voice->types.ogg.stream         = stb_vorbis;
-   voice->types.ogg.position       = 0;
-   voice->types.ogg.samples        = 0;
+   voice->ring.chunk               = samples + 16;
+   voice->ring.decoder             = AUDIO_MIXER_TYPE_OGG;
 
    return true;
 
@@ -583,6 +1068,7 @@ static bool audio_mixer_play_mod(
    int buf_samples               = 0;
    int samples                   = 0;
    void *mod_buffer              = NULL;
+   void *mod_pcm                 = NULL;
    struct module* module         = NULL;
    struct replay* replay         = NULL;
 
@@ -606,8 +1092,9 @@ static bool audio_mixer_play_mod(
 
    buf_samples = calculate_mix_buf_len(s_rate);
    mod_buffer  = memalign_alloc(16, ((buf_samples + 15) & ~15) * sizeof(int));
+   mod_pcm     = memalign_alloc(16, ((buf_samples + 15) & ~15) * sizeof(float));
 
-   if (!mod_buffer)
+   if (!mod_buffer || !mod_pcm)
    {
       printf("audio_mixer_play_mod cannot allocate mod_buffer !\n");
       goto error;
@@ -622,16 +1109,22 @@ static bool audio_mixer_play_mod(
    }
 
    voice->types.mod.buffer         = (int*)mod_buffer;
+   voice->types.mod.pcm            = (float*)mod_pcm;
    voice->types.mod.buf_samples    = buf_samples;
+   voice->types.mod.module         = module;
    voice->types.mod.stream         = replay;
-   voice->types.mod.position       = 0;
-    voice->types.mod.samples       = 0; /* samples; */
+   voice->ring.chunk               = buf_samples;
+   voice->ring.decoder             = AUDIO_MIXER_TYPE_MOD;
 
    return true;
 
 error:
+   if (mod_pcm)
+      memalign_free(mod_pcm);
    if (mod_buffer)
       memalign_free(mod_buffer);
+   if (replay)
+      dispose_replay(replay);
    if (module)
       dispose_module(module);
    return false;
@@ -669,11 +1162,12 @@ static bool audio_mixer_play_flac(
 
    samples                         = (unsigned)(AUDIO_MIXER_TEMP_BUFFER * ratio);
    flac_buffer                      = (float*)memalign_alloc(16,
-         ((samples + 15) & ~15) * sizeof(float));
+         ((samples + 16 + 15) & ~15) * sizeof(float));
 
    if (!flac_buffer)
    {
-      resamp->free(resampler_data);
+      if (resamp)
+         resamp->free(resampler_data);
       goto error;
    }
 
@@ -683,8 +1177,8 @@ static bool audio_mixer_play_flac(
    voice->types.flac.buf_samples    = samples;
    voice->types.flac.ratio          = ratio;
    voice->types.flac.stream         = dr_flac;
-   voice->types.flac.position       = 0;
-   voice->types.flac.samples        = 0;
+   voice->ring.chunk                = samples + 16;
+   voice->ring.decoder              = AUDIO_MIXER_TYPE_FLAC;
 
    return true;
 
@@ -721,11 +1215,12 @@ static bool audio_mixer_play_mp3(
 
    samples                         = (unsigned)(AUDIO_MIXER_TEMP_BUFFER * ratio);
    mp3_buffer                      = (float*)memalign_alloc(16,
-         ((samples + 15) & ~15) * sizeof(float));
+         ((samples + 16 + 15) & ~15) * sizeof(float));
 
    if (!mp3_buffer)
    {
-      resamp->free(resampler_data);
+      if (resamp)
+         resamp->free(resampler_data);
       goto error;
    }
 
@@ -734,8 +1229,8 @@ static bool audio_mixer_play_mp3(
    voice->types.mp3.buffer         = (float*)mp3_buffer;
    voice->types.mp3.buf_samples    = samples;
    voice->types.mp3.ratio          = ratio;
-   voice->types.mp3.position       = 0;
-   voice->types.mp3.samples        = 0;
+   voice->ring.chunk               = samples + 16;
+   voice->ring.decoder             = AUDIO_MIXER_TYPE_MP3;
 
    return true;
 
@@ -746,6 +1241,31 @@ error:
 #endif
 
 
+/**
+ * audio_mixer_voice_start:
+ * @voice              : Streamed voice, set up by audio_mixer_play_*().
+ *
+ * Allocates the ring of @voice and decodes its first chunk, so that
+ * it can be mixed right away.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool audio_mixer_voice_start(audio_mixer_voice_t *voice)
+{
+   float temp[AUDIO_MIXER_TEMP_BUFFER];
+   unsigned size     = next_pow2(voice->ring.chunk * AUDIO_MIXER_RING_CHUNKS);
+
+   voice->ring.data  = (float*)memalign_alloc(16, size * sizeof(float));
+
+   if (!voice->ring.data)
+      return false;
+
+   voice->ring.size  = size;
+   audio_mixer_voice_fill(voice, temp, true);
+
+   return true;
+}
+
 audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       float volume, audio_mixer_stop_cb_t stop_cb)
 {
@@ -757,6 +1277,7 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       return NULL;
 
 #ifdef HAVE_THREADS
+   slock_lock(s_decode_locker);
    slock_lock(s_locker);
 #endif
 
@@ -765,6 +1286,12 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       if (voice->type != AUDIO_MIXER_TYPE_NONE)
          continue;
 
+      /* The slot may still hold the decoder of a sound that
+       * finished playing. */
+      audio_mixer_voice_release(voice);
+
+      voice->repeat = repeat;
+
       switch (sound->type)
       {
          case AUDIO_MIXER_TYPE_WAV:
@@ -794,6 +1321,14 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
             break;
       }
 
+      if (res && sound->type != AUDIO_MIXER_TYPE_WAV)
+      {
+         res = audio_mixer_voice_start(voice);
+
+         if (!res)
+            audio_mixer_voice_release(voice);
+      }
+
       break;
    }
 
@@ -810,6 +1345,10 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
 
 #ifdef HAVE_THREADS
    slock_unlock(s_locker);
+   slock_unlock(s_decode_locker);
+
+   if (voice && s_decoder)
+      audio_mixer_decoder_wake();
 #endif
 
    return voice;
@@ -826,13 +1365,16 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
       sound   = voice->sound;
 
 #ifdef HAVE_THREADS
+      slock_lock(s_decode_locker);
       slock_lock(s_locker);
 #endif
 
       voice->type = AUDIO_MIXER_TYPE_NONE;
+      audio_mixer_voice_release(voice);
 
 #ifdef HAVE_THREADS
       slock_unlock(s_locker);
+      slock_unlock(s_decode_locker);
 #endif
 
       if (stop_cb)
@@ -840,350 +1382,109 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
    }
 }
 
-static void audio_mixer_mix_wav(float* buffer, size_t num_frames,
+/**
+ * audio_mixer_mix_wav:
+ * @buffer             : Output samples.
+ * @samples            : Number of samples in @buffer.
+ * @voice              : WAV voice.
+ * @volume             : Gain.
+ *
+ * Mixes @voice into @buffer. Loops and the end of the sound are
+ * reported through ring.repeats and ring.finished.
+ **/
+static void audio_mixer_mix_wav(float* buffer, unsigned samples,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
    const audio_mixer_sound_t* sound = voice->sound;
-   unsigned pcm_available           = sound->types.wav.frames
-      * 2 - voice->types.wav.position;
-   const float* pcm                 = sound->types.wav.pcm +
-      voice->types.wav.position;
-
-again:
-   if (pcm_available < buf_free)
-   {
-      for (i = pcm_available; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      if (voice->repeat)
-      {
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-         buf_free                  -= pcm_available;
-         pcm_available              = sound->types.wav.frames * 2;
-         pcm                        = sound->types.wav.pcm;
-         voice->types.wav.position  = 0;
-         goto again;
-      }
-
-      if (voice->stop_cb)
-         voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+   unsigned total                   = sound->types.wav.frames * 2;
 
-      voice->type = AUDIO_MIXER_TYPE_NONE;
-   }
-   else
-   {
-      for (i = buf_free; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      voice->types.wav.position += buf_free;
-   }
-}
-
-#ifdef HAVE_STB_VORBIS
-static void audio_mixer_mix_ogg(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   struct resampler_data info = { 0 };
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
-
-   if (voice->types.ogg.position == voice->types.ogg.samples)
+   while (samples)
    {
-again:
-      temp_samples = stb_vorbis_get_samples_float_interleaved(
-            voice->types.ogg.stream, 2, temp_buffer,
-            AUDIO_MIXER_TEMP_BUFFER) * 2;
+      unsigned pcm_available = total - voice->types.wav.position;
 
-      if (temp_samples == 0)
+      if (!pcm_available)
       {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            stb_vorbis_seek_start(voice->types.ogg.stream);
-            goto again;
-         }
-         else
+         if (!voice->repeat || !total)
          {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
+            voice->ring.finished      = true;
             return;
          }
-      }
-
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.ogg.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.ogg.ratio;
-
-      if (voice->types.ogg.resampler)
-        voice->types.ogg.resampler->process(voice->types.ogg.resampler_data, &info);
-      else
-        memcpy(voice->types.ogg.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.ogg.position = 0;
-      voice->types.ogg.samples  = voice->types.ogg.buf_samples;
-   }
 
-   pcm = voice->types.ogg.buffer + voice->types.ogg.position;
-
-   if (voice->types.ogg.samples < buf_free)
-   {
-      for (i = voice->types.ogg.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.ogg.samples;
-      goto again;
-   }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-         *buffer++ += *pcm++ * volume;
-
-      voice->types.ogg.position += buf_free;
-      voice->types.ogg.samples  -= buf_free;
-   }
-}
-#endif
-
-#ifdef HAVE_IBXM
-static void audio_mixer_mix_mod(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   float samplef                    = 0.0f;
-   int samplei                      = 0;
-   unsigned temp_samples            = 0;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   int* pcm                         = NULL;
-
-   if (voice->types.mod.position == voice->types.mod.samples)
-   {
-again:
-      temp_samples = replay_get_audio(
-            voice->types.mod.stream, voice->types.mod.buffer );
-
-      temp_samples *= 2; /* stereo */
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            replay_seek( voice->types.mod.stream, 0);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
+         voice->ring.repeats++;
+         voice->types.wav.position    = 0;
+         pcm_available                = total;
       }
 
-      voice->types.mod.position = 0;
-      voice->types.mod.samples  = temp_samples;
-   }
-   pcm = voice->types.mod.buffer + voice->types.mod.position;
+      if (pcm_available > samples)
+         pcm_available = samples;
 
-   if (voice->types.mod.samples < buf_free)
-   {
-      for (i = voice->types.mod.samples; i != 0; i--)
-      {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
-      }
+      audio_mixer_mac(buffer,
+            sound->types.wav.pcm + voice->types.wav.position,
+            pcm_available, volume);
 
-      buf_free -= voice->types.mod.samples;
-      goto again;
+      buffer                    += pcm_available;
+      samples                   -= pcm_available;
+      voice->types.wav.position += pcm_available;
    }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-      {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
-      }
 
-      voice->types.mod.position += buf_free;
-      voice->types.mod.samples  -= buf_free;
-   }
+   if (voice->types.wav.position == total && !voice->repeat)
+      voice->ring.finished = true;
 }
-#endif
 
-#ifdef HAVE_DR_FLAC
-static void audio_mixer_mix_flac(float* buffer, size_t num_frames,
+/**
+ * audio_mixer_mix_stream:
+ * @buffer             : Output samples.
+ * @samples            : Number of samples in @buffer.
+ * @voice              : Streamed voice.
+ * @volume             : Gain.
+ *
+ * Mixes the decoded samples of @voice into @buffer. Without a
+ * decoder thread, the voice is decoded here as needed; otherwise
+ * a ring that runs dry is simply mixed as silence.
+ **/
+static void audio_mixer_mix_stream(float* buffer, unsigned samples,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
-   struct resampler_data info = { 0 };
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
-
-   if (voice->types.flac.position == voice->types.flac.samples)
-   {
-again:
-      temp_samples = drflac_read_f32( voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER, temp_buffer);
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+   bool decode_inline = true;
 
-            drflac_seek_to_sample(voice->types.flac.stream,0);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
-      }
-
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.flac.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.flac.ratio;
-
-      if (voice->types.flac.resampler)
-        voice->types.flac.resampler->process(voice->types.flac.resampler_data, &info);
-      else
-        memcpy(voice->types.flac.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.flac.position = 0;
-      voice->types.flac.samples  = voice->types.flac.buf_samples;
-   }
-
-   pcm = voice->types.flac.buffer + voice->types.flac.position;
-
-   if (voice->types.flac.samples < buf_free)
-   {
-      for (i = voice->types.flac.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.flac.samples;
-      goto again;
-   }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-         *buffer++ += *pcm++ * volume;
-
-      voice->types.flac.position += buf_free;
-      voice->types.flac.samples  -= buf_free;
-   }
-}
+#ifdef HAVE_THREADS
+   decode_inline      = !s_decoder;
 #endif
 
-#ifdef HAVE_DR_MP3
-static void audio_mixer_mix_mp3(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   struct resampler_data info = { 0 };
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
-
-   if (voice->types.mp3.position == voice->types.mp3.samples)
+   while (samples)
    {
-again:
-      temp_samples = drmp3_read_f32(&voice->types.mp3.stream, AUDIO_MIXER_TEMP_BUFFER/2, temp_buffer) * 2;
-      
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+      unsigned avail = audio_mixer_ring_avail(voice);
 
-            drmp3_seek_to_frame(&voice->types.mp3.stream,0);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+      if (!avail)
+      {
+         if (!decode_inline || voice->ring.finished)
+            break;
 
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
+         audio_mixer_voice_fill_inline(voice);
+         continue;
       }
 
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.mp3.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.mp3.ratio;
-
-      if (voice->types.mp3.resampler)
-        voice->types.mp3.resampler->process(voice->types.mp3.resampler_data, &info);
-      else
-        memcpy(voice->types.mp3.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.mp3.position = 0;
-      voice->types.mp3.samples  = voice->types.mp3.buf_samples;
-   }
+      if (avail > samples)
+         avail = samples;
 
-   pcm = voice->types.mp3.buffer + voice->types.mp3.position;
+      audio_mixer_ring_mix(buffer, voice, avail, volume);
 
-   if (voice->types.mp3.samples < buf_free)
-   {
-      for (i = voice->types.mp3.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.mp3.samples;
-      goto again;
-   }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-         *buffer++ += *pcm++ * volume;
-
-      voice->types.mp3.position += buf_free;
-      voice->types.mp3.samples  -= buf_free;
+      buffer  += avail;
+      samples -= avail;
    }
 }
-#endif
 
 void audio_mixer_mix(float* buffer, size_t num_frames, float volume_override, bool override)
 {
    unsigned i;
-   size_t j                   = 0;
-   float* sample              = NULL;
+   unsigned repeats[AUDIO_MIXER_MAX_VOICES];
+   bool finished[AUDIO_MIXER_MAX_VOICES];
+   audio_mixer_stop_cb_t stop_cbs[AUDIO_MIXER_MAX_VOICES];
+   audio_mixer_sound_t* sounds[AUDIO_MIXER_MAX_VOICES];
+   bool streamed              = false;
+   unsigned samples           = (unsigned)(num_frames * 2);
    audio_mixer_voice_t* voice = s_voices;
 
 #ifdef HAVE_THREADS
@@ -1194,47 +1495,62 @@ void audio_mixer_mix(float* buffer, size_t num_frames, float volume_override, bo
    {
       float volume = (override) ? volume_override : voice->volume;
 
+      repeats[i]   = 0;
+      finished[i]  = false;
+      stop_cbs[i]  = NULL;
+
       switch (voice->type)
       {
          case AUDIO_MIXER_TYPE_WAV:
-            audio_mixer_mix_wav(buffer, num_frames, voice, volume);
+            audio_mixer_mix_wav(buffer, samples, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_OGG:
-#ifdef HAVE_STB_VORBIS
-            audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_MOD:
-#ifdef HAVE_IBXM
-            audio_mixer_mix_mod(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_FLAC:
-#ifdef HAVE_DR_FLAC
-            audio_mixer_mix_flac(buffer, num_frames, voice, volume);
-#endif
-            break;
-            case AUDIO_MIXER_TYPE_MP3:
-#ifdef HAVE_DR_MP3
-            audio_mixer_mix_mp3(buffer, num_frames, voice, volume);
-#endif
+         case AUDIO_MIXER_TYPE_MP3:
+            audio_mixer_mix_stream(buffer, samples, voice, volume);
+            streamed = true;
             break;
          case AUDIO_MIXER_TYPE_NONE:
-            break;
+            continue;
+      }
+
+      repeats[i]          = voice->ring.repeats;
+      stop_cbs[i]         = voice->stop_cb;
+      sounds[i]           = voice->sound;
+      voice->ring.repeats = 0;
+
+      /* A streamed voice only ends once its ring ran dry. */
+      if (     voice->ring.finished
+            && !audio_mixer_ring_avail(voice))
+      {
+         finished[i] = true;
+         voice->type = AUDIO_MIXER_TYPE_NONE;
       }
    }
 
 #ifdef HAVE_THREADS
    slock_unlock(s_locker);
+
+   if (streamed && s_decoder)
+      audio_mixer_decoder_wake();
 #endif
 
-   for (j = 0, sample = buffer; j < num_frames; j++, sample++)
+   /* Callbacks may play or stop voices, so they
+    * can only run once the lock is released. */
+   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
    {
-      if (*sample < -1.0f)
-         *sample = -1.0f;
-      else if (*sample > 1.0f)
-         *sample = 1.0f;
+      if (!stop_cbs[i])
+         continue;
+
+      for (; repeats[i]; repeats[i]--)
+         stop_cbs[i](sounds[i], AUDIO_MIXER_SOUND_REPEATED);
+
+      if (finished[i])
+         stop_cbs[i](sounds[i], AUDIO_MIXER_SOUND_FINISHED);
    }
+
+   audio_mixer_clamp(buffer, samples);
 }
 
 float audio_mixer_voice_get_volume(audio_mixer_voice_t *voice)
@@ -141,6 +141,7 @@ extern const struct dspfilter_implementation *phaser_dspfilter_get_implementatio
 extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *eq_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *chorus_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *reverb_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 
 static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    panning_dspfilter_get_implementation,
@@ -150,6 +151,7 @@ static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    wahwah_dspfilter_get_implementation,
    eq_dspfilter_get_implementation,
    chorus_dspfilter_get_implementation,
+   reverb_dspfilter_get_implementation,
 };
 
 static bool append_plugs(retro_dsp_filter_t *dsp, struct string_list *list)
@@ -12,6 +12,12 @@ filter0 = eq
 # allows finer-grained control over the spectrum.
 # eq_block_size_log2 = 8
 
+# The filter is applied in partitions of this many samples.
+# Latency is one partition, and processing cost grows only slowly with
+# the filter length, so long filters can use small partitions.
+# Defaults to the block size.
+# eq_partition_size_log2 = 8
+
 # An array of which frequencies to control.
 # You can create an arbitrary amount of these sampling points.
 # The EQ will try to create a frequency response which fits well to these points.
@@ -39,3 +45,8 @@ filter0 = eq
 # freqz(res, 1, 4096, 48000);
 #
 # It will give the response in Hz; 48000 is the default Output Rate of RetroArch
+
+# Loads an impulse response in the same format, replacing the filter
+# designed from the frequencies and gains above, e.g. a room or speaker
+# correction measured elsewhere. It is applied to both channels.
+# eq_impulse_response = "room_impulse.txt"
@@ -27,12 +27,18 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+#include <arm_neon.h>
+#endif
+
 #define CHORUS_MAX_DELAY 4096
 #define CHORUS_DELAY_MASK (CHORUS_MAX_DELAY - 1)
 
 struct chorus_data
 {
-   float old[2][CHORUS_MAX_DELAY];
+   float old[CHORUS_MAX_DELAY][2];
    unsigned old_ptr;
 
    float delay;
@@ -42,6 +48,9 @@ struct chorus_data
    float mix_wet;
    unsigned lfo_ptr;
    unsigned lfo_period;
+
+   /* One LFO step, as a rotation. */
+   double lfo_cos, lfo_sin;
 };
 
 static void chorus_free(void *data)
@@ -54,24 +63,43 @@ static void chorus_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
    unsigned i;
+   double lfo_re, lfo_im;
    float *out             = NULL;
    struct chorus_data *ch = (struct chorus_data*)data;
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+   __m128 mix_dry         = _mm_set1_ps(ch->mix_dry);
+   __m128 mix_wet         = _mm_set1_ps(ch->mix_wet);
+#endif
 
    output->samples        = input->samples;
    output->frames         = input->frames;
    out                    = output->samples;
 
+   /* The LFO is advanced by rotating a phasor, which is only
+    * computed from scratch once per block. */
+   lfo_re                 = cos((2.0 * M_PI * ch->lfo_ptr) / ch->lfo_period);
+   lfo_im                 = sin((2.0 * M_PI * ch->lfo_ptr) / ch->lfo_period);
+
    for (i = 0; i < input->frames; i++, out += 2)
    {
-      unsigned delay_int;
-      float delay_frac, l_a, l_b, r_a, r_b;
-      float chorus_l, chorus_r;
-      float in[2] = { out[0], out[1] };
-      float delay = ch->delay + ch->depth * sin((2.0 * M_PI * ch->lfo_ptr++) / ch->lfo_period);
-
-      delay *= ch->input_rate;
-      if (ch->lfo_ptr >= ch->lfo_period)
+      unsigned delay_int, ptr_a, ptr_b;
+      float delay_frac;
+      float delay = ch->delay + ch->depth * lfo_im;
+      double re   = lfo_re;
+
+      delay      *= ch->input_rate;
+
+      if (++ch->lfo_ptr >= ch->lfo_period)
+      {
          ch->lfo_ptr = 0;
+         lfo_re      = 1.0;
+         lfo_im      = 0.0;
+      }
+      else
+      {
+         lfo_re      = re * ch->lfo_cos - lfo_im * ch->lfo_sin;
+         lfo_im      = lfo_im * ch->lfo_cos + re * ch->lfo_sin;
+      }
 
       delay_int = (unsigned)delay;
 
@@ -79,22 +107,56 @@ static void chorus_process(void *data, struct dspfilter_output *output,
          delay_int = CHORUS_MAX_DELAY - 2;
 
       delay_frac = delay - delay_int;
-
-      ch->old[0][ch->old_ptr] = in[0];
-      ch->old[1][ch->old_ptr] = in[1];
-
-      l_a         = ch->old[0][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      l_b         = ch->old[0][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
-      r_a         = ch->old[1][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      r_b         = ch->old[1][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
+      ptr_a      = (ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK;
+      ptr_b      = (ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK;
 
       /* Lerp introduces aliasing of the chorus component,
        * but doing full polyphase here is probably overkill. */
-      chorus_l    = l_a * (1.0f - delay_frac) + l_b * delay_frac;
-      chorus_r    = r_a * (1.0f - delay_frac) + r_b * delay_frac;
-
-      out[0]      = ch->mix_dry * in[0] + ch->mix_wet * chorus_l;
-      out[1]      = ch->mix_dry * in[1] + ch->mix_wet * chorus_r;
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+      {
+         __m128 in     = _mm_castpd_ps(_mm_load_sd((const double*)out));
+         __m128 chorus;
+
+         _mm_store_sd((double*)ch->old[ch->old_ptr], _mm_castps_pd(in));
+
+         chorus        = _mm_add_ps(
+               _mm_mul_ps(_mm_castpd_ps(_mm_load_sd((const double*)ch->old[ptr_a])),
+                  _mm_set1_ps(1.0f - delay_frac)),
+               _mm_mul_ps(_mm_castpd_ps(_mm_load_sd((const double*)ch->old[ptr_b])),
+                  _mm_set1_ps(delay_frac)));
+
+         _mm_store_sd((double*)out, _mm_castps_pd(_mm_add_ps(
+                     _mm_mul_ps(mix_dry, in), _mm_mul_ps(mix_wet, chorus))));
+      }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+      {
+         float32x2_t in     = vld1_f32(out);
+         float32x2_t chorus;
+
+         vst1_f32(ch->old[ch->old_ptr], in);
+
+         chorus             = vmla_n_f32(
+               vmul_n_f32(vld1_f32(ch->old[ptr_a]), 1.0f - delay_frac),
+               vld1_f32(ch->old[ptr_b]), delay_frac);
+
+         vst1_f32(out, vmla_n_f32(vmul_n_f32(in, ch->mix_dry),
+                  chorus, ch->mix_wet));
+      }
+#else
+      {
+         unsigned c;
+
+         ch->old[ch->old_ptr][0] = out[0];
+         ch->old[ch->old_ptr][1] = out[1];
+
+         for (c = 0; c < 2; c++)
+         {
+            float chorus = ch->old[ptr_a][c] * (1.0f - delay_frac)
+               + ch->old[ptr_b][c] * delay_frac;
+            out[c]       = ch->mix_dry * out[c] + ch->mix_wet * chorus;
+         }
+      }
+#endif
 
       ch->old_ptr = (ch->old_ptr + 1) & CHORUS_DELAY_MASK;
    }
@@ -133,6 +195,8 @@ static void *chorus_init(const struct dspfilter_info *info,
    ch->input_rate = info->input_rate;
    if (!ch->lfo_period)
       ch->lfo_period = 1;
+   ch->lfo_cos = cos(2.0 * M_PI / ch->lfo_period);
+   ch->lfo_sin = sin(2.0 * M_PI / ch->lfo_period);
    return ch;
 }
 
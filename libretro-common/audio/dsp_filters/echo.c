@@ -25,6 +25,12 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+#include <arm_neon.h>
+#endif
+
 struct echo_channel
 {
    float *buffer;
@@ -51,6 +57,84 @@ static void echo_free(void *data)
    free(echo);
 }
 
+/**
+ * echo_process_run:
+ * @echo               : Echo filter.
+ * @out                : Interleaved stereo samples, processed in place.
+ * @samples            : Number of samples in @out.
+ *
+ * Runs @samples through the delay lines, none of which may wrap
+ * around in the meantime. Each delay line slot is then read and
+ * written exactly once, so the samples don't depend on each other
+ * and can be processed as a block.
+ **/
+static void echo_process_run(struct echo_data *echo,
+      float *out, unsigned samples)
+{
+   unsigned i = 0;
+   unsigned c;
+
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+   __m128 amp = _mm_set1_ps(echo->amp);
+
+   for (; i + 4 <= samples; i += 4)
+   {
+      __m128 in       = _mm_loadu_ps(out + i);
+      __m128 echo_out = _mm_setzero_ps();
+
+      for (c = 0; c < echo->num_channels; c++)
+         echo_out = _mm_add_ps(echo_out, _mm_loadu_ps(
+                  echo->channels[c].buffer + (echo->channels[c].ptr << 1) + i));
+
+      echo_out        = _mm_mul_ps(echo_out, amp);
+
+      for (c = 0; c < echo->num_channels; c++)
+         _mm_storeu_ps(
+               echo->channels[c].buffer + (echo->channels[c].ptr << 1) + i,
+               _mm_add_ps(in, _mm_mul_ps(
+                     _mm_set1_ps(echo->channels[c].feedback), echo_out)));
+
+      _mm_storeu_ps(out + i, _mm_add_ps(in, echo_out));
+   }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+   for (; i + 4 <= samples; i += 4)
+   {
+      float32x4_t in       = vld1q_f32(out + i);
+      float32x4_t echo_out = vdupq_n_f32(0.0f);
+
+      for (c = 0; c < echo->num_channels; c++)
+         echo_out = vaddq_f32(echo_out, vld1q_f32(
+                  echo->channels[c].buffer + (echo->channels[c].ptr << 1) + i));
+
+      echo_out             = vmulq_n_f32(echo_out, echo->amp);
+
+      for (c = 0; c < echo->num_channels; c++)
+         vst1q_f32(
+               echo->channels[c].buffer + (echo->channels[c].ptr << 1) + i,
+               vmlaq_n_f32(in, echo_out, echo->channels[c].feedback));
+
+      vst1q_f32(out + i, vaddq_f32(in, echo_out));
+   }
+#endif
+
+   for (; i < samples; i++)
+   {
+      float in       = out[i];
+      float echo_out = 0.0f;
+
+      for (c = 0; c < echo->num_channels; c++)
+         echo_out += echo->channels[c].buffer[(echo->channels[c].ptr << 1) + i];
+
+      echo_out      *= echo->amp;
+
+      for (c = 0; c < echo->num_channels; c++)
+         echo->channels[c].buffer[(echo->channels[c].ptr << 1) + i] =
+            in + echo->channels[c].feedback * echo_out;
+
+      out[i]         = in + echo_out;
+   }
+}
+
 static void echo_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
@@ -63,37 +147,28 @@ static void echo_process(void *data, struct dspfilter_output *output,
 
    out                    = output->samples;
 
-   for (i = 0; i < input->frames; i++, out += 2)
+   for (i = 0; i < input->frames; )
    {
-      float left, right;
-      float echo_left  = 0.0f;
-      float echo_right = 0.0f;
+      unsigned frames = input->frames - i;
 
       for (c = 0; c < echo->num_channels; c++)
       {
-         echo_left  += echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 0];
-         echo_right += echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 1];
+         unsigned left = echo->channels[c].frames - echo->channels[c].ptr;
+         if (left < frames)
+            frames = left;
       }
 
-      echo_left  *= echo->amp;
-      echo_right *= echo->amp;
-
-      left        = out[0] + echo_left;
-      right       = out[1] + echo_right;
+      echo_process_run(echo, out, frames << 1);
 
       for (c = 0; c < echo->num_channels; c++)
       {
-         float feedback_left  = out[0] + echo->channels[c].feedback * echo_left;
-         float feedback_right = out[1] + echo->channels[c].feedback * echo_right;
-
-         echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 0] = feedback_left;
-         echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 1] = feedback_right;
-
-         echo->channels[c].ptr = (echo->channels[c].ptr + 1) % echo->channels[c].frames;
+         echo->channels[c].ptr += frames;
+         if (echo->channels[c].ptr >= echo->channels[c].frames)
+            echo->channels[c].ptr = 0;
       }
 
-      out[0] = left;
-      out[1] = right;
+      out += frames << 1;
+      i   += frames;
    }
 }
 
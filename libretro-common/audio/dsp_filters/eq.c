@@ -24,23 +24,51 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <boolean.h>
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <filters.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+#include <arm_neon.h>
+#endif
+
 #include "fft/fft.c"
 
+/* The filter is applied by uniformly partitioned overlap-save
+ * convolution. It is cut into partitions of partition_size taps,
+ * each kept as the spectrum of an FFT twice that size. The spectra
+ * of the last partitions worth of input blocks are kept as well
+ * (the frequency-domain delay line), so each new block costs one
+ * FFT, one multiply-accumulate per partition and one inverse FFT,
+ * whatever the length of the filter.
+ *
+ * Both channels go through the same real filter, so they are
+ * packed into one complex signal, left in the real part and right
+ * in the imaginary part, and convolved together.
+ *
+ * Spectra are stored split, all real parts followed by all
+ * imaginary parts, which suits the SIMD multiply-accumulate. */
+
 struct eq_data
 {
    fft_t *fft;
-   float buffer[8 * 1024];
 
-   float *save;
-   float *block;
-   fft_complex_t *filter;
+   float *buffer;
+   unsigned buffer_frames;
+
+   fft_complex_t *block;    /* The last two input blocks. */
    fft_complex_t *fftblock;
-   unsigned block_size;
+   fft_complex_t *timeblock;
+   float *filter;           /* One spectrum per partition. */
+   float *fdl;              /* One spectrum per past input block. */
+   float *accum;
+   unsigned partition_size;
+   unsigned partitions;
+   unsigned fdl_ptr;
    unsigned block_ptr;
 };
 
@@ -57,13 +85,133 @@ static void eq_free(void *data)
       return;
 
    fft_free(eq->fft);
-   free(eq->save);
+   free(eq->buffer);
    free(eq->block);
    free(eq->fftblock);
+   free(eq->timeblock);
    free(eq->filter);
+   free(eq->fdl);
+   free(eq->accum);
    free(eq);
 }
 
+/**
+ * eq_complex_mac:
+ * @accum              : Accumulated spectrum.
+ * @a                  : Spectrum.
+ * @b                  : Spectrum.
+ * @size               : Number of bins, a multiple of 4.
+ *
+ * Adds the bin-wise product of @a and @b to @accum. All three
+ * are stored split, @size real parts followed by @size imaginary
+ * parts.
+ **/
+static void eq_complex_mac(float *accum,
+      const float *a, const float *b, unsigned size)
+{
+   unsigned i           = 0;
+   float *accum_im      = accum + size;
+   const float *a_im    = a + size;
+   const float *b_im    = b + size;
+
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+   for (; i < size; i += 4)
+   {
+      __m128 ar = _mm_loadu_ps(a + i);
+      __m128 ai = _mm_loadu_ps(a_im + i);
+      __m128 br = _mm_loadu_ps(b + i);
+      __m128 bi = _mm_loadu_ps(b_im + i);
+
+      _mm_storeu_ps(accum + i, _mm_add_ps(_mm_loadu_ps(accum + i),
+               _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi))));
+      _mm_storeu_ps(accum_im + i, _mm_add_ps(_mm_loadu_ps(accum_im + i),
+               _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br))));
+   }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+   for (; i < size; i += 4)
+   {
+      float32x4_t ar = vld1q_f32(a + i);
+      float32x4_t ai = vld1q_f32(a_im + i);
+      float32x4_t br = vld1q_f32(b + i);
+      float32x4_t bi = vld1q_f32(b_im + i);
+
+      vst1q_f32(accum + i, vaddq_f32(vld1q_f32(accum + i),
+               vsubq_f32(vmulq_f32(ar, br), vmulq_f32(ai, bi))));
+      vst1q_f32(accum_im + i, vaddq_f32(vld1q_f32(accum_im + i),
+               vaddq_f32(vmulq_f32(ar, bi), vmulq_f32(ai, br))));
+   }
+#endif
+
+   for (; i < size; i++)
+   {
+      accum[i]    += a[i] * b[i] - a_im[i] * b_im[i];
+      accum_im[i] += a[i] * b_im[i] + a_im[i] * b[i];
+   }
+}
+
+static void eq_split(float *out, const fft_complex_t *in, unsigned size)
+{
+   unsigned i;
+   for (i = 0; i < size; i++)
+   {
+      out[i]        = in[i].real;
+      out[i + size] = in[i].imag;
+   }
+}
+
+static void eq_merge(fft_complex_t *out, const float *in, unsigned size)
+{
+   unsigned i;
+   for (i = 0; i < size; i++)
+   {
+      out[i].real = in[i];
+      out[i].imag = in[i + size];
+   }
+}
+
+/**
+ * eq_convolve:
+ * @eq                 : EQ.
+ * @out                : partition_size stereo frames of output.
+ *
+ * Convolves the input block that was just completed.
+ **/
+static void eq_convolve(struct eq_data *eq, float *out)
+{
+   unsigned p;
+   unsigned size     = eq->partition_size * 2;
+   size_t spectrum   = size * 2;
+
+   fft_process_forward_complex(eq->fft, eq->fftblock, eq->block, 1);
+
+   /* The newest spectrum goes first, the oldest one is dropped. */
+   eq->fdl_ptr = eq->fdl_ptr ? eq->fdl_ptr - 1 : eq->partitions - 1;
+   eq_split(eq->fdl + eq->fdl_ptr * spectrum, eq->fftblock, size);
+
+   memset(eq->accum, 0, spectrum * sizeof(float));
+
+   for (p = 0; p < eq->partitions; p++)
+   {
+      unsigned fdl = eq->fdl_ptr + p;
+      if (fdl >= eq->partitions)
+         fdl -= eq->partitions;
+
+      eq_complex_mac(eq->accum,
+            eq->fdl + fdl * spectrum, eq->filter + p * spectrum, size);
+   }
+
+   eq_merge(eq->fftblock, eq->accum, size);
+   fft_process_inverse_complex(eq->fft, eq->timeblock, eq->fftblock, 1);
+
+   /* Overlap-save, only the second half is free of wrap-around. */
+   memcpy(out, eq->timeblock + eq->partition_size,
+         eq->partition_size * sizeof(fft_complex_t));
+
+   /* Slide the input along for the next block. */
+   memcpy(eq->block, eq->block + eq->partition_size,
+         eq->partition_size * sizeof(fft_complex_t));
+}
+
 static void eq_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
@@ -71,6 +219,24 @@ static void eq_process(void *data, struct dspfilter_output *output,
    const float *in;
    unsigned input_frames;
    struct eq_data *eq = (struct eq_data*)data;
+   unsigned max_frames = input->frames + eq->partition_size;
+
+   if (max_frames > eq->buffer_frames)
+   {
+      float *buffer = (float*)realloc(eq->buffer,
+            max_frames * 2 * sizeof(float));
+
+      if (!buffer)
+      {
+         /* Let the block through unfiltered. */
+         output->samples = input->samples;
+         output->frames  = input->frames;
+         return;
+      }
+
+      eq->buffer        = buffer;
+      eq->buffer_frames = max_frames;
+   }
 
    output->samples    = eq->buffer;
    output->frames     = 0;
@@ -81,40 +247,27 @@ static void eq_process(void *data, struct dspfilter_output *output,
 
    while (input_frames)
    {
-      unsigned write_avail = eq->block_size - eq->block_ptr;
+      unsigned write_avail = eq->partition_size - eq->block_ptr;
 
       if (input_frames < write_avail)
          write_avail = input_frames;
 
-      memcpy(eq->block + eq->block_ptr * 2, in, write_avail * 2 * sizeof(float));
+      /* Interleaved stereo is already laid out as left + i * right. */
+      memcpy(eq->block + eq->partition_size + eq->block_ptr, in,
+            write_avail * 2 * sizeof(float));
 
-      in += write_avail * 2;
-      input_frames -= write_avail;
+      in            += write_avail * 2;
+      input_frames  -= write_avail;
       eq->block_ptr += write_avail;
 
-      // Convolve a new block.
-      if (eq->block_ptr == eq->block_size)
+      /* Convolve a new block. */
+      if (eq->block_ptr == eq->partition_size)
       {
-         unsigned i, c;
+         eq_convolve(eq, out);
 
-         for (c = 0; c < 2; c++)
-         {
-            fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
-            fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
-         }
-
-         // Overlap add method, so add in saved block now.
-         for (i = 0; i < 2 * eq->block_size; i++)
-            out[i] += eq->save[i];
-
-         // Save block for later.
-         memcpy(eq->save, out + 2 * eq->block_size, 2 * eq->block_size * sizeof(float));
-
-         out += eq->block_size * 2;
-         output->frames += eq->block_size;
-         eq->block_ptr = 0;
+         out            += eq->partition_size * 2;
+         output->frames += eq->partition_size;
+         eq->block_ptr   = 0;
       }
    }
 }
@@ -191,26 +344,44 @@ static void generate_response(fft_complex_t *response,
    }
 }
 
-static void create_filter(struct eq_data *eq, unsigned size_log2,
-      struct eq_gain *gains, unsigned num_gains, double beta, const char *filter_path)
+/**
+ * create_filter:
+ * @taps               : Receives (1 << @size_log2) - 1 coefficients.
+ * @size_log2          : Log2 of the design block size.
+ * @gains              : Frequency sample points.
+ * @num_gains          : Number of elements in @gains.
+ * @beta               : Kaiser window beta.
+ * @filter_path        : Where to dump the coefficients, or NULL.
+ *
+ * Designs a linear phase FIR filter approximating @gains.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool create_filter(float *taps, unsigned size_log2,
+      struct eq_gain *gains, unsigned num_gains, double beta,
+      const char *filter_path)
 {
    int i;
-   int half_block_size = eq->block_size >> 1;
-   double window_mod = 1.0 / kaiser_window_function(0.0, beta);
-
-   fft_t *fft = fft_new(size_log2);
-   float *time_filter = (float*)calloc(eq->block_size * 2 + 1, sizeof(*time_filter));
-   if (!fft || !time_filter)
+   bool ret                  = false;
+   int block_size            = 1 << size_log2;
+   int half_block_size       = block_size >> 1;
+   double window_mod         = 1.0 / kaiser_window_function(0.0, beta);
+
+   fft_t *fft                = fft_new(size_log2);
+   float *time_filter        = (float*)calloc(block_size, sizeof(*time_filter));
+   fft_complex_t *response   = (fft_complex_t*)calloc(block_size + 1,
+         sizeof(*response));
+   if (!fft || !time_filter || !response)
       goto end;
 
    /* Make sure bands are in correct order. */
    qsort(gains, num_gains, sizeof(*gains), gains_cmp);
 
    /* Compute desired filter response. */
-   generate_response(eq->filter, gains, num_gains, half_block_size);
+   generate_response(response, gains, num_gains, half_block_size);
 
    /* Get equivalent time-domain filter. */
-   fft_process_inverse(fft, time_filter, eq->filter, 1);
+   fft_process_inverse(fft, time_filter, response, 1);
 
    /* ifftshift() to create the correct linear phase filter.
     * The filter response was designed with zero phase, which
@@ -225,46 +396,146 @@ static void create_filter(struct eq_data *eq, unsigned size_log2,
    }
 
    /* Apply a window to smooth out the frequency repsonse. */
-   for (i = 0; i < (int)eq->block_size; i++)
+   for (i = 0; i < block_size; i++)
    {
       /* Kaiser window. */
-      double phase = (double)i / eq->block_size;
+      double phase = (double)i / block_size;
       phase = 2.0 * (phase - 0.5);
       time_filter[i] *= window_mod * kaiser_window_function(phase, beta);
    }
 
+   /* Make our even-length filter odd by discarding the first coefficient.
+    * For some interesting reason, this allows us to design an odd-length linear phase filter.
+    */
+   memcpy(taps, time_filter + 1, (block_size - 1) * sizeof(*taps));
+
    /* Debugging. */
    if (filter_path)
    {
       FILE *file = fopen(filter_path, "w");
       if (file)
       {
-         for (i = 0; i < (int)eq->block_size - 1; i++)
-            fprintf(file, "%.8f\n", time_filter[i + 1]);
+         for (i = 0; i < block_size - 1; i++)
+            fprintf(file, "%.8f\n", taps[i]);
          fclose(file);
       }
    }
 
-   /* Padded FFT to create our FFT filter.
-    * Make our even-length filter odd by discarding the first coefficient.
-    * For some interesting reason, this allows us to design an odd-length linear phase filter.
-    */
-   fft_process_forward(eq->fft, eq->filter, time_filter + 1, 1);
+   ret = true;
 
 end:
    fft_free(fft);
    free(time_filter);
+   free(response);
+   return ret;
+}
+
+/**
+ * load_filter:
+ * @path               : Plain-text file with one coefficient per line,
+ *                       as written by impulse_response_output.
+ * @num_taps           : Receives the number of coefficients.
+ *
+ * Returns: the coefficients, to be freed with free(), or NULL on error.
+ **/
+static float *load_filter(const char *path, unsigned *num_taps)
+{
+   float tap;
+   unsigned size  = 0;
+   unsigned count = 0;
+   float *taps    = NULL;
+   FILE *file     = fopen(path, "r");
+   if (!file)
+      return NULL;
+
+   while (fscanf(file, "%f", &tap) == 1)
+   {
+      if (count == size)
+      {
+         float *new_taps;
+         size     = size ? size * 2 : 1024;
+         new_taps = (float*)realloc(taps, size * sizeof(*taps));
+         if (!new_taps)
+            goto error;
+         taps     = new_taps;
+      }
+
+      taps[count++] = tap;
+   }
+
+   if (!count)
+      goto error;
+
+   fclose(file);
+   *num_taps = count;
+   return taps;
+
+error:
+   fclose(file);
+   free(taps);
+   return NULL;
+}
+
+/**
+ * set_filter:
+ * @eq                 : EQ.
+ * @taps               : Filter coefficients.
+ * @num_taps           : Number of elements in @taps.
+ *
+ * Cuts @taps into partitions and allocates the frequency-domain
+ * state for them.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool set_filter(struct eq_data *eq,
+      const float *taps, unsigned num_taps)
+{
+   unsigned p;
+   unsigned size   = eq->partition_size * 2;
+   size_t spectrum = size * 2;
+   float *padded   = (float*)calloc(size, sizeof(*padded));
+   if (!padded)
+      return false;
+
+   eq->partitions  = (num_taps + eq->partition_size - 1) / eq->partition_size;
+   eq->filter      = (float*)calloc(eq->partitions * spectrum, sizeof(float));
+   eq->fdl         = (float*)calloc(eq->partitions * spectrum, sizeof(float));
+   eq->accum       = (float*)calloc(spectrum, sizeof(float));
+
+   if (!eq->filter || !eq->fdl || !eq->accum)
+   {
+      free(padded);
+      return false;
+   }
+
+   for (p = 0; p < eq->partitions; p++)
+   {
+      unsigned offset = p * eq->partition_size;
+      unsigned count  = MIN(eq->partition_size, num_taps - offset);
+
+      /* Zero-padding makes circular convolution => proper convolution. */
+      memcpy(padded, taps + offset, count * sizeof(*padded));
+      memset(padded + count, 0, (size - count) * sizeof(*padded));
+
+      fft_process_forward(eq->fft, eq->fftblock, padded, 1);
+      eq_split(eq->filter + p * spectrum, eq->fftblock, size);
+   }
+
+   free(padded);
+   return true;
 }
 
 static void *eq_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
    float *frequencies, *gain;
-   unsigned num_freq, num_gain, i, size;
-   int size_log2;
+   unsigned num_freq, num_gain, i, size, num_taps;
+   int size_log2, partition_size_log2;
    float beta;
    struct eq_gain *gains = NULL;
+   float *taps = NULL;
    char *filter_path = NULL;
+   char *response_path = NULL;
    const float default_freq[] = { 0.0f, info->input_rate };
    const float default_gain[] = { 0.0f, 0.0f };
    struct eq_data *eq = (struct eq_data*)calloc(1, sizeof(*eq));
@@ -275,8 +546,15 @@ static void *eq_init(const struct dspfilter_info *info,
    config->get_float(userdata, "window_beta", &beta, 4.0f);
 
    config->get_int(userdata, "block_size_log2", &size_log2, 8);
+   size_log2 = MAX(MIN(size_log2, 16), 2);
    size = 1 << size_log2;
 
+   /* Partitions default to the design block size, which gives the
+    * same latency as a single FFT over the whole filter. */
+   config->get_int(userdata, "partition_size_log2",
+         &partition_size_log2, size_log2);
+   partition_size_log2 = MAX(MIN(partition_size_log2, 16), 2);
+
    config->get_float_array(userdata, "frequencies", &frequencies, &num_freq, default_freq, 2);
    config->get_float_array(userdata, "gains", &gain, &num_gain, default_gain, 2);
 
@@ -286,6 +564,12 @@ static void *eq_init(const struct dspfilter_info *info,
       filter_path = NULL;
    }
 
+   if (!config->get_string(userdata, "impulse_response", &response_path, ""))
+   {
+      config->free(response_path);
+      response_path = NULL;
+   }
+
    num_gain = num_freq = MIN(num_gain, num_freq);
 
    gains = (struct eq_gain*)calloc(num_gain, sizeof(*gains));
@@ -300,29 +584,46 @@ static void *eq_init(const struct dspfilter_info *info,
    config->free(frequencies);
    config->free(gain);
 
-   eq->block_size = size;
+   eq->partition_size = 1 << partition_size_log2;
 
-   eq->save     = (float*)calloc(    size, 2 * sizeof(*eq->save));
-   eq->block    = (float*)calloc(2 * size, 2 * sizeof(*eq->block));
-   eq->fftblock = (fft_complex_t*)calloc(2 * size, sizeof(*eq->fftblock));
-   eq->filter   = (fft_complex_t*)calloc(2 * size, sizeof(*eq->filter));
+   eq->block     = (fft_complex_t*)calloc(2 * eq->partition_size, sizeof(*eq->block));
+   eq->fftblock  = (fft_complex_t*)calloc(2 * eq->partition_size, sizeof(*eq->fftblock));
+   eq->timeblock = (fft_complex_t*)calloc(2 * eq->partition_size, sizeof(*eq->timeblock));
 
-   /* Use an FFT which is twice the block size with zero-padding
+   /* Use an FFT which is twice the partition size with zero-padding
     * to make circular convolution => proper convolution.
     */
-   eq->fft = fft_new(size_log2 + 1);
+   eq->fft = fft_new(partition_size_log2 + 1);
 
-   if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter)
+   if (!eq->fft || !eq->block || !eq->fftblock || !eq->timeblock)
       goto error;
 
-   create_filter(eq, size_log2, gains, num_gain, beta, filter_path);
-   config->free(filter_path);
-   filter_path = NULL;
+   /* A measured impulse response replaces the designed filter. */
+   if (response_path)
+      taps = load_filter(response_path, &num_taps);
 
+   if (!taps)
+   {
+      num_taps = size - 1;
+      taps     = (float*)malloc(num_taps * sizeof(*taps));
+      if (!taps || !create_filter(taps, size_log2,
+               gains, num_gain, beta, filter_path))
+         goto error;
+   }
+
+   if (!set_filter(eq, taps, num_taps))
+      goto error;
+
+   config->free(filter_path);
+   config->free(response_path);
+   free(taps);
    free(gains);
    return eq;
 
 error:
+   config->free(filter_path);
+   config->free(response_path);
+   free(taps);
    free(gains);
    eq_free(eq);
    return NULL;
@@ -96,6 +96,17 @@ static void resolve_float(float *out, const fft_complex_t *in, unsigned samples,
       *out = gain * in->real;
 }
 
+static void resolve_complex(fft_complex_t *out, const fft_complex_t *in,
+      unsigned samples, float gain, unsigned step)
+{
+   unsigned i;
+   for (i = 0; i < samples; i++, in++, out += step)
+   {
+      out->real = gain * in->real;
+      out->imag = gain * in->imag;
+   }
+}
+
 fft_t *fft_new(unsigned block_size_log2)
 {
    unsigned size;
@@ -203,3 +214,21 @@ void fft_process_inverse(fft_t *fft,
    resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
 }
 
+void fft_process_inverse_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   unsigned step_size;
+   unsigned samples = fft->size;
+
+   interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer,
+         in, samples, 1);
+
+   for (step_size = 1; step_size < samples; step_size <<= 1)
+   {
+      butterflies(fft->interleave_buffer,
+            fft->phase_lut + samples,
+            1, step_size, samples);
+   }
+
+   resolve_complex(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+}
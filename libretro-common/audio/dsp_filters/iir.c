@@ -28,6 +28,12 @@
 #include <libretro_dspfilter.h>
 #include <string/stdstring.h>
 
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+#include <arm_neon.h>
+#endif
+
 #define sqr(a) ((a) * (a))
 
 /* filter types */
@@ -49,8 +55,9 @@ enum IIRFilter
 
 struct iir_data
 {
+   /* Normalised, so that a0 is 1. */
    float b0, b1, b2;
-   float a0, a1, a2;
+   float a1, a2;
 
    struct
    {
@@ -69,59 +76,155 @@ static void iir_process(void *data, struct dspfilter_output *output,
 {
    unsigned i;
    struct iir_data *iir = (struct iir_data*)data;
-   float *out           = output->samples;
-
-   float b0             = iir->b0;
-   float b1             = iir->b1;
-   float b2             = iir->b2;
-   float a0             = iir->a0;
-   float a1             = iir->a1;
-   float a2             = iir->a2;
-
-   float xn1_l          = iir->l.xn1;
-   float xn2_l          = iir->l.xn2;
-   float yn1_l          = iir->l.yn1;
-   float yn2_l          = iir->l.yn2;
-
-   float xn1_r          = iir->r.xn1;
-   float xn2_r          = iir->r.xn2;
-   float yn1_r          = iir->r.yn1;
-   float yn2_r          = iir->r.yn2;
+   float *out           = NULL;
 
    output->samples      = input->samples;
    output->frames       = input->frames;
+   out                  = output->samples;
+
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+   {
+      /* Both channels run through the biquad together,
+       * left in lane 0 and right in lane 1. */
+      __m128 b0  = _mm_set1_ps(iir->b0);
+      __m128 b1  = _mm_set1_ps(iir->b1);
+      __m128 b2  = _mm_set1_ps(iir->b2);
+      __m128 a1  = _mm_set1_ps(iir->a1);
+      __m128 a2  = _mm_set1_ps(iir->a2);
+      __m128 xn1 = _mm_setr_ps(iir->l.xn1, iir->r.xn1, 0.0f, 0.0f);
+      __m128 xn2 = _mm_setr_ps(iir->l.xn2, iir->r.xn2, 0.0f, 0.0f);
+      __m128 yn1 = _mm_setr_ps(iir->l.yn1, iir->r.yn1, 0.0f, 0.0f);
+      __m128 yn2 = _mm_setr_ps(iir->l.yn2, iir->r.yn2, 0.0f, 0.0f);
+      float state[4];
+
+      for (i = 0; i < input->frames; i++, out += 2)
+      {
+         __m128 in = _mm_castpd_ps(_mm_load_sd((const double*)out));
+         __m128 y  = _mm_add_ps(_mm_mul_ps(b0, in), _mm_mul_ps(b1, xn1));
+         y         = _mm_add_ps(y, _mm_mul_ps(b2, xn2));
+         y         = _mm_sub_ps(y, _mm_mul_ps(a1, yn1));
+         y         = _mm_sub_ps(y, _mm_mul_ps(a2, yn2));
+
+         xn2       = xn1;
+         xn1       = in;
+         yn2       = yn1;
+         yn1       = y;
+
+         _mm_store_sd((double*)out, _mm_castps_pd(y));
+      }
+
+      _mm_storeu_ps(state, xn1);
+      iir->l.xn1 = state[0];
+      iir->r.xn1 = state[1];
+      _mm_storeu_ps(state, xn2);
+      iir->l.xn2 = state[0];
+      iir->r.xn2 = state[1];
+      _mm_storeu_ps(state, yn1);
+      iir->l.yn1 = state[0];
+      iir->r.yn1 = state[1];
+      _mm_storeu_ps(state, yn2);
+      iir->l.yn2 = state[0];
+      iir->r.yn2 = state[1];
+   }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+   {
+      float state[2];
+      float32x2_t xn1, xn2, yn1, yn2;
+
+      state[0] = iir->l.xn1;
+      state[1] = iir->r.xn1;
+      xn1      = vld1_f32(state);
+      state[0] = iir->l.xn2;
+      state[1] = iir->r.xn2;
+      xn2      = vld1_f32(state);
+      state[0] = iir->l.yn1;
+      state[1] = iir->r.yn1;
+      yn1      = vld1_f32(state);
+      state[0] = iir->l.yn2;
+      state[1] = iir->r.yn2;
+      yn2      = vld1_f32(state);
+
+      for (i = 0; i < input->frames; i++, out += 2)
+      {
+         float32x2_t in = vld1_f32(out);
+         float32x2_t y  = vmul_n_f32(in, iir->b0);
+         y              = vmla_n_f32(y, xn1, iir->b1);
+         y              = vmla_n_f32(y, xn2, iir->b2);
+         y              = vmls_n_f32(y, yn1, iir->a1);
+         y              = vmls_n_f32(y, yn2, iir->a2);
+
+         xn2            = xn1;
+         xn1            = in;
+         yn2            = yn1;
+         yn1            = y;
+
+         vst1_f32(out, y);
+      }
 
-   for (i = 0; i < input->frames; i++, out += 2)
+      vst1_f32(state, xn1);
+      iir->l.xn1 = state[0];
+      iir->r.xn1 = state[1];
+      vst1_f32(state, xn2);
+      iir->l.xn2 = state[0];
+      iir->r.xn2 = state[1];
+      vst1_f32(state, yn1);
+      iir->l.yn1 = state[0];
+      iir->r.yn1 = state[1];
+      vst1_f32(state, yn2);
+      iir->l.yn2 = state[0];
+      iir->r.yn2 = state[1];
+   }
+#else
    {
-      float in_l = out[0];
-      float in_r = out[1];
+      float b0    = iir->b0;
+      float b1    = iir->b1;
+      float b2    = iir->b2;
+      float a1    = iir->a1;
+      float a2    = iir->a2;
+
+      float xn1_l = iir->l.xn1;
+      float xn2_l = iir->l.xn2;
+      float yn1_l = iir->l.yn1;
+      float yn2_l = iir->l.yn2;
+
+      float xn1_r = iir->r.xn1;
+      float xn2_r = iir->r.xn2;
+      float yn1_r = iir->r.yn1;
+      float yn2_r = iir->r.yn2;
+
+      for (i = 0; i < input->frames; i++, out += 2)
+      {
+         float in_l = out[0];
+         float in_r = out[1];
 
-      float l    = (b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l) / a0;
-      float r    = (b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r) / a0;
+         float l    = b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l;
+         float r    = b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r;
 
-      xn2_l      = xn1_l;
-      xn1_l      = in_l;
-      yn2_l      = yn1_l;
-      yn1_l      = l;
+         xn2_l      = xn1_l;
+         xn1_l      = in_l;
+         yn2_l      = yn1_l;
+         yn1_l      = l;
 
-      xn2_r      = xn1_r;
-      xn1_r      = in_r;
-      yn2_r      = yn1_r;
-      yn1_r      = r;
+         xn2_r      = xn1_r;
+         xn1_r      = in_r;
+         yn2_r      = yn1_r;
+         yn1_r      = r;
 
-      out[0]     = l;
-      out[1]     = r;
-   }
+         out[0]     = l;
+         out[1]     = r;
+      }
 
-   iir->l.xn1 = xn1_l;
-   iir->l.xn2 = xn2_l;
-   iir->l.yn1 = yn1_l;
-   iir->l.yn2 = yn2_l;
+      iir->l.xn1 = xn1_l;
+      iir->l.xn2 = xn2_l;
+      iir->l.yn1 = yn1_l;
+      iir->l.yn2 = yn2_l;
 
-   iir->r.xn1 = xn1_r;
-   iir->r.xn2 = xn2_r;
-   iir->r.yn1 = yn1_r;
-   iir->r.yn2 = yn2_r;
+      iir->r.xn1 = xn1_r;
+      iir->r.xn2 = xn2_r;
+      iir->r.yn1 = yn1_r;
+      iir->r.yn2 = yn2_r;
+   }
+#endif
 }
 
 #define CHECK(x) if (string_is_equal(str, #x)) return x
@@ -317,12 +420,13 @@ static void iir_filter_init(struct iir_data *iir,
          break;
    }
 
-   iir->b0 = b0;
-   iir->b1 = b1;
-   iir->b2 = b2;
-   iir->a0 = a0;
-   iir->a1 = a1;
-   iir->a2 = a2;
+   /* Fold the division by a0 into the coefficients,
+    * so that processing doesn't need one per sample. */
+   iir->b0 = b0 / a0;
+   iir->b1 = b1 / a0;
+   iir->b2 = b2 / a0;
+   iir->a1 = a1 / a0;
+   iir->a2 = a2 / a0;
 }
 
 static void *iir_init(const struct dspfilter_info *info,
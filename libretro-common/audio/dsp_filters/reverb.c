@@ -24,17 +24,27 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <boolean.h>
 #include <retro_inline.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+#include <arm_neon.h>
+#endif
+
+/* Both channels share the same delay lengths, so they are
+ * processed together, with their delay lines interleaved. */
+
 struct comb
 {
    float *buffer;
-   unsigned bufsize;
+   unsigned bufsize; /* In frames. */
    unsigned bufidx;
 
    float feedback;
-   float filterstore;
+   float filterstore[2];
    float damp1, damp2;
 };
 
@@ -42,36 +52,44 @@ struct allpass
 {
    float *buffer;
    float feedback;
-   unsigned bufsize;
+   unsigned bufsize; /* In frames. */
    unsigned bufidx;
 };
 
-static INLINE float comb_process(struct comb *c, float input)
+static INLINE void comb_process(struct comb *c,
+      const float *input, float *output)
 {
-   float output         = c->buffer[c->bufidx];
-   c->filterstore       = (output * c->damp2) + (c->filterstore * c->damp1);
+   unsigned ch;
+   float *buffer = c->buffer + (c->bufidx << 1);
 
-   c->buffer[c->bufidx] = input + (c->filterstore * c->feedback);
+   for (ch = 0; ch < 2; ch++)
+   {
+      output[ch]         = buffer[ch];
+      c->filterstore[ch] = (output[ch] * c->damp2) + (c->filterstore[ch] * c->damp1);
+      buffer[ch]         = input[ch] + (c->filterstore[ch] * c->feedback);
+   }
 
    c->bufidx++;
    if (c->bufidx >= c->bufsize)
       c->bufidx = 0;
-
-   return output;
 }
 
-
-static INLINE float allpass_process(struct allpass *a, float input)
+static INLINE void allpass_process(struct allpass *a, float *samples)
 {
-   float bufout         = a->buffer[a->bufidx];
-   float output         = -input + bufout;
-   a->buffer[a->bufidx] = input + bufout * a->feedback;
+   unsigned ch;
+   float *buffer = a->buffer + (a->bufidx << 1);
+
+   for (ch = 0; ch < 2; ch++)
+   {
+      float bufout = buffer[ch];
+      float input  = samples[ch];
+      samples[ch]  = -input + bufout;
+      buffer[ch]   = input + bufout * a->feedback;
+   }
 
    a->bufidx++;
    if (a->bufidx >= a->bufsize)
       a->bufidx = 0;
-
-   return output;
 }
 
 #define numcombs 8
@@ -93,11 +111,8 @@ static const float freezemode = 0.5f;
 
 struct revmodel
 {
-   struct comb combL[numcombs];
-   struct allpass allpassL[numallpasses];
-
-   float **bufcomb;
-   float **bufallpass;
+   struct comb comb[numcombs];
+   struct allpass allpass[numallpasses];
 
    float gain;
    float roomsize, roomsize1;
@@ -108,20 +123,192 @@ struct revmodel
    float mode;
 };
 
-static float revmodel_process(struct revmodel *rev, float in)
+/* The comb bank is summed as two halves, in the same order
+ * by every implementation below. */
+static void revmodel_process(struct revmodel *rev,
+      float *samples, unsigned frames)
 {
-   int i;
-   float mono_out = 0.0f;
-   float mono_in  = in;
-   float input    = mono_in * rev->gain;
-
-   for (i = 0; i < numcombs; i++)
-      mono_out += comb_process(&rev->combL[i], input);
+   unsigned i, c;
+#if defined(__SSE2__) && !defined(DSPFILTER_NO_SIMD)
+   /* Lanes hold left and right of comb c in the low half,
+    * and of comb c + numcombs / 2 in the high half. */
+   __m128 filterstore[numcombs / 2];
+   __m128 gain     = _mm_set1_ps(rev->gain);
+   __m128 dry      = _mm_set1_ps(rev->dry);
+   __m128 wet1     = _mm_set1_ps(rev->wet1);
+   __m128 damp1    = _mm_set1_ps(rev->comb[0].damp1);
+   __m128 damp2    = _mm_set1_ps(rev->comb[0].damp2);
+   __m128 feedback = _mm_set1_ps(rev->comb[0].feedback);
+
+   for (c = 0; c < numcombs / 2; c++)
+      filterstore[c] = _mm_setr_ps(
+            rev->comb[c].filterstore[0],
+            rev->comb[c].filterstore[1],
+            rev->comb[c + numcombs / 2].filterstore[0],
+            rev->comb[c + numcombs / 2].filterstore[1]);
+
+   for (i = 0; i < frames; i++, samples += 2)
+   {
+      __m128 in       = _mm_castpd_ps(_mm_load_sd((const double*)samples));
+      __m128 input    = _mm_mul_ps(in, gain);
+      __m128 mono_out = _mm_setzero_ps();
+
+      input           = _mm_movelh_ps(input, input);
+
+      for (c = 0; c < numcombs / 2; c++)
+      {
+         struct comb *lo = &rev->comb[c];
+         struct comb *hi = &rev->comb[c + numcombs / 2];
+         float *buf_lo   = lo->buffer + (lo->bufidx << 1);
+         float *buf_hi   = hi->buffer + (hi->bufidx << 1);
+         __m128 output   = _mm_loadh_pi(
+               _mm_castpd_ps(_mm_load_sd((const double*)buf_lo)),
+               (const __m64*)buf_hi);
+
+         filterstore[c]  = _mm_add_ps(_mm_mul_ps(output, damp2),
+               _mm_mul_ps(filterstore[c], damp1));
+         mono_out        = _mm_add_ps(mono_out, output);
+
+         output          = _mm_add_ps(input,
+               _mm_mul_ps(filterstore[c], feedback));
+         _mm_storel_pi((__m64*)buf_lo, output);
+         _mm_storeh_pi((__m64*)buf_hi, output);
+
+         if (++lo->bufidx >= lo->bufsize)
+            lo->bufidx = 0;
+         if (++hi->bufidx >= hi->bufsize)
+            hi->bufidx = 0;
+      }
+
+      mono_out = _mm_add_ps(mono_out, _mm_movehl_ps(mono_out, mono_out));
+
+      for (c = 0; c < numallpasses; c++)
+      {
+         struct allpass *a = &rev->allpass[c];
+         float *buffer     = a->buffer + (a->bufidx << 1);
+         __m128 bufout     = _mm_castpd_ps(_mm_load_sd((const double*)buffer));
+
+         _mm_store_sd((double*)buffer, _mm_castps_pd(_mm_add_ps(mono_out,
+                     _mm_mul_ps(bufout, _mm_set1_ps(a->feedback)))));
+         mono_out          = _mm_sub_ps(bufout, mono_out);
+
+         if (++a->bufidx >= a->bufsize)
+            a->bufidx = 0;
+      }
+
+      _mm_store_sd((double*)samples, _mm_castps_pd(_mm_add_ps(
+                  _mm_mul_ps(in, dry), _mm_mul_ps(mono_out, wet1))));
+   }
 
-   for (i = 0; i < numallpasses; i++)
-      mono_out = allpass_process(&rev->allpassL[i], mono_out);
+   for (c = 0; c < numcombs / 2; c++)
+   {
+      float store[4];
+      _mm_storeu_ps(store, filterstore[c]);
+      rev->comb[c].filterstore[0]                = store[0];
+      rev->comb[c].filterstore[1]                = store[1];
+      rev->comb[c + numcombs / 2].filterstore[0] = store[2];
+      rev->comb[c + numcombs / 2].filterstore[1] = store[3];
+   }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DSPFILTER_NO_SIMD)
+   /* Same lane layout as the SSE2 path. */
+   float32x4_t filterstore[numcombs / 2];
+   float damp1    = rev->comb[0].damp1;
+   float damp2    = rev->comb[0].damp2;
+   float feedback = rev->comb[0].feedback;
+
+   for (c = 0; c < numcombs / 2; c++)
+      filterstore[c] = vcombine_f32(
+            vld1_f32(rev->comb[c].filterstore),
+            vld1_f32(rev->comb[c + numcombs / 2].filterstore));
+
+   for (i = 0; i < frames; i++, samples += 2)
+   {
+      float32x2_t in      = vld1_f32(samples);
+      float32x2_t input2  = vmul_n_f32(in, rev->gain);
+      float32x4_t input   = vcombine_f32(input2, input2);
+      float32x4_t sum     = vdupq_n_f32(0.0f);
+      float32x2_t mono_out;
+
+      for (c = 0; c < numcombs / 2; c++)
+      {
+         struct comb *lo    = &rev->comb[c];
+         struct comb *hi    = &rev->comb[c + numcombs / 2];
+         float *buf_lo      = lo->buffer + (lo->bufidx << 1);
+         float *buf_hi      = hi->buffer + (hi->bufidx << 1);
+         float32x4_t output = vcombine_f32(vld1_f32(buf_lo), vld1_f32(buf_hi));
+
+         filterstore[c]     = vmlaq_n_f32(vmulq_n_f32(output, damp2),
+               filterstore[c], damp1);
+         sum                = vaddq_f32(sum, output);
+
+         output             = vmlaq_n_f32(input, filterstore[c], feedback);
+         vst1_f32(buf_lo, vget_low_f32(output));
+         vst1_f32(buf_hi, vget_high_f32(output));
+
+         if (++lo->bufidx >= lo->bufsize)
+            lo->bufidx = 0;
+         if (++hi->bufidx >= hi->bufsize)
+            hi->bufidx = 0;
+      }
+
+      mono_out = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+
+      for (c = 0; c < numallpasses; c++)
+      {
+         struct allpass *a  = &rev->allpass[c];
+         float *buffer      = a->buffer + (a->bufidx << 1);
+         float32x2_t bufout = vld1_f32(buffer);
+
+         vst1_f32(buffer, vmla_n_f32(mono_out, bufout, a->feedback));
+         mono_out           = vsub_f32(bufout, mono_out);
+
+         if (++a->bufidx >= a->bufsize)
+            a->bufidx = 0;
+      }
+
+      vst1_f32(samples, vmla_n_f32(vmul_n_f32(in, rev->dry),
+               mono_out, rev->wet1));
+   }
 
-   return mono_in * rev->dry + mono_out * rev->wet1;
+   for (c = 0; c < numcombs / 2; c++)
+   {
+      vst1_f32(rev->comb[c].filterstore, vget_low_f32(filterstore[c]));
+      vst1_f32(rev->comb[c + numcombs / 2].filterstore,
+            vget_high_f32(filterstore[c]));
+   }
+#else
+   for (i = 0; i < frames; i++, samples += 2)
+   {
+      unsigned ch;
+      float input[2], output[2];
+      float mono_lo[2] = { 0.0f, 0.0f };
+      float mono_hi[2] = { 0.0f, 0.0f };
+      float mono_out[2];
+
+      input[0] = samples[0] * rev->gain;
+      input[1] = samples[1] * rev->gain;
+
+      for (c = 0; c < numcombs / 2; c++)
+      {
+         comb_process(&rev->comb[c], input, output);
+         mono_lo[0] += output[0];
+         mono_lo[1] += output[1];
+
+         comb_process(&rev->comb[c + numcombs / 2], input, output);
+         mono_hi[0] += output[0];
+         mono_hi[1] += output[1];
+      }
+
+      mono_out[0] = mono_lo[0] + mono_hi[0];
+      mono_out[1] = mono_lo[1] + mono_hi[1];
+
+      for (c = 0; c < numallpasses; c++)
+         allpass_process(&rev->allpass[c], mono_out);
+
+      for (ch = 0; ch < 2; ch++)
+         samples[ch] = samples[ch] * rev->dry + mono_out[ch] * rev->wet1;
+   }
+#endif
 }
 
 static void revmodel_update(struct revmodel *rev)
@@ -144,9 +331,9 @@ static void revmodel_update(struct revmodel *rev)
 
    for (i = 0; i < numcombs; i++)
    {
-      rev->combL[i].feedback = rev->roomsize1;
-      rev->combL[i].damp1 = rev->damp1;
-      rev->combL[i].damp2 = 1.0f - rev->damp1;
+      rev->comb[i].feedback = rev->roomsize1;
+      rev->comb[i].damp1 = rev->damp1;
+      rev->comb[i].damp2 = 1.0f - rev->damp1;
    }
 }
 
@@ -186,34 +373,35 @@ static void revmodel_setmode(struct revmodel *rev, float value)
    revmodel_update(rev);
 }
 
-static void revmodel_init(struct revmodel *rev,int srate)
+static bool revmodel_init(struct revmodel *rev,int srate)
 {
+   static const int comb_lengths[8] = { 1116,1188,1277,1356,1422,1491,1557,1617 };
+   static const int allpass_lengths[4] = { 225,341,441,556 };
+   double r = srate * (1 / 44100.0);
+   unsigned c;
 
-  static const int comb_lengths[8] = { 1116,1188,1277,1356,1422,1491,1557,1617 };
-  static const int allpass_lengths[4] = { 225,341,441,556 };
-  double r = srate * (1 / 44100.0);
-  unsigned c;
-
-   rev->bufcomb=malloc(numcombs*sizeof(float*));
    for (c = 0; c < numcombs; ++c)
    {
-	   rev->bufcomb[c] = malloc(r*comb_lengths[c]*sizeof(float));
-	   rev->combL[c].buffer  =  rev->bufcomb[c];
-         rev->combL[c].bufsize=r*comb_lengths[c];
-  }
+      rev->comb[c].bufsize = r * comb_lengths[c];
+      rev->comb[c].buffer  = (float*)calloc(rev->comb[c].bufsize,
+            2 * sizeof(float));
+      if (!rev->comb[c].buffer)
+         return false;
+   }
 
-  rev->bufallpass=malloc(numallpasses*sizeof(float*));
    for (c = 0; c < numallpasses; ++c)
    {
-	   rev->bufallpass[c] = malloc(r*allpass_lengths[c]*sizeof(float));
-	   rev->allpassL[c].buffer  =  rev->bufallpass[c];
-         rev->allpassL[c].bufsize=r*allpass_lengths[c];
-  }
+      rev->allpass[c].bufsize = r * allpass_lengths[c];
+      rev->allpass[c].buffer  = (float*)calloc(rev->allpass[c].bufsize,
+            2 * sizeof(float));
+      if (!rev->allpass[c].buffer)
+         return false;
+   }
 
-   rev->allpassL[0].feedback = 0.5f;
-   rev->allpassL[1].feedback = 0.5f;
-   rev->allpassL[2].feedback = 0.5f;
-   rev->allpassL[3].feedback = 0.5f;
+   rev->allpass[0].feedback = 0.5f;
+   rev->allpass[1].feedback = 0.5f;
+   rev->allpass[2].feedback = 0.5f;
+   rev->allpass[3].feedback = 0.5f;
 
    revmodel_setwet(rev, initialwet);
    revmodel_setroomsize(rev, initialroom);
@@ -221,11 +409,13 @@ static void revmodel_init(struct revmodel *rev,int srate)
    revmodel_setdamp(rev, initialdamp);
    revmodel_setwidth(rev, initialwidth);
    revmodel_setmode(rev, initialmode);
+
+   return true;
 }
 
 struct reverb_data
 {
-   struct revmodel left, right;
+   struct revmodel model;
 };
 
 static void reverb_free(void *data)
@@ -233,40 +423,24 @@ static void reverb_free(void *data)
    struct reverb_data *rev = (struct reverb_data*)data;
    unsigned i;
 
-   for (i = 0; i < numcombs; i++) {
-   free(rev->left.bufcomb[i]);
-   free(rev->right.bufcomb[i]);
-   }
-   free(rev->left.bufcomb);
-   free(rev->right.bufcomb);
+   for (i = 0; i < numcombs; i++)
+      free(rev->model.comb[i].buffer);
+
+   for (i = 0; i < numallpasses; i++)
+      free(rev->model.allpass[i].buffer);
 
-   for (i = 0; i < numallpasses; i++) {
-   free(rev->left.bufallpass[i]);
-   free(rev->right.bufallpass[i]);
-   }
-   free(rev->left.bufallpass);
-   free(rev->right.bufallpass);
    free(data);
 }
 
 static void reverb_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
-   unsigned i;
-   float *out;
    struct reverb_data *rev = (struct reverb_data*)data;
 
    output->samples         = input->samples;
    output->frames          = input->frames;
-   out                     = output->samples;
-
-   for (i = 0; i < input->frames; i++, out += 2)
-   {
-      float in[2] = { out[0], out[1] };
 
-      out[0] = revmodel_process(&rev->left, in[0]);
-      out[1] = revmodel_process(&rev->right, in[1]);
-   }
+   revmodel_process(&rev->model, output->samples, output->frames);
 }
 
 static void *reverb_init(const struct dspfilter_info *info,
@@ -284,20 +458,17 @@ static void *reverb_init(const struct dspfilter_info *info,
    config->get_float(userdata, "roomwidth", &roomwidth, 0.56f);
    config->get_float(userdata, "roomsize", &roomsize, 0.56f);
 
-   revmodel_init(&rev->left,info->input_rate);
-   revmodel_init(&rev->right,info->input_rate);
-
-   revmodel_setdamp(&rev->left, damping);
-   revmodel_setdry(&rev->left, drytime);
-   revmodel_setwet(&rev->left, wettime);
-   revmodel_setwidth(&rev->left, roomwidth);
-   revmodel_setroomsize(&rev->left, roomsize);
+   if (!revmodel_init(&rev->model, info->input_rate))
+   {
+      reverb_free(rev);
+      return NULL;
+   }
 
-   revmodel_setdamp(&rev->right, damping);
-   revmodel_setdry(&rev->right, drytime);
-   revmodel_setwet(&rev->right, wettime);
-   revmodel_setwidth(&rev->right, roomwidth);
-   revmodel_setroomsize(&rev->right, roomsize);
+   revmodel_setdamp(&rev->model, damping);
+   revmodel_setdry(&rev->model, drytime);
+   revmodel_setwet(&rev->model, wettime);
+   revmodel_setwidth(&rev->model, roomwidth);
+   revmodel_setroomsize(&rev->model, roomsize);
 
    return rev;
 }
@@ -153,7 +153,8 @@ static bool zip_file_decompressed_handle(
 #endif
 
    if (handle->stream)
-      free(handle->stream);
+      handle->backend->stream_free(handle->stream);
+   handle->stream = NULL;
 
    return true;
 #if 0
@@ -188,40 +189,61 @@ static int zip_file_decompressed(
 
    if (strstr(name, userdata->decomp_state.needle))
    {
-      bool goto_error = false;
+      bool goto_error                   = false;
+      const uint8_t *data               = NULL;
       file_archive_file_handle_t handle = {0};
 
+      /* A stored entry is read straight from its compressed data,
+       * which must hold all of it. */
+      if (cmode == ARCHIVE_MODE_UNCOMPRESSED && size > csize)
+         return 0;
+
       userdata->decomp_state.found = true;
 
-      if (zip_file_decompressed_handle(&handle,
+      /* Stored entries are kept verbatim inside the (mapped)
+       * archive, so read them in place instead of running
+       * them through zlib into a scratch buffer. */
+      if (cmode == ARCHIVE_MODE_UNCOMPRESSED)
+         data = cdata;
+      else if (zip_file_decompressed_handle(&handle,
                cdata, csize, size, crc32))
+         data = handle.data;
+
+      if (data)
       {
          if (userdata->decomp_state.opt_file != 0)
          {
             /* Called in case core has need_fullpath enabled. */
-            char *buf       = (char*)malloc(size);
-
-            if (buf)
-            {
-               memcpy(buf, handle.data, size);
-
-               if (!filestream_write_file(userdata->decomp_state.opt_file, buf, size))
-                  goto_error = true;
-            }
-
-            free(buf);
+            if (!filestream_write_file(
+                     userdata->decomp_state.opt_file, data, size))
+               goto_error = true;
 
             userdata->decomp_state.size = 0;
          }
          else
          {
             /* Called in case core has need_fullpath disabled.
-             * Will copy decompressed content directly into
-             * RetroArch's ROM buffer. */
-            *userdata->decomp_state.buf = malloc(size);
-            memcpy(*userdata->decomp_state.buf, handle.data, size);
-
-            userdata->decomp_state.size = size;
+             * Hand the inflated buffer over to RetroArch's
+             * ROM buffer as-is; stored entries need one copy
+             * out of the archive mapping. */
+            if (data == handle.data)
+            {
+               *userdata->decomp_state.buf = handle.data;
+               userdata->decomp_state.size = size;
+               handle.data                 = NULL;
+            }
+            else
+            {
+               *userdata->decomp_state.buf = malloc(size);
+
+               if (*userdata->decomp_state.buf)
+               {
+                  memcpy(*userdata->decomp_state.buf, data, size);
+                  userdata->decomp_state.size = size;
+               }
+               else
+                  goto_error = true;
+            }
          }
       }
 
@@ -332,9 +354,18 @@ static int zip_parse_file_iterate_step_internal(
    memcpy(filename, state->directory + 46, namelength); /* file name */
 
    offset         = read_le(state->directory + 42, 4); /* relative offset of local file header */
+
+   if ((uint64_t)offset + 30 > (uint64_t)state->archive_size)
+      return -1;
+
    offsetNL       = read_le(state->data + offset + 26, 2); /* file name length */
    offsetEL       = read_le(state->data + offset + 28, 2); /* extra field length */
 
+   /* Entries are read in place, so they must lie within the archive. */
+   if ((uint64_t)offset + 30 + offsetNL + offsetEL + *csize
+         > (uint64_t)state->archive_size)
+      return -1;
+
    *cdata         = state->data + offset + 30 + offsetNL + offsetEL;
 
    *payback       = 46 + namelength + extralength + commentlength;
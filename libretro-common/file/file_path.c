@@ -107,7 +107,8 @@ enum stat_mode
    IS_VALID
 };
 
-static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
+static bool path_stat(const char *path, enum stat_mode mode,
+      int64_t *size, int64_t *mtime)
 {
 #if defined(VITA) || defined(PSP)
    SceIoStat buf;
@@ -167,7 +168,16 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
 #endif
 
    if (size)
-      *size = (int32_t)buf.st_size;
+      *size = (int64_t)buf.st_size;
+
+   if (mtime)
+   {
+#if defined(VITA) || defined(PSP)
+      *mtime = -1;
+#else
+      *mtime = (int64_t)buf.st_mtime;
+#endif
+   }
 
    switch (mode)
    {
@@ -204,28 +214,46 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
  */
 bool path_is_directory(const char *path)
 {
-   return path_stat(path, IS_DIRECTORY, NULL);
+   return path_stat(path, IS_DIRECTORY, NULL, NULL);
 }
 
 bool path_is_character_special(const char *path)
 {
-   return path_stat(path, IS_CHARACTER_SPECIAL, NULL);
+   return path_stat(path, IS_CHARACTER_SPECIAL, NULL, NULL);
 }
 
 bool path_is_valid(const char *path)
 {
-   return path_stat(path, IS_VALID, NULL);
+   return path_stat(path, IS_VALID, NULL, NULL);
 }
 
 int32_t path_get_size(const char *path)
 {
-   int32_t filesize = 0;
-   if (path_stat(path, IS_VALID, &filesize))
-      return filesize;
+   int64_t filesize = 0;
+   if (path_stat(path, IS_VALID, &filesize, NULL))
+      return (int32_t)filesize;
 
    return -1;
 }
 
+/**
+ * path_get_size_mtime:
+ * @path               : path
+ * @size               : size of the file in bytes
+ * @mtime              : last modification time, in seconds
+ *
+ * Retrieves both with a single stat call.
+ *
+ * Returns: true (1) on success, false (0) if @path is not valid
+ * or the platform does not provide modification times.
+ */
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime)
+{
+   if (!path_stat(path, IS_VALID, size, mtime))
+      return false;
+   return *mtime != -1;
+}
+
 static bool path_mkdir_error(int ret)
 {
 #if defined(VITA)
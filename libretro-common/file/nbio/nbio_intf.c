@@ -30,10 +30,13 @@
 #include <file/nbio.h>
 
 extern nbio_intf_t nbio_linux;
+extern nbio_intf_t nbio_linux_uring;
 extern nbio_intf_t nbio_mmap_unix;
 extern nbio_intf_t nbio_mmap_win32;
 extern nbio_intf_t nbio_stdio;
 
+extern bool nbio_linux_uring_enabled(void);
+
 #if defined(_linux__)
 static nbio_intf_t *internal_nbio = &nbio_linux;
 #elif defined(HAVE_MMAP) && defined(BSD)
@@ -44,42 +47,54 @@ static nbio_intf_t *internal_nbio = &nbio_mmap_win32;
 static nbio_intf_t *internal_nbio = &nbio_stdio;
 #endif
 
+static nbio_intf_t *nbio_get_intf(void)
+{
+#if defined(__linux__) && defined(HAVE_IO_URING) && defined(HAVE_THREADS)
+   /* Opt-in with LIBRETRO_NBIO_URING=1, and only where the
+    * kernel lets us set up a ring. Decided once per process,
+    * so handles never change backend. */
+   if (nbio_linux_uring_enabled())
+      return &nbio_linux_uring;
+#endif
+   return internal_nbio;
+}
+
 void *nbio_open(const char * filename, unsigned mode)
 {
-   return internal_nbio->open(filename, mode);
+   return nbio_get_intf()->open(filename, mode);
 }
 
 void nbio_begin_read(void *data)
 {
-   internal_nbio->begin_read(data);
+   nbio_get_intf()->begin_read(data);
 }
 
 void nbio_begin_write(void *data)
 {
-   internal_nbio->begin_write(data);
+   nbio_get_intf()->begin_write(data);
 }
 
 bool nbio_iterate(void *data)
 {
-   return internal_nbio->iterate(data);
+   return nbio_get_intf()->iterate(data);
 }
 
 void nbio_resize(void *data, size_t len)
 {
-   internal_nbio->resize(data, len);
+   nbio_get_intf()->resize(data, len);
 }
 
 void *nbio_get_ptr(void *data, size_t* len)
 {
-   return internal_nbio->get_ptr(data, len);
+   return nbio_get_intf()->get_ptr(data, len);
 }
 
 void nbio_cancel(void *data)
 {
-   internal_nbio->cancel(data);
+   nbio_get_intf()->cancel(data);
 }
 
 void nbio_free(void *data)
 {
-   internal_nbio->free(data);
+   nbio_get_intf()->free(data);
 }
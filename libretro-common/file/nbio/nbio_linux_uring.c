@@ -0,0 +1,688 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_linux_uring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <file/nbio.h>
+
+#if defined(__linux__) && defined(HAVE_IO_URING) && defined(HAVE_THREADS)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include <rthreads/rthreads.h>
+
+#define NBIO_URING_ENTRIES 256
+
+/* Set to 1 to let nbio_open() use this backend. */
+#define NBIO_URING_ENV "LIBRETRO_NBIO_URING"
+
+/* All handles share a single ring. Reads and writes started
+ * with nbio_begin_{read,write} are only queued; the next
+ * nbio_iterate on any handle submits everything queued so
+ * far in one syscall and reaps every completion available.
+ *
+ * nbio is used from the task thread as well as the main and
+ * video threads, so the ring and the state of every handle
+ * are only touched with nbio_uring_lock held. Completions are
+ * dispatched through user_data, so it does not matter which
+ * thread reaps them.
+ *
+ * Waiting for a completion is done without the lock, by one
+ * thread at a time: see nbio_uring_wait().
+ *
+ * At most sq_entries requests are in flight, counting from
+ * queueing to reaping. That keeps the submission queue from
+ * filling up and the completion queue, which is at least as
+ * large, from overflowing, so no completion is ever dropped
+ * on kernels without IORING_FEAT_NODROP. */
+struct nbio_uring_ring
+{
+   int fd;
+
+   unsigned *sq_head;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   struct io_uring_sqe *sqes;
+
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   struct io_uring_cqe *cqes;
+
+   unsigned to_submit;
+   unsigned inflight;
+   unsigned max_inflight;
+
+   /* A thread is blocked in io_uring_enter. */
+   bool waiting;
+   /* io_uring_enter failed for good, every request since fails. */
+   bool broken;
+
+   /* Handles with a request in flight. */
+   struct nbio_uring_t *busy_list;
+};
+
+struct nbio_uring_t
+{
+   int fd;
+   bool busy;
+   signed char mode;
+   uint8_t op;
+
+   void* ptr;
+   size_t len;
+   size_t progress;
+
+   struct iovec iov;
+
+   struct nbio_uring_t *prev;
+   struct nbio_uring_t *next;
+};
+
+/* 0 - not probed yet, 1 - ring is up, -1 - unavailable */
+static int nbio_uring_state               = 0;
+static bool nbio_uring_opted_in           = false;
+/* rthreads has no once primitive, and the lock can't be
+ * created lazily without one. */
+static pthread_once_t nbio_uring_once     = PTHREAD_ONCE_INIT;
+static pthread_once_t nbio_uring_env_once = PTHREAD_ONCE_INIT;
+static slock_t *nbio_uring_lock           = NULL;
+static scond_t *nbio_uring_cond           = NULL;
+static struct nbio_uring_ring nbio_uring_ring;
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+   return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit,
+      unsigned min_complete, unsigned flags)
+{
+   return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+         min_complete, flags, NULL, 0);
+}
+
+/* The ring lives until the process exits; setting it up per
+ * file would cost more than the batching saves. */
+static bool nbio_uring_ring_init(struct nbio_uring_ring *ring)
+{
+   struct io_uring_params p;
+   uint8_t *sq_ptr  = NULL;
+   uint8_t *cq_ptr  = NULL;
+   size_t sq_size   = 0;
+   size_t cq_size   = 0;
+   void *sqes       = NULL;
+
+   memset(&p, 0, sizeof(p));
+
+   ring->fd         = io_uring_setup(NBIO_URING_ENTRIES, &p);
+   if (ring->fd < 0)
+      return false;
+
+   sq_size          = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   cq_size          = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if (cq_size > sq_size)
+         sq_size    = cq_size;
+      cq_size       = sq_size;
+   }
+
+   sq_ptr           = (uint8_t*)mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+   if (sq_ptr == MAP_FAILED)
+      goto error;
+
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+      cq_ptr        = sq_ptr;
+   else
+   {
+      cq_ptr        = (uint8_t*)mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+      if (cq_ptr == MAP_FAILED)
+         goto error;
+   }
+
+   sqes             = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         ring->fd, IORING_OFF_SQES);
+   if (sqes == MAP_FAILED)
+      goto error;
+
+   ring->sq_head    = (unsigned*)(sq_ptr + p.sq_off.head);
+   ring->sq_tail    = (unsigned*)(sq_ptr + p.sq_off.tail);
+   ring->sq_mask    = (unsigned*)(sq_ptr + p.sq_off.ring_mask);
+   ring->sq_array   = (unsigned*)(sq_ptr + p.sq_off.array);
+   ring->sqes       = (struct io_uring_sqe*)sqes;
+
+   ring->cq_head    = (unsigned*)(cq_ptr + p.cq_off.head);
+   ring->cq_tail    = (unsigned*)(cq_ptr + p.cq_off.tail);
+   ring->cq_mask    = (unsigned*)(cq_ptr + p.cq_off.ring_mask);
+   ring->cqes       = (struct io_uring_cqe*)(cq_ptr + p.cq_off.cqes);
+
+   ring->to_submit    = 0;
+   ring->inflight     = 0;
+   ring->max_inflight = p.sq_entries < p.cq_entries
+      ? p.sq_entries : p.cq_entries;
+   ring->waiting      = false;
+   ring->broken       = false;
+   ring->busy_list    = NULL;
+
+   return true;
+
+error:
+   if (cq_ptr && cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+      munmap(cq_ptr, cq_size);
+   if (sq_ptr && sq_ptr != MAP_FAILED)
+      munmap(sq_ptr, sq_size);
+   close(ring->fd);
+   ring->fd = -1;
+   return false;
+}
+
+static void nbio_uring_unlink(struct nbio_uring_t *handle)
+{
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   if (handle->prev)
+      handle->prev->next = handle->next;
+   else
+      ring->busy_list    = handle->next;
+   if (handle->next)
+      handle->next->prev = handle->prev;
+
+   handle->prev = NULL;
+   handle->next = NULL;
+   handle->busy = false;
+}
+
+/* io_uring_enter failed with something other than EINTR.
+ * Ends every request in flight as if it had failed, so that
+ * nobody keeps waiting on them, and makes every later one fail
+ * straight away. Nothing calls into the kernel after this, so
+ * requests never submitted are dropped; ones the kernel already
+ * has can't be taken back. Called with nbio_uring_lock held. */
+static void nbio_uring_fail(void)
+{
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   ring->broken    = true;
+   ring->to_submit = 0;
+   ring->inflight  = 0;
+
+   while (ring->busy_list)
+      nbio_uring_unlink(ring->busy_list);
+}
+
+/* Queues the remainder of the handle's current operation.
+ * The caller makes sure there is room for one more request.
+ * Called with nbio_uring_lock held. */
+static void nbio_uring_queue(struct nbio_uring_t *handle)
+{
+   unsigned tail, index;
+   struct io_uring_sqe *sqe;
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   tail                  = *ring->sq_tail;
+   index                 = tail & *ring->sq_mask;
+   sqe                   = &ring->sqes[index];
+
+   handle->iov.iov_base  = (uint8_t*)handle->ptr + handle->progress;
+   handle->iov.iov_len   = handle->len - handle->progress;
+
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode           = handle->op;
+   sqe->fd               = handle->fd;
+   sqe->off              = handle->progress;
+   sqe->addr             = (uint64_t)(uintptr_t)&handle->iov;
+   sqe->len              = 1;
+   sqe->user_data        = (uint64_t)(uintptr_t)handle;
+
+   ring->sq_array[index] = index;
+   __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+   ring->to_submit++;
+   ring->inflight++;
+}
+
+/* Hands everything queued to the kernel, without waiting.
+ * Called with nbio_uring_lock held.
+ *
+ * Returns: false if the ring broke down. */
+static bool nbio_uring_submit(void)
+{
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   while (ring->to_submit)
+   {
+      int ret = io_uring_enter(ring->fd, ring->to_submit, 0, 0);
+
+      if (ret > 0)
+      {
+         ring->to_submit -= (unsigned)ret;
+         continue;
+      }
+
+      if (ret < 0 && errno == EINTR)
+         continue;
+
+      /* Out of resources for now; completions of what was
+       * already submitted will free some. */
+      if ((ret == 0 || errno == EAGAIN || errno == EBUSY)
+            && ring->inflight > ring->to_submit)
+         return true;
+
+      nbio_uring_fail();
+      return false;
+   }
+
+   return true;
+}
+
+/* Dispatches every completion available to its handle.
+ * Called with nbio_uring_lock held. */
+static void nbio_uring_reap(void)
+{
+   unsigned head;
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   while ((head = *ring->cq_head)
+         != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+   {
+      struct io_uring_cqe *cqe       = &ring->cqes[head & *ring->cq_mask];
+      struct nbio_uring_t *handle    = (struct nbio_uring_t*)
+         (uintptr_t)cqe->user_data;
+      int res                        = cqe->res;
+
+      __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+      /* After a failure the handle may already be gone. */
+      if (!handle || ring->broken)
+         continue;
+
+      ring->inflight--;
+
+      /* Errors and early EOF end the operation like a
+       * short fread/fwrite would in nbio_stdio. */
+      if (res > 0)
+         handle->progress += (size_t)res;
+
+      if (res > 0 && handle->progress < handle->len)
+         nbio_uring_queue(handle);
+      else
+         nbio_uring_unlink(handle);
+   }
+}
+
+/* Submits what is queued and reaps what has completed, unless
+ * another thread is waiting for completions: it will get them
+ * as soon as there are any. Called with nbio_uring_lock held. */
+static void nbio_uring_poll(void)
+{
+   if (nbio_uring_submit() && !nbio_uring_ring.waiting)
+      nbio_uring_reap();
+}
+
+/* Blocks until at least one request completes, or another
+ * thread has reaped some. Called with nbio_uring_lock held and
+ * at least one request in flight; the lock is released while
+ * blocking.
+ *
+ * Only one thread blocks in the kernel at a time, and nobody
+ * else reaps meanwhile: a completion reaped by another thread
+ * could otherwise leave it waiting for an event that never
+ * comes. The other threads wait on nbio_uring_cond instead,
+ * and check their handles again once woken up. */
+static void nbio_uring_wait(void)
+{
+   int ret, err;
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   if (ring->waiting)
+   {
+      scond_wait(nbio_uring_cond, nbio_uring_lock);
+      return;
+   }
+
+   if (!nbio_uring_submit())
+      return;
+
+   ring->waiting = true;
+   slock_unlock(nbio_uring_lock);
+
+   ret           = io_uring_enter(ring->fd, 0, 1,
+         IORING_ENTER_GETEVENTS);
+   err           = errno;
+
+   slock_lock(nbio_uring_lock);
+   ring->waiting = false;
+
+   if (ret < 0 && err != EINTR)
+      nbio_uring_fail();
+   else
+      nbio_uring_reap();
+
+   scond_broadcast(nbio_uring_cond);
+}
+
+static void nbio_uring_init_once(void)
+{
+   nbio_uring_lock  = slock_new();
+   nbio_uring_cond  = scond_new();
+   nbio_uring_state = -1;
+
+   if (nbio_uring_lock && nbio_uring_cond
+         && nbio_uring_ring_init(&nbio_uring_ring))
+      nbio_uring_state = 1;
+}
+
+static void nbio_uring_env_init_once(void)
+{
+   const char *env     = getenv(NBIO_URING_ENV);
+   nbio_uring_opted_in = env && !strcmp(env, "1");
+}
+
+bool nbio_linux_uring_available(void)
+{
+   pthread_once(&nbio_uring_once, nbio_uring_init_once);
+   return nbio_uring_state > 0;
+}
+
+/* Read once, so that every handle keeps going to the backend
+ * that opened it. */
+bool nbio_linux_uring_enabled(void)
+{
+   pthread_once(&nbio_uring_env_once, nbio_uring_env_init_once);
+   return nbio_uring_opted_in && nbio_linux_uring_available();
+}
+
+static void *nbio_uring_open(const char * filename, unsigned mode)
+{
+   static const int o_flags[]  =   { O_RDONLY, O_RDWR|O_CREAT|O_TRUNC, O_RDWR, O_RDONLY, O_RDWR|O_CREAT|O_TRUNC };
+
+   off_t len                   = 0;
+   struct nbio_uring_t* handle = NULL;
+   int fd                      = -1;
+
+   if (!nbio_linux_uring_available())
+      return NULL;
+
+   fd                          = open(filename, o_flags[mode]|O_CLOEXEC, 0644);
+   if (fd < 0)
+      return NULL;
+
+   switch (mode)
+   {
+      case NBIO_WRITE:
+      case BIO_WRITE:
+         break;
+      default:
+         len = lseek(fd, 0, SEEK_END);
+         if (len < 0)
+            goto error;
+         break;
+   }
+
+   handle             = (struct nbio_uring_t*)malloc(sizeof(*handle));
+   if (!handle)
+      goto error;
+
+   handle->fd         = fd;
+   handle->busy       = false;
+   handle->mode       = mode;
+   handle->op         = IORING_OP_READV;
+   handle->ptr        = NULL;
+   handle->len        = (size_t)len;
+   handle->progress   = handle->len;
+   handle->prev       = NULL;
+   handle->next       = NULL;
+
+   if (handle->len)
+   {
+      handle->ptr     = malloc(handle->len);
+      if (!handle->ptr)
+         goto error;
+   }
+
+   return handle;
+
+error:
+   if (handle)
+      free(handle);
+   close(fd);
+   return NULL;
+}
+
+static void nbio_uring_begin_op(struct nbio_uring_t *handle, uint8_t op)
+{
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   slock_lock(nbio_uring_lock);
+
+   if (handle->busy)
+   {
+      puts("ERROR - attempted file operation while busy");
+      abort();
+   }
+
+   handle->op       = op;
+   handle->progress = 0;
+
+   while (!ring->broken && ring->inflight >= ring->max_inflight)
+      nbio_uring_wait();
+
+   /* On a broken ring the operation ends right away, short. */
+   if (handle->len && !ring->broken)
+   {
+      handle->busy  = true;
+      handle->prev  = NULL;
+      handle->next  = ring->busy_list;
+      if (handle->next)
+         handle->next->prev = handle;
+      ring->busy_list = handle;
+
+      nbio_uring_queue(handle);
+   }
+
+   slock_unlock(nbio_uring_lock);
+}
+
+static void nbio_uring_begin_read(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (handle)
+      nbio_uring_begin_op(handle, IORING_OP_READV);
+}
+
+static void nbio_uring_begin_write(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (handle)
+      nbio_uring_begin_op(handle, IORING_OP_WRITEV);
+}
+
+static bool nbio_uring_iterate(void *data)
+{
+   bool busy;
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return false;
+
+   slock_lock(nbio_uring_lock);
+
+   if (handle->busy)
+   {
+      bool blocking = handle->mode == BIO_READ || handle->mode == BIO_WRITE;
+
+      nbio_uring_poll();
+
+      while (blocking && handle->busy)
+         nbio_uring_wait();
+   }
+
+   busy = handle->busy;
+
+   slock_unlock(nbio_uring_lock);
+
+   return !busy;
+}
+
+static void nbio_uring_resize(void *data, size_t len)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   slock_lock(nbio_uring_lock);
+   if (handle->busy)
+   {
+      puts("ERROR - attempted file resize operation while busy");
+      abort();
+   }
+   slock_unlock(nbio_uring_lock);
+   if (len < handle->len)
+   {
+      /* this works perfectly fine if this check is removed, but it
+       * won't work on other nbio implementations */
+      /* therefore, it's blocked so nobody accidentally relies on it */
+      puts("ERROR - attempted file shrink operation, not implemented");
+      abort();
+   }
+
+   if (ftruncate(handle->fd, len) != 0)
+   {
+      puts("ERROR - couldn't resize file (ftruncate)");
+      abort(); /* this one returns void and I can't find any other way
+                  for it to report failure */
+   }
+
+   handle->ptr      = realloc(handle->ptr, len);
+   handle->len      = len;
+   handle->progress = len;
+}
+
+static void *nbio_uring_get_ptr(void *data, size_t* len)
+{
+   bool busy;
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return NULL;
+
+   slock_lock(nbio_uring_lock);
+   busy = handle->busy;
+   slock_unlock(nbio_uring_lock);
+
+   if (len)
+      *len = handle->len;
+   if (!busy)
+      return handle->ptr;
+   return NULL;
+}
+
+/* The kernel may still be writing into the buffer, so wait
+ * for the request to finish rather than abandoning it. */
+static void nbio_uring_cancel(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   slock_lock(nbio_uring_lock);
+   while (handle->busy)
+      nbio_uring_wait();
+   slock_unlock(nbio_uring_lock);
+
+   handle->progress = handle->len;
+}
+
+static void nbio_uring_free(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   slock_lock(nbio_uring_lock);
+   if (handle->busy)
+   {
+      puts("ERROR - attempted free() while busy");
+      abort();
+   }
+   slock_unlock(nbio_uring_lock);
+
+   close(handle->fd);
+   free(handle->ptr);
+   free(handle);
+}
+
+nbio_intf_t nbio_linux_uring = {
+   nbio_uring_open,
+   nbio_uring_begin_read,
+   nbio_uring_begin_write,
+   nbio_uring_iterate,
+   nbio_uring_resize,
+   nbio_uring_get_ptr,
+   nbio_uring_cancel,
+   nbio_uring_free,
+   "nbio_linux_uring",
+};
+#else
+bool nbio_linux_uring_available(void)
+{
+   return false;
+}
+
+bool nbio_linux_uring_enabled(void)
+{
+   return false;
+}
+
+nbio_intf_t nbio_linux_uring = {
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   "nbio_linux_uring",
+};
+
+#endif
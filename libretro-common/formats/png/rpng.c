@@ -37,6 +37,16 @@
 
 #include "rpng_internal.h"
 
+#if defined(__SSE2__) && !defined(RPNG_NO_SIMD)
+#include <emmintrin.h>
+#define RPNG_SSE2
+#define RPNG_SIMD
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(__ARM_BIG_ENDIAN) && !defined(RPNG_NO_SIMD)
+#include <arm_neon.h>
+#define RPNG_NEON
+#define RPNG_SIMD
+#endif
+
 enum png_ihdr_color_type
 {
    PNG_IHDR_COLOR_GRAY       = 0,
@@ -271,6 +281,71 @@ static void png_reverse_filter_copy_line_rgba(uint32_t *data,
    }
 }
 
+/* 8-bit RGBA to ARGB, which only needs R and B swapped. */
+static void png_reverse_filter_copy_line_rgba8(uint32_t *data,
+      const uint8_t *decoded, unsigned width)
+{
+   unsigned i = 0;
+
+#if defined(RPNG_SSE2)
+   const __m128i mask_ag = _mm_set1_epi32(0xff00ff00);
+   const __m128i mask_rb = _mm_set1_epi32(0x00ff00ff);
+
+   for (; i + 4 <= width; i += 4)
+   {
+      __m128i in = _mm_loadu_si128((const __m128i*)(decoded + i * 4));
+      __m128i ag = _mm_and_si128(in, mask_ag);
+      __m128i rb = _mm_and_si128(in, mask_rb);
+
+      rb         = _mm_or_si128(_mm_slli_epi32(rb, 16),
+            _mm_srli_epi32(rb, 16));
+
+      _mm_storeu_si128((__m128i*)(data + i),
+            _mm_or_si128(ag, _mm_and_si128(rb, mask_rb)));
+   }
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= width; i += 16)
+   {
+      uint8x16x4_t px = vld4q_u8(decoded + i * 4);
+      uint8x16_t    r = px.val[0];
+
+      px.val[0]       = px.val[2];
+      px.val[2]       = r;
+
+      vst4q_u8((uint8_t*)(data + i), px);
+   }
+#endif
+
+   for (decoded += i * 4; i < width; i++, decoded += 4)
+      data[i] = ((uint32_t)decoded[3] << 24) | (decoded[0] << 16)
+         | (decoded[1] << 8) | (decoded[2] << 0);
+}
+
+static void png_reverse_filter_copy_line_rgb8(uint32_t *data,
+      const uint8_t *decoded, unsigned width)
+{
+   unsigned i = 0;
+
+#if defined(RPNG_NEON)
+   for (; i + 16 <= width; i += 16)
+   {
+      uint8x16x3_t px = vld3q_u8(decoded + i * 3);
+      uint8x16x4_t out;
+
+      out.val[0]      = px.val[2];
+      out.val[1]      = px.val[1];
+      out.val[2]      = px.val[0];
+      out.val[3]      = vdupq_n_u8(0xff);
+
+      vst4q_u8((uint8_t*)(data + i), out);
+   }
+#endif
+
+   for (decoded += i * 3; i < width; i++, decoded += 3)
+      data[i] = (0xffu << 24) | (decoded[0] << 16)
+         | (decoded[1] << 8) | (decoded[2] << 0);
+}
+
 static void png_reverse_filter_copy_line_bw(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned depth)
 {
@@ -562,8 +637,10 @@ static int png_reverse_filter_init(const struct png_ihdr *ihdr,
 
    pngp->restore_buf_size      = 0;
    pngp->data_restore_buf_size = 0;
-   pngp->prev_scanline         = (uint8_t*)calloc(1, pngp->pitch);
-   pngp->decoded_scanline      = (uint8_t*)calloc(1, pngp->pitch);
+   /* One byte of slack, for the 4 byte pixel accesses
+    * in png_reverse_filter_fused(). */
+   pngp->prev_scanline         = (uint8_t*)calloc(1, pngp->pitch + 1);
+   pngp->decoded_scanline      = (uint8_t*)calloc(1, pngp->pitch + 1);
 
    if (!pngp->prev_scanline || !pngp->decoded_scanline)
       goto error;
@@ -578,10 +655,270 @@ error:
    return -1;
 }
 
+static void png_reverse_filter_up(uint8_t *decoded,
+      const uint8_t *prev, const uint8_t *in, unsigned pitch)
+{
+   unsigned i = 0;
+
+#if defined(RPNG_SSE2)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(decoded + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(prev + i)),
+               _mm_loadu_si128((const __m128i*)(in + i))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= pitch; i += 16)
+      vst1q_u8(decoded + i, vaddq_u8(vld1q_u8(prev + i), vld1q_u8(in + i)));
+#endif
+
+   for (; i < pitch; i++)
+      decoded[i] = prev[i] + in[i];
+}
+
+#ifdef RPNG_SIMD
+/* Sub, Average and Paeth depend on the pixel to the left, so they
+ * can't be vectorised along the scanline. For 8-bit RGB and RGBA
+ * these run one pixel per step instead, with all channels in one
+ * register, and write the ARGB output as they go rather than making
+ * a second pass over the scanline. bpp is 3 or 4, and always passed
+ * as a constant so the pixel loads and stores get inlined. Pixels
+ * are always read and written as 4 bytes: for RGB the extra byte
+ * belongs to the next pixel (which is written after) or to the
+ * slack byte at the end of each buffer. */
+
+static INLINE uint32_t png_load_px(const uint8_t *p, unsigned bpp)
+{
+   uint32_t px;
+   memcpy(&px, p, sizeof(px));
+   return bpp == 3 ? (px & 0x00ffffff) : px;
+}
+
+static INLINE uint32_t png_px_to_argb(uint32_t px, unsigned bpp)
+{
+   uint32_t argb = (px & 0xff00ff00) | ((px >> 16) & 0xff) | ((px & 0xff) << 16);
+   return bpp == 3 ? (argb | 0xff000000u) : argb;
+}
+
+#if defined(RPNG_SSE2)
+static INLINE void png_reverse_filter_sub_px(uint8_t *decoded,
+      const uint8_t *in, unsigned width, unsigned bpp, uint32_t *data)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+
+   for (i = 0; i < width; i++, decoded += bpp, in += bpp)
+   {
+      uint32_t px;
+
+      a       = _mm_add_epi8(a, _mm_cvtsi32_si128(png_load_px(in, bpp)));
+      px      = _mm_cvtsi128_si32(a);
+
+      memcpy(decoded, &px, sizeof(px));
+      data[i] = png_px_to_argb(px, bpp);
+   }
+}
+
+static INLINE void png_reverse_filter_avg_px(uint8_t *decoded,
+      const uint8_t *prev, const uint8_t *in, unsigned width,
+      unsigned bpp, uint32_t *data)
+{
+   unsigned i;
+   const __m128i one = _mm_set1_epi8(1);
+   __m128i a         = _mm_setzero_si128();
+
+   for (i = 0; i < width; i++, decoded += bpp, prev += bpp, in += bpp)
+   {
+      uint32_t px;
+      __m128i b   = _mm_cvtsi32_si128(png_load_px(prev, bpp));
+      /* avg_epu8 rounds up, PNG wants (a + b) >> 1. */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), one));
+
+      a           = _mm_add_epi8(avg, _mm_cvtsi32_si128(png_load_px(in, bpp)));
+      px          = _mm_cvtsi128_si32(a);
+
+      memcpy(decoded, &px, sizeof(px));
+      data[i]     = png_px_to_argb(px, bpp);
+   }
+}
+
+static INLINE __m128i png_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static INLINE __m128i png_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static INLINE void png_reverse_filter_paeth_px(uint8_t *decoded,
+      const uint8_t *prev, const uint8_t *in, unsigned width,
+      unsigned bpp, uint32_t *data)
+{
+   unsigned i;
+   const __m128i zero    = _mm_setzero_si128();
+   const __m128i mask_ff = _mm_set1_epi16(0xff);
+   __m128i a             = zero;
+   __m128i c             = zero;
+
+   for (i = 0; i < width; i++, decoded += bpp, prev += bpp, in += bpp)
+   {
+      uint32_t px;
+      __m128i pa, pb, pc, smallest, nearest;
+      __m128i b = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128(png_load_px(prev, bpp)), zero);
+      __m128i x = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128(png_load_px(in, bpp)), zero);
+
+      /* Same as paeth() in filters.h, with p = a + b - c:
+       * |p - a| = |b - c|, |p - b| = |a - c|,
+       * |p - c| = |(b - c) + (a - c)|. */
+      pa       = _mm_sub_epi16(b, c);
+      pb       = _mm_sub_epi16(a, c);
+      pc       = png_abs_epi16(_mm_add_epi16(pa, pb));
+      pa       = png_abs_epi16(pa);
+      pb       = png_abs_epi16(pb);
+
+      smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+      nearest  = png_select(_mm_cmpeq_epi16(pb, smallest), b, c);
+      nearest  = png_select(_mm_cmpeq_epi16(pa, smallest), a, nearest);
+
+      a        = _mm_and_si128(_mm_add_epi16(nearest, x), mask_ff);
+      c        = b;
+      px       = _mm_cvtsi128_si32(_mm_packus_epi16(a, a));
+
+      memcpy(decoded, &px, sizeof(px));
+      data[i]  = png_px_to_argb(px, bpp);
+   }
+}
+#elif defined(RPNG_NEON)
+static INLINE uint32_t png_store_px(uint8_t *p, uint8x8_t v, unsigned bpp)
+{
+   uint32_t px = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+   memcpy(p, &px, sizeof(px));
+   return px;
+}
+
+static INLINE void png_reverse_filter_sub_px(uint8_t *decoded,
+      const uint8_t *in, unsigned width, unsigned bpp, uint32_t *data)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < width; i++, decoded += bpp, in += bpp)
+   {
+      a       = vadd_u8(a, vcreate_u8(png_load_px(in, bpp)));
+      data[i] = png_px_to_argb(png_store_px(decoded, a, bpp), bpp);
+   }
+}
+
+static INLINE void png_reverse_filter_avg_px(uint8_t *decoded,
+      const uint8_t *prev, const uint8_t *in, unsigned width,
+      unsigned bpp, uint32_t *data)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < width; i++, decoded += bpp, prev += bpp, in += bpp)
+   {
+      uint8x8_t b = vcreate_u8(png_load_px(prev, bpp));
+
+      a           = vadd_u8(vhadd_u8(a, b),
+            vcreate_u8(png_load_px(in, bpp)));
+      data[i]     = png_px_to_argb(png_store_px(decoded, a, bpp), bpp);
+   }
+}
+
+static INLINE int16x4_t png_widen_px(uint32_t px)
+{
+   return vreinterpret_s16_u16(vget_low_u16(vmovl_u8(vcreate_u8(px))));
+}
+
+static INLINE void png_reverse_filter_paeth_px(uint8_t *decoded,
+      const uint8_t *prev, const uint8_t *in, unsigned width,
+      unsigned bpp, uint32_t *data)
+{
+   unsigned i;
+   const int16x4_t mask_ff = vdup_n_s16(0xff);
+   int16x4_t a             = vdup_n_s16(0);
+   int16x4_t c             = vdup_n_s16(0);
+
+   for (i = 0; i < width; i++, decoded += bpp, prev += bpp, in += bpp)
+   {
+      uint16x4_t res;
+      int16x4_t pa, pb, pc, smallest, nearest;
+      int16x4_t b = png_widen_px(png_load_px(prev, bpp));
+      int16x4_t x = png_widen_px(png_load_px(in, bpp));
+
+      /* See the SSE2 version. */
+      pa       = vsub_s16(b, c);
+      pb       = vsub_s16(a, c);
+      pc       = vabs_s16(vadd_s16(pa, pb));
+      pa       = vabs_s16(pa);
+      pb       = vabs_s16(pb);
+
+      smallest = vmin_s16(pc, vmin_s16(pa, pb));
+      nearest  = vbsl_s16(vceq_s16(pb, smallest), b, c);
+      nearest  = vbsl_s16(vceq_s16(pa, smallest), a, nearest);
+
+      a        = vand_s16(vadd_s16(nearest, x), mask_ff);
+      c        = b;
+      res      = vreinterpret_u16_s16(a);
+
+      data[i]  = png_px_to_argb(png_store_px(decoded,
+               vmovn_u16(vcombine_u16(res, res)), bpp), bpp);
+   }
+}
+#endif
+
+static bool png_reverse_filter_fused(uint32_t *data,
+      struct rpng_process *pngp, unsigned width, unsigned filter)
+{
+   uint8_t *decoded    = pngp->decoded_scanline;
+   const uint8_t *prev = pngp->prev_scanline;
+   const uint8_t *in   = pngp->inflate_buf;
+
+   switch (filter)
+   {
+      case PNG_FILTER_SUB:
+         if (pngp->bpp == 4)
+            png_reverse_filter_sub_px(decoded, in, width, 4, data);
+         else
+            png_reverse_filter_sub_px(decoded, in, width, 3, data);
+         return true;
+      case PNG_FILTER_AVERAGE:
+         if (pngp->bpp == 4)
+            png_reverse_filter_avg_px(decoded, prev, in, width, 4, data);
+         else
+            png_reverse_filter_avg_px(decoded, prev, in, width, 3, data);
+         return true;
+      case PNG_FILTER_PAETH:
+         if (pngp->bpp == 4)
+            png_reverse_filter_paeth_px(decoded, prev, in, width, 4, data);
+         else
+            png_reverse_filter_paeth_px(decoded, prev, in, width, 3, data);
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+#endif
+
 static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
    unsigned i;
+   uint8_t *scanline;
+
+#ifdef RPNG_SIMD
+   if (ihdr->depth == 8
+         && (ihdr->color_type == PNG_IHDR_COLOR_RGB
+            || ihdr->color_type == PNG_IHDR_COLOR_RGBA)
+         && png_reverse_filter_fused(data, pngp, ihdr->width, filter))
+      goto end;
+#endif
 
    switch (filter)
    {
@@ -595,8 +932,8 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
             pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
          break;
       case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
+         png_reverse_filter_up(pngp->decoded_scanline,
+               pngp->prev_scanline, pngp->inflate_buf, pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
          for (i = 0; i < pngp->bpp; i++)
@@ -628,7 +965,10 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          png_reverse_filter_copy_line_bw(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGB:
-         png_reverse_filter_copy_line_rgb(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
+         if (ihdr->depth == 8)
+            png_reverse_filter_copy_line_rgb8(data, pngp->decoded_scanline, ihdr->width);
+         else
+            png_reverse_filter_copy_line_rgb(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
          break;
       case PNG_IHDR_COLOR_PLT:
          png_reverse_filter_copy_line_plt(data, pngp->decoded_scanline, ihdr->width,
@@ -639,11 +979,20 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
                ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGBA:
-         png_reverse_filter_copy_line_rgba(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
+         if (ihdr->depth == 8)
+            png_reverse_filter_copy_line_rgba8(data, pngp->decoded_scanline, ihdr->width);
+         else
+            png_reverse_filter_copy_line_rgba(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+#ifdef RPNG_SIMD
+end:
+#endif
+   /* This scanline is the previous one for the next row. */
+   scanline               = pngp->prev_scanline;
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = scanline;
 
    return IMAGE_PROCESS_NEXT;
 }
@@ -889,7 +1238,8 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, uns
       return NULL;
    }
 
-   inflate_buf = (uint8_t*)malloc(process->inflate_buf_size);
+   /* One byte of slack, see png_reverse_filter_init(). */
+   inflate_buf = (uint8_t*)malloc(process->inflate_buf_size + 1);
    if (!inflate_buf)
       goto error;
 
@@ -957,7 +1307,6 @@ static bool png_parse_ihdr(uint8_t *buf,
 
 bool rpng_iterate_image(rpng_t *rpng)
 {
-   unsigned i;
    struct png_chunk chunk;
    uint8_t *buf           = (uint8_t*)rpng->buff_data;
 
@@ -1051,8 +1400,7 @@ bool rpng_iterate_image(rpng_t *rpng)
 
          buf += 8;
 
-         for (i = 0; i < chunk.size; i++)
-            rpng->idat_buf.data[i + rpng->idat_buf.size] = buf[i];
+         memcpy(rpng->idat_buf.data + rpng->idat_buf.size, buf, chunk.size);
 
          rpng->idat_buf.size += chunk.size;
 
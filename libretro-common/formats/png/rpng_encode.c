@@ -24,12 +24,28 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <compat/zlib.h>
 #include <encodings/crc32.h>
 #include <streams/file_stream.h>
-#include <streams/trans_stream.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "rpng_internal.h"
 
+#if defined(__SSE2__) && !defined(RPNG_NO_SIMD)
+#include <emmintrin.h>
+#define RPNG_SSE2
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(RPNG_NO_SIMD)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+
+/* Images are only split for parallel deflate when every
+ * block gets at least this much filtered data. */
+#define RPNG_ENCODE_MIN_BLOCK_SIZE (1 << 18)
+
 #undef GOTO_END_ERROR
 #define GOTO_END_ERROR() do { \
    fprintf(stderr, "[RPNG]: Error in line %d.\n", __LINE__); \
@@ -145,11 +161,102 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
    }
 }
 
+#if defined(RPNG_SSE2)
+static INLINE __m128i png_sad_acc(__m128i acc, __m128i t)
+{
+   /* |(int8_t)t| is min(t, -t) when both are taken as unsigned. */
+   const __m128i zero = _mm_setzero_si128();
+   __m128i abs_t      = _mm_min_epu8(t, _mm_sub_epi8(zero, t));
+   return _mm_add_epi64(acc, _mm_sad_epu8(abs_t, zero));
+}
+
+static INLINE unsigned png_sad_sum(__m128i acc)
+{
+   return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+static INLINE __m128i png_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static INLINE __m128i png_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static INLINE __m128i png_paeth_epi16(__m128i a, __m128i b, __m128i c)
+{
+   /* With p = a + b - c: |p - a| = |b - c|, |p - b| = |a - c|,
+    * |p - c| = |(b - c) + (a - c)|. Ties go to a, then b,
+    * same as paeth(). */
+   __m128i pa = _mm_sub_epi16(b, c);
+   __m128i pb = _mm_sub_epi16(a, c);
+   __m128i pc = png_abs_epi16(_mm_add_epi16(pa, pb));
+   __m128i smallest, nearest;
+
+   pa       = png_abs_epi16(pa);
+   pb       = png_abs_epi16(pb);
+   smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+   nearest  = png_select(_mm_cmpeq_epi16(pb, smallest), b, c);
+   return png_select(_mm_cmpeq_epi16(pa, smallest), a, nearest);
+}
+#elif defined(RPNG_NEON)
+static INLINE uint32x4_t png_sad_acc(uint32x4_t acc, uint8x16_t t)
+{
+   /* |(int8_t)t| is min(t, -t) when both are taken as unsigned. */
+   uint8x16_t abs_t = vminq_u8(t, vsubq_u8(vdupq_n_u8(0), t));
+   return vpadalq_u16(acc, vpaddlq_u8(abs_t));
+}
+
+static INLINE unsigned png_sad_sum(uint32x4_t acc)
+{
+   uint64x2_t sum = vpaddlq_u32(acc);
+   return (unsigned)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+static INLINE uint8x8_t png_paeth_u8(uint8x8_t a8, uint8x8_t b8, uint8x8_t c8)
+{
+   /* See the SSE2 version. */
+   int16x8_t a  = vreinterpretq_s16_u16(vmovl_u8(a8));
+   int16x8_t b  = vreinterpretq_s16_u16(vmovl_u8(b8));
+   int16x8_t c  = vreinterpretq_s16_u16(vmovl_u8(c8));
+   int16x8_t pa = vsubq_s16(b, c);
+   int16x8_t pb = vsubq_s16(a, c);
+   int16x8_t pc = vabsq_s16(vaddq_s16(pa, pb));
+   int16x8_t smallest, nearest;
+
+   pa       = vabsq_s16(pa);
+   pb       = vabsq_s16(pb);
+   smallest = vminq_s16(pc, vminq_s16(pa, pb));
+   nearest  = vbslq_s16(vceqq_s16(pb, smallest), b, c);
+   nearest  = vbslq_s16(vceqq_s16(pa, smallest), a, nearest);
+   return vmovn_u16(vreinterpretq_u16_s16(nearest));
+}
+#endif
+
+/* The filters below read the bpp bytes before line and prev, which
+ * the caller keeps zeroed, instead of special casing the first pixel.
+ * Each one returns the sum of absolute values of what it wrote. */
+
 static unsigned count_sad(const uint8_t *data, size_t size)
 {
-   size_t i;
+   size_t i     = 0;
    unsigned cnt = 0;
-   for (i = 0; i < size; i++)
+
+#if defined(RPNG_SSE2)
+   __m128i acc = _mm_setzero_si128();
+   for (; i + 16 <= size; i += 16)
+      acc = png_sad_acc(acc, _mm_loadu_si128((const __m128i*)(data + i)));
+   cnt = png_sad_sum(acc);
+#elif defined(RPNG_NEON)
+   uint32x4_t acc = vdupq_n_u32(0);
+   for (; i + 16 <= size; i += 16)
+      acc = png_sad_acc(acc, vld1q_u8(data + i));
+   cnt = png_sad_sum(acc);
+#endif
+
+   for (; i < size; i++)
       cnt += abs((int8_t)data[i]);
    return cnt;
 }
@@ -157,119 +264,264 @@ static unsigned count_sad(const uint8_t *data, size_t size)
 static unsigned filter_up(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i   = 0;
+   unsigned cnt = 0;
    width *= bpp;
-   for (i = 0; i < width; i++)
+
+#if defined(RPNG_SSE2)
+   {
+      __m128i acc = _mm_setzero_si128();
+      for (; i + 16 <= width; i += 16)
+      {
+         __m128i t = _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i)));
+         _mm_storeu_si128((__m128i*)(target + i), t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#elif defined(RPNG_NEON)
+   {
+      uint32x4_t acc = vdupq_n_u32(0);
+      for (; i + 16 <= width; i += 16)
+      {
+         uint8x16_t t = vsubq_u8(vld1q_u8(line + i), vld1q_u8(prev + i));
+         vst1q_u8(target + i, t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#endif
+
+   for (; i < width; i++)
+   {
       target[i] = line[i] - prev[i];
+      cnt      += abs((int8_t)target[i]);
+   }
 
-   return count_sad(target, width);
+   return cnt;
 }
 
 static unsigned filter_sub(uint8_t *target, const uint8_t *line,
       unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i          = 0;
+   unsigned cnt        = 0;
+   const uint8_t *left = line - bpp;
    width *= bpp;
-   for (i = 0; i < bpp; i++)
-      target[i] = line[i];
-   for (i = bpp; i < width; i++)
-      target[i] = line[i] - line[i - bpp];
 
-   return count_sad(target, width);
+#if defined(RPNG_SSE2)
+   {
+      __m128i acc = _mm_setzero_si128();
+      for (; i + 16 <= width; i += 16)
+      {
+         __m128i t = _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(left + i)));
+         _mm_storeu_si128((__m128i*)(target + i), t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#elif defined(RPNG_NEON)
+   {
+      uint32x4_t acc = vdupq_n_u32(0);
+      for (; i + 16 <= width; i += 16)
+      {
+         uint8x16_t t = vsubq_u8(vld1q_u8(line + i), vld1q_u8(left + i));
+         vst1q_u8(target + i, t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#endif
+
+   for (; i < width; i++)
+   {
+      target[i] = line[i] - left[i];
+      cnt      += abs((int8_t)target[i]);
+   }
+
+   return cnt;
 }
 
 static unsigned filter_avg(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i          = 0;
+   unsigned cnt        = 0;
+   const uint8_t *left = line - bpp;
    width *= bpp;
-   for (i = 0; i < bpp; i++)
-      target[i] = line[i] - (prev[i] >> 1);
-   for (i = bpp; i < width; i++)
-      target[i] = line[i] - ((line[i - bpp] + prev[i]) >> 1);
 
-   return count_sad(target, width);
+#if defined(RPNG_SSE2)
+   {
+      const __m128i one = _mm_set1_epi8(1);
+      __m128i acc       = _mm_setzero_si128();
+      for (; i + 16 <= width; i += 16)
+      {
+         __m128i a   = _mm_loadu_si128((const __m128i*)(left + i));
+         __m128i b   = _mm_loadu_si128((const __m128i*)(prev + i));
+         /* avg_epu8 rounds up, PNG wants (a + b) >> 1. */
+         __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+               _mm_and_si128(_mm_xor_si128(a, b), one));
+         __m128i t   = _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)), avg);
+         _mm_storeu_si128((__m128i*)(target + i), t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#elif defined(RPNG_NEON)
+   {
+      uint32x4_t acc = vdupq_n_u32(0);
+      for (; i + 16 <= width; i += 16)
+      {
+         uint8x16_t t = vsubq_u8(vld1q_u8(line + i),
+               vhaddq_u8(vld1q_u8(left + i), vld1q_u8(prev + i)));
+         vst1q_u8(target + i, t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#endif
+
+   for (; i < width; i++)
+   {
+      target[i] = line[i] - ((left[i] + prev[i]) >> 1);
+      cnt      += abs((int8_t)target[i]);
+   }
+
+   return cnt;
 }
 
 static unsigned filter_paeth(uint8_t *target,
       const uint8_t *line, const uint8_t *prev,
       unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i             = 0;
+   unsigned cnt           = 0;
+   const uint8_t *left    = line - bpp;
+   const uint8_t *up_left = prev - bpp;
    width *= bpp;
-   for (i = 0; i < bpp; i++)
-      target[i] = line[i] - paeth(0, prev[i], 0);
-   for (i = bpp; i < width; i++)
-      target[i] = line[i] - paeth(line[i - bpp], prev[i], prev[i - bpp]);
 
-   return count_sad(target, width);
+#if defined(RPNG_SSE2)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i acc        = _mm_setzero_si128();
+      for (; i + 16 <= width; i += 16)
+      {
+         __m128i a    = _mm_loadu_si128((const __m128i*)(left + i));
+         __m128i b    = _mm_loadu_si128((const __m128i*)(prev + i));
+         __m128i c    = _mm_loadu_si128((const __m128i*)(up_left + i));
+         __m128i pred = _mm_packus_epi16(
+               png_paeth_epi16(_mm_unpacklo_epi8(a, zero),
+                  _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero)),
+               png_paeth_epi16(_mm_unpackhi_epi8(a, zero),
+                  _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero)));
+         __m128i t    = _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)), pred);
+         _mm_storeu_si128((__m128i*)(target + i), t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#elif defined(RPNG_NEON)
+   {
+      uint32x4_t acc = vdupq_n_u32(0);
+      for (; i + 16 <= width; i += 16)
+      {
+         uint8x16_t a    = vld1q_u8(left + i);
+         uint8x16_t b    = vld1q_u8(prev + i);
+         uint8x16_t c    = vld1q_u8(up_left + i);
+         uint8x16_t pred = vcombine_u8(
+               png_paeth_u8(vget_low_u8(a), vget_low_u8(b), vget_low_u8(c)),
+               png_paeth_u8(vget_high_u8(a), vget_high_u8(b), vget_high_u8(c)));
+         uint8x16_t t    = vsubq_u8(vld1q_u8(line + i), pred);
+         vst1q_u8(target + i, t);
+         acc = png_sad_acc(acc, t);
+      }
+      cnt = png_sad_sum(acc);
+   }
+#endif
+
+   for (; i < width; i++)
+   {
+      target[i] = line[i] - paeth(left[i], prev[i], up_left[i]);
+      cnt      += abs((int8_t)target[i]);
+   }
+
+   return cnt;
 }
 
-static bool rpng_save_image(const char *path,
-      const uint8_t *data,
-      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+/* A band of rows that is filtered and deflated on its own.
+ * Every block but the last ends with a sync flush, so the
+ * raw deflate outputs can be concatenated into one stream. */
+struct rpng_encode_block
 {
-   unsigned h;
-   bool ret = true;
-   struct png_ihdr ihdr = {0};
+   const uint8_t *data;
+   uint8_t *encode_buf;
+   uint8_t *deflate_buf;
+   size_t encode_size;
+   size_t deflate_size;
+   unsigned first_row;
+   unsigned rows;
+   unsigned width;
+   unsigned pitch;
+   unsigned bpp;
+   int level;
+   uint32_t adler;
+   bool last;
+   bool ok;
+};
+
+static void png_copy_line(uint8_t *dst, const uint8_t *src,
+      unsigned width, unsigned bpp)
+{
+   if (bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, width);
+   else
+      copy_bgr24_line(dst, src, width);
+}
 
-   const struct trans_stream_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
+static bool png_filter_block(struct rpng_encode_block *block)
+{
+   unsigned h;
+   bool ret                = true;
+   unsigned bpp            = block->bpp;
+   unsigned width          = block->width;
+   size_t line_size        = width * bpp;
+   const uint8_t *data     = block->data;
+   uint8_t *encode_target  = block->encode_buf;
+   /* Both lines keep bpp zero bytes in front for the filters. */
+   uint8_t *line_buf       = (uint8_t*)calloc(2, line_size + bpp);
+   uint8_t *filter_buf     = (uint8_t*)malloc(4 * line_size);
    uint8_t *rgba_line      = NULL;
+   uint8_t *prev_encoded   = NULL;
    uint8_t *up_filtered    = NULL;
    uint8_t *sub_filtered   = NULL;
    uint8_t *avg_filtered   = NULL;
    uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
-   RFILE *file             = filestream_open(path,
-         RETRO_VFS_FILE_ACCESS_WRITE,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
-   if (!file)
-      GOTO_END_ERROR();
-
-   stream_backend = trans_stream_get_zlib_deflate_backend();
-
-   if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
-      GOTO_END_ERROR();
-
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr(file, &ihdr))
-      GOTO_END_ERROR();
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
+   if (!line_buf || !filter_buf)
       GOTO_END_ERROR();
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+   rgba_line      = line_buf + bpp;
+   prev_encoded   = line_buf + line_size + 2 * bpp;
+   up_filtered    = filter_buf;
+   sub_filtered   = filter_buf + line_size;
+   avg_filtered   = filter_buf + line_size * 2;
+   paeth_filtered = filter_buf + line_size * 3;
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+   /* The row above this block, which the filters are relative to. */
+   if (block->first_row > 0)
+      png_copy_line(prev_encoded, data - block->pitch, width, bpp);
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+   for (h = 0; h < block->rows; h++, data += block->pitch)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
+      uint8_t *tmp;
+
+      png_copy_line(rgba_line, data, width, bpp);
 
       /* Try every filtering method, and choose the method
        * which has most entries as zero.
@@ -278,7 +530,7 @@ static bool rpng_save_image(const char *path,
        * simple to implement.
        */
       {
-         unsigned none_score  = count_sad(rgba_line, width * bpp);
+         unsigned none_score  = count_sad(rgba_line, line_size);
          unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
          unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
          unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
@@ -316,38 +568,231 @@ static bool rpng_save_image(const char *path,
          }
 
          *encode_target++ = filter;
-         memcpy(encode_target, chosen_filtered, width * bpp);
-
-         memcpy(prev_encoded, rgba_line, width * bpp);
+         memcpy(encode_target, chosen_filtered, line_size);
+         encode_target   += line_size;
       }
+
+      tmp          = prev_encoded;
+      prev_encoded = rgba_line;
+      rgba_line    = tmp;
+   }
+
+end:
+   free(line_buf);
+   free(filter_buf);
+   return ret;
+}
+
+static bool png_deflate_block(struct rpng_encode_block *block)
+{
+   int zret;
+   z_stream z;
+   size_t bound;
+
+   memset(&z, 0, sizeof(z));
+
+   if (deflateInit2(&z, block->level, Z_DEFLATED, -MAX_WBITS, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK)
+      return false;
+
+   /* A sync flush adds an empty stored block on top of the bound. */
+   bound              = deflateBound(&z, (uLong)block->encode_size) + 16;
+   block->deflate_buf = (uint8_t*)malloc(bound);
+   if (!block->deflate_buf)
+   {
+      deflateEnd(&z);
+      return false;
    }
 
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
+   z.next_in   = block->encode_buf;
+   z.avail_in  = (uInt)block->encode_size;
+   z.next_out  = block->deflate_buf;
+   z.avail_out = (uInt)bound;
+
+   zret        = deflate(&z, block->last ? Z_FINISH : Z_SYNC_FLUSH);
+   deflateEnd(&z);
+
+   if (block->last ? zret != Z_STREAM_END
+         : (zret != Z_OK || z.avail_in != 0 || z.avail_out == 0))
+      return false;
+
+   block->deflate_size = bound - z.avail_out;
+   block->adler        = adler32(adler32(0, NULL, 0),
+         block->encode_buf, (uInt)block->encode_size);
+   return true;
+}
+
+static void png_encode_block(void *data)
+{
+   struct rpng_encode_block *block = (struct rpng_encode_block*)data;
+   block->ok = png_filter_block(block) && png_deflate_block(block);
+}
+
+/**
+ * png_adler32_combine:
+ * @adler1             : Adler-32 of the first part.
+ * @adler2             : Adler-32 of the second part.
+ * @len2               : Length of the second part.
+ *
+ * Same as zlib's adler32_combine(), which the bundled zlib
+ * doesn't have.
+ *
+ * Returns: Adler-32 of both parts one after the other.
+ **/
+static uint32_t png_adler32_combine(uint32_t adler1, uint32_t adler2,
+      uint64_t len2)
+{
+   const uint32_t base = 65521;
+   uint32_t rem        = (uint32_t)(len2 % base);
+   uint32_t sum1       = adler1 & 0xffff;
+   uint32_t sum2       = (uint32_t)(((uint64_t)rem * sum1) % base);
+
+   sum1 += (adler2 & 0xffff) + base - 1;
+   sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff)
+      + base - rem;
+
+   if (sum1 >= base)
+      sum1 -= base;
+   if (sum1 >= base)
+      sum1 -= base;
+   if (sum2 >= base << 1)
+      sum2 -= base << 1;
+   if (sum2 >= base)
+      sum2 -= base;
+
+   return sum1 | (sum2 << 16);
+}
+
+static bool rpng_save_image(const char *path,
+      const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp,
+      bool fast, unsigned threads)
+{
+   unsigned i;
+   bool ret = true;
+   struct png_ihdr ihdr = {0};
+
+   size_t encode_buf_size  = 0;
+   size_t idat_size        = 0;
+   unsigned num_blocks     = 1;
+   uint8_t *encode_buf     = NULL;
+   uint8_t *idat_buf       = NULL;
+   uint8_t *idat_target    = NULL;
+   struct rpng_encode_block *blocks = NULL;
+#ifdef HAVE_THREADS
+   sthread_t **workers     = NULL;
+#endif
+   uint32_t adler          = 0;
+   RFILE *file             = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!file)
+      GOTO_END_ERROR();
+
+   if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
       GOTO_END_ERROR();
 
-   stream = stream_backend->stream_new();
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr(file, &ihdr))
+      GOTO_END_ERROR();
 
-   if (!stream)
+   encode_buf_size = (width * bpp + 1) * height;
+   encode_buf = (uint8_t*)malloc(encode_buf_size);
+   if (!encode_buf)
+      GOTO_END_ERROR();
+
+#ifdef HAVE_THREADS
+   num_blocks = encode_buf_size / RPNG_ENCODE_MIN_BLOCK_SIZE;
+   if (num_blocks > threads)
+      num_blocks = threads;
+   if (num_blocks > height)
+      num_blocks = height;
+   if (num_blocks < 1)
+      num_blocks = 1;
+#endif
+
+   blocks = (struct rpng_encode_block*)calloc(num_blocks, sizeof(*blocks));
+   if (!blocks)
       GOTO_END_ERROR();
 
-   stream_backend->set_in(
-         stream,
-         encode_buf,
-         (unsigned)encode_buf_size);
-   stream_backend->set_out(
-         stream,
-         deflate_buf + 8,
-         (unsigned)(encode_buf_size * 2));
+   for (i = 0; i < num_blocks; i++)
+   {
+      struct rpng_encode_block *block = &blocks[i];
+      unsigned first_row              = (unsigned)((uint64_t)height * i / num_blocks);
+      unsigned last_row               = (unsigned)((uint64_t)height * (i + 1) / num_blocks);
+
+      block->data        = data + (size_t)first_row * pitch;
+      block->encode_buf  = encode_buf + (size_t)first_row * (width * bpp + 1);
+      block->encode_size = (size_t)(last_row - first_row) * (width * bpp + 1);
+      block->first_row   = first_row;
+      block->rows        = last_row - first_row;
+      block->width       = width;
+      block->pitch       = pitch;
+      block->bpp         = bpp;
+      block->level       = fast ? Z_BEST_SPEED : Z_BEST_COMPRESSION;
+      block->last        = i == num_blocks - 1;
+   }
 
-   if (!stream_backend->trans(stream, true, &total_in, &total_out, NULL))
+#ifdef HAVE_THREADS
+   if (num_blocks > 1)
    {
+      workers = (sthread_t**)calloc(num_blocks, sizeof(*workers));
+      if (!workers)
+         GOTO_END_ERROR();
+
+      for (i = 1; i < num_blocks; i++)
+         workers[i] = sthread_create(png_encode_block, &blocks[i]);
+   }
+#endif
+
+   png_encode_block(&blocks[0]);
+
+   for (i = 1; i < num_blocks; i++)
+   {
+#ifdef HAVE_THREADS
+      if (workers[i])
+      {
+         sthread_join(workers[i]);
+         continue;
+      }
+#endif
+      /* Couldn't start a thread for it, do it here. */
+      png_encode_block(&blocks[i]);
+   }
+
+   /* Stitch the blocks into a single zlib stream: a header,
+    * the raw deflate data, and the checksum of everything. */
+   idat_size = 8 + 2 + 4;
+   for (i = 0; i < num_blocks; i++)
+   {
+      if (!blocks[i].ok)
+         GOTO_END_ERROR();
+      idat_size += blocks[i].deflate_size;
+      adler      = i == 0 ? blocks[i].adler : png_adler32_combine(adler,
+            blocks[i].adler, blocks[i].encode_size);
+   }
+
+   idat_buf = (uint8_t*)malloc(idat_size);
+   if (!idat_buf)
       GOTO_END_ERROR();
+
+   dword_write_be(idat_buf + 0, (uint32_t)(idat_size - 8));
+   memcpy(idat_buf + 4, "IDAT", 4);
+   idat_buf[8]  = 0x78;
+   idat_buf[9]  = fast ? 0x01 : 0xda;
+   idat_target  = idat_buf + 10;
+
+   for (i = 0; i < num_blocks; i++)
+   {
+      memcpy(idat_target, blocks[i].deflate_buf, blocks[i].deflate_size);
+      idat_target += blocks[i].deflate_size;
    }
+   dword_write_be(idat_target, adler);
 
-   memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0,        ((uint32_t)total_out));
-   if (!png_write_idat(file, deflate_buf, ((size_t)total_out + 8)))
+   if (!png_write_idat(file, idat_buf, idat_size))
       GOTO_END_ERROR();
 
    if (!png_write_iend(file))
@@ -357,21 +802,15 @@ end:
    if (file)
       filestream_close(file);
    free(encode_buf);
-   free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
-
-   if (stream_backend)
+   free(idat_buf);
+#ifdef HAVE_THREADS
+   free(workers);
+#endif
+   if (blocks)
    {
-      if (stream)
-      {
-         if (stream_backend->stream_free)
-            stream_backend->stream_free(stream);
-      }
+      for (i = 0; i < num_blocks; i++)
+         free(blocks[i].deflate_buf);
+      free(blocks);
    }
    return ret;
 }
@@ -380,12 +819,28 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, sizeof(uint32_t));
+         width, height, pitch, sizeof(uint32_t), false, 1);
 }
 
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, 3);
+         width, height, pitch, 3, false, 1);
+}
+
+bool rpng_save_image_argb_ex(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      bool fast, unsigned threads)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, sizeof(uint32_t), fast, threads);
+}
+
+bool rpng_save_image_bgr24_ex(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      bool fast, unsigned threads)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, 3, fast, threads);
 }
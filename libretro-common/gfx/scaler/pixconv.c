@@ -35,6 +35,9 @@
 
 #if defined(__SSE2__)
 #include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD)
+#define SCALER_NEON
+#include <arm_neon.h>
 #endif
 
 void conv_rgb565_0rgb1555(void *output_, const void *input_,
@@ -45,24 +48,36 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
    const uint16_t *input = (const uint16_t*)input_;
    uint16_t *output = (uint16_t*)output_;
 
-#if defined(__SSE2_)
+#if defined(__SSE2__)
    int max_width           = width - 7;
    const __m128i hi_mask   = _mm_set1_epi16(0x7fe0);
    const __m128i lo_mask   = _mm_set1_epi16(0x1f);
+#elif defined(SCALER_NEON)
+   int max_width           = width - 7;
+   const uint16x8_t hi_mask = vdupq_n_u16(0x7fe0);
+   const uint16x8_t lo_mask = vdupq_n_u16(0x1f);
 #endif
 
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 1)
    {
       int w = 0;
-#if defined(__SSE2_)
+#if defined(__SSE2__)
       for (; w < max_width; w += 8)
       {
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
          __m128i lo = _mm_and_si128(in, lo_mask);
          _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t hi       = vandq_u16(vshrq_n_u16(in, 1), hi_mask);
+         uint16x8_t lo       = vandq_u16(in, lo_mask);
+         vst1q_u16(output + w, vorrq_u16(hi, lo));
+      }
 #endif
 
       for (; w < width; w++)
@@ -90,6 +105,12 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
          (int16_t)((0x1f << 11) | (0x1f << 6)));
    const __m128i lo_mask   = _mm_set1_epi16(0x1f);
    const __m128i glow_mask = _mm_set1_epi16(1 << 5);
+#elif defined(SCALER_NEON)
+   int max_width              = width - 7;
+
+   const uint16x8_t hi_mask   = vdupq_n_u16((0x1f << 11) | (0x1f << 6));
+   const uint16x8_t lo_mask   = vdupq_n_u16(0x1f);
+   const uint16x8_t glow_mask = vdupq_n_u16(1 << 5);
 #endif
 
    for (h = 0; h < height;
@@ -106,6 +127,15 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w),
                _mm_or_si128(rg, _mm_or_si128(b, glow)));
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t rg       = vandq_u16(vshlq_n_u16(in, 1), hi_mask);
+         uint16x8_t b        = vandq_u16(in, lo_mask);
+         uint16x8_t glow     = vandq_u16(vshrq_n_u16(in, 4), glow_mask);
+         vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+      }
 #endif
 
       for (; w < width; w++)
@@ -135,6 +165,11 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
    const __m128i a           = _mm_set1_epi16(0x00ff);
 
    int max_width = width - 7;
+#elif defined(SCALER_NEON)
+   const uint8x8_t mask = vdup_n_u8(0x1f);
+   const uint8x8_t a    = vdup_n_u8(0xff);
+
+   int max_width        = width - 7;
 #endif
 
    for (h = 0; h < height;
@@ -169,6 +204,22 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
          _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t res;
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t         r = vand_u8(vmovn_u16(vshrq_n_u16(in, 10)), mask);
+         uint8x8_t         g = vand_u8(vshrn_n_u16(in, 5), mask);
+         uint8x8_t         b = vand_u8(vmovn_u16(in), mask);
+
+         res.val[0]          = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+         res.val[1]          = vorr_u8(vshl_n_u8(g, 3), vshr_n_u8(g, 2));
+         res.val[2]          = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+         res.val[3]          = a;
+
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -203,6 +254,14 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
    const __m128i mul16_b    = _mm_set1_epi16(0x4200);
    const __m128i a          = _mm_set1_epi16(0x00ff);
 
+   int max_width            = width - 7;
+#elif defined(SCALER_NEON)
+   const uint8x8_t mask_g   = vdup_n_u8(0x3f);
+   const uint8x8_t mask_b   = vdup_n_u8(0x1f);
+#ifndef HAVE_NXRGUI
+   const uint8x8_t a        = vdup_n_u8(0xff);
+#endif
+
    int max_width            = width - 7;
 #endif
 
@@ -219,15 +278,21 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
          __m128i        r = _mm_and_si128(_mm_srli_epi16(in, 1), pix_mask_r);
          __m128i        g = _mm_and_si128(in, pix_mask_g);
          __m128i        b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_b);
+         __m128i    alpha = a;
 
          r                = _mm_mulhi_epi16(r, mul16_r);
          g                = _mm_mulhi_epi16(g, mul16_g);
          b                = _mm_mulhi_epi16(b, mul16_b);
 
+#ifdef HAVE_NXRGUI
+         alpha            = _mm_and_si128(
+               _mm_cmpgt_epi16(r, _mm_setzero_si128()), a);
+#endif
+
          res_lo_bg        = _mm_unpacklo_epi8(b, g);
          res_hi_bg        = _mm_unpackhi_epi8(b, g);
-         res_lo_ra        = _mm_unpacklo_epi8(r, a);
-         res_hi_ra        = _mm_unpackhi_epi8(r, a);
+         res_lo_ra        = _mm_unpacklo_epi8(r, alpha);
+         res_hi_ra        = _mm_unpackhi_epi8(r, alpha);
 
          res_lo           = _mm_or_si128(res_lo_bg,
                _mm_slli_si128(res_lo_ra, 2));
@@ -237,6 +302,26 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
          _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t res;
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t         r = vmovn_u16(vshrq_n_u16(in, 11));
+         uint8x8_t         g = vand_u8(vshrn_n_u16(in, 5), mask_g);
+         uint8x8_t         b = vand_u8(vmovn_u16(in), mask_b);
+
+         res.val[0]          = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+         res.val[1]          = vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4));
+         res.val[2]          = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+#ifdef HAVE_NXRGUI
+         res.val[3]          = vtst_u8(r, r);
+#else
+         res.val[3]          = a;
+#endif
+
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -276,6 +361,14 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
    const __m128i mul16_b    = _mm_set1_epi16(0x4200);
    const __m128i a          = _mm_set1_epi16(0x00ff);
 
+   int max_width            = width - 7;
+#elif defined(SCALER_NEON)
+   const uint8x8_t mask_g   = vdup_n_u8(0x3f);
+   const uint8x8_t mask_b   = vdup_n_u8(0x1f);
+#ifndef HAVE_NXRGUI
+   const uint8x8_t a        = vdup_n_u8(0xff);
+#endif
+
    int max_width            = width - 7;
 #endif
 
@@ -292,15 +385,21 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
          __m128i        r = _mm_and_si128(_mm_srli_epi16(in, 1), pix_mask_r);
          __m128i        g = _mm_and_si128(in, pix_mask_g);
          __m128i        b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_b);
+         __m128i    alpha = a;
 
          r                = _mm_mulhi_epi16(r, mul16_r);
          g                = _mm_mulhi_epi16(g, mul16_g);
          b                = _mm_mulhi_epi16(b, mul16_b);
 
-         res_lo_bg        = _mm_unpacklo_epi8(b, g);
-         res_hi_bg        = _mm_unpackhi_epi8(b, g);
-         res_lo_ra        = _mm_unpacklo_epi8(r, a);
-         res_hi_ra        = _mm_unpackhi_epi8(r, a);
+#ifdef HAVE_NXRGUI
+         alpha            = _mm_and_si128(
+               _mm_cmpgt_epi16(r, _mm_setzero_si128()), a);
+#endif
+
+         res_lo_bg        = _mm_unpacklo_epi8(r, g);
+         res_hi_bg        = _mm_unpackhi_epi8(r, g);
+         res_lo_ra        = _mm_unpacklo_epi8(b, alpha);
+         res_hi_ra        = _mm_unpackhi_epi8(b, alpha);
 
          res_lo           = _mm_or_si128(res_lo_bg,
                _mm_slli_si128(res_lo_ra, 2));
@@ -310,6 +409,26 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
          _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t res;
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t         r = vmovn_u16(vshrq_n_u16(in, 11));
+         uint8x8_t         g = vand_u8(vshrn_n_u16(in, 5), mask_g);
+         uint8x8_t         b = vand_u8(vmovn_u16(in), mask_b);
+
+         res.val[0]          = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+         res.val[1]          = vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4));
+         res.val[2]          = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+#ifdef HAVE_NXRGUI
+         res.val[3]          = vtst_u8(r, r);
+#else
+         res.val[3]          = a;
+#endif
+
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -474,6 +593,10 @@ void conv_0rgb1555_bgr24(void *output_, const void *input_,
    const __m128i a           = _mm_set1_epi16(0x00ff);
 
    int max_width             = width - 15;
+#elif defined(SCALER_NEON)
+   const uint8x8_t mask      = vdup_n_u8(0x1f);
+
+   int max_width             = width - 7;
 #endif
 
    for (h = 0; h < height;
@@ -525,6 +648,21 @@ void conv_0rgb1555_bgr24(void *output_, const void *input_,
          /* Non-POT pixel sizes for the loss */
          store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8, out += 24)
+      {
+         uint8x8x3_t res;
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t         r = vand_u8(vmovn_u16(vshrq_n_u16(in, 10)), mask);
+         uint8x8_t         g = vand_u8(vshrn_n_u16(in, 5), mask);
+         uint8x8_t         b = vand_u8(vmovn_u16(in), mask);
+
+         res.val[0]          = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+         res.val[1]          = vorr_u8(vshl_n_u8(g, 3), vshr_n_u8(g, 2));
+         res.val[2]          = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+
+         vst3_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -562,6 +700,11 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
    const __m128i a          = _mm_set1_epi16(0x00ff);
 
    int max_width            = width - 15;
+#elif defined(SCALER_NEON)
+   const uint8x8_t mask_g   = vdup_n_u8(0x3f);
+   const uint8x8_t mask_b   = vdup_n_u8(0x1f);
+
+   int max_width            = width - 7;
 #endif
 
    for (h = 0; h < height; h++, output += out_stride, input += in_stride >> 1)
@@ -610,6 +753,21 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
 
          store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8, out += 24)
+      {
+         uint8x8x3_t res;
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t         r = vmovn_u16(vshrq_n_u16(in, 11));
+         uint8x8_t         g = vand_u8(vshrn_n_u16(in, 5), mask_g);
+         uint8x8_t         b = vand_u8(vmovn_u16(in), mask_b);
+
+         res.val[0]          = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+         res.val[1]          = vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4));
+         res.val[2]          = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+
+         vst3_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -683,6 +841,8 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
 
 #if defined(__SSE2__)
    int max_width = width - 15;
+#elif defined(SCALER_NEON)
+   int max_width = width - 7;
 #endif
 
    for (h = 0; h < height;
@@ -699,6 +859,18 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
                _mm_loadu_si128((const __m128i*)(input + w +  8)),
                _mm_loadu_si128((const __m128i*)(input + w + 12)));
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8, out += 24)
+      {
+         uint8x8x4_t px = vld4_u8((const uint8_t*)(input + w));
+         uint8x8x3_t res;
+
+         res.val[0]     = px.val[0];
+         res.val[1]     = px.val[1];
+         res.val[2]     = px.val[2];
+
+         vst3_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -715,14 +887,50 @@ void conv_argb8888_abgr8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
 
+#if defined(__SSE2__)
+   const __m128i mask_ag = _mm_set1_epi32(0xff00ff00);
+   const __m128i mask_rb = _mm_set1_epi32(0x00ff00ff);
+
+   int max_width         = width - 3;
+#elif defined(SCALER_NEON)
+   int max_width         = width - 15;
+#endif
+
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = 0;
+#if defined(__SSE2__)
+      for (; w < max_width; w += 4)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i       ag = _mm_and_si128(in, mask_ag);
+         __m128i       rb = _mm_and_si128(in, mask_rb);
+
+         rb               = _mm_or_si128(_mm_slli_epi32(rb, 16),
+               _mm_srli_epi32(rb, 16));
+
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_or_si128(ag, _mm_and_si128(rb, mask_rb)));
+      }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 16)
+      {
+         uint8x16x4_t px = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16_t   b  = px.val[0];
+
+         px.val[0]       = px.val[2];
+         px.val[2]       = b;
+
+         vst4q_u8((uint8_t*)(output + w), px);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          output[w]    = ((col << 16) & 0xff0000) |
@@ -761,6 +969,10 @@ void conv_yuyv_argb8888(void *output_, const void *input_,
    const __m128i v_g_mul       = _mm_set1_epi16(YUV_MAT_V_G);
    const __m128i a             = _mm_cmpeq_epi16(
          _mm_setzero_si128(), _mm_setzero_si128());
+#elif defined(SCALER_NEON)
+   const int16x8_t chroma_offset = vdupq_n_s16(128);
+   const int16x8_t round_offset  = vdupq_n_s16(YUV_OFFSET);
+   const uint8x8_t a             = vdup_n_u8(0xff);
 #endif
 
    for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
@@ -852,6 +1064,46 @@ void conv_yuyv_argb8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(dst +  8), res2);
          _mm_storeu_si128((__m128i*)(dst + 12), res3);
       }
+#elif defined(SCALER_NEON)
+      /* Each loop processes 16 pixels. */
+      for (; w + 16 <= width; w += 16, src += 32, dst += 16)
+      {
+         uint8x8x2_t r, g, b;
+         uint8x8x4_t res;
+         uint8x8x4_t yuv = vld4_u8(src); /* [Y0, U, Y1, V] x 8 */
+
+         int16x8_t _y0   = vreinterpretq_s16_u16(vshll_n_u8(yuv.val[0], 6));
+         int16x8_t _y1   = vreinterpretq_s16_u16(vshll_n_u8(yuv.val[2], 6));
+         int16x8_t u     = vsubq_s16(
+               vreinterpretq_s16_u16(vmovl_u8(yuv.val[1])), chroma_offset);
+         int16x8_t v     = vsubq_s16(
+               vreinterpretq_s16_u16(vmovl_u8(yuv.val[3])), chroma_offset);
+
+         /* Chroma contributions are shared by both pixels of a pair. */
+         int16x8_t r_uv  = vaddq_s16(vmulq_n_s16(v, YUV_MAT_V_R), round_offset);
+         int16x8_t g_uv  = vaddq_s16(vaddq_s16(vmulq_n_s16(u, YUV_MAT_U_G),
+                  vmulq_n_s16(v, YUV_MAT_V_G)), round_offset);
+         int16x8_t b_uv  = vaddq_s16(vmulq_n_s16(u, YUV_MAT_U_B), round_offset);
+
+         /* Saturate into 8-bit and put even and odd pixels back in order. */
+         r = vzip_u8(vqshrun_n_s16(vaddq_s16(_y0, r_uv), YUV_SHIFT),
+               vqshrun_n_s16(vaddq_s16(_y1, r_uv), YUV_SHIFT));
+         g = vzip_u8(vqshrun_n_s16(vaddq_s16(_y0, g_uv), YUV_SHIFT),
+               vqshrun_n_s16(vaddq_s16(_y1, g_uv), YUV_SHIFT));
+         b = vzip_u8(vqshrun_n_s16(vaddq_s16(_y0, b_uv), YUV_SHIFT),
+               vqshrun_n_s16(vaddq_s16(_y1, b_uv), YUV_SHIFT));
+
+         res.val[0] = b.val[0];
+         res.val[1] = g.val[0];
+         res.val[2] = r.val[0];
+         res.val[3] = a;
+         vst4_u8((uint8_t*)(dst + 0), res);
+
+         res.val[0] = b.val[1];
+         res.val[1] = g.val[1];
+         res.val[2] = r.val[1];
+         vst4_u8((uint8_t*)(dst + 8), res);
+      }
 #endif
 
       /* Finish off the rest (if any) in C. */
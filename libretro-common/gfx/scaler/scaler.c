@@ -30,6 +30,48 @@
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+/* With ctx->threads > 1 the output is cut into horizontal bands.
+ * Each band converts and horizontally scales only the input rows
+ * its vertical taps touch, into buffers of its own, so bands share
+ * nothing but disjoint output rows and can run on any thread.
+ * Rows near a band edge are horizontally scaled by both neighbours. */
+struct scaler_slice
+{
+   int out_y;
+   int out_height;
+   int in_y;
+   int in_height;
+   int *filter_pos;          /* vert.filter_pos, relative to in_y. */
+   uint32_t *input_frame;
+   uint64_t *scaled_frame;
+};
+
+#ifdef HAVE_THREADS
+struct scaler_pool
+{
+   sthread_t **threads;
+   unsigned num_threads;
+
+   slock_t *lock;
+   scond_t *cond;
+   scond_t *done_cond;
+
+   /* Current job, protected by lock. */
+   const struct scaler_ctx *ctx;
+   void *output;
+   const void *input;
+   unsigned next_slice;
+   unsigned num_slices;
+   unsigned pending;
+
+   bool quit;
+};
+#endif
+
 static bool allocate_frames(struct scaler_ctx *ctx)
 {
    uint64_t *scaled_frame = NULL;
@@ -74,9 +116,319 @@ static bool allocate_frames(struct scaler_ctx *ctx)
    return true;
 }
 
+static void scaler_ctx_free_slices(struct scaler_ctx *ctx)
+{
+   unsigned i;
+
+   if (!ctx->slices)
+      return;
+
+   for (i = 0; i < ctx->num_slices; i++)
+   {
+      free(ctx->slices[i].filter_pos);
+      free(ctx->slices[i].input_frame);
+      free(ctx->slices[i].scaled_frame);
+   }
+
+   free(ctx->slices);
+   ctx->slices     = NULL;
+   ctx->num_slices = 0;
+}
+
+#ifdef HAVE_THREADS
+/**
+ * scaler_ctx_gen_slices:
+ * @ctx          : pointer to scaler context object.
+ *
+ * Splits the output into ctx->threads bands and works out, from the
+ * vertical filter, which input rows each of them needs.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool scaler_ctx_gen_slices(struct scaler_ctx *ctx)
+{
+   unsigned i;
+   unsigned num_slices = ctx->threads;
+
+   if (num_slices > (unsigned)ctx->out_height)
+      num_slices = ctx->out_height;
+
+   ctx->slices = (struct scaler_slice*)
+      calloc(num_slices, sizeof(*ctx->slices));
+
+   if (!ctx->slices)
+      return false;
+
+   ctx->num_slices = num_slices;
+
+   for (i = 0; i < num_slices; i++)
+   {
+      int y;
+      struct scaler_slice *slice = &ctx->slices[i];
+      int out_end                = ctx->out_height * (i + 1) / num_slices;
+      int in_end                 = 0;
+
+      slice->out_y               = ctx->out_height * i / num_slices;
+      slice->out_height          = out_end - slice->out_y;
+      slice->in_y                = ctx->in_height;
+
+      for (y = slice->out_y; y < out_end; y++)
+      {
+         int pos = ctx->vert.filter_pos[y];
+
+         if (pos < slice->in_y)
+            slice->in_y = pos;
+         if (pos + ctx->vert.filter_len > in_end)
+            in_end = pos + ctx->vert.filter_len;
+      }
+
+      slice->in_height           = in_end - slice->in_y;
+      slice->filter_pos          = (int*)
+         malloc(slice->out_height * sizeof(int));
+      slice->scaled_frame        = (uint64_t*)calloc(sizeof(uint64_t),
+            (ctx->scaled.stride * slice->in_height) >> 3);
+
+      if (!slice->filter_pos || !slice->scaled_frame)
+         return false;
+
+      for (y = 0; y < slice->out_height; y++)
+         slice->filter_pos[y] =
+            ctx->vert.filter_pos[slice->out_y + y] - slice->in_y;
+
+      if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+      {
+         slice->input_frame = (uint32_t*)calloc(sizeof(uint32_t),
+               (ctx->input.stride * slice->in_height) >> 2);
+
+         if (!slice->input_frame)
+            return false;
+      }
+   }
+
+   /* The bands carry their own intermediate buffers. */
+   free(ctx->scaled.frame);
+   free(ctx->input.frame);
+   ctx->scaled.frame = NULL;
+   ctx->input.frame  = NULL;
+
+   return true;
+}
+#endif
+
+static void scaler_ctx_scale_slice(const struct scaler_ctx *ctx,
+      const struct scaler_slice *slice, void *output, const void *input)
+{
+   struct scaler_ctx band  = *ctx;
+   const uint8_t *in_frame = (const uint8_t*)input
+      + slice->in_y * ctx->in_stride;
+   uint8_t *out_frame      = (uint8_t*)output
+      + slice->out_y * ctx->out_stride;
+   int input_stride        = ctx->in_stride;
+
+   band.scaled.frame       = slice->scaled_frame;
+   band.scaled.height      = slice->in_height;
+   band.out_height         = slice->out_height;
+   band.vert.filter        = ctx->vert.filter
+      + slice->out_y * ctx->vert.filter_stride;
+   band.vert.filter_pos    = slice->filter_pos;
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      ctx->in_pixconv(slice->input_frame, in_frame,
+            ctx->in_width, slice->in_height,
+            ctx->input.stride, ctx->in_stride);
+
+      in_frame     = (const uint8_t*)slice->input_frame;
+      input_stride = ctx->input.stride;
+   }
+
+   ctx->scaler_horiz(&band, in_frame, input_stride);
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   {
+      uint32_t *frame = ctx->output.frame
+         + slice->out_y * (ctx->output.stride >> 2);
+
+      ctx->scaler_vert(&band, frame, ctx->output.stride);
+      ctx->out_pixconv(out_frame, frame,
+            ctx->out_width, slice->out_height,
+            ctx->out_stride, ctx->output.stride);
+   }
+   else
+      ctx->scaler_vert(&band, out_frame, ctx->out_stride);
+}
+
+#ifdef HAVE_THREADS
+static void scaler_pool_thread(void *data)
+{
+   struct scaler_pool *pool = (struct scaler_pool*)data;
+
+   slock_lock(pool->lock);
+
+   for (;;)
+   {
+      unsigned i;
+
+      while (!pool->quit && pool->next_slice >= pool->num_slices)
+         scond_wait(pool->cond, pool->lock);
+
+      if (pool->quit)
+         break;
+
+      i = pool->next_slice++;
+
+      slock_unlock(pool->lock);
+      scaler_ctx_scale_slice(pool->ctx, &pool->ctx->slices[i],
+            pool->output, pool->input);
+      slock_lock(pool->lock);
+
+      if (--pool->pending == 0)
+         scond_signal(pool->done_cond);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void scaler_pool_free(struct scaler_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      scond_broadcast(pool->cond);
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->num_threads; i++)
+      if (pool->threads[i])
+         sthread_join(pool->threads[i]);
+
+   free(pool->threads);
+
+   if (pool->cond)
+      scond_free(pool->cond);
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+
+   free(pool);
+}
+
+static struct scaler_pool *scaler_pool_new(unsigned num_threads)
+{
+   unsigned i;
+   struct scaler_pool *pool = (struct scaler_pool*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->lock      = slock_new();
+   pool->cond      = scond_new();
+   pool->done_cond = scond_new();
+   pool->threads   = (sthread_t**)calloc(num_threads, sizeof(sthread_t*));
+
+   if (!pool->lock || !pool->cond || !pool->done_cond || !pool->threads)
+      goto error;
+
+   for (i = 0; i < num_threads; i++)
+   {
+      if (!(pool->threads[i] = sthread_create(scaler_pool_thread, pool)))
+         goto error;
+      pool->num_threads++;
+   }
+
+   return pool;
+
+error:
+   scaler_pool_free(pool);
+   return NULL;
+}
+
+static void scaler_pool_run(struct scaler_pool *pool,
+      const struct scaler_ctx *ctx, void *output, const void *input)
+{
+   slock_lock(pool->lock);
+
+   pool->ctx        = ctx;
+   pool->output     = output;
+   pool->input      = input;
+   pool->next_slice = 0;
+   pool->num_slices = ctx->num_slices;
+   pool->pending    = ctx->num_slices;
+
+   scond_broadcast(pool->cond);
+
+   /* The calling thread takes bands as well instead of idling. */
+   while (pool->next_slice < pool->num_slices)
+   {
+      unsigned i = pool->next_slice++;
+
+      slock_unlock(pool->lock);
+      scaler_ctx_scale_slice(ctx, &ctx->slices[i], output, input);
+      slock_lock(pool->lock);
+
+      pool->pending--;
+   }
+
+   while (pool->pending)
+      scond_wait(pool->done_cond, pool->lock);
+
+   slock_unlock(pool->lock);
+}
+#endif
+
+static void scaler_ctx_free_frames(struct scaler_ctx *ctx)
+{
+   if (ctx->horiz.filter)
+      free(ctx->horiz.filter);
+   if (ctx->horiz.filter_pos)
+      free(ctx->horiz.filter_pos);
+   if (ctx->vert.filter)
+      free(ctx->vert.filter);
+   if (ctx->vert.filter_pos)
+      free(ctx->vert.filter_pos);
+   if (ctx->scaled.frame)
+      free(ctx->scaled.frame);
+   if (ctx->input.frame)
+      free(ctx->input.frame);
+   if (ctx->output.frame)
+      free(ctx->output.frame);
+
+   scaler_ctx_free_slices(ctx);
+
+   ctx->horiz.filter        = NULL;
+   ctx->horiz.filter_len    = 0;
+   ctx->horiz.filter_stride = 0;
+   ctx->horiz.filter_pos    = NULL;
+
+   ctx->vert.filter         = NULL;
+   ctx->vert.filter_len     = 0;
+   ctx->vert.filter_stride  = 0;
+   ctx->vert.filter_pos     = NULL;
+
+   ctx->scaled.frame        = NULL;
+   ctx->scaled.width        = 0;
+   ctx->scaled.height       = 0;
+   ctx->scaled.stride       = 0;
+
+   ctx->input.frame         = NULL;
+   ctx->input.stride        = 0;
+
+   ctx->output.frame        = NULL;
+   ctx->output.stride       = 0;
+}
+
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 {
-   scaler_ctx_gen_reset(ctx);
+   /* Keep the worker threads around across size changes. */
+   scaler_ctx_free_frames(ctx);
 
    ctx->scaler_special = NULL;
    ctx->unscaled       = false;
@@ -252,6 +604,24 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
       if (!scaler_gen_filter(ctx))
          return false;
+
+#ifdef HAVE_THREADS
+      if (ctx->threads > 1 && !ctx->scaler_special)
+      {
+         if (!scaler_ctx_gen_slices(ctx))
+            return false;
+
+         if (ctx->pool && ctx->pool->num_threads != ctx->num_slices - 1)
+         {
+            scaler_pool_free(ctx->pool);
+            ctx->pool = NULL;
+         }
+
+         /* Without workers the bands simply run one after another. */
+         if (!ctx->pool && ctx->num_slices > 1)
+            ctx->pool = scaler_pool_new(ctx->num_slices - 1);
+      }
+#endif
    }
 
    return true;
@@ -259,41 +629,12 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
 void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 {
-   if (ctx->horiz.filter)
-      free(ctx->horiz.filter);
-   if (ctx->horiz.filter_pos)
-      free(ctx->horiz.filter_pos);
-   if (ctx->vert.filter)
-      free(ctx->vert.filter);
-   if (ctx->vert.filter_pos)
-      free(ctx->vert.filter_pos);
-   if (ctx->scaled.frame)
-      free(ctx->scaled.frame);
-   if (ctx->input.frame)
-      free(ctx->input.frame);
-   if (ctx->output.frame)
-      free(ctx->output.frame);
-
-   ctx->horiz.filter        = NULL;
-   ctx->horiz.filter_len    = 0;
-   ctx->horiz.filter_stride = 0;
-   ctx->horiz.filter_pos    = NULL;
-
-   ctx->vert.filter         = NULL;
-   ctx->vert.filter_len     = 0;
-   ctx->vert.filter_stride  = 0;
-   ctx->vert.filter_pos     = NULL;
-
-   ctx->scaled.frame        = NULL;
-   ctx->scaled.width        = 0;
-   ctx->scaled.height       = 0;
-   ctx->scaled.stride       = 0;
+   scaler_ctx_free_frames(ctx);
 
-   ctx->input.frame         = NULL;
-   ctx->input.stride        = 0;
-
-   ctx->output.frame        = NULL;
-   ctx->output.stride       = 0;
+#ifdef HAVE_THREADS
+   scaler_pool_free(ctx->pool);
+#endif
+   ctx->pool = NULL;
 }
 
 /**
@@ -312,6 +653,23 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
    int input_stride        = ctx->in_stride;
    int output_stride       = ctx->out_stride;
 
+   if (ctx->slices)
+   {
+      unsigned i;
+
+#ifdef HAVE_THREADS
+      if (ctx->pool)
+      {
+         scaler_pool_run(ctx->pool, ctx, output, input);
+         return;
+      }
+#endif
+
+      for (i = 0; i < ctx->num_slices; i++)
+         scaler_ctx_scale_slice(ctx, &ctx->slices[i], output, input);
+      return;
+   }
+
    if (ctx->in_fmt != SCALER_FMT_ARGB8888)
    {
       ctx->in_pixconv(ctx->input.frame, input,
@@ -340,7 +698,7 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
       if (ctx->scaler_horiz)
          ctx->scaler_horiz(ctx, input_frame, input_stride);
       if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
+         ctx->scaler_vert (ctx, output_frame, output_stride);
    }
 
    if (ctx->out_fmt != SCALER_FMT_ARGB8888)
@@ -33,6 +33,9 @@
 #ifdef _WIN32
 #include <intrin.h>
 #endif
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD)
+#define SCALER_NEON
+#include <arm_neon.h>
 #endif
 
 /* ARGB8888 scaler is split in two:
@@ -86,7 +89,8 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
          for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2,
                input_base_y += (ctx->scaled.stride >> 2))
          {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
+            __m128i coeff = _mm_unpacklo_epi64(
+                  _mm_set1_epi16(filter_vert[y + 0]), _mm_set1_epi16(filter_vert[y + 1]));
             __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
 
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
@@ -94,7 +98,8 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
 
          for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
+            __m128i coeff = _mm_unpacklo_epi64(
+                  _mm_set1_epi16(filter_vert[y]), _mm_setzero_si128());
             __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
 
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
@@ -106,6 +111,24 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
          final     = _mm_packus_epi16(res, res);
 
          output[w] = _mm_cvtsi128_si32(final);
+#elif defined(SCALER_NEON)
+         uint8x8_t final;
+         int16x4_t res = vdup_n_s16(0);
+
+         for (y = 0; y < ctx->vert.filter_len; y++,
+               input_base_y += (ctx->scaled.stride >> 3))
+         {
+            int16x4_t col = vreinterpret_s16_u64(vld1_u64(input_base_y));
+
+            res           = vadd_s16(res,
+                  vshrn_n_s32(vmull_n_s16(col, filter_vert[y]), 16));
+         }
+
+         res       = vshr_n_s16(res, (7 - 2 - 2));
+
+         final     = vqmovun_s16(vcombine_s16(res, res));
+
+         output[w] = vget_lane_u32(vreinterpret_u32_u8(final), 0);
 #else
          int16_t res_a = 0;
          int16_t res_r = 0;
@@ -165,7 +188,8 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 
          for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
          {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
+            __m128i coeff = _mm_unpacklo_epi64(
+                  _mm_set1_epi16(filter_horiz[x + 0]), _mm_set1_epi16(filter_horiz[x + 1]));
 
             __m128i col   = _mm_unpacklo_epi8(_mm_set_epi64x(0,
                      ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
@@ -176,7 +200,8 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 
          for (; x < ctx->horiz.filter_len; x++)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
+            __m128i coeff = _mm_unpacklo_epi64(
+                  _mm_set1_epi16(filter_horiz[x]), _mm_setzero_si128());
             __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
 
             col           = _mm_slli_epi16(col, 7);
@@ -197,6 +222,20 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
          u.u32[0] = _mm_cvtsi128_si32(res);
          u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
 #endif
+#elif defined(SCALER_NEON)
+         int16x4_t res = vdup_n_s16(0);
+
+         for (x = 0; x < ctx->horiz.filter_len; x++)
+         {
+            uint8x8_t px  = vreinterpret_u8_u32(vdup_n_u32(input_base_x[x]));
+            int16x4_t col = vreinterpret_s16_u16(
+                  vget_low_u16(vshll_n_u8(px, 7)));
+
+            res           = vadd_s16(res,
+                  vshrn_n_s32(vmull_n_s16(col, filter_horiz[x]), 16));
+         }
+
+         vst1_u64(output + w, vreinterpret_u64_s16(res));
 #else
          int16_t res_a = 0;
          int16_t res_r = 0;
@@ -220,11 +259,14 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
             res_b         += (b * coeff) >> 16;
          }
 
+         /* Negative lobes of the sinc filter can leave a
+          * channel below zero, keep it from sign extending
+          * into the other ones. */
          output[w]         = (
-               (uint64_t)res_a  << 48)  |
-               ((uint64_t)res_r << 32)  |
-               ((uint64_t)res_g << 16)  |
-               ((uint64_t)res_b << 0);
+               (uint64_t)(uint16_t)res_a  << 48)  |
+               ((uint64_t)(uint16_t)res_r << 32)  |
+               ((uint64_t)(uint16_t)res_g << 16)  |
+               ((uint64_t)(uint16_t)res_b << 0);
 #endif
       }
    }
@@ -486,6 +486,19 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/**
+ * path_get_size_mtime:
+ * @path               : path
+ * @size               : size of the file in bytes
+ * @mtime              : last modification time, in seconds
+ *
+ * Retrieves both with a single stat call.
+ *
+ * Returns: true (1) on success, false (0) if @path is not valid
+ * or the platform does not provide modification times.
+ */
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime);
+
 RETRO_END_DECLS
 
 #endif
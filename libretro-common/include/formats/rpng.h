@@ -56,6 +56,16 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
 
+/* Same as above, but with @fast the image is deflated at the
+ * fastest level, and large images get filtered and deflated in
+ * up to @threads bands in parallel. */
+bool rpng_save_image_argb_ex(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      bool fast, unsigned threads);
+bool rpng_save_image_bgr24_ex(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      bool fast, unsigned threads);
+
 RETRO_END_DECLS
 
 #endif
@@ -59,6 +59,9 @@ struct scaler_filter
    int *filter_pos;
 };
 
+struct scaler_slice;
+struct scaler_pool;
+
 struct scaler_ctx
 {
    int in_width;
@@ -106,6 +109,15 @@ struct scaler_ctx
       uint32_t *frame;
       int stride;
    } output;
+
+   /* Number of horizontal bands the output is split into and
+    * scaled on in parallel. 0 or 1 scales on the calling thread.
+    * Set before scaler_ctx_gen_filter(). */
+   unsigned threads;
+
+   unsigned num_slices;
+   struct scaler_slice *slices;
+   struct scaler_pool *pool;
 };
 
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx);
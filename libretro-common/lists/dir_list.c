@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(_WIN32) && defined(_XBOX)
 #include <xtl.h>
@@ -60,6 +61,43 @@ static int qstrcmp_dir(const void *a_, const void *b_)
    return strcasecmp(a->data, b->data);
 }
 
+static int qstrcmp_ext(const void *a_, const void *b_)
+{
+   const char *a                    = (const char*)a_;
+   const struct string_list_elem *b = (const struct string_list_elem*)b_;
+
+   return strcasecmp(a, b->data);
+}
+
+/* Extension lists can hold hundreds of entries (e.g. every
+ * extension of every installed core), so they are sorted
+ * once up front and searched with bsearch for each entry. */
+static void dir_list_prepare_ext_list(struct string_list *ext_list)
+{
+   size_t i;
+
+   for (i = 0; i < ext_list->size; i++)
+   {
+      char *ext = ext_list->elems[i].data;
+
+      if (ext && *ext == '.')
+         memmove(ext, ext + 1, strlen(ext));
+   }
+
+   qsort(ext_list->elems, ext_list->size,
+         sizeof(struct string_list_elem), qstrcmp_plain);
+}
+
+static bool dir_list_find_ext(const struct string_list *ext_list,
+      const char *ext)
+{
+   if (!ext_list || string_is_empty(ext))
+      return false;
+
+   return bsearch(ext, ext_list->elems, ext_list->size,
+         sizeof(struct string_list_elem), qstrcmp_ext) != NULL;
+}
+
 /**
  * dir_list_sort:
  * @list      : pointer to the directory listing.
@@ -117,7 +155,7 @@ static int parse_dir_entry(const char *name, char *file_path,
    if (!is_dir)
    {
       is_compressed_file = path_is_compressed_file(file_path);
-      if (string_list_find_elem_prefix(ext_list, ".", file_ext))
+      if (dir_list_find_ext(ext_list, file_ext))
          supported_by_core = true;
    }
 
@@ -256,7 +294,11 @@ struct string_list *dir_list_new(const char *dir,
       return NULL;
 
    if (ext)
+   {
       ext_list = string_split(ext, "|");
+      if (ext_list)
+         dir_list_prepare_ext_list(ext_list);
+   }
 
    if(dir_list_read(dir, list, ext_list, include_dirs,
             include_hidden, include_compressed, recursive) == -1)
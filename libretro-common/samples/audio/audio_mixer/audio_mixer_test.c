@@ -0,0 +1,387 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (audio_mixer_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_timers.h>
+#include <audio/audio_mixer.h>
+#include <rthreads/rthreads.h>
+
+/* Exercises the streamed voice path of the mixer with its
+ * decoder thread:
+ *
+ * - a voice played while the decoder thread is idle gets its
+ *   ring filled without the mixer running;
+ * - voices played and stopped from one thread while another one
+ *   mixes all get exactly one stop callback, short sounds left to
+ *   play out all finish, and the mixer shuts down cleanly.
+ *
+ * The streamed sound is a tiny generated MOD and the short one a
+ * generated WAV, so no files are needed. Build with
+ * -fsanitize=thread to check the locking. */
+
+#define TEST_RATE        48000
+#define TEST_BLOCK       512
+#define TEST_ITERATIONS  3000
+#define TEST_MAX_PLAYING 4
+#define TEST_SHOT_FRAMES 480
+
+static slock_t *test_lock       = NULL;
+static unsigned test_stopped    = 0;
+static unsigned test_finished   = 0;
+static bool test_quit           = false;
+static unsigned test_failures   = 0;
+
+#define TEST_CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         test_failures++; \
+      } \
+   } while (0)
+
+static void test_put_be16(uint8_t *p, unsigned val)
+{
+   p[0] = (uint8_t)(val >> 8);
+   p[1] = (uint8_t)val;
+}
+
+static void test_put_le16(uint8_t *p, unsigned val)
+{
+   p[0] = (uint8_t)val;
+   p[1] = (uint8_t)(val >> 8);
+}
+
+static void test_put_le32(uint8_t *p, uint32_t val)
+{
+   test_put_le16(p, val & 0xffff);
+   test_put_le16(p + 2, val >> 16);
+}
+
+/**
+ * test_make_mod:
+ * @size               : Output, size of the module.
+ *
+ * Builds a 4 channel ProTracker module with one looped square
+ * wave sample and one note on each channel. ibxm loops songs,
+ * so the voice only ever ends by being stopped.
+ *
+ * Returns: the module, owned by the sound it is loaded into.
+ **/
+static uint8_t *test_make_mod(int32_t *size)
+{
+   unsigned i;
+   const unsigned sample_len = 64;
+   uint8_t *mod              = NULL;
+   uint8_t *pattern          = NULL;
+   uint8_t *sample           = NULL;
+
+   *size   = 1084 + 1024 + sample_len;
+   mod     = (uint8_t*)calloc(1, *size);
+
+   if (!mod)
+      return NULL;
+
+   /* Sample 1: length, volume and loop, lengths are in words. */
+   test_put_be16(mod + 20 + 22, sample_len / 2);
+   mod[20 + 25] = 64;
+   test_put_be16(mod + 20 + 26, 0);
+   test_put_be16(mod + 20 + 28, sample_len / 2);
+
+   mod[950]  = 1;
+   mod[951]  = 127;
+   mod[952]  = 0;
+   memcpy(mod + 1080, "M.K.", 4);
+
+   /* Sample 1 at period 428 (C-2) on every channel. */
+   pattern   = mod + 1084;
+   for (i = 0; i < 4; i++)
+   {
+      pattern[i * 4 + 0] = 0x00 | (428 >> 8);
+      pattern[i * 4 + 1] = 428 & 0xff;
+      pattern[i * 4 + 2] = 0x10;
+   }
+
+   sample    = pattern + 1024;
+   for (i = 0; i < sample_len; i++)
+      sample[i] = i < sample_len / 2 ? 0x60 : 0xa0;
+
+   return mod;
+}
+
+/**
+ * test_make_wav:
+ * @size               : Output, size of the file.
+ *
+ * Builds a 16-bit stereo WAV of TEST_SHOT_FRAMES frames of a
+ * square wave.
+ *
+ * Returns: the file, to be freed by the caller once loaded.
+ **/
+static uint8_t *test_make_wav(int32_t *size)
+{
+   unsigned i;
+   const uint32_t data_size = TEST_SHOT_FRAMES * 4;
+   uint8_t *wav             = NULL;
+
+   *size = 44 + data_size;
+   wav   = (uint8_t*)calloc(1, *size);
+
+   if (!wav)
+      return NULL;
+
+   memcpy(wav, "RIFF", 4);
+   test_put_le32(wav + 4, 36 + data_size);
+   memcpy(wav + 8, "WAVEfmt ", 8);
+   test_put_le32(wav + 16, 16);
+   test_put_le16(wav + 20, 1);
+   test_put_le16(wav + 22, 2);
+   test_put_le32(wav + 24, TEST_RATE);
+   test_put_le32(wav + 28, TEST_RATE * 4);
+   test_put_le16(wav + 32, 4);
+   test_put_le16(wav + 34, 16);
+   memcpy(wav + 36, "data", 4);
+   test_put_le32(wav + 40, data_size);
+
+   for (i = 0; i < TEST_SHOT_FRAMES * 2; i++)
+      test_put_le16(wav + 44 + i * 2, (i / 40) & 1 ? 0x2000 : 0xe000);
+
+   return wav;
+}
+
+static void test_stop_cb(audio_mixer_sound_t *sound, unsigned reason)
+{
+   slock_lock(test_lock);
+   if (reason == AUDIO_MIXER_SOUND_STOPPED)
+      test_stopped++;
+   else if (reason == AUDIO_MIXER_SOUND_FINISHED)
+      test_finished++;
+   slock_unlock(test_lock);
+}
+
+static void test_mixer_thread(void *data)
+{
+   float buffer[TEST_BLOCK * 2];
+   bool quit = false;
+
+   while (!quit)
+   {
+      memset(buffer, 0, sizeof(buffer));
+      audio_mixer_mix(buffer, TEST_BLOCK, 1.0f, false);
+
+      slock_lock(test_lock);
+      quit = test_quit;
+      slock_unlock(test_lock);
+   }
+}
+
+/**
+ * test_wake_from_idle:
+ * @sound              : Streamed sound.
+ *
+ * Plays @sound while the decoder thread sleeps with nothing to do
+ * and checks that it fills the whole ring on its own, by mixing
+ * far more than the one tick audio_mixer_play() decodes itself.
+ **/
+static void test_wake_from_idle(audio_mixer_sound_t *sound)
+{
+   unsigned i;
+   static float buffer[8192 * 2];
+   audio_mixer_voice_t *voice = NULL;
+   bool tail_audible          = false;
+
+   /* Give the decoder thread time to go to sleep. */
+   retro_sleep(50);
+
+   voice = audio_mixer_play(sound, true, 1.0f, test_stop_cb);
+   TEST_CHECK(voice != NULL);
+   if (!voice)
+      return;
+
+   retro_sleep(100);
+
+   audio_mixer_mix(buffer, 8192, 1.0f, false);
+
+   for (i = 7168 * 2; i < 8192 * 2; i++)
+      if (buffer[i] != 0.0f)
+         tail_audible = true;
+
+   TEST_CHECK(tail_audible);
+
+   audio_mixer_stop(voice);
+}
+
+/**
+ * test_play_stop_stress:
+ * @looped             : Sound that is played repeating and stopped.
+ * @shot               : Short sound that is left to finish.
+ *
+ * Plays and stops voices as fast as possible while another thread
+ * mixes, going idle now and then so the decoder thread goes back
+ * to sleep.
+ **/
+static void test_play_stop_stress(audio_mixer_sound_t *looped,
+      audio_mixer_sound_t *shot)
+{
+   unsigned i;
+   audio_mixer_voice_t *playing[TEST_MAX_PLAYING];
+   unsigned num_playing = 0;
+   unsigned stops       = 0;
+   unsigned shots       = 0;
+   unsigned finished    = 0;
+   unsigned waited      = 0;
+   sthread_t *mixer     = NULL;
+
+   test_quit    = false;
+   mixer        = sthread_create(test_mixer_thread, NULL);
+   TEST_CHECK(mixer != NULL);
+   if (!mixer)
+      return;
+
+   srand(1);
+
+   for (i = 0; i < TEST_ITERATIONS; i++)
+   {
+      unsigned r = rand();
+
+      if (r % 8 == 0)
+      {
+         if (audio_mixer_play(shot, false, 1.0f, test_stop_cb))
+            shots++;
+      }
+      else if (num_playing < TEST_MAX_PLAYING && (r % 2 || !num_playing))
+      {
+         audio_mixer_voice_t *voice = audio_mixer_play(
+               looped, true, 1.0f, test_stop_cb);
+
+         if (voice)
+            playing[num_playing++] = voice;
+      }
+      else if (num_playing)
+      {
+         unsigned victim = r % num_playing;
+
+         audio_mixer_stop(playing[victim]);
+         playing[victim] = playing[--num_playing];
+         stops++;
+      }
+
+      if (i % 500 == 499)
+      {
+         while (num_playing)
+         {
+            audio_mixer_stop(playing[--num_playing]);
+            stops++;
+         }
+
+         retro_sleep(5);
+      }
+   }
+
+   while (num_playing)
+   {
+      audio_mixer_stop(playing[--num_playing]);
+      stops++;
+   }
+
+   /* The short sounds end after 10 ms, give them a few seconds. */
+   for (waited = 0; waited < 5000; waited += 10)
+   {
+      slock_lock(test_lock);
+      finished = test_finished;
+      slock_unlock(test_lock);
+
+      if (finished >= shots)
+         break;
+
+      retro_sleep(10);
+   }
+
+   slock_lock(test_lock);
+   test_quit = true;
+   slock_unlock(test_lock);
+   sthread_join(mixer);
+
+   slock_lock(test_lock);
+   TEST_CHECK(test_stopped == stops);
+   TEST_CHECK(test_finished == shots);
+   slock_unlock(test_lock);
+
+   printf("%u stopped, %u finished\n", stops, shots);
+}
+
+int main(void)
+{
+   int32_t mod_size            = 0;
+   int32_t wav_size            = 0;
+   uint8_t *mod                = test_make_mod(&mod_size);
+   uint8_t *wav                = test_make_wav(&wav_size);
+   audio_mixer_sound_t *looped = NULL;
+   audio_mixer_sound_t *shot   = NULL;
+
+   test_lock = slock_new();
+
+   if (!mod || !wav || !test_lock)
+      return 1;
+
+   audio_mixer_init(TEST_RATE);
+
+   looped = audio_mixer_load_mod(mod, mod_size);
+   shot   = audio_mixer_load_wav(wav, wav_size);
+   free(wav);
+
+   if (!looped || !shot)
+   {
+      fprintf(stderr, "Built without HAVE_IBXM.\n");
+      return 1;
+   }
+
+   test_wake_from_idle(looped);
+
+   slock_lock(test_lock);
+   test_stopped  = 0;
+   test_finished = 0;
+   slock_unlock(test_lock);
+
+   test_play_stop_stress(looped, shot);
+
+   audio_mixer_destroy(looped);
+   audio_mixer_destroy(shot);
+   audio_mixer_done();
+
+   slock_free(test_lock);
+
+   if (test_failures)
+   {
+      fprintf(stderr, "%u check(s) failed.\n", test_failures);
+      return 1;
+   }
+
+   printf("All checks passed.\n");
+   return 0;
+}
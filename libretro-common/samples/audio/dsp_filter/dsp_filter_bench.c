@@ -0,0 +1,380 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dsp_filter_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <audio/dsp_filter.h>
+#include <file/file_path.h>
+#include <formats/rwav.h>
+#include <lists/string_list.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+/* Runs every DSP preset given on the command line over the same
+ * PCM and reports the cost in ns per stereo frame.
+ *
+ *    dsp_filter_bench [input.wav] plugins... [-r plugins...] presets...
+ *
+ * Plugins are the filter shared libraries to load. The ones after
+ * -r are a reference build of the same filters (the Makefile builds
+ * one with DSPFILTER_NO_SIMD); each preset is then also run with
+ * them, timed, and their output compared with the first set.
+ *
+ * Without a WAV file, a few seconds of generated test signal are
+ * used instead. */
+
+#define BENCH_RATE     48000
+#define BENCH_SECONDS  10
+#define BENCH_BLOCK    1024
+#define BENCH_MIN_TIME 0.5
+
+struct pcm
+{
+   float *samples;
+   unsigned frames;
+   unsigned rate;
+};
+
+struct bench_result
+{
+   bool ok;
+   double ns_per_frame;
+   float *output;
+   unsigned frames;
+};
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+/* A couple of chords, some noise bursts and a few bits of
+ * silence, to have the filters go through tails and denormals. */
+static bool pcm_generate(struct pcm *pcm)
+{
+   unsigned i;
+   uint32_t seed = 0x12345678;
+
+   pcm->rate     = BENCH_RATE;
+   pcm->frames   = BENCH_RATE * BENCH_SECONDS;
+   pcm->samples  = (float*)malloc(pcm->frames * 2 * sizeof(float));
+
+   if (!pcm->samples)
+      return false;
+
+   for (i = 0; i < pcm->frames; i++)
+   {
+      double t       = (double)i / BENCH_RATE;
+      unsigned beat  = (unsigned)(t * 2.0);
+      double env     = exp(-4.0 * (t * 2.0 - beat));
+      double base    = (beat & 1) ? 220.0 : 261.63;
+      double l, r, noise;
+
+      seed           = seed * 1664525u + 1013904223u;
+      noise          = ((seed >> 8) / 8388608.0 - 1.0) * ((beat % 4) == 3 ? env : 0.0);
+
+      l              = sin(2.0 * M_PI * base * t)
+         + 0.5 * sin(2.0 * M_PI * base * 1.25 * t);
+      r              = sin(2.0 * M_PI * base * 1.5 * t)
+         + 0.5 * sin(2.0 * M_PI * base * 2.0 * t);
+
+      if ((beat % 8) == 7)
+         env         = 0.0;
+
+      pcm->samples[i * 2 + 0] = (float)(0.3 * (l * env + noise));
+      pcm->samples[i * 2 + 1] = (float)(0.3 * (r * env + noise));
+   }
+
+   return true;
+}
+
+static bool pcm_load_wav(struct pcm *pcm, const char *path)
+{
+   unsigned i;
+   rwav_t wav;
+   void *buf       = NULL;
+   int64_t len     = 0;
+   const int16_t *in;
+
+   if (!filestream_read_file(path, &buf, &len))
+      return false;
+
+   if (rwav_load(&wav, buf, (size_t)len) != RWAV_ITERATE_DONE)
+   {
+      free(buf);
+      return false;
+   }
+
+   free(buf);
+
+   if (wav.bitspersample != 16 || wav.numchannels < 1 || wav.numchannels > 2)
+   {
+      fprintf(stderr, "%s: only 16-bit mono or stereo is supported.\n", path);
+      rwav_free(&wav);
+      return false;
+   }
+
+   pcm->rate    = wav.samplerate;
+   pcm->frames  = wav.numsamples;
+   pcm->samples = (float*)malloc(pcm->frames * 2 * sizeof(float));
+   in           = (const int16_t*)wav.samples;
+
+   if (!pcm->samples)
+   {
+      rwav_free(&wav);
+      return false;
+   }
+
+   for (i = 0; i < pcm->frames; i++)
+   {
+      if (wav.numchannels == 2)
+      {
+         pcm->samples[i * 2 + 0] = in[i * 2 + 0] / 32768.0f;
+         pcm->samples[i * 2 + 1] = in[i * 2 + 1] / 32768.0f;
+      }
+      else
+         pcm->samples[i * 2 + 0] = pcm->samples[i * 2 + 1] = in[i] / 32768.0f;
+   }
+
+   rwav_free(&wav);
+   return true;
+}
+
+static struct string_list *plugin_list(char **plugins, unsigned count)
+{
+   unsigned i;
+   union string_list_elem_attr attr;
+   struct string_list *list = string_list_new();
+
+   attr.i = 0;
+
+   for (i = 0; list && i < count; i++)
+      string_list_append(list, plugins[i], attr);
+
+   return list;
+}
+
+/**
+ * bench_preset:
+ * @preset             : Path to the .dsp preset.
+ * @plugins            : Filter plugins to load.
+ * @num_plugins        : Number of plugins.
+ * @pcm                : Input.
+ *
+ * Runs @pcm through the preset once, keeping the output, then
+ * keeps going over it until BENCH_MIN_TIME has passed.
+ *
+ * Returns: the timing and the output of the first pass.
+ **/
+static struct bench_result bench_preset(const char *preset,
+      char **plugins, unsigned num_plugins, const struct pcm *pcm)
+{
+   unsigned pass;
+   float block[BENCH_BLOCK * 2];
+   double elapsed             = 0.0;
+   uint64_t frames            = 0;
+   struct bench_result result = {0};
+   retro_dsp_filter_t *dsp    = retro_dsp_filter_new(preset,
+         plugin_list(plugins, num_plugins), pcm->rate);
+
+   if (!dsp)
+      return result;
+
+   for (pass = 0; pass == 0 || elapsed < BENCH_MIN_TIME; pass++)
+   {
+      unsigned i;
+      double start = get_time();
+
+      for (i = 0; i < pcm->frames; i += BENCH_BLOCK)
+      {
+         struct retro_dsp_data data;
+         unsigned count     = MIN(BENCH_BLOCK, pcm->frames - i);
+
+         memcpy(block, pcm->samples + i * 2, count * 2 * sizeof(float));
+
+         data.input         = block;
+         data.input_frames  = count;
+         data.output        = NULL;
+         data.output_frames = 0;
+
+         retro_dsp_filter_process(dsp, &data);
+
+         if (pass == 0)
+         {
+            float *output = (float*)realloc(result.output,
+                  (result.frames + data.output_frames) * 2 * sizeof(float));
+            if (!output)
+               break;
+
+            memcpy(output + result.frames * 2, data.output,
+                  data.output_frames * 2 * sizeof(float));
+            result.output  = output;
+            result.frames += data.output_frames;
+         }
+      }
+
+      /* The first pass also copies the output out,
+       * leave it out of the timing. */
+      if (pass > 0)
+      {
+         elapsed += get_time() - start;
+         frames  += pcm->frames;
+      }
+   }
+
+   retro_dsp_filter_free(dsp);
+
+   result.ok           = true;
+   result.ns_per_frame = elapsed * 1000000000.0 / frames;
+   return result;
+}
+
+static float max_difference(const struct bench_result *a,
+      const struct bench_result *b)
+{
+   unsigned i;
+   float diff = 0.0f;
+
+   if (a->frames != b->frames)
+      return INFINITY;
+
+   for (i = 0; i < a->frames * 2; i++)
+   {
+      float d = fabsf(a->output[i] - b->output[i]);
+      if (d > diff || d != d)
+         diff = d;
+   }
+
+   return diff;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   struct pcm pcm;
+   char **plugins         = NULL;
+   char **ref_plugins     = NULL;
+   char **presets         = NULL;
+   unsigned num_plugins   = 0;
+   unsigned num_ref       = 0;
+   unsigned num_presets   = 0;
+   const char *wav        = NULL;
+   bool ref               = false;
+   int ret                = 0;
+
+   plugins     = (char**)calloc(argc, sizeof(*plugins));
+   ref_plugins = (char**)calloc(argc, sizeof(*ref_plugins));
+   presets     = (char**)calloc(argc, sizeof(*presets));
+
+   if (!plugins || !ref_plugins || !presets)
+      return 1;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (string_is_equal(argv[i], "-r"))
+         ref = true;
+      else if (string_is_equal(path_get_extension(argv[i]), "dsp"))
+         presets[num_presets++] = argv[i];
+      else if (string_is_equal(path_get_extension(argv[i]), "wav"))
+         wav = argv[i];
+      else if (ref)
+         ref_plugins[num_ref++] = argv[i];
+      else
+         plugins[num_plugins++] = argv[i];
+   }
+
+   if (!num_plugins || !num_presets)
+   {
+      fprintf(stderr, "Usage: %s [input.wav] plugins... "
+            "[-r reference plugins...] presets.dsp...\n", argv[0]);
+      return 1;
+   }
+
+   if (wav ? !pcm_load_wav(&pcm, wav) : !pcm_generate(&pcm))
+   {
+      fprintf(stderr, "Failed to set up the input.\n");
+      return 1;
+   }
+
+   printf("%u frames at %u Hz, blocks of %u frames.\n\n",
+         pcm.frames, pcm.rate, BENCH_BLOCK);
+
+   if (num_ref)
+      printf("%-24s %12s %12s %8s %12s\n",
+            "preset", "ns/frame", "ref", "speedup", "max diff");
+   else
+      printf("%-24s %12s\n", "preset", "ns/frame");
+
+   for (i = 0; i < (int)num_presets; i++)
+   {
+      const char *name          = strrchr(presets[i], '/');
+      struct bench_result res   = bench_preset(presets[i],
+            plugins, num_plugins, &pcm);
+
+      name = name ? name + 1 : presets[i];
+
+      if (!res.ok)
+      {
+         printf("%-24s %12s\n", name, "failed");
+         ret = 1;
+         continue;
+      }
+
+      if (num_ref)
+      {
+         struct bench_result ref_res = bench_preset(presets[i],
+               ref_plugins, num_ref, &pcm);
+
+         if (ref_res.ok)
+            printf("%-24s %12.2f %12.2f %7.2fx %12g\n", name,
+                  res.ns_per_frame, ref_res.ns_per_frame,
+                  ref_res.ns_per_frame / res.ns_per_frame,
+                  max_difference(&res, &ref_res));
+         else
+         {
+            printf("%-24s %12.2f %12s\n", name, res.ns_per_frame, "failed");
+            ret = 1;
+         }
+
+         free(ref_res.output);
+      }
+      else
+         printf("%-24s %12.2f\n", name, res.ns_per_frame);
+
+      free(res.output);
+   }
+
+   free(pcm.samples);
+   free(plugins);
+   free(ref_plugins);
+   free(presets);
+   return ret;
+}
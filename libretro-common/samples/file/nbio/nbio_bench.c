@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <file/nbio.h>
+
+/* Mimics a thumbnail-heavy menu view: a large number of
+ * small files are opened, all reads are started up front and
+ * then every handle is iterated until all of them are done.
+ *
+ * Every backend built in is timed on the same files, once
+ * from a single thread and once split across BENCH_THREADS
+ * threads, the way the task thread and the menu share nbio. */
+
+#define BENCH_FILES     1000
+#define BENCH_FILE_SIZE (24 * 1024)
+#define BENCH_THREADS   4
+#define BENCH_PASSES    5
+#define BENCH_DIR       "nbio_bench_files"
+
+extern nbio_intf_t nbio_stdio;
+extern nbio_intf_t nbio_linux_uring;
+
+extern bool nbio_linux_uring_available(void);
+
+struct bench_slice
+{
+   nbio_intf_t *intf;
+   unsigned first;
+   unsigned count;
+   unsigned errors;
+};
+
+static double bench_now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_path(char *s, size_t len, unsigned i)
+{
+   snprintf(s, len, BENCH_DIR "/%04u.png", i);
+}
+
+static bool bench_create_files(void)
+{
+   unsigned i;
+   char *buf = (char*)malloc(BENCH_FILE_SIZE);
+
+   if (!buf)
+      return false;
+
+   mkdir(BENCH_DIR, 0755);
+
+   for (i = 0; i < BENCH_FILES; i++)
+   {
+      char path[64];
+      FILE *f = NULL;
+
+      bench_path(path, sizeof(path), i);
+      memset(buf, i & 0xff, BENCH_FILE_SIZE);
+
+      if (!(f = fopen(path, "wb")))
+      {
+         free(buf);
+         return false;
+      }
+
+      fwrite(buf, 1, BENCH_FILE_SIZE, f);
+      fclose(f);
+   }
+
+   free(buf);
+   return true;
+}
+
+static void bench_remove_files(void)
+{
+   unsigned i;
+
+   for (i = 0; i < BENCH_FILES; i++)
+   {
+      char path[64];
+      bench_path(path, sizeof(path), i);
+      remove(path);
+   }
+
+   rmdir(BENCH_DIR);
+}
+
+/* Reads files [first, first + count) through one backend,
+ * all of them in flight at once. */
+static void *bench_read_slice(void *data)
+{
+   unsigned i;
+   struct bench_slice *slice = (struct bench_slice*)data;
+   nbio_intf_t *intf         = slice->intf;
+   unsigned pending          = slice->count;
+   void **handles            = (void**)calloc(slice->count, sizeof(*handles));
+
+   if (!handles)
+   {
+      slice->errors = slice->count;
+      return NULL;
+   }
+
+   for (i = 0; i < slice->count; i++)
+   {
+      char path[64];
+      bench_path(path, sizeof(path), slice->first + i);
+
+      if (!(handles[i] = intf->open(path, NBIO_READ)))
+      {
+         slice->errors++;
+         pending--;
+         continue;
+      }
+
+      intf->begin_read(handles[i]);
+   }
+
+   while (pending)
+   {
+      for (i = 0; i < slice->count; i++)
+      {
+         unsigned n = slice->first + i;
+
+         if (!handles[i] || !intf->iterate(handles[i]))
+            continue;
+
+         {
+            size_t len          = 0;
+            const uint8_t *data = (const uint8_t*)
+               intf->get_ptr(handles[i], &len);
+
+            if (     !data
+                  || len != BENCH_FILE_SIZE
+                  || data[0] != (n & 0xff)
+                  || data[len - 1] != (n & 0xff))
+               slice->errors++;
+         }
+
+         intf->free(handles[i]);
+         handles[i] = NULL;
+         pending--;
+      }
+   }
+
+   free(handles);
+   return NULL;
+}
+
+/* Returns the best of BENCH_PASSES in milliseconds. */
+static double bench_backend(nbio_intf_t *intf, unsigned threads,
+      unsigned *errors)
+{
+   unsigned pass, t;
+   double best = 0.0;
+
+   for (pass = 0; pass < BENCH_PASSES; pass++)
+   {
+      double elapsed;
+      pthread_t tids[BENCH_THREADS];
+      struct bench_slice slices[BENCH_THREADS];
+      double start = bench_now();
+
+      for (t = 0; t < threads; t++)
+      {
+         slices[t].intf   = intf;
+         slices[t].first  = t * (BENCH_FILES / threads);
+         slices[t].count  = (t == threads - 1)
+            ? BENCH_FILES - slices[t].first
+            : BENCH_FILES / threads;
+         slices[t].errors = 0;
+      }
+
+      if (threads == 1)
+         bench_read_slice(&slices[0]);
+      else
+      {
+         for (t = 0; t < threads; t++)
+            pthread_create(&tids[t], NULL, bench_read_slice, &slices[t]);
+         for (t = 0; t < threads; t++)
+            pthread_join(tids[t], NULL);
+      }
+
+      elapsed = (bench_now() - start) * 1000.0;
+
+      for (t = 0; t < threads; t++)
+         *errors += slices[t].errors;
+
+      if (pass == 0 || elapsed < best)
+         best = elapsed;
+   }
+
+   return best;
+}
+
+int main(void)
+{
+   unsigned i;
+   unsigned errors             = 0;
+   nbio_intf_t *backends[2];
+   unsigned backend_count      = 0;
+
+   backends[backend_count++]   = &nbio_stdio;
+   if (nbio_linux_uring_available())
+      backends[backend_count++] = &nbio_linux_uring;
+
+   if (!bench_create_files())
+   {
+      puts("[ERROR]: could not create benchmark files");
+      return 1;
+   }
+
+   printf("Reading %u files of %u bytes, best of %u passes:\n",
+         BENCH_FILES, BENCH_FILE_SIZE, BENCH_PASSES);
+
+   for (i = 0; i < backend_count; i++)
+   {
+      double single   = bench_backend(backends[i], 1, &errors);
+      double threaded = bench_backend(backends[i], BENCH_THREADS, &errors);
+
+      printf("  %-18s %8.3f ms, %8.3f ms on %u threads\n",
+            backends[i]->ident, single, threaded, BENCH_THREADS);
+   }
+
+   printf("%u errors.\n", errors);
+
+   bench_remove_files();
+
+   return errors ? 1 : 0;
+}
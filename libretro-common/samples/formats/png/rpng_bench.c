@@ -0,0 +1,501 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rpng_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include <boolean.h>
+#include <encodings/crc32.h>
+#include <formats/rpng.h>
+#include <formats/image.h>
+
+/* Decodes a set of thumbnail sized PNGs over and over and reports
+ * the throughput. The built-in corpus is encoded here with a fixed
+ * filter per image (or every filter in turn, row by row), so each
+ * unfilter path is both checked against the source pixels and
+ * timed on its own. PNG files given on the command line are timed
+ * as well, as a corpus of real thumbnails.
+ *
+ * After that it times the encoder on a 4K screenshot, with one
+ * thread and with one per core, at both compression levels, and
+ * checks that each result decodes back to the source. */
+
+#define THUMB_WIDTH  320
+#define THUMB_HEIGHT 240
+#define BENCH_MIN_TIME 0.5
+
+#define SHOT_WIDTH  3840
+#define SHOT_HEIGHT 2160
+#define SHOT_PATH   "rpng_bench.png"
+
+#define FILTER_MIXED 5
+
+struct png_file
+{
+   char name[64];
+   uint8_t *data;
+   size_t size;
+   const uint32_t *expected;
+};
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+   int p  = a + b - c;
+   int pa = abs(p - a);
+   int pb = abs(p - b);
+   int pc = abs(p - c);
+
+   if (pa <= pb && pa <= pc)
+      return a;
+   if (pb <= pc)
+      return b;
+   return c;
+}
+
+static void filter_line(uint8_t *dst, const uint8_t *line,
+      const uint8_t *prev, unsigned pitch, unsigned bpp, unsigned filter)
+{
+   unsigned i;
+
+   for (i = 0; i < pitch; i++)
+   {
+      uint8_t a = i >= bpp ? line[i - bpp] : 0;
+      uint8_t b = prev[i];
+      uint8_t c = i >= bpp ? prev[i - bpp] : 0;
+
+      switch (filter)
+      {
+         case 0:
+            dst[i] = line[i];
+            break;
+         case 1:
+            dst[i] = line[i] - a;
+            break;
+         case 2:
+            dst[i] = line[i] - b;
+            break;
+         case 3:
+            dst[i] = line[i] - ((a + b) >> 1);
+            break;
+         case 4:
+            dst[i] = line[i] - paeth(a, b, c);
+            break;
+      }
+   }
+}
+
+static uint8_t *write_chunk(uint8_t *out, const char *type,
+      const uint8_t *data, uint32_t size)
+{
+   uint8_t *start = out + 4;
+   uint32_t crc;
+
+   *out++ = size >> 24;
+   *out++ = size >> 16;
+   *out++ = size >>  8;
+   *out++ = size >>  0;
+   memcpy(out, type, 4);
+   out += 4;
+   if (size)
+      memcpy(out, data, size);
+   out += size;
+
+   crc    = encoding_crc32(0, start, size + 4);
+   *out++ = crc >> 24;
+   *out++ = crc >> 16;
+   *out++ = crc >>  8;
+   *out++ = crc >>  0;
+   return out;
+}
+
+/* rpng_save_image_* picks the filter per row by itself, so the
+ * corpus is encoded by hand to control which filters get used. */
+static uint8_t *encode_png(const uint32_t *argb, unsigned width,
+      unsigned height, unsigned bpp, unsigned filter, size_t *size)
+{
+   static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+   unsigned x, y;
+   uint8_t ihdr[13];
+   unsigned pitch    = width * bpp;
+   size_t raw_size   = (pitch + 1) * height;
+   uLongf comp_size  = compressBound(raw_size);
+   uint8_t *line     = (uint8_t*)malloc(pitch);
+   uint8_t *prev     = (uint8_t*)calloc(1, pitch);
+   uint8_t *raw      = (uint8_t*)malloc(raw_size);
+   uint8_t *comp     = (uint8_t*)malloc(comp_size);
+   uint8_t *png      = (uint8_t*)malloc(comp_size + 64);
+   uint8_t *out      = png;
+
+   for (y = 0; y < height; y++)
+   {
+      uint8_t *row     = raw + y * (pitch + 1);
+      unsigned row_flt = filter == FILTER_MIXED ? y % 5 : filter;
+
+      for (x = 0; x < width; x++)
+      {
+         uint32_t col = argb[y * width + x];
+
+         line[x * bpp + 0] = col >> 16;
+         line[x * bpp + 1] = col >>  8;
+         line[x * bpp + 2] = col >>  0;
+         if (bpp == 4)
+            line[x * bpp + 3] = col >> 24;
+      }
+
+      row[0] = row_flt;
+      filter_line(row + 1, line, prev, pitch, bpp, row_flt);
+      memcpy(prev, line, pitch);
+   }
+
+   compress2(comp, &comp_size, raw, raw_size, 6);
+
+   ihdr[0]  = width >> 24;
+   ihdr[1]  = width >> 16;
+   ihdr[2]  = width >>  8;
+   ihdr[3]  = width >>  0;
+   ihdr[4]  = height >> 24;
+   ihdr[5]  = height >> 16;
+   ihdr[6]  = height >>  8;
+   ihdr[7]  = height >>  0;
+   ihdr[8]  = 8;
+   ihdr[9]  = bpp == 4 ? 6 : 2;
+   ihdr[10] = 0;
+   ihdr[11] = 0;
+   ihdr[12] = 0;
+
+   memcpy(out, sig, sizeof(sig));
+   out   = write_chunk(out + sizeof(sig), "IHDR", ihdr, sizeof(ihdr));
+   out   = write_chunk(out, "IDAT", comp, comp_size);
+   out   = write_chunk(out, "IEND", NULL, 0);
+   *size = out - png;
+
+   free(line);
+   free(prev);
+   free(raw);
+   free(comp);
+   return png;
+}
+
+static bool decode_png(uint8_t *buf, size_t size, uint32_t **data,
+      unsigned *width, unsigned *height)
+{
+   int retval;
+   rpng_t *rpng = rpng_alloc();
+
+   *data = NULL;
+
+   if (!rpng)
+      return false;
+
+   if (!rpng_set_buf_ptr(rpng, buf) || !rpng_start(rpng))
+      goto error;
+
+   while (rpng_iterate_image(rpng));
+
+   if (!rpng_is_valid(rpng))
+      goto error;
+
+   do
+   {
+      retval = rpng_process_image(rpng, (void**)data, size, width, height);
+   } while (retval == IMAGE_PROCESS_NEXT);
+
+   if (retval == IMAGE_PROCESS_ERROR || retval == IMAGE_PROCESS_ERROR_END)
+      goto error;
+
+   rpng_free(rpng);
+   return true;
+
+error:
+   rpng_free(rpng);
+   free(*data);
+   *data = NULL;
+   return false;
+}
+
+/* Something thumbnail-like: smooth gradients with a noisy band,
+ * so the encoder output isn't trivially compressible. */
+static void gen_image(uint32_t *argb, unsigned width, unsigned height,
+      bool alpha, unsigned seed)
+{
+   unsigned x, y;
+
+   srand(seed);
+
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         uint32_t r = (x * 255) / width;
+         uint32_t g = (y * 255) / height;
+         uint32_t b = ((x + y) * 7 + seed * 31) & 0xff;
+         uint32_t a = alpha ? ((x ^ y) & 0xff) : 0xff;
+
+         if (y > height / 3 && y < height / 2)
+         {
+            r = rand() & 0xff;
+            b = rand() & 0xff;
+         }
+
+         argb[y * width + x] = (a << 24) | (r << 16) | (g << 8) | b;
+      }
+   }
+}
+
+static bool load_file(const char *path, struct png_file *file)
+{
+   long len;
+   FILE *f = fopen(path, "rb");
+
+   if (!f)
+      return false;
+
+   fseek(f, 0, SEEK_END);
+   len = ftell(f);
+   fseek(f, 0, SEEK_SET);
+
+   file->data = (uint8_t*)malloc(len);
+   file->size = len;
+   if (fread(file->data, 1, len, f) != (size_t)len)
+   {
+      fclose(f);
+      free(file->data);
+      return false;
+   }
+
+   fclose(f);
+   snprintf(file->name, sizeof(file->name), "%s", path);
+   file->expected = NULL;
+   return true;
+}
+
+static bool bench_file(const struct png_file *file)
+{
+   unsigned width, height;
+   uint32_t *data = NULL;
+   unsigned iters = 0;
+   double start, elapsed;
+
+   if (!decode_png(file->data, file->size, &data, &width, &height))
+   {
+      fprintf(stderr, "%-24s decode failed\n", file->name);
+      return false;
+   }
+
+   if (file->expected && memcmp(data, file->expected,
+            width * height * sizeof(uint32_t)))
+   {
+      fprintf(stderr, "%-24s MISMATCH\n", file->name);
+      free(data);
+      return false;
+   }
+   free(data);
+
+   start = get_time();
+   do
+   {
+      decode_png(file->data, file->size, &data, &width, &height);
+      free(data);
+      iters++;
+      elapsed = get_time() - start;
+   } while (elapsed < BENCH_MIN_TIME);
+
+   printf("%-24s %4ux%-4u %8.2f MPix/s\n", file->name, width, height,
+         (double)width * height * iters / elapsed / 1000000.0);
+   return true;
+}
+
+static bool bench_encode(const uint32_t *argb, unsigned width,
+      unsigned height, bool alpha, bool fast, unsigned threads)
+{
+   struct png_file file;
+   unsigned out_width, out_height;
+   unsigned x;
+   uint8_t *bgr24  = NULL;
+   uint32_t *data  = NULL;
+   unsigned iters  = 0;
+   bool ret        = true;
+   size_t pixels   = (size_t)width * height;
+   double start, elapsed;
+
+   if (!alpha)
+   {
+      bgr24 = (uint8_t*)malloc(pixels * 3);
+      for (x = 0; x < pixels; x++)
+      {
+         bgr24[x * 3 + 0] = argb[x] >>  0;
+         bgr24[x * 3 + 1] = argb[x] >>  8;
+         bgr24[x * 3 + 2] = argb[x] >> 16;
+      }
+   }
+
+   start = get_time();
+   do
+   {
+      if (alpha)
+         ret = rpng_save_image_argb_ex(SHOT_PATH, argb, width, height,
+               width * sizeof(uint32_t), fast, threads);
+      else
+         ret = rpng_save_image_bgr24_ex(SHOT_PATH, bgr24, width, height,
+               width * 3, fast, threads);
+      iters++;
+      elapsed = get_time() - start;
+   } while (ret && elapsed < BENCH_MIN_TIME);
+
+   free(bgr24);
+
+   if (!ret || !load_file(SHOT_PATH, &file))
+   {
+      fprintf(stderr, "encode %ux%u failed\n", width, height);
+      return false;
+   }
+
+   if (!decode_png(file.data, file.size, &data, &out_width, &out_height)
+         || out_width != width || out_height != height)
+      ret = false;
+   else
+   {
+      for (x = 0; x < pixels; x++)
+      {
+         uint32_t expected = alpha ? argb[x] : (argb[x] | 0xff000000u);
+         if (data[x] != expected)
+         {
+            ret = false;
+            break;
+         }
+      }
+   }
+
+   printf("encode %-5s %4ux%-4u %-4s %2u thread%s %8.2f MPix/s %9u bytes%s\n",
+         alpha ? "rgba" : "bgr24", width, height, fast ? "fast" : "best",
+         threads, threads == 1 ? " " : "s",
+         (double)pixels * iters / elapsed / 1000000.0, (unsigned)file.size,
+         ret ? "" : "  MISMATCH");
+
+   free(data);
+   free(file.data);
+   remove(SHOT_PATH);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   static const char *filter_names[] = {
+      "none", "sub", "up", "avg", "paeth", "mixed"
+   };
+   /* The odd size catches the scalar tails of the SIMD loops. */
+   static const unsigned sizes[][2] = {
+      { THUMB_WIDTH, THUMB_HEIGHT },
+      { 97, 61 },
+   };
+   unsigned bpp, filter, s;
+   int i;
+   int failed = 0;
+
+   for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+   {
+      unsigned width  = sizes[s][0];
+      unsigned height = sizes[s][1];
+      uint32_t *argb  = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+      uint32_t *rgba  = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+
+      gen_image(argb, width, height, false, 1);
+      gen_image(rgba, width, height, true, 2);
+
+      for (bpp = 3; bpp <= 4; bpp++)
+      {
+         for (filter = 0; filter <= FILTER_MIXED; filter++)
+         {
+            struct png_file file;
+
+            file.expected = bpp == 4 ? rgba : argb;
+            file.data     = encode_png(file.expected, width, height,
+                  bpp, filter, &file.size);
+            snprintf(file.name, sizeof(file.name), "%s %s",
+                  bpp == 4 ? "rgba" : "rgb", filter_names[filter]);
+
+            if (!bench_file(&file))
+               failed++;
+            free(file.data);
+         }
+      }
+
+      free(argb);
+      free(rgba);
+   }
+
+   for (i = 1; i < argc; i++)
+   {
+      struct png_file file;
+
+      if (!load_file(argv[i], &file))
+      {
+         fprintf(stderr, "Failed to read %s.\n", argv[i]);
+         failed++;
+         continue;
+      }
+
+      if (!bench_file(&file))
+         failed++;
+      free(file.data);
+   }
+
+   {
+      unsigned fast;
+      long cores       = sysconf(_SC_NPROCESSORS_ONLN);
+      /* Always split the image at least once, so the block
+       * stitching gets checked on single core machines too. */
+      unsigned threads = cores > 1 ? (unsigned)cores : 4;
+      uint32_t *shot   = (uint32_t*)malloc(SHOT_WIDTH * SHOT_HEIGHT * sizeof(uint32_t));
+
+      gen_image(shot, SHOT_WIDTH, SHOT_HEIGHT, false, 3);
+
+      for (fast = 0; fast <= 1; fast++)
+      {
+         if (!bench_encode(shot, SHOT_WIDTH, SHOT_HEIGHT, false, fast, 1))
+            failed++;
+         if (!bench_encode(shot, SHOT_WIDTH, SHOT_HEIGHT, false, fast, threads))
+            failed++;
+      }
+
+      gen_image(shot, 1024, 768, true, 4);
+      if (!bench_encode(shot, 1024, 768, true, false, threads))
+         failed++;
+
+      free(shot);
+   }
+
+   return failed ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#include <boolean.h>
+#include <gfx/scaler/scaler.h>
+#include <gfx/scaler/scaler_int.h>
+#include <gfx/scaler/pixconv.h>
+
+/* Throughput of every SIMD pixel converter and of the bilinear
+ * scaler passes, next to the plain C versions they replace. */
+
+#define BENCH_WIDTH  1920
+#define BENCH_HEIGHT 1080
+#define BENCH_MIN_TIME 0.25
+
+typedef void (*conv_func_t)(void*, const void*, int, int, int, int);
+
+void ref_conv_rgb565_0rgb1555(void*, const void*, int, int, int, int);
+void ref_conv_0rgb1555_rgb565(void*, const void*, int, int, int, int);
+void ref_conv_0rgb1555_argb8888(void*, const void*, int, int, int, int);
+void ref_conv_rgb565_argb8888(void*, const void*, int, int, int, int);
+void ref_conv_rgb565_abgr8888(void*, const void*, int, int, int, int);
+void ref_conv_0rgb1555_bgr24(void*, const void*, int, int, int, int);
+void ref_conv_rgb565_bgr24(void*, const void*, int, int, int, int);
+void ref_conv_argb8888_bgr24(void*, const void*, int, int, int, int);
+void ref_conv_argb8888_abgr8888(void*, const void*, int, int, int, int);
+void ref_conv_yuyv_argb8888(void*, const void*, int, int, int, int);
+
+void ref_scaler_argb8888_vert(const struct scaler_ctx *ctx,
+      void *output, int stride);
+void ref_scaler_argb8888_horiz(const struct scaler_ctx *ctx,
+      const void *input, int stride);
+
+struct conv_bench
+{
+   const char *name;
+   conv_func_t func;
+   conv_func_t ref;
+   int in_bpp;
+   int out_bpp;
+};
+
+static const struct conv_bench conv_benches[] = {
+   { "rgb565_0rgb1555",   conv_rgb565_0rgb1555,   ref_conv_rgb565_0rgb1555,   2, 2 },
+   { "0rgb1555_rgb565",   conv_0rgb1555_rgb565,   ref_conv_0rgb1555_rgb565,   2, 2 },
+   { "0rgb1555_argb8888", conv_0rgb1555_argb8888, ref_conv_0rgb1555_argb8888, 2, 4 },
+   { "rgb565_argb8888",   conv_rgb565_argb8888,   ref_conv_rgb565_argb8888,   2, 4 },
+   { "rgb565_abgr8888",   conv_rgb565_abgr8888,   ref_conv_rgb565_abgr8888,   2, 4 },
+   { "0rgb1555_bgr24",    conv_0rgb1555_bgr24,    ref_conv_0rgb1555_bgr24,    2, 3 },
+   { "rgb565_bgr24",      conv_rgb565_bgr24,      ref_conv_rgb565_bgr24,      2, 3 },
+   { "argb8888_bgr24",    conv_argb8888_bgr24,    ref_conv_argb8888_bgr24,    4, 3 },
+   { "argb8888_abgr8888", conv_argb8888_abgr8888, ref_conv_argb8888_abgr8888, 4, 4 },
+   { "yuyv_argb8888",     conv_yuyv_argb8888,     ref_conv_yuyv_argb8888,     2, 4 },
+};
+
+static double bench_now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double bench_conv(conv_func_t func, void *out, const void *in,
+      int out_bpp, int in_bpp)
+{
+   unsigned iterations = 0;
+   double start        = bench_now();
+   double elapsed;
+
+   do
+   {
+      func(out, in, BENCH_WIDTH, BENCH_HEIGHT,
+            BENCH_WIDTH * out_bpp, BENCH_WIDTH * in_bpp);
+      iterations++;
+   } while ((elapsed = bench_now() - start) < BENCH_MIN_TIME);
+
+   return (double)BENCH_WIDTH * BENCH_HEIGHT * iterations / elapsed / 1e6;
+}
+
+static double bench_scaler(struct scaler_ctx *ctx, bool ref,
+      void *out, const void *in)
+{
+   unsigned iterations = 0;
+   double start        = bench_now();
+   double elapsed;
+
+   do
+   {
+      if (ref)
+      {
+         ref_scaler_argb8888_horiz(ctx, in, ctx->in_stride);
+         ref_scaler_argb8888_vert(ctx, out, ctx->out_stride);
+      }
+      else
+      {
+         scaler_argb8888_horiz(ctx, in, ctx->in_stride);
+         scaler_argb8888_vert(ctx, out, ctx->out_stride);
+      }
+      iterations++;
+   } while ((elapsed = bench_now() - start) < BENCH_MIN_TIME);
+
+   return (double)ctx->out_width * ctx->out_height
+      * iterations / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   struct scaler_ctx ctx;
+   size_t size  = (size_t)BENCH_WIDTH * BENCH_HEIGHT * 4;
+   uint8_t *in  = (uint8_t*)malloc(size);
+   uint8_t *out = (uint8_t*)malloc(size);
+
+   (void)argc;
+   (void)argv;
+
+   if (!in || !out)
+      return 1;
+
+   for (i = 0; i < size; i++)
+      in[i] = (uint8_t)(i * 2654435761u >> 24);
+
+   printf("%-20s %12s %12s %8s\n", "format", "C MPix/s", "SIMD MPix/s",
+         "speedup");
+
+   for (i = 0; i < sizeof(conv_benches) / sizeof(conv_benches[0]); i++)
+   {
+      const struct conv_bench *bench = &conv_benches[i];
+      double ref = bench_conv(bench->ref,  out, in,
+            bench->out_bpp, bench->in_bpp);
+      double opt = bench_conv(bench->func, out, in,
+            bench->out_bpp, bench->in_bpp);
+
+      printf("%-20s %12.1f %12.1f %7.2fx\n", bench->name, ref, opt, opt / ref);
+   }
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.in_width    = 320;
+   ctx.in_height   = 240;
+   ctx.in_stride   = 320 * 4;
+   ctx.out_width   = 1280;
+   ctx.out_height  = 960;
+   ctx.out_stride  = 1280 * 4;
+   ctx.in_fmt      = SCALER_FMT_ARGB8888;
+   ctx.out_fmt     = SCALER_FMT_ARGB8888;
+   ctx.scaler_type = SCALER_TYPE_BILINEAR;
+
+   if (scaler_ctx_gen_filter(&ctx))
+   {
+      double ref = bench_scaler(&ctx, true,  out, in);
+      double opt = bench_scaler(&ctx, false, out, in);
+
+      printf("%-20s %12.1f %12.1f %7.2fx\n", "bilinear 4x",
+            ref, opt, opt / ref);
+   }
+
+   scaler_ctx_gen_reset(&ctx);
+
+   /* Full scaler_ctx_scale() as used for recording: 640x480 RGB565
+    * to 1080p BGR24 with sinc, on one thread and on every core. */
+   {
+      unsigned threads[2];
+      size_t out_size = (size_t)BENCH_WIDTH * BENCH_HEIGHT * 3;
+      uint8_t *rec    = (uint8_t*)malloc(out_size);
+
+      threads[0]      = 1;
+      threads[1]      = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+
+      for (i = 0; rec && i < 2; i++)
+      {
+         unsigned iterations = 0;
+         double start, elapsed;
+
+         memset(&ctx, 0, sizeof(ctx));
+         ctx.in_width    = 640;
+         ctx.in_height   = 480;
+         ctx.in_stride   = 640 * 2;
+         ctx.out_width   = BENCH_WIDTH;
+         ctx.out_height  = BENCH_HEIGHT;
+         ctx.out_stride  = BENCH_WIDTH * 3;
+         ctx.in_fmt      = SCALER_FMT_RGB565;
+         ctx.out_fmt     = SCALER_FMT_BGR24;
+         ctx.scaler_type = SCALER_TYPE_SINC;
+         ctx.threads     = threads[i];
+
+         if (!scaler_ctx_gen_filter(&ctx))
+            break;
+
+         start = bench_now();
+         do
+         {
+            scaler_ctx_scale(&ctx, rec, in);
+            iterations++;
+         } while ((elapsed = bench_now() - start) < BENCH_MIN_TIME * 4);
+
+         printf("sinc 1080p, %2u thread(s): %6.1f frames/s\n",
+               threads[i], iterations / elapsed);
+
+         scaler_ctx_gen_reset(&ctx);
+      }
+
+      free(rec);
+   }
+
+   free(in);
+   free(out);
+   return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef __SCALER_REF_H
+#define __SCALER_REF_H
+
+/* Force-included when building the plain C reference copies of the
+ * pixel converters and scalers, so they can be linked next to the
+ * SIMD versions under a different name. */
+
+#define conv_rgb565_0rgb1555   ref_conv_rgb565_0rgb1555
+#define conv_0rgb1555_rgb565   ref_conv_0rgb1555_rgb565
+#define conv_0rgb1555_argb8888 ref_conv_0rgb1555_argb8888
+#define conv_rgb565_argb8888   ref_conv_rgb565_argb8888
+#define conv_rgb565_abgr8888   ref_conv_rgb565_abgr8888
+#define conv_argb8888_rgba4444 ref_conv_argb8888_rgba4444
+#define conv_rgba4444_argb8888 ref_conv_rgba4444_argb8888
+#define conv_rgba4444_rgb565   ref_conv_rgba4444_rgb565
+#define conv_0rgb1555_bgr24    ref_conv_0rgb1555_bgr24
+#define conv_rgb565_bgr24      ref_conv_rgb565_bgr24
+#define conv_bgr24_argb8888    ref_conv_bgr24_argb8888
+#define conv_argb8888_0rgb1555 ref_conv_argb8888_0rgb1555
+#define conv_argb8888_rgb565   ref_conv_argb8888_rgb565
+#define conv_argb8888_bgr24    ref_conv_argb8888_bgr24
+#define conv_argb8888_abgr8888 ref_conv_argb8888_abgr8888
+#define conv_yuyv_argb8888     ref_conv_yuyv_argb8888
+#define conv_copy              ref_conv_copy
+
+#define scaler_argb8888_vert          ref_scaler_argb8888_vert
+#define scaler_argb8888_horiz         ref_scaler_argb8888_horiz
+#define scaler_argb8888_point_special ref_scaler_argb8888_point_special
+
+#endif
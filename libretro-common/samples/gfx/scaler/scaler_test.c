@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <gfx/scaler/scaler.h>
+#include <gfx/scaler/scaler_int.h>
+#include <gfx/scaler/pixconv.h>
+
+/* Checks that the SIMD pixel converters and scaler passes produce
+ * bit-exact results against the plain C versions (linked in with a
+ * ref_ prefix, see scaler_ref.h) for odd widths and padded strides. */
+
+typedef void (*conv_func_t)(void*, const void*, int, int, int, int);
+
+void ref_conv_rgb565_0rgb1555(void*, const void*, int, int, int, int);
+void ref_conv_0rgb1555_rgb565(void*, const void*, int, int, int, int);
+void ref_conv_0rgb1555_argb8888(void*, const void*, int, int, int, int);
+void ref_conv_rgb565_argb8888(void*, const void*, int, int, int, int);
+void ref_conv_rgb565_abgr8888(void*, const void*, int, int, int, int);
+void ref_conv_0rgb1555_bgr24(void*, const void*, int, int, int, int);
+void ref_conv_rgb565_bgr24(void*, const void*, int, int, int, int);
+void ref_conv_argb8888_bgr24(void*, const void*, int, int, int, int);
+void ref_conv_argb8888_abgr8888(void*, const void*, int, int, int, int);
+void ref_conv_yuyv_argb8888(void*, const void*, int, int, int, int);
+
+void ref_scaler_argb8888_vert(const struct scaler_ctx *ctx,
+      void *output, int stride);
+void ref_scaler_argb8888_horiz(const struct scaler_ctx *ctx,
+      const void *input, int stride);
+
+struct conv_test
+{
+   const char *name;
+   conv_func_t func;
+   conv_func_t ref;
+   int in_bpp;
+   int out_bpp;
+   int width_align;
+};
+
+static const struct conv_test conv_tests[] = {
+   { "rgb565_0rgb1555",   conv_rgb565_0rgb1555,   ref_conv_rgb565_0rgb1555,   2, 2, 1 },
+   { "0rgb1555_rgb565",   conv_0rgb1555_rgb565,   ref_conv_0rgb1555_rgb565,   2, 2, 1 },
+   { "0rgb1555_argb8888", conv_0rgb1555_argb8888, ref_conv_0rgb1555_argb8888, 2, 4, 1 },
+   { "rgb565_argb8888",   conv_rgb565_argb8888,   ref_conv_rgb565_argb8888,   2, 4, 1 },
+   { "rgb565_abgr8888",   conv_rgb565_abgr8888,   ref_conv_rgb565_abgr8888,   2, 4, 1 },
+   { "0rgb1555_bgr24",    conv_0rgb1555_bgr24,    ref_conv_0rgb1555_bgr24,    2, 3, 1 },
+   { "rgb565_bgr24",      conv_rgb565_bgr24,      ref_conv_rgb565_bgr24,      2, 3, 1 },
+   { "argb8888_bgr24",    conv_argb8888_bgr24,    ref_conv_argb8888_bgr24,    4, 3, 1 },
+   { "argb8888_abgr8888", conv_argb8888_abgr8888, ref_conv_argb8888_abgr8888, 4, 4, 1 },
+   { "yuyv_argb8888",     conv_yuyv_argb8888,     ref_conv_yuyv_argb8888,     2, 4, 2 },
+};
+
+static uint32_t rand_state = 0x12345678;
+
+static uint32_t test_rand(void)
+{
+   rand_state ^= rand_state << 13;
+   rand_state ^= rand_state >> 17;
+   rand_state ^= rand_state << 5;
+   return rand_state;
+}
+
+static void fill_random(uint8_t *buf, size_t size)
+{
+   size_t i;
+   for (i = 0; i < size; i++)
+      buf[i] = (uint8_t)test_rand();
+}
+
+static bool test_conv(const struct conv_test *test, int width, int height)
+{
+   int y;
+   bool ret         = true;
+   /* Pad the strides by an odd amount of pixels so that rows start
+    * at unaligned addresses, and keep them a multiple of the
+    * pixel size as the converters expect. */
+   int in_stride    = (width + 3) * test->in_bpp;
+   int out_stride   = (width + 5) * test->out_bpp;
+   size_t in_size   = (size_t)in_stride  * height;
+   size_t out_size  = (size_t)out_stride * height;
+   uint8_t *in      = (uint8_t*)malloc(in_size);
+   uint8_t *out     = (uint8_t*)malloc(out_size);
+   uint8_t *out_ref = (uint8_t*)malloc(out_size);
+
+   if (!in || !out || !out_ref)
+   {
+      free(in);
+      free(out);
+      free(out_ref);
+      return false;
+   }
+
+   fill_random(in, in_size);
+   /* Same garbage in both outputs so writes into the row padding
+    * show up as a mismatch. */
+   fill_random(out, out_size);
+   memcpy(out_ref, out, out_size);
+
+   test->func(out,    in, width, height, out_stride, in_stride);
+   test->ref(out_ref, in, width, height, out_stride, in_stride);
+
+   for (y = 0; y < height; y++)
+   {
+      int x;
+      const uint8_t *row     = out     + y * out_stride;
+      const uint8_t *row_ref = out_ref + y * out_stride;
+
+      if (!memcmp(row, row_ref, out_stride))
+         continue;
+
+      for (x = 0; x < out_stride; x++)
+         if (row[x] != row_ref[x])
+            break;
+
+      printf("[FAIL] %s %dx%d: mismatch at row %d, byte %d"
+            " (got %02x, expected %02x)\n",
+            test->name, width, height, y, x, row[x], row_ref[x]);
+      ret = false;
+      break;
+   }
+
+   free(in);
+   free(out);
+   free(out_ref);
+   return ret;
+}
+
+static bool test_scaler(enum scaler_type type,
+      int in_width, int in_height, int out_width, int out_height)
+{
+   struct scaler_ctx ctx;
+   int y;
+   bool ret          = true;
+   int in_stride     = (in_width  + 3) * 4;
+   int out_stride    = (out_width + 5) * 4;
+   uint8_t *in       = (uint8_t*)malloc((size_t)in_stride  * in_height);
+   uint8_t *out      = (uint8_t*)malloc((size_t)out_stride * out_height);
+   uint8_t *out_ref  = (uint8_t*)malloc((size_t)out_stride * out_height);
+   uint64_t *scaled  = NULL;
+   size_t scaled_size;
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.in_width    = in_width;
+   ctx.in_height   = in_height;
+   ctx.in_stride   = in_stride;
+   ctx.out_width   = out_width;
+   ctx.out_height  = out_height;
+   ctx.out_stride  = out_stride;
+   ctx.in_fmt      = SCALER_FMT_ARGB8888;
+   ctx.out_fmt     = SCALER_FMT_ARGB8888;
+   ctx.scaler_type = type;
+
+   if (!in || !out || !out_ref || !scaler_ctx_gen_filter(&ctx))
+   {
+      printf("[FAIL] scaler: setup failed\n");
+      ret = false;
+      goto end;
+   }
+
+   scaled_size = (size_t)ctx.scaled.stride * ctx.scaled.height;
+   if (!(scaled = (uint64_t*)malloc(scaled_size)))
+   {
+      ret = false;
+      goto end;
+   }
+
+   fill_random(in, (size_t)in_stride * in_height);
+   fill_random(out, (size_t)out_stride * out_height);
+   memcpy(out_ref, out, (size_t)out_stride * out_height);
+
+   /* Horizontal pass. */
+   ref_scaler_argb8888_horiz(&ctx, in, in_stride);
+   memcpy(scaled, ctx.scaled.frame, scaled_size);
+   scaler_argb8888_horiz(&ctx, in, in_stride);
+
+   for (y = 0; y < ctx.scaled.height; y++)
+   {
+      size_t row = (size_t)y * (ctx.scaled.stride >> 3);
+      if (memcmp(scaled + row, ctx.scaled.frame + row,
+               ctx.scaled.width * sizeof(uint64_t)))
+      {
+         printf("[FAIL] scaler horiz %dx%d -> %dx%d (type %d): row %d\n",
+               in_width, in_height, out_width, out_height, type, y);
+         ret = false;
+         goto end;
+      }
+   }
+
+   /* Vertical pass, both from the same intermediate frame. */
+   ref_scaler_argb8888_vert(&ctx, out_ref, out_stride);
+   scaler_argb8888_vert(&ctx, out, out_stride);
+
+   if (memcmp(out, out_ref, (size_t)out_stride * out_height))
+   {
+      printf("[FAIL] scaler vert %dx%d -> %dx%d (type %d)\n",
+            in_width, in_height, out_width, out_height, type);
+      ret = false;
+   }
+
+end:
+   scaler_ctx_gen_reset(&ctx);
+   free(scaled);
+   free(in);
+   free(out);
+   free(out_ref);
+   return ret;
+}
+
+static int fmt_bpp(enum scaler_pix_fmt fmt)
+{
+   switch (fmt)
+   {
+      case SCALER_FMT_0RGB1555:
+      case SCALER_FMT_RGB565:
+         return 2;
+      case SCALER_FMT_BGR24:
+         return 3;
+      default:
+         break;
+   }
+
+   return 4;
+}
+
+/* Banded multithreaded scaling has to match scaling the whole
+ * frame in one go. */
+static bool test_slices(enum scaler_pix_fmt in_fmt,
+      enum scaler_pix_fmt out_fmt, enum scaler_type type,
+      unsigned threads,
+      int in_width, int in_height, int out_width, int out_height)
+{
+   struct scaler_ctx ctx, ctx_ref;
+   bool ret         = true;
+   int in_stride    = (in_width  + 3) * fmt_bpp(in_fmt);
+   int out_stride   = (out_width + 5) * fmt_bpp(out_fmt);
+   size_t in_size   = (size_t)in_stride  * in_height;
+   size_t out_size  = (size_t)out_stride * out_height;
+   uint8_t *in      = (uint8_t*)malloc(in_size);
+   uint8_t *out     = (uint8_t*)malloc(out_size);
+   uint8_t *out_ref = (uint8_t*)malloc(out_size);
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.in_width    = in_width;
+   ctx.in_height   = in_height;
+   ctx.in_stride   = in_stride;
+   ctx.out_width   = out_width;
+   ctx.out_height  = out_height;
+   ctx.out_stride  = out_stride;
+   ctx.in_fmt      = in_fmt;
+   ctx.out_fmt     = out_fmt;
+   ctx.scaler_type = type;
+   ctx_ref         = ctx;
+   ctx.threads     = threads;
+
+   if (!in || !out || !out_ref
+         || !scaler_ctx_gen_filter(&ctx)
+         || !scaler_ctx_gen_filter(&ctx_ref))
+   {
+      printf("[FAIL] slices: setup failed\n");
+      ret = false;
+      goto end;
+   }
+
+   fill_random(in, in_size);
+   fill_random(out, out_size);
+   memcpy(out_ref, out, out_size);
+
+   /* Twice, to make sure the workers pick up a second frame. */
+   scaler_ctx_scale(&ctx, out, in);
+   scaler_ctx_scale(&ctx, out, in);
+   scaler_ctx_scale(&ctx_ref, out_ref, in);
+
+   if (memcmp(out, out_ref, out_size))
+   {
+      printf("[FAIL] slices %u: fmt %d -> %d, %dx%d -> %dx%d (type %d)\n",
+            threads, in_fmt, out_fmt, in_width, in_height,
+            out_width, out_height, type);
+      ret = false;
+   }
+
+end:
+   scaler_ctx_gen_reset(&ctx);
+   scaler_ctx_gen_reset(&ctx_ref);
+   free(in);
+   free(out);
+   free(out_ref);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   static const int widths[]  = { 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 33, 63, 100, 333 };
+   static const int heights[] = { 1, 3, 16 };
+   static const int sizes[][4] = {
+      {  256, 224,  320, 240 },
+      {  320, 240,  256, 224 },
+      {  333, 111, 1001, 333 },
+      {   17,   9,    5,   3 },
+      {    2,   2,    7,   5 },
+      { 1280, 720,  400, 240 },
+   };
+   unsigned i, j, k;
+   unsigned failed = 0;
+   unsigned total  = 0;
+
+   (void)argc;
+   (void)argv;
+
+   for (i = 0; i < sizeof(conv_tests) / sizeof(conv_tests[0]); i++)
+   {
+      const struct conv_test *test = &conv_tests[i];
+      bool ok                      = true;
+
+      for (j = 0; j < sizeof(widths) / sizeof(widths[0]); j++)
+      {
+         int width = widths[j];
+
+         if (width % test->width_align)
+            width += test->width_align - (width % test->width_align);
+
+         for (k = 0; k < sizeof(heights) / sizeof(heights[0]); k++)
+         {
+            total++;
+            if (!test_conv(test, width, heights[k]))
+            {
+               failed++;
+               ok = false;
+            }
+         }
+      }
+
+      printf("[%s] conv_%s\n", ok ? " OK " : "FAIL", test->name);
+   }
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      enum scaler_type type;
+
+      for (type = SCALER_TYPE_BILINEAR; type <= SCALER_TYPE_SINC; type++)
+      {
+         /* The sinc taps need a few input pixels on each side. */
+         if (type == SCALER_TYPE_SINC &&
+               (sizes[i][0] < 64 || sizes[i][1] < 64))
+            continue;
+
+         total++;
+         if (!test_scaler(type, sizes[i][0], sizes[i][1],
+                  sizes[i][2], sizes[i][3]))
+            failed++;
+      }
+   }
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      static const enum scaler_pix_fmt fmts[][2] = {
+         { SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888 },
+         { SCALER_FMT_RGB565,   SCALER_FMT_ARGB8888 },
+         { SCALER_FMT_ARGB8888, SCALER_FMT_BGR24    },
+         { SCALER_FMT_0RGB1555, SCALER_FMT_BGR24    },
+      };
+      static const unsigned threads[] = { 2, 3, 8 };
+
+      for (j = 0; j < sizeof(fmts) / sizeof(fmts[0]); j++)
+      {
+         for (k = 0; k < sizeof(threads) / sizeof(threads[0]); k++)
+         {
+            enum scaler_type type = (sizes[i][0] >= 64 && sizes[i][1] >= 64)
+               ? SCALER_TYPE_SINC : SCALER_TYPE_BILINEAR;
+
+            total++;
+            if (!test_slices(fmts[j][0], fmts[j][1], type, threads[k],
+                     sizes[i][0], sizes[i][1], sizes[i][2], sizes[i][3]))
+               failed++;
+         }
+      }
+   }
+
+   printf("%u/%u tests passed\n", total - failed, total);
+   return failed ? 1 : 0;
+}
@@ -309,12 +309,14 @@ libretro_vfs_implementation_file *retro_vfs_file_open_impl(const char *path, uns
       {
          stream->mappos  = 0;
          stream->mapped  = NULL;
-         stream->mapsize = retro_vfs_file_seek_internal(stream, 0, SEEK_END);
+         /* Not mapped yet, so retro_vfs_file_seek_internal()
+          * would not report the position. */
+         stream->mapsize = lseek(stream->fd, 0, SEEK_END);
 
          if (stream->mapsize == (uint64_t)-1)
             goto error;
 
-         retro_vfs_file_seek_internal(stream, 0, SEEK_SET);
+         lseek(stream->fd, 0, SEEK_SET);
 
          stream->mapped = (uint8_t*)mmap((void*)0,
                stream->mapsize, PROT_READ,  MAP_SHARED, stream->fd, 0);
@@ -399,10 +401,7 @@ int64_t retro_vfs_file_tell_impl(libretro_vfs_implementation_file *stream)
    if (stream->mapped && stream->hints & RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS)
       return stream->mappos;
 #endif
-   if (lseek(stream->fd, 0, SEEK_CUR) < 0)
-      return -1;
-
-   return 0;
+   return lseek(stream->fd, 0, SEEK_CUR);
 }
 
 int64_t retro_vfs_file_seek_impl(libretro_vfs_implementation_file *stream, int64_t offset, int seek_position)
@@ -36,21 +36,24 @@
 #include <retro_endianness.h>
 #include <string/stdstring.h>
 #include <compat/strl.h>
+#include <boolean.h>
+#include <retro_miscellaneous.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
-{
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
-};
+/* Every index record is a key followed by the big-endian
+ * offset of its item. */
+#define INDEX_OFFSET_SIZE sizeof(uint64_t)
+
+/* String keys are a big-endian offset and length into the
+ * string pool, which follows the records. */
+#define INDEX_STRING_KEY_SIZE (2 * sizeof(uint32_t))
 
 struct libretrodb
 {
@@ -64,8 +67,23 @@ struct libretrodb
 struct libretrodb_index
 {
 	char name[50];
+	uint64_t type;
 	uint64_t key_size;
+	uint64_t count;
 	uint64_t next;
+	uint64_t offset;
+};
+
+struct libretrodb_index_builder
+{
+   uint8_t *records;
+   char *pool;
+   uint64_t count;
+   uint64_t capacity;
+   uint64_t pool_size;
+   uint64_t pool_capacity;
+   uint64_t key_size;
+   enum libretrodb_index_type type;
 };
 
 typedef struct libretrodb_metadata
@@ -173,8 +191,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(
-            fd, 0, RETRO_VFS_SEEK_POSITION_CURRENT));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
    filestream_seek(fd, root, RETRO_VFS_SEEK_POSITION_START);
@@ -184,24 +201,103 @@ clean:
    return rv;
 }
 
-static int libretrodb_read_index_header(RFILE *fd, libretrodb_index_t *idx)
+static void libretrodb_store_be(uint8_t *out, uint64_t val, unsigned size)
 {
-   uint64_t name_len = 50;
-   return rmsgpack_dom_read_into(fd,
-         "name", idx->name, &name_len,
-         "key_size", &idx->key_size,
-         "next", &idx->next, NULL);
+   while (size--)
+   {
+      out[size] = (uint8_t)val;
+      val     >>= 8;
+   }
 }
 
-static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
+static uint64_t libretrodb_load_be(const uint8_t *in, unsigned size)
 {
-   rmsgpack_write_map_header(fd, 3);
+   unsigned i;
+   uint64_t val = 0;
+
+   for (i = 0; i < size; i++)
+      val = (val << 8) | in[i];
+
+   return val;
+}
+
+static int libretrodb_read_index_header(RFILE *fd, libretrodb_index_t *idx,
+      uint64_t item_count)
+{
+   struct rmsgpack_dom_value map;
+   struct rmsgpack_dom_value key;
+   struct rmsgpack_dom_value *value;
+   unsigned i;
+   int rv;
+   const char *names[]  = { "type", "key_size", "count", "next" };
+   uint64_t *fields[]   = { &idx->type, &idx->key_size, &idx->count, &idx->next };
+
+   if ((rv = rmsgpack_dom_read(fd, &map)) < 0)
+      return rv;
+
+   rv = -EINVAL;
+
+   if (map.type != RDT_MAP)
+      goto clean;
+
+   /* Indexes written before types existed are binary and
+    * have a record for every item. */
+   idx->type  = LIBRETRODB_INDEX_BINARY;
+   idx->count = item_count;
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = (uint32_t)strlen("name");
+   key.val.string.buff = (char*)"name";
+   value               = rmsgpack_dom_value_map_value(&map, &key);
+
+   if (!value || value->type != RDT_STRING)
+      goto clean;
+
+   strlcpy(idx->name, value->val.string.buff, MIN(sizeof(idx->name),
+            (size_t)value->val.string.len + 1));
+
+   for (i = 0; i < ARRAY_SIZE(names); i++)
+   {
+      key.val.string.len  = (uint32_t)strlen(names[i]);
+      key.val.string.buff = (char*)names[i];
+      value               = rmsgpack_dom_value_map_value(&map, &key);
+
+      if (!value)
+      {
+         if (fields[i] == &idx->type || fields[i] == &idx->count)
+            continue;
+         goto clean;
+      }
+
+      if (value->type == RDT_UINT)
+         *fields[i] = value->val.uint_;
+      else if (value->type == RDT_INT && value->val.int_ >= 0)
+         *fields[i] = (uint64_t)value->val.int_;
+      else
+         goto clean;
+   }
+
+   idx->offset = filestream_tell(fd);
+   rv          = 0;
+
+clean:
+   rmsgpack_dom_value_free(&map);
+   return rv;
+}
+
+static int libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
+{
+   rmsgpack_write_map_header(fd, 5);
    rmsgpack_write_string(fd, "name", strlen("name"));
    rmsgpack_write_string(fd, idx->name, (uint32_t)strlen(idx->name));
+   rmsgpack_write_string(fd, "type", strlen("type"));
+   rmsgpack_write_uint(fd, idx->type);
    rmsgpack_write_string(fd, "key_size", (uint32_t)strlen("key_size"));
    rmsgpack_write_uint(fd, idx->key_size);
+   rmsgpack_write_string(fd, "count", strlen("count"));
+   rmsgpack_write_uint(fd, idx->count);
    rmsgpack_write_string(fd, "next", strlen("next"));
-   rmsgpack_write_uint(fd, idx->next);
+   return rmsgpack_write_uint(fd, idx->next);
 }
 
 void libretrodb_close(libretrodb_t *db)
@@ -219,9 +315,11 @@ int libretrodb_open(const char *path, libretrodb_t *db)
    libretrodb_header_t header;
    libretrodb_metadata_t md;
    int rv    = 0;
+   /* Mapped where possible, so that index lookups
+    * read the records in place. */
    RFILE *fd = filestream_open(path,
          RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+         RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
 
    if (!fd)
       return -errno;
@@ -238,7 +336,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER) - 1) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -269,91 +367,184 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
       libretrodb_index_t *idx)
 {
    ssize_t eof    = filestream_get_size(db->fd);
-   ssize_t offset = filestream_seek(db->fd,
-         (ssize_t)db->first_index_offset,
-         RETRO_VFS_SEEK_POSITION_START);
+   ssize_t offset = (ssize_t)db->first_index_offset;
+
+   filestream_seek(db->fd, offset, RETRO_VFS_SEEK_POSITION_START);
 
    /* TODO: this should use filestream_eof instead */
    while (offset < eof)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      if (libretrodb_read_index_header(db->fd, idx, db->count) < 0)
+         return -1;
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+      if (string_is_equal(index_name, idx->name))
          return 0;
 
-      filestream_seek(db->fd, (ssize_t)idx->next,
-            RETRO_VFS_SEEK_POSITION_CURRENT);
-      offset = filestream_tell(db->fd);
+      offset = (ssize_t)(idx->offset + idx->next);
+      filestream_seek(db->fd, offset, RETRO_VFS_SEEK_POSITION_START);
    }
 
    return -1;
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+/* Compares the string a record points at with @key, the result
+ * goes to @cmp. Returns -EIO if the string can't be read. */
+static int libretrodb_index_compare_string(RFILE *fd,
+      const libretrodb_index_t *idx, const uint8_t *record,
+      const char *key, size_t key_len, int *cmp)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
+   uint8_t buff[256];
+   uint64_t pos     = 0;
+   uint64_t offset  = libretrodb_load_be(record, sizeof(uint32_t));
+   uint64_t len     = libretrodb_load_be(record + sizeof(uint32_t),
+         sizeof(uint32_t));
+   uint64_t min_len = MIN(len, key_len);
+
+   filestream_seek(fd, (ssize_t)(idx->offset +
+            idx->count * (idx->key_size + INDEX_OFFSET_SIZE) + offset),
+         RETRO_VFS_SEEK_POSITION_START);
 
-   if (rv == 0)
+   while (pos < min_len)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
+      int rv;
+      size_t chunk = (size_t)MIN(min_len - pos, sizeof(buff));
+
+      if (filestream_read(fd, buff, chunk) != (ssize_t)chunk)
+         return -EIO;
+
+      if ((rv = memcmp(buff, key + pos, chunk)) != 0)
+      {
+         *cmp = rv;
+         return 0;
+      }
+
+      pos += chunk;
    }
 
-   if (count == 0)
-      return -1;
+   if (len == key_len)
+      *cmp = 0;
+   else
+      *cmp = len < key_len ? -1 : 1;
+   return 0;
+}
+
+/**
+ * libretrodb_index_search:
+ * @db                  : Handle to database.
+ * @idx                 : Index header, as read by libretrodb_find_index().
+ * @key                 : Encoded key; a string for string indexes.
+ * @key_len             : Length of @key.
+ * @offset              : Item offset of the first matching record.
+ *
+ * Binary searches the sorted records of @idx, reading only the
+ * records it probes.
+ *
+ * Returns: 0 if found, -EIO if a record can't be read,
+ * otherwise negative.
+ **/
+static int libretrodb_index_search(libretrodb_t *db,
+      const libretrodb_index_t *idx, const void *key, size_t key_len,
+      uint64_t *offset)
+{
+   uint8_t record[256];
+   uint64_t lo          = 0;
+   uint64_t hi          = idx->count;
+   uint64_t record_size = idx->key_size + INDEX_OFFSET_SIZE;
+   bool found           = false;
+
+   if (record_size > sizeof(record))
+      return -EINVAL;
+
+   /* Lower bound, so that duplicate keys resolve to the first
+    * item. Whether the bound matches is known from the last probe
+    * that moved it. */
+   while (lo < hi)
+   {
+      int rv;
+      uint64_t mid = lo + (hi - lo) / 2;
+
+      filestream_seek(db->fd, (ssize_t)(idx->offset + mid * record_size),
+            RETRO_VFS_SEEK_POSITION_START);
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      if (filestream_read(db->fd, record, (ssize_t)record_size)
+            != (ssize_t)record_size)
+         return -EIO;
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+      if (idx->type == LIBRETRODB_INDEX_STRING)
+      {
+         if (libretrodb_index_compare_string(db->fd, idx, record,
+                  (const char*)key, key_len, &rv) < 0)
+            return -EIO;
+      }
+      else
+         rv = memcmp(record, key, (size_t)idx->key_size);
+
+      if (rv < 0)
+         lo    = mid + 1;
+      else
+      {
+         hi    = mid;
+         found = (rv == 0);
+         if (found)
+            *offset = libretrodb_load_be(record + idx->key_size,
+                  INDEX_OFFSET_SIZE);
+      }
+   }
+
+   return found ? 0 : -1;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
    libretrodb_index_t idx;
+   uint8_t int_key[sizeof(int64_t)];
+   size_t key_len = 0;
+   uint64_t offset = 0;
    int rv;
-   void *buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
 
    if (libretrodb_find_index(db, index_name, &idx) < 0)
       return -1;
 
-   bufflen = idx.next;
-   buff = malloc(bufflen);
-
-   if (!buff)
-      return -ENOMEM;
-
-   while (nread < bufflen)
+   switch (idx.type)
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
-
-      if (rv <= 0)
-      {
-         free(buff);
-         return -errno;
-      }
-      nread += rv;
+      case LIBRETRODB_INDEX_BINARY:
+         key_len = (size_t)idx.key_size;
+         break;
+      case LIBRETRODB_INDEX_INT:
+         /* Flip the sign bit so that keys sort as unsigned bytes. */
+         libretrodb_store_be(int_key,
+               (uint64_t)*(const int64_t*)key ^ (UINT64_C(1) << 63),
+               sizeof(int_key));
+         key     = int_key;
+         key_len = sizeof(int_key);
+         break;
+      case LIBRETRODB_INDEX_STRING:
+         key_len = strlen((const char*)key);
+         break;
+      default:
+         return -EINVAL;
    }
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+   if ((rv = libretrodb_index_search(db, &idx, key, key_len, &offset)) < 0)
+      return rv;
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset,
-            RETRO_VFS_SEEK_POSITION_START);
+   filestream_seek(db->fd, (ssize_t)offset,
+         RETRO_VFS_SEEK_POSITION_START);
 
    return rmsgpack_dom_read(db->fd, out);
 }
 
+int libretrodb_index_type(libretrodb_t *db, const char *index_name)
+{
+   libretrodb_index_t idx;
+
+   if (libretrodb_find_index(db, index_name, &idx) < 0)
+      return -1;
+
+   return (int)idx.type;
+}
+
 /**
  * libretrodb_cursor_reset:
  * @cursor              : Handle to database cursor.
@@ -461,132 +652,330 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    return 0;
 }
 
-static int node_iter(void *value, void *ctx)
+static int libretrodb_index_compare(
+      const struct libretrodb_index_builder *builder,
+      const uint8_t *a, const uint8_t *b)
 {
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+   int rv;
+   uint64_t a_offset, a_len, b_offset, b_len;
+
+   if (builder->type != LIBRETRODB_INDEX_STRING)
+      return memcmp(a, b, (size_t)builder->key_size);
+
+   a_offset = libretrodb_load_be(a, sizeof(uint32_t));
+   a_len    = libretrodb_load_be(a + sizeof(uint32_t), sizeof(uint32_t));
+   b_offset = libretrodb_load_be(b, sizeof(uint32_t));
+   b_len    = libretrodb_load_be(b + sizeof(uint32_t), sizeof(uint32_t));
 
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
+   if ((rv = memcmp(builder->pool + a_offset, builder->pool + b_offset,
+               (size_t)MIN(a_len, b_len))) != 0)
+      return rv;
+
+   if (a_len == b_len)
       return 0;
+   return a_len < b_len ? -1 : 1;
+}
 
-   return -1;
+/**
+ * libretrodb_index_sort:
+ * @builder             : Collected index records.
+ *
+ * Bottom-up merge sort of the records. It is stable, so records
+ * with equal keys stay in item order, and runs that are already
+ * in order are copied without merging, which makes input sorted
+ * by the indexed field (common for DAT-derived databases) linear.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+static int libretrodb_index_sort(struct libretrodb_index_builder *builder)
+{
+   uint64_t width;
+   size_t record_size = (size_t)(builder->key_size + INDEX_OFFSET_SIZE);
+   uint8_t *src       = builder->records;
+   uint8_t *dst       = NULL;
+
+   if (builder->count < 2)
+      return 0;
+
+   dst                = (uint8_t*)malloc((size_t)builder->count * record_size);
+
+   if (!dst)
+      return -ENOMEM;
+
+   for (width = 1; width < builder->count; width *= 2)
+   {
+      uint64_t lo;
+
+      for (lo = 0; lo < builder->count; lo += 2 * width)
+      {
+         uint64_t mid = MIN(lo + width, builder->count);
+         uint64_t hi  = MIN(lo + 2 * width, builder->count);
+         uint64_t i   = lo;
+         uint64_t j   = mid;
+         uint8_t *out = dst + lo * record_size;
+
+         if (mid < hi && libretrodb_index_compare(builder,
+                  src + (mid - 1) * record_size,
+                  src + mid * record_size) <= 0)
+         {
+            memcpy(out, src + lo * record_size,
+                  (size_t)(hi - lo) * record_size);
+            continue;
+         }
+
+         while (i < mid && j < hi)
+         {
+            if (libretrodb_index_compare(builder,
+                     src + j * record_size, src + i * record_size) < 0)
+               memcpy(out, src + j++ * record_size, record_size);
+            else
+               memcpy(out, src + i++ * record_size, record_size);
+            out += record_size;
+         }
+
+         memcpy(out, src + i * record_size, (size_t)(mid - i) * record_size);
+         out += (mid - i) * record_size;
+         memcpy(out, src + j * record_size, (size_t)(hi - j) * record_size);
+      }
+
+      /* Ping-pong between the two buffers. */
+      {
+         uint8_t *tmp = src;
+         src          = dst;
+         dst          = tmp;
+      }
+   }
+
+   builder->records = src;
+   free(dst);
+   return 0;
 }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
+static int libretrodb_index_add(struct libretrodb_index_builder *builder,
+      const struct rmsgpack_dom_value *field, uint64_t item_loc)
 {
-   return filestream_tell(db->fd);
+   uint8_t *record;
+   size_t record_size;
+   enum libretrodb_index_type type;
+   uint64_t key_size;
+
+   switch (field->type)
+   {
+      case RDT_BINARY:
+         type     = LIBRETRODB_INDEX_BINARY;
+         key_size = field->val.binary.len;
+         if (key_size == 0)
+         {
+            printf("field is empty\n");
+            return -EINVAL;
+         }
+         break;
+      case RDT_INT:
+      case RDT_UINT:
+         type     = LIBRETRODB_INDEX_INT;
+         key_size = sizeof(int64_t);
+         if (field->type == RDT_UINT && field->val.uint_ > INT64_MAX)
+         {
+            printf("field is out of range\n");
+            return -EINVAL;
+         }
+         break;
+      case RDT_STRING:
+         type     = LIBRETRODB_INDEX_STRING;
+         key_size = INDEX_STRING_KEY_SIZE;
+         break;
+      default:
+         printf("field is not binary, integer or string\n");
+         return -EINVAL;
+   }
+
+   if (builder->count == 0)
+   {
+      builder->type     = type;
+      builder->key_size = key_size;
+   }
+   else if (type != builder->type || key_size != builder->key_size)
+   {
+      printf("field is not of correct type or size\n");
+      return -EINVAL;
+   }
+
+   record_size = (size_t)(key_size + INDEX_OFFSET_SIZE);
+
+   if (builder->count == builder->capacity)
+   {
+      uint64_t capacity = builder->capacity ? builder->capacity * 2 : 1024;
+      uint8_t *records  = (uint8_t*)realloc(builder->records,
+            (size_t)capacity * record_size);
+
+      if (!records)
+         return -ENOMEM;
+
+      builder->records  = records;
+      builder->capacity = capacity;
+   }
+
+   record = builder->records + builder->count * record_size;
+
+   switch (type)
+   {
+      case LIBRETRODB_INDEX_BINARY:
+         memcpy(record, field->val.binary.buff, (size_t)key_size);
+         break;
+      case LIBRETRODB_INDEX_INT:
+         {
+            int64_t val = field->type == RDT_UINT
+               ? (int64_t)field->val.uint_ : field->val.int_;
+            /* Flip the sign bit so that keys sort as unsigned bytes. */
+            libretrodb_store_be(record, (uint64_t)val ^ (UINT64_C(1) << 63),
+                  sizeof(int64_t));
+         }
+         break;
+      case LIBRETRODB_INDEX_STRING:
+         {
+            uint32_t len = field->val.string.len;
+
+            if (builder->pool_size + len > UINT32_MAX)
+            {
+               printf("string pool is too large\n");
+               return -EINVAL;
+            }
+
+            if (builder->pool_size + len > builder->pool_capacity)
+            {
+               uint64_t capacity = MAX(builder->pool_capacity * 2,
+                     builder->pool_size + len + 4096);
+               char *pool        = (char*)realloc(builder->pool,
+                     (size_t)capacity);
+
+               if (!pool)
+                  return -ENOMEM;
+
+               builder->pool          = pool;
+               builder->pool_capacity = capacity;
+            }
+
+            memcpy(builder->pool + builder->pool_size,
+                  field->val.string.buff, len);
+            libretrodb_store_be(record, builder->pool_size, sizeof(uint32_t));
+            libretrodb_store_be(record + sizeof(uint32_t), len,
+                  sizeof(uint32_t));
+            builder->pool_size += len;
+         }
+         break;
+   }
+
+   libretrodb_store_be(record + key_size, item_loc, INDEX_OFFSET_SIZE);
+   builder->count++;
+   return 0;
 }
 
-static int node_compare(const void *a, const void *b, void *ctx)
+static int libretrodb_index_write(libretrodb_t *db, const char *name,
+      const struct libretrodb_index_builder *builder)
 {
-   return memcmp(a, b, *(uint8_t *)ctx);
+   libretrodb_index_t idx;
+   size_t records_size = (size_t)(builder->count *
+         (builder->key_size + INDEX_OFFSET_SIZE));
+   int rv              = 0;
+   RFILE *fd           = filestream_open(db->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd)
+      return -errno;
+
+   filestream_seek(fd, 0, RETRO_VFS_SEEK_POSITION_END);
+
+   strlcpy(idx.name, name, sizeof(idx.name));
+   idx.type     = builder->type;
+   idx.key_size = builder->key_size;
+   idx.count    = builder->count;
+   idx.next     = records_size + builder->pool_size;
+
+   if (libretrodb_write_index_header(fd, &idx) < 0
+         || (records_size && filestream_write(fd, builder->records,
+               records_size) != (ssize_t)records_size)
+         || (builder->pool_size && filestream_write(fd, builder->pool,
+               (size_t)builder->pool_size) != (ssize_t)builder->pool_size))
+      rv = -EIO;
+
+   filestream_close(fd);
+   return rv;
 }
 
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
-   struct node_iter_ctx nictx;
    struct rmsgpack_dom_value key;
-   libretrodb_index_t idx;
    struct rmsgpack_dom_value item;
-   libretrodb_cursor_t cur          = {0};
-   struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
-   uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
+   struct libretrodb_index_builder builder = {0};
+   libretrodb_cursor_t cur                 = {0};
+   char *path                              = NULL;
+   int rv;
 
-   item.type                        = RDT_NULL;
+   item.type = RDT_NULL;
 
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
+   if ((rv = libretrodb_cursor_open(db, &cur, NULL)) != 0)
       goto clean;
 
    key.type            = RDT_STRING;
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
 
-   while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   for (;;)
    {
+      struct rmsgpack_dom_value *field = NULL;
+      uint64_t item_loc                = filestream_tell(cur.fd);
+
+      if (libretrodb_cursor_read_item(&cur, &item) != 0)
+         break;
+
       if (item.type != RDT_MAP)
       {
          printf("Only map keys are supported\n");
+         rv = -EINVAL;
          goto clean;
       }
 
       field = rmsgpack_dom_value_map_value(&item, &key);
 
-      if (!field)
-      {
-         printf("field not found in item\n");
-         goto clean;
-      }
-
-      if (field->type != RDT_BINARY)
-      {
-         printf("field is not binary\n");
-         goto clean;
-      }
-
-      if (field->val.binary.len == 0)
-      {
-         printf("field is empty\n");
-         goto clean;
-      }
-
-      if (field_size == 0)
-         field_size = field->val.binary.len;
-      else if (field->val.binary.len != field_size)
-      {
-         printf("field is not of correct size\n");
-         goto clean;
-      }
-
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
-
-      memcpy(buff, field->val.binary.buff, field_size);
-
-      buff_u64 = (uint64_t *)buff + field_size;
-
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
-
-      if (bintree_insert(tree, buff) != 0)
+      if (field && (rv = libretrodb_index_add(&builder, field, item_loc)) < 0)
       {
-         printf("Value is not unique: ");
          rmsgpack_dom_value_print(field);
          printf("\n");
          goto clean;
       }
-      buff     = NULL;
+
       rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
+      item.type = RDT_NULL;
    }
 
-   filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
+   if ((rv = libretrodb_index_sort(&builder)) < 0)
+      goto clean;
 
-   strncpy(idx.name, name, 50);
+   if ((rv = libretrodb_index_write(db, name, &builder)) < 0)
+      goto clean;
 
-   idx.name[49] = '\0';
-   idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   /* Reopen so that the new index is visible to lookups. */
+   path = strdup(db->path);
+   if (!path)
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
 
-   nictx.db  = db;
-   nictx.idx = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   libretrodb_close(db);
+   rv = libretrodb_open(path, db);
 
 clean:
    rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
    if (cur.is_valid)
       libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
-   return 0;
+   free(builder.records);
+   free(builder.pool);
+   free(path);
+   return rv;
 }
 
 libretrodb_cursor_t *libretrodb_cursor_new(void)
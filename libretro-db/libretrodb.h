@@ -43,6 +43,13 @@ typedef struct libretrodb_cursor libretrodb_cursor_t;
 
 typedef struct libretrodb_index libretrodb_index_t;
 
+enum libretrodb_index_type
+{
+   LIBRETRODB_INDEX_BINARY = 0,
+   LIBRETRODB_INDEX_INT,
+   LIBRETRODB_INDEX_STRING
+};
+
 typedef int (*libretrodb_value_provider)(void *ctx, struct rmsgpack_dom_value *out);
 
 int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider, void *ctx);
@@ -51,12 +58,45 @@ void libretrodb_close(libretrodb_t *db);
 
 int libretrodb_open(const char *path, libretrodb_t *db);
 
+/**
+ * libretrodb_create_index:
+ * @db                  : Handle to database.
+ * @name                : Name of the new index.
+ * @field_name          : Field to index.
+ *
+ * Appends a sorted index of @field_name to the database file.
+ * Binary, integer and string fields are supported; items
+ * without the field are left out of the index.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
 int libretrodb_create_index(libretrodb_t *db, const char *name,
       const char *field_name);
 
+/**
+ * libretrodb_find_entry:
+ * @db                  : Handle to database.
+ * @index_name          : Name of the index to search.
+ * @key                 : Key to look up: the raw bytes for a binary
+ *                        index, an int64_t for an integer index and
+ *                        a NUL-terminated string for a string index.
+ * @out                 : Receives the first item with @key.
+ *
+ * Returns: 0 if found, otherwise negative.
+ **/
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_index_type:
+ * @db                  : Handle to database.
+ * @index_name          : Name of the index.
+ *
+ * Returns: the enum libretrodb_index_type of the index,
+ * or -1 if there is no such index.
+ **/
+int libretrodb_index_type(libretrodb_t *db, const char *index_name);
+
 libretrodb_t *libretrodb_new(void);
 
 void libretrodb_free(libretrodb_t *db);
@@ -21,19 +21,204 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+static int find_by_index(libretrodb_t *db, const char *index_name,
+      const char *value, struct rmsgpack_dom_value *out)
+{
+   unsigned i;
+   int64_t int_key;
+   uint8_t binary_key[256] = {0};
+
+   switch (libretrodb_index_type(db, index_name))
+   {
+      case LIBRETRODB_INDEX_BINARY:
+         /* Hex digits, as printed by list. */
+         for (i = 0; value[2 * i] && value[2 * i + 1]
+               && i < sizeof(binary_key); i++)
+         {
+            char byte[3];
+            byte[0]       = value[2 * i];
+            byte[1]       = value[2 * i + 1];
+            byte[2]       = '\0';
+            binary_key[i] = (uint8_t)strtoul(byte, NULL, 16);
+         }
+         return libretrodb_find_entry(db, index_name, binary_key, out);
+      case LIBRETRODB_INDEX_INT:
+         int_key = strtoll(value, NULL, 10);
+         return libretrodb_find_entry(db, index_name, &int_key, out);
+      case LIBRETRODB_INDEX_STRING:
+         return libretrodb_find_entry(db, index_name, value, out);
+      default:
+         break;
+   }
+
+   printf("No index named '%s'\n", index_name);
+   return -1;
+}
+
+/* Indexes a copy of the database, then looks up the field
+ * of every item through the index and checks the result. */
+static int bench_index(const char *path, const char *field_name)
+{
+   struct rmsgpack_dom_value key;
+   struct rmsgpack_dom_value item;
+   char bench_path[PATH_MAX_LENGTH];
+   void *buff                       = NULL;
+   int64_t len                      = 0;
+   libretrodb_t *db                 = NULL;
+   libretrodb_cursor_t *cur         = NULL;
+   bool cur_open                    = false;
+   uint64_t items                   = 0;
+   uint64_t lookups                 = 0;
+   uint64_t misses                  = 0;
+   retro_time_t lookup_time         = 0;
+   retro_time_t lookup_max          = 0;
+   retro_time_t build_time, scan_time;
+   int rv                           = -1;
+
+   item.type = RDT_NULL;
+
+   snprintf(bench_path, sizeof(bench_path), "%s.bench", path);
+
+   if (!filestream_read_file(path, &buff, &len)
+         || !filestream_write_file(bench_path, buff, len))
+   {
+      printf("Could not copy '%s' to '%s'\n", path, bench_path);
+      free(buff);
+      return -1;
+   }
+   free(buff);
+
+   if (!(db = libretrodb_new()) || libretrodb_open(bench_path, db) != 0)
+      goto end;
+
+   build_time = cpu_features_get_time_usec();
+   if ((rv = libretrodb_create_index(db, "bench", field_name)) != 0)
+   {
+      printf("Could not create index: %s\n", strerror(-rv));
+      goto end;
+   }
+   build_time = cpu_features_get_time_usec() - build_time;
+
+   /* A full scan is what a lookup costs without an index. */
+   rv = -1;
+   if (!(cur = libretrodb_cursor_new())
+         || (rv = libretrodb_cursor_open(db, cur, NULL)) != 0)
+      goto end;
+   cur_open = true;
+
+   scan_time = cpu_features_get_time_usec();
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      rmsgpack_dom_value_free(&item);
+      items++;
+   }
+   scan_time = cpu_features_get_time_usec() - scan_time;
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = (uint32_t)strlen(field_name);
+   key.val.string.buff = (char*)field_name;
+
+   libretrodb_cursor_reset(cur);
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      struct rmsgpack_dom_value found;
+      struct rmsgpack_dom_value *found_field;
+      int64_t int_key;
+      retro_time_t elapsed;
+      const void *find_key             = NULL;
+      struct rmsgpack_dom_value *field = rmsgpack_dom_value_map_value(
+            &item, &key);
+
+      found.type = RDT_NULL;
+
+      if (field)
+      {
+         switch (field->type)
+         {
+            case RDT_BINARY:
+               find_key = field->val.binary.buff;
+               break;
+            case RDT_STRING:
+               find_key = field->val.string.buff;
+               break;
+            case RDT_INT:
+               int_key  = field->val.int_;
+               find_key = &int_key;
+               break;
+            case RDT_UINT:
+               int_key  = (int64_t)field->val.uint_;
+               find_key = &int_key;
+               break;
+            default:
+               break;
+         }
+      }
+
+      if (find_key)
+      {
+         elapsed = cpu_features_get_time_usec();
+         rv      = libretrodb_find_entry(db, "bench", find_key, &found);
+         elapsed = cpu_features_get_time_usec() - elapsed;
+
+         found_field = rv == 0
+            ? rmsgpack_dom_value_map_value(&found, &key) : NULL;
+
+         if (!found_field || rmsgpack_dom_value_cmp(found_field, field) != 0)
+            misses++;
+
+         lookup_time += elapsed;
+         if (elapsed > lookup_max)
+            lookup_max = elapsed;
+         lookups++;
+
+         rmsgpack_dom_value_free(&found);
+      }
+
+      rmsgpack_dom_value_free(&item);
+   }
+
+   printf("%s: %llu items, %llu keys\n", path,
+         (unsigned long long)items, (unsigned long long)lookups);
+   printf("  build:  %.3f ms\n", build_time / 1000.0);
+   printf("  scan:   %.3f ms\n", scan_time / 1000.0);
+   if (lookups)
+      printf("  lookup: %.3f us avg, %lld us max, %llu misses\n",
+            (double)lookup_time / lookups, (long long)lookup_max,
+            (unsigned long long)misses);
+
+   rv = misses ? -1 : 0;
+
+end:
+   if (cur_open)
+      libretrodb_cursor_close(cur);
+   libretrodb_cursor_free(cur);
+   if (db)
+   {
+      libretrodb_close(db);
+      libretrodb_free(db);
+   }
+   filestream_delete(bench_path);
+   return rv;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
    libretrodb_t *db;
    libretrodb_cursor_t *cur;
-   libretrodb_query_t *q;
+   libretrodb_query_t *q = NULL;
    struct rmsgpack_dom_value item;
    const char *command, *path, *query_exp, *error;
 
@@ -44,10 +229,23 @@ int main(int argc, char ** argv)
       printf("\tlist\n");
       printf("\tcreate-index <index name> <field name>\n");
       printf("\tfind <query expression>\n");
+      printf("\tfind <index name> <value>\n");
       printf("\tget-names <query expression>\n");
+      printf("\tbench-index <field name>\n");
       return 1;
    }
 
+   if (memcmp(argv[2], "bench-index", 11) == 0)
+   {
+      if (argc != 4)
+      {
+         printf("Usage: %s <db file> bench-index <field name>\n", argv[0]);
+         return 1;
+      }
+
+      return bench_index(argv[1], argv[3]) == 0 ? 0 : 1;
+   }
+
    command = argv[2];
    path    = argv[1];
 
@@ -83,6 +281,18 @@ int main(int argc, char ** argv)
          rmsgpack_dom_value_free(&item);
       }
    }
+   else if (memcmp(command, "find", 4) == 0 && argc == 5)
+   {
+      if (find_by_index(db, argv[3], argv[4], &item) != 0)
+      {
+         printf("Not found\n");
+         goto error;
+      }
+
+      rmsgpack_dom_value_print(&item);
+      printf("\n");
+      rmsgpack_dom_value_free(&item);
+   }
    else if (memcmp(command, "find", 4) == 0)
    {
       if (argc != 4)
@@ -247,6 +247,8 @@ int setting_action_ok_bind_defaults(void *data, bool wraparound)
       target->mbutton = NO_BTN;
    }
 
+   input_config_binds_changed();
+
    return 0;
 }
 
@@ -157,6 +157,7 @@ static int action_scan_input_desc(const char *path,
       target->joykey  = NO_BTN;
       target->joyaxis = AXIS_NONE;
       target->mbutton = NO_BTN;
+      input_config_binds_changed();
    }
 
    return 0;
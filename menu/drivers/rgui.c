@@ -63,12 +63,21 @@ typedef struct
       unsigned frame_count;
       bool bg_thickness;
       bool border_thickness;
+      bool framebuf_prev_valid;
       float scroll_y;
       char *msgbox;
 } rgui_t;
 
 static uint16_t *rgui_framebuf_data = NULL;
 
+/* Copy of the last frame handed to the video driver, used to
+ * skip texture uploads when a redraw produced the same image. */
+static uint16_t *rgui_framebuf_prev = NULL;
+
+/* Font glyphs expanded to one byte per row, bit i set for
+ * pixel i, so that text is drawn without bit-stream lookups. */
+static uint8_t rgui_glyph_rows[256][FONT_HEIGHT];
+
 #if defined(GEKKO) || defined(PSP)
 #define HOVER_COLOR(settings) ((3 << 0) | (10 << 4) | (3 << 8) | (7 << 12))
 #define NORMAL_COLOR(settings) 0x7FFF
@@ -118,6 +127,8 @@ static uint16_t rgui_green_filler(rgui_t *rgui, unsigned x, unsigned y)
 #endif
 }
 
+/* Fillers are checkerboards that repeat every 4 rows at most,
+ * so only the first 4 rows are computed and the rest copied. */
 static void rgui_fill_rect(
     rgui_t *rgui,
     uint16_t *data,
@@ -127,10 +138,22 @@ static void rgui_fill_rect(
     uint16_t (*col)(rgui_t *rgui, unsigned x, unsigned y))
 {
       unsigned i, j;
+      size_t pitch_in_pixels = pitch >> 1;
 
       for (j = y; j < y + height; j++)
+      {
+            uint16_t *dst = data + j * pitch_in_pixels + x;
+
+            if (j >= y + 4)
+            {
+                  memcpy(dst, dst - 4 * pitch_in_pixels,
+                         width * sizeof(uint16_t));
+                  continue;
+            }
+
             for (i = x; i < x + width; i++)
-                  data[j * (pitch >> 1) + i] = col(rgui, i, j);
+                  *dst++ = col(rgui, i, j);
+      }
 }
 
 static void rgui_color_rect(
@@ -153,29 +176,52 @@ static void blit_line(int x, int y,
                       const char *message, uint16_t color)
 {
       size_t pitch = menu_display_get_framebuffer_pitch();
-      const uint8_t *font_fb = menu_display_get_font_framebuffer();
+      size_t pitch_in_pixels = pitch >> 1;
+
+      if (!menu_display_get_font_framebuffer())
+            return;
 
-      if (font_fb)
+      while (!string_is_empty(message))
       {
-            while (!string_is_empty(message))
+            unsigned j;
+            const uint8_t *rows = rgui_glyph_rows[(uint8_t)*message++];
+            uint16_t *dst = rgui_framebuf_data + y * pitch_in_pixels + x;
+
+            for (j = 0; j < FONT_HEIGHT; j++, dst += pitch_in_pixels)
             {
-                  unsigned i, j;
-                  char symbol = *message++;
+                  unsigned i;
+                  uint8_t row = rows[j];
+
+                  for (i = 0; row; i++, row >>= 1)
+                        if (row & 1)
+                              dst[i] = color;
+            }
+
+            x += FONT_WIDTH_STRIDE;
+      }
+}
+
+static void rgui_init_glyph_rows(const uint8_t *font_fb)
+{
+      unsigned c, i, j;
 
-                  for (j = 0; j < FONT_HEIGHT; j++)
+      memset(rgui_glyph_rows, 0, sizeof(rgui_glyph_rows));
+
+      if (!font_fb)
+            return;
+
+      for (c = 0; c < 256; c++)
+      {
+            for (j = 0; j < FONT_HEIGHT; j++)
+            {
+                  for (i = 0; i < FONT_WIDTH; i++)
                   {
-                        for (i = 0; i < FONT_WIDTH; i++)
-                        {
-                              uint8_t rem = 1 << ((i + j * FONT_WIDTH) & 7);
-                              int offset = (i + j * FONT_WIDTH) >> 3;
-                              bool col = (font_fb[FONT_OFFSET(symbol) + offset] & rem);
-
-                              if (col)
-                                    rgui_framebuf_data[(y + j) * (pitch >> 1) + (x + i)] = color;
-                        }
-                  }
+                        uint8_t rem = 1 << ((i + j * FONT_WIDTH) & 7);
+                        int offset = (i + j * FONT_WIDTH) >> 3;
 
-                  x += FONT_WIDTH_STRIDE;
+                        if (font_fb[FONT_OFFSET(c) + offset] & rem)
+                              rgui_glyph_rows[c][j] |= 1 << i;
+                  }
             }
       }
 }
@@ -247,6 +293,7 @@ static bool rguidisp_init_font(menu_handle_t *menu)
 #endif
 
       menu_display_set_font_framebuffer(font_bin_buf);
+      rgui_init_glyph_rows(font_bin_buf);
 
       return true;
 }
@@ -423,6 +470,37 @@ static void rgui_frame(void *data, video_frame_info_t *video_info)
       rgui->frame_count++;
 }
 
+/**
+ * rgui_framebuffer_commit:
+ * @rgui                  : RGUI handle.
+ * @fb_pitch              : Framebuffer pitch in bytes.
+ * @fb_height             : Framebuffer height.
+ *
+ * Compares the freshly rendered framebuffer against the last
+ * uploaded one and only flags the framebuffer dirty when a pixel
+ * actually changed, so idle frames skip the texture upload.
+ **/
+static void rgui_framebuffer_commit(rgui_t *rgui,
+      size_t fb_pitch, unsigned fb_height)
+{
+      size_t size = fb_pitch * fb_height;
+
+      if (!rgui_framebuf_data)
+            return;
+
+      if (rgui_framebuf_prev)
+      {
+            if (rgui->framebuf_prev_valid &&
+                !memcmp(rgui_framebuf_prev, rgui_framebuf_data, size))
+                  return;
+
+            memcpy(rgui_framebuf_prev, rgui_framebuf_data, size);
+            rgui->framebuf_prev_valid = true;
+      }
+
+      menu_display_set_framebuffer_dirty_flag();
+}
+
 static void rgui_render(void *data, bool is_idle)
 {
       menu_animation_ctx_ticker_t ticker;
@@ -465,12 +543,17 @@ static void rgui_render(void *data, bool is_idle)
                                  fb_pitch, 0, fb_height, fb_width, 4, rgui_gray_filler);
             rgui->last_width = fb_width;
             rgui->last_height = fb_height;
+            rgui->framebuf_prev_valid = false;
       }
 
       if (rgui->bg_modified)
             rgui->bg_modified = false;
 
-      menu_display_set_framebuffer_dirty_flag();
+      /* a forced redraw always reaches the texture, even if the
+       * rendered frame happens to match the previous one */
+      if (rgui->force_redraw)
+            rgui->framebuf_prev_valid = false;
+
       menu_animation_ctl(MENU_ANIMATION_CTL_CLEAR_ACTIVE, NULL);
 
       rgui->force_redraw = false;
@@ -698,6 +781,8 @@ static void rgui_render(void *data, bool is_idle)
             if (settings->bools.menu_mouse_enable && cursor_visible)
                   rgui_blit_cursor();
       }
+
+      rgui_framebuffer_commit(rgui, fb_pitch, fb_height);
 }
 
 static void rgui_framebuffer_free(void)
@@ -705,6 +790,10 @@ static void rgui_framebuffer_free(void)
       if (rgui_framebuf_data)
             free(rgui_framebuf_data);
       rgui_framebuf_data = NULL;
+
+      if (rgui_framebuf_prev)
+            free(rgui_framebuf_prev);
+      rgui_framebuf_prev = NULL;
 }
 
 static void *rgui_init(void **userdata, bool video_is_threaded)
@@ -733,6 +822,13 @@ static void *rgui_init(void **userdata, bool video_is_threaded)
       if (!rgui_framebuf_data)
             goto error;
 
+      /* copy of the last uploaded frame, used to skip redundant uploads */
+      rgui_framebuf_prev = (uint16_t *)
+          calloc(400 * 240, sizeof(uint16_t));
+
+      if (!rgui_framebuf_prev)
+            goto error;
+
       fb_width = 320;
       fb_height = 240;
       fb_pitch = fb_width * sizeof(uint16_t);
@@ -867,6 +963,23 @@ static void rgui_populate_entries(void *data,
       rgui_navigation_set(data, true);
 }
 
+static void rgui_context_reset(void *data, bool is_threaded)
+{
+      rgui_t *rgui = (rgui_t *)data;
+
+      /* the texture went away with the context, upload again */
+      if (rgui)
+            rgui->framebuf_prev_valid = false;
+}
+
+static void rgui_toggle(void *userdata, bool menu_on)
+{
+      rgui_t *rgui = (rgui_t *)userdata;
+
+      if (rgui && menu_on)
+            rgui->framebuf_prev_valid = false;
+}
+
 static int rgui_environ(enum menu_environ_cb type,
                         void *data, void *userdata)
 {
@@ -928,10 +1041,10 @@ menu_ctx_driver_t menu_ctx_rgui = {
     rgui_frame,
     rgui_init,
     rgui_free,
-    NULL,
+    rgui_context_reset,
     NULL,
     rgui_populate_entries,
-    NULL,
+    rgui_toggle,
     rgui_navigation_clear,
     NULL,
     NULL,
@@ -1095,16 +1095,28 @@ static void xmb_update_savestate_thumbnail_path(void *data, unsigned i)
    menu_entry_free(&entry);
 }
 
+/* Thumbnails are never drawn larger than the screen, so there is
+ * no point in uploading them at a higher resolution than that. */
+static void xmb_get_thumbnail_max_size(unsigned *max_width,
+      unsigned *max_height)
+{
+   video_driver_get_size(max_width, max_height);
+}
+
 static void xmb_update_thumbnail_image(void *data)
 {
+   unsigned max_width, max_height;
    xmb_handle_t *xmb = (xmb_handle_t*)data;
    if (!xmb)
       return;
 
+   xmb_get_thumbnail_max_size(&max_width, &max_height);
+
    if (!(string_is_empty(xmb->thumbnail_file_path)))
    {
       if (filestream_exists(xmb->thumbnail_file_path))
-         task_push_image_load(xmb->thumbnail_file_path,
+         task_push_image_load_thumbnail(xmb->thumbnail_file_path,
+               max_width, max_height,
                menu_display_handle_thumbnail_upload, NULL);
       else
          xmb->thumbnail = 0;
@@ -1116,7 +1128,8 @@ static void xmb_update_thumbnail_image(void *data)
    if (!(string_is_empty(xmb->left_thumbnail_file_path)))
    {
       if (filestream_exists(xmb->left_thumbnail_file_path))
-         task_push_image_load(xmb->left_thumbnail_file_path,
+         task_push_image_load_thumbnail(xmb->left_thumbnail_file_path,
+               max_width, max_height,
                menu_display_handle_left_thumbnail_upload, NULL);
       else
          xmb->left_thumbnail = 0;
@@ -1157,6 +1170,67 @@ static void xmb_set_thumbnail_content(void *data, char *s, size_t len)
    xmb->thumbnail_content = strdup(s);
 }
 
+/**
+ * xmb_prefetch_thumbnails:
+ * @xmb                   : XMB handle.
+ * @selection             : Index of the selected playlist entry.
+ *
+ * Decodes the right thumbnails of the entries next to @selection
+ * into the image cache, so scrolling onto them does not have to
+ * wait for the disk and the decoder.
+ **/
+static void xmb_prefetch_thumbnails(xmb_handle_t *xmb, size_t selection)
+{
+   unsigned max_width, max_height;
+   size_t i;
+   size_t list_size          = menu_entries_get_size();
+   char *selected_content    = string_is_empty(xmb->thumbnail_content)
+      ? NULL : strdup(xmb->thumbnail_content);
+   size_t neighbours[2];
+
+   neighbours[0] = selection - 1;
+   neighbours[1] = selection + 1;
+
+   xmb_get_thumbnail_max_size(&max_width, &max_height);
+
+   for (i = 0; i < ARRAY_SIZE(neighbours); i++)
+   {
+      menu_entry_t entry;
+
+      /* also catches selection - 1 wrapping around */
+      if (neighbours[i] >= list_size)
+         continue;
+
+      menu_entry_init(&entry);
+      menu_entry_get(&entry, 0, neighbours[i], NULL, true);
+
+      if (!string_is_empty(entry.path))
+      {
+         xmb_set_thumbnail_content(xmb, entry.path, 0 /* will be ignored */);
+         xmb_update_thumbnail_path(xmb, (unsigned)neighbours[i], 'R');
+
+         if (!string_is_empty(xmb->thumbnail_file_path))
+         {
+            if (filestream_exists(xmb->thumbnail_file_path))
+               task_push_image_prefetch(xmb->thumbnail_file_path,
+                     max_width, max_height);
+            free(xmb->thumbnail_file_path);
+         }
+         xmb->thumbnail_file_path = NULL;
+      }
+
+      menu_entry_free(&entry);
+   }
+
+   if (selected_content)
+   {
+      xmb_set_thumbnail_content(xmb, selected_content, 0 /* will be ignored */);
+      free(selected_content);
+   }
+   else
+      xmb_reset_thumbnail_content(xmb);
+}
+
 static void xmb_update_savestate_thumbnail_image(void *data)
 {
    xmb_handle_t *xmb = (xmb_handle_t*)data;
@@ -1255,6 +1329,9 @@ static void xmb_selection_pointer_changed(
                   xmb_update_thumbnail_path(xmb, i, 'L');
                   xmb_update_thumbnail_image(xmb);
                }
+               if (!string_is_equal(thumb_ident,
+                        msg_hash_to_str(MENU_ENUM_LABEL_VALUE_OFF)))
+                  xmb_prefetch_thumbnails(xmb, i);
             }
             else if (((entry_type == FILE_TYPE_IMAGE || entry_type == FILE_TYPE_IMAGEVIEWER ||
                         entry_type == FILE_TYPE_RDB || entry_type == FILE_TYPE_RDB_ENTRY)
@@ -2994,6 +3071,10 @@ static void xmb_frame(void *data, video_frame_info_t *video_info)
    xmb->raster_block.carr.coords.vertices  = 0;
    xmb->raster_block2.carr.coords.vertices = 0;
 
+   /* Text goes to the raster blocks until they are flushed
+    * below, so icons and quads up to there can be batched. */
+   menu_display_batch_begin(video_info);
+
    menu_display_set_alpha(coord_black, MIN(
             (float)video_info->xmb_alpha_factor/100, xmb->alpha));
    menu_display_set_alpha(coord_white, xmb->alpha);
@@ -3676,6 +3757,8 @@ static void xmb_frame(void *data, video_frame_info_t *video_info)
             width,
             height);
 
+   menu_display_batch_end(video_info);
+
    font_driver_flush(video_info->width, video_info->height, xmb->font,
          video_info);
    font_driver_bind_block(xmb->font, NULL);
@@ -4132,6 +4215,8 @@ static void xmb_free(void *data)
 
    if (xmb)
    {
+      task_image_cache_clear();
+
       if (xmb->selection_buf_old)
       {
          xmb_free_list_nodes(xmb->selection_buf_old, false);
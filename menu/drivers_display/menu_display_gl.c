@@ -13,7 +13,10 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
+
 #include <retro_miscellaneous.h>
+#include <gfx/math/matrix_4x4.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
@@ -40,6 +43,34 @@ static const GLfloat gl_tex_coords[] = {
    1, 0
 };
 
+/* Maximum number of quads submitted by one batched draw. */
+#define MENU_DISPLAY_GL_BATCH_QUADS 256
+
+/* Quads drawn between batch_begin and batch_end that share a
+ * texture are transformed on the CPU into full viewport space
+ * and submitted as a single triangle list. Every other display
+ * call flushes the batch first, so draw order is preserved. */
+typedef struct menu_display_gl_batch
+{
+   bool enable;
+   unsigned quads;
+   unsigned width;
+   unsigned height;
+   uintptr_t texture;
+   GLfloat vertex[MENU_DISPLAY_GL_BATCH_QUADS * 6 * 2];
+   GLfloat tex_coord[MENU_DISPLAY_GL_BATCH_QUADS * 6 * 2];
+   GLfloat color[MENU_DISPLAY_GL_BATCH_QUADS * 6 * 4];
+} menu_display_gl_batch_t;
+
+static menu_display_gl_batch_t gl_batch;
+
+static const GLfloat gl_white[] = {
+   1, 1, 1, 1,
+   1, 1, 1, 1,
+   1, 1, 1, 1,
+   1, 1, 1, 1
+};
+
 static const float *menu_display_gl_get_default_vertices(void)
 {
    return &gl_vertexes[0];
@@ -77,10 +108,169 @@ static GLenum menu_display_prim_to_gl_enum(
    return 0;
 }
 
+static void menu_display_gl_batch_flush(video_frame_info_t *video_info)
+{
+   struct video_coords coords;
+   video_shader_ctx_mvp_t mvp;
+   video_shader_ctx_coords_t coords_info;
+   math_matrix_4x4 identity;
+   gl_t *gl = video_info ? (gl_t*)video_info->userdata : NULL;
+
+   if (!gl_batch.quads)
+      return;
+
+   if (!gl)
+   {
+      gl_batch.quads = 0;
+      return;
+   }
+
+   coords.vertices        = gl_batch.quads * 6;
+   coords.vertex          = gl_batch.vertex;
+   coords.tex_coord       = gl_batch.tex_coord;
+   coords.lut_tex_coord   = gl_batch.tex_coord;
+   coords.color           = gl_batch.color;
+
+   glViewport(0, 0, gl_batch.width, gl_batch.height);
+   glBindTexture(GL_TEXTURE_2D, (GLuint)gl_batch.texture);
+
+   coords_info.handle_data = gl;
+   coords_info.data        = &coords;
+
+   video_driver_set_coords(&coords_info);
+
+   /* Vertices are already in normalized device coordinates. */
+   matrix_4x4_identity(identity);
+
+   mvp.data   = gl;
+   mvp.matrix = &identity;
+
+   video_driver_set_mvp(&mvp);
+
+   glDrawArrays(GL_TRIANGLES, 0, coords.vertices);
+
+   gl->coords.color = gl->white_color_ptr;
+   gl_batch.quads   = 0;
+
+   menu_display_count_draw_calls(1);
+}
+
+/**
+ * menu_display_gl_batch_add:
+ * @draw                  : Draw to append.
+ *
+ * Appends @draw to the current batch if it is a plain quad
+ * that lies fully inside its viewport, so that drawing it in
+ * the full viewport produces the same pixels.
+ *
+ * Returns: true if @draw was batched, false if it has to be
+ * drawn immediately.
+ **/
+static bool menu_display_gl_batch_add(menu_display_ctx_draw_t *draw,
+      video_frame_info_t *video_info)
+{
+   unsigned i;
+   float pos[4][2];
+   GLfloat *vertex, *tex_coord, *color;
+   static const unsigned strip_to_tris[6] = { 0, 1, 2, 2, 1, 3 };
+   const math_matrix_4x4 *mat             = NULL;
+   const float *src_color                 = NULL;
+
+   if (     !gl_batch.enable
+         || draw->prim_type != MENU_DISPLAY_PRIM_TRIANGLESTRIP
+         || draw->coords->vertices != 4
+         || draw->pipeline.id
+         || !video_info->width
+         || !video_info->height)
+      return false;
+
+   mat = draw->matrix_data ? (const math_matrix_4x4*)draw->matrix_data
+      : (const math_matrix_4x4*)menu_display_gl_get_default_mvp(video_info);
+
+   if (!mat)
+      return false;
+
+   for (i = 0; i < 4; i++)
+   {
+      float x  = draw->coords->vertex[i * 2 + 0];
+      float y  = draw->coords->vertex[i * 2 + 1];
+      float cx = MAT_ELEM_4X4(*mat, 0, 0) * x
+         + MAT_ELEM_4X4(*mat, 0, 1) * y + MAT_ELEM_4X4(*mat, 0, 3);
+      float cy = MAT_ELEM_4X4(*mat, 1, 0) * x
+         + MAT_ELEM_4X4(*mat, 1, 1) * y + MAT_ELEM_4X4(*mat, 1, 3);
+      float cz = MAT_ELEM_4X4(*mat, 2, 0) * x
+         + MAT_ELEM_4X4(*mat, 2, 1) * y + MAT_ELEM_4X4(*mat, 2, 3);
+      float cw = MAT_ELEM_4X4(*mat, 3, 0) * x
+         + MAT_ELEM_4X4(*mat, 3, 1) * y + MAT_ELEM_4X4(*mat, 3, 3);
+
+      /* Only affine transforms of quads that GL would not clip. */
+      if (     fabs(cw - 1.0f) > 0.0001f
+            || fabs(cx) > 1.0001f
+            || fabs(cy) > 1.0001f
+            || fabs(cz) > 1.0f)
+         return false;
+
+      /* Viewport of the draw, then back to NDC of the full one. */
+      pos[i][0] = ((float)draw->x + (cx + 1.0f) * 0.5f * draw->width)
+         * 2.0f / video_info->width  - 1.0f;
+      pos[i][1] = ((float)draw->y + (cy + 1.0f) * 0.5f * draw->height)
+         * 2.0f / video_info->height - 1.0f;
+   }
+
+   if (gl_batch.quads &&
+         (     gl_batch.texture != draw->texture
+            || gl_batch.width   != video_info->width
+            || gl_batch.height  != video_info->height
+            || gl_batch.quads   == MENU_DISPLAY_GL_BATCH_QUADS))
+      menu_display_gl_batch_flush(video_info);
+
+   gl_batch.texture = draw->texture;
+   gl_batch.width   = video_info->width;
+   gl_batch.height  = video_info->height;
+
+   src_color        = draw->coords->color ? draw->coords->color : gl_white;
+   vertex           = &gl_batch.vertex[gl_batch.quads * 6 * 2];
+   tex_coord        = &gl_batch.tex_coord[gl_batch.quads * 6 * 2];
+   color            = &gl_batch.color[gl_batch.quads * 6 * 4];
+
+   for (i = 0; i < 6; i++)
+   {
+      unsigned j       = strip_to_tris[i];
+
+      vertex[0]        = pos[j][0];
+      vertex[1]        = pos[j][1];
+      tex_coord[0]     = draw->coords->tex_coord[j * 2 + 0];
+      tex_coord[1]     = draw->coords->tex_coord[j * 2 + 1];
+      memcpy(color, &src_color[j * 4], 4 * sizeof(GLfloat));
+
+      vertex          += 2;
+      tex_coord       += 2;
+      color           += 4;
+   }
+
+   gl_batch.quads++;
+
+   return true;
+}
+
+static void menu_display_gl_batch_begin(video_frame_info_t *video_info)
+{
+   menu_display_gl_batch_flush(video_info);
+   gl_batch.enable = true;
+}
+
+static void menu_display_gl_batch_end(video_frame_info_t *video_info)
+{
+   menu_display_gl_batch_flush(video_info);
+   gl_batch.enable = false;
+}
+
 static void menu_display_gl_blend_begin(video_frame_info_t *video_info)
 {
    video_shader_ctx_info_t shader_info;
 
+   menu_display_gl_batch_flush(video_info);
+
    glEnable(GL_BLEND);
    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
@@ -93,12 +283,14 @@ static void menu_display_gl_blend_begin(video_frame_info_t *video_info)
 
 static void menu_display_gl_blend_end(video_frame_info_t *video_info)
 {
+   menu_display_gl_batch_flush(video_info);
    glDisable(GL_BLEND);
 }
 
 static void menu_display_gl_viewport(menu_display_ctx_draw_t *draw,
       video_frame_info_t *video_info)
 {
+   menu_display_gl_batch_flush(video_info);
    if (draw)
       glViewport(draw->x, draw->y, draw->width, draw->height);
 }
@@ -121,6 +313,9 @@ static void menu_display_gl_draw(menu_display_ctx_draw_t *draw,
    if (!draw->coords->lut_tex_coord)
       draw->coords->lut_tex_coord = menu_display_gl_get_default_tex_coords();
 
+   if (menu_display_gl_batch_add(draw, video_info))
+      return;
+
    menu_display_gl_viewport(draw, video_info);
    if (draw)
       glBindTexture(GL_TEXTURE_2D, (GLuint)draw->texture);
@@ -140,6 +335,8 @@ static void menu_display_gl_draw(menu_display_ctx_draw_t *draw,
             draw->prim_type), 0, draw->coords->vertices);
 
    gl->coords.color     = gl->white_color_ptr;
+
+   menu_display_count_draw_calls(1);
 }
 
 static void menu_display_gl_draw_pipeline(menu_display_ctx_draw_t *draw,
@@ -151,6 +348,8 @@ static void menu_display_gl_draw_pipeline(menu_display_ctx_draw_t *draw,
    static float t                   = 0;
    video_coord_array_t *ca          = menu_display_get_coords_array();
 
+   menu_display_gl_batch_flush(video_info);
+
    draw->x                          = 0;
    draw->y                          = 0;
    draw->coords                     = (struct video_coords*)(&ca->coords);
@@ -231,6 +430,8 @@ static void menu_display_gl_clear_color(
    if (!clearcolor)
       return;
 
+   menu_display_gl_batch_flush(video_info);
+
    glClearColor(clearcolor->r,
          clearcolor->g, clearcolor->b, clearcolor->a);
    glClear(GL_COLOR_BUFFER_BIT);
@@ -264,5 +465,7 @@ menu_display_ctx_driver_t menu_display_ctx_gl = {
    menu_display_gl_font_init_first,
    MENU_VIDEO_DRIVER_OPENGL,
    "menu_display_gl",
-   false
+   false,
+   menu_display_gl_batch_begin,
+   menu_display_gl_batch_end
 };
@@ -45,11 +45,9 @@ struct tween
 struct menu_animation
 {
    struct tween *list;
-   bool need_defrag;
 
    size_t capacity;
    size_t size;
-   size_t first_dead;
 };
 
 typedef struct menu_animation menu_animation_t;
@@ -445,63 +443,42 @@ bool menu_animation_push(menu_animation_ctx_entry_t *entry)
    if (!t.easing || t.duration == 0 || t.initial_value == t.target_value)
       return false;
 
-   if (anim.first_dead < anim.size && !anim.list[anim.first_dead].alive)
-      target = &anim.list[anim.first_dead++];
-   else
+   /* Dead tweens are compacted away by menu_animation_update,
+    * so new ones always go at the end. Grow geometrically, menus
+    * push hundreds of tweens at once. */
+   if (anim.size >= anim.capacity)
    {
-      if (anim.size >= anim.capacity)
-      {
-         anim.capacity++;
-         anim.list = (struct tween*)realloc(anim.list,
-               anim.capacity * sizeof(struct tween));
-      }
+      size_t capacity   = anim.capacity ? anim.capacity * 2 : 64;
+      struct tween *list = (struct tween*)realloc(anim.list,
+            capacity * sizeof(struct tween));
+
+      if (!list)
+         return false;
 
-      target = &anim.list[anim.size++];
+      anim.list         = list;
+      anim.capacity     = capacity;
    }
 
+   target  = &anim.list[anim.size++];
    *target = t;
 
-   anim.need_defrag = true;
-
    return true;
 }
 
-static int menu_animation_defrag_cmp(const void *a, const void *b)
-{
-   const struct tween *ta = (const struct tween *)a;
-   const struct tween *tb = (const struct tween *)b;
-
-   return tb->alive - ta->alive;
-}
-
-/* defragments and shrinks the tween list when possible */
-static void menu_animation_defrag()
-{
-   size_t i;
-
-   qsort(anim.list, anim.size, sizeof(anim.list[0]), menu_animation_defrag_cmp);
-
-   for (i = anim.size-1; i > 0; i--)
-   {
-      if (anim.list[i].alive)
-         break;
-
-      anim.size--;
-   }
-
-   anim.first_dead = anim.size;
-   anim.need_defrag = false;
-}
-
 bool menu_animation_update(float delta_time)
 {
-   unsigned i;
+   size_t i;
+   size_t alive           = 0;
    unsigned active_tweens = 0;
 
-   for(i = 0; i < anim.size; i++)
+   /* Updates live tweens and compacts them towards the front in
+    * the same pass, keeping their order. anim.size is re-read on
+    * every iteration since callbacks may push new tweens. */
+   for (i = 0; i < anim.size; i++)
    {
       struct tween *tween = &anim.list[i];
-      if (!tween || !tween->alive)
+
+      if (!tween->alive)
          continue;
 
       tween->running_since += delta_time;
@@ -514,28 +491,29 @@ bool menu_animation_update(float delta_time)
 
       if (tween->running_since >= tween->duration)
       {
+         tween_cb cb     = tween->cb;
+
          *tween->subject = tween->target_value;
          tween->alive    = false;
-         anim.need_defrag = true;
 
-         if (tween->cb)
-            tween->cb();
+         /* may push tweens and reallocate the list,
+          * so tween must not be touched afterwards */
+         if (cb)
+            cb();
+         continue;
       }
 
-      if (tween->running_since < tween->duration)
-         active_tweens += 1;
+      active_tweens += 1;
+
+      if (alive != i)
+         anim.list[alive] = *tween;
+      alive++;
    }
 
-   if (anim.need_defrag)
-      menu_animation_defrag();
+   anim.size = alive;
 
    if (!active_tweens)
-   {
-      anim.size           = 0;
-      anim.first_dead     = 0;
-      anim.need_defrag    = false;
       return false;
-   }
 
 
    animation_is_active = true;
@@ -668,11 +646,6 @@ bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data)
 
                anim.list[i].alive   = false;
                anim.list[i].subject = NULL;
-
-               if (i < anim.first_dead)
-                  anim.first_dead = i;
-
-               anim.need_defrag = true;
             }
          }
          break;
@@ -696,11 +669,7 @@ bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data)
                   anim.list[i].alive   = false;
                   anim.list[i].subject = NULL;
 
-                  if (i < anim.first_dead)
-                     anim.first_dead = i;
-
                   killed++;
-                  anim.need_defrag = true;
                   break;
                }
             }
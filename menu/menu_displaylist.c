@@ -1245,6 +1245,8 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
       playlist_t *playlist, const char *path_playlist, bool is_history)
 {
    unsigned i;
+   char *fill_buf   = NULL;
+   char *path_short = NULL;
    size_t selection = menu_navigation_get_selection();
    size_t list_size = playlist_size(playlist);
 
@@ -1265,28 +1267,22 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
    /* preallocate the file list */
    file_list_reserve(info->list, list_size);
 
+   /* Only history lists and entries without a path display
+    * the formatted label; collections show the playlist label
+    * as is, so don't format 'label (core)' for every entry. */
+   fill_buf   = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+   path_short = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
    for (i = 0; i < list_size; i++)
    {
-      char *path_copy                 = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
-      char *fill_buf                  = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
       size_t path_size                = PATH_MAX_LENGTH * sizeof(char);
       const char *core_name           = NULL;
       const char *path                = NULL;
       const char *label               = NULL;
 
-      fill_buf[0] = path_copy[0]      = '\0';
-
-      if (!string_is_empty(info->path))
-         strlcpy(path_copy, info->path, path_size);
-
-      path                            = path_copy;
-
       playlist_get_index(playlist, i,
             &path, &label, NULL, &core_name, NULL, NULL);
 
-      if (core_name)
-         strlcpy(fill_buf, core_name, path_size);
-
       if (!is_history && i == selection && !string_is_empty(label))
       {
          char *content_basename = strdup(label);
@@ -1300,52 +1296,50 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
          }
       }
 
-      if (path)
+      if (!path)
       {
-         char *path_short = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+         fill_buf[0] = '\0';
 
-         path_short[0] = '\0';
+         if (core_name)
+            strlcpy(fill_buf, core_name, path_size);
 
-         fill_short_pathname_representation(path_short, path,
-               path_size);
-         strlcpy(fill_buf,
-               (!string_is_empty(label)) ? label : path_short,
-               path_size);
+         menu_entries_append_enum(info->list, fill_buf, path_playlist,
+               MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_PLAYLIST_ENTRY, 0, i);
+      }
+      else if (is_history)
+      {
+         if (!string_is_empty(label))
+            strlcpy(fill_buf, label, path_size);
+         else
+         {
+            path_short[0] = '\0';
+            fill_short_pathname_representation(path_short, path,
+                  path_size);
+            strlcpy(fill_buf, path_short, path_size);
+         }
 
          if (!string_is_empty(core_name))
          {
             if (!string_is_equal(core_name,
                      file_path_str(FILE_PATH_DETECT)))
             {
-               char *tmp       = (char*)
-                  malloc(PATH_MAX_LENGTH * sizeof(char));
-
-               tmp[0] = '\0';
-
-               snprintf(tmp, path_size, " (%s)", core_name);
-               strlcat(fill_buf, tmp, path_size);
-
-               free(tmp);
+               strlcat(fill_buf, " (", path_size);
+               strlcat(fill_buf, core_name, path_size);
+               strlcat(fill_buf, ")", path_size);
             }
          }
 
-         free(path_short);
-      }
-
-      if (!path)
-         menu_entries_append_enum(info->list, fill_buf, path_playlist,
-               MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_PLAYLIST_ENTRY, 0, i);
-      else if (is_history)
          menu_entries_append_enum(info->list, fill_buf,
                path, MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i);
+      }
       else
          menu_entries_append_enum(info->list, label,
                path, MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i);
-
-      free(path_copy);
-      free(fill_buf);
    }
 
+   free(fill_buf);
+   free(path_short);
+
    return 0;
 
 error:
@@ -168,6 +168,11 @@ static bool menu_display_framebuf_dirty          = false;
 static const uint8_t *menu_display_font_framebuf = NULL;
 static menu_display_ctx_driver_t *menu_disp      = NULL;
 
+/* Draw statistics of the menu frame being rendered
+ * and of the last completed one */
+static menu_display_draw_stats_t menu_display_draw_stats_cur;
+static menu_display_draw_stats_t menu_display_draw_stats_last;
+
 /* when enabled, on next iteration the 'Quick Menu' list will
  * be pushed onto the stack */
 static bool menu_driver_pending_quick_menu      = false;
@@ -370,6 +375,34 @@ void menu_display_blend_end(video_frame_info_t *video_info)
       menu_disp->blend_end(video_info);
 }
 
+/* Begin batching draws, if the display driver supports it */
+void menu_display_batch_begin(video_frame_info_t *video_info)
+{
+   if (menu_disp && menu_disp->batch_begin)
+      menu_disp->batch_begin(video_info);
+}
+
+/* Submit all batched draws and stop batching */
+void menu_display_batch_end(video_frame_info_t *video_info)
+{
+   if (menu_disp && menu_disp->batch_end)
+      menu_disp->batch_end(video_info);
+}
+
+/* Called by batching display drivers for every draw
+ * call they submit */
+void menu_display_count_draw_calls(unsigned count)
+{
+   menu_display_draw_stats_cur.draw_calls += count;
+}
+
+/* Draw statistics of the last completed menu frame */
+void menu_display_get_draw_stats(menu_display_draw_stats_t *stats)
+{
+   if (stats)
+      *stats = menu_display_draw_stats_last;
+}
+
 /* Teardown; deinitializes and frees all
  * fonts associated to the menu driver */
 void menu_display_font_free(font_data_t *font)
@@ -653,6 +686,10 @@ void menu_display_draw(menu_display_ctx_draw_t *draw,
    if (draw->height <= 0)
       draw->height = 1;
 
+   menu_display_draw_stats_cur.draws++;
+   if (!menu_disp->batch_begin)
+      menu_display_draw_stats_cur.draw_calls++;
+
    menu_disp->draw(draw, video_info);
 }
 
@@ -1752,7 +1789,14 @@ const char *menu_driver_ident(void)
 void menu_driver_frame(video_frame_info_t *video_info)
 {
    if (menu_driver_alive && menu_driver_ctx->frame)
+   {
+      menu_display_draw_stats_cur.draws      = 0;
+      menu_display_draw_stats_cur.draw_calls = 0;
+
       menu_driver_ctx->frame(menu_userdata, video_info);
+
+      menu_display_draw_stats_last           = menu_display_draw_stats_cur;
+   }
 }
 
 bool menu_driver_render(bool is_idle, bool rarch_is_inited,
@@ -375,8 +375,21 @@ typedef struct menu_display_ctx_driver
    enum menu_display_driver_type type;
    const char *ident;
    bool handles_transform;
+   /* Optional: between batch_begin and batch_end, draw may
+    * defer compatible quads and submit them together. Drivers
+    * only open a batch where nothing else draws in between. */
+   void (*batch_begin)(video_frame_info_t *video_info);
+   void (*batch_end)(video_frame_info_t *video_info);
 } menu_display_ctx_driver_t;
 
+typedef struct menu_display_draw_stats
+{
+   /* menu_display_draw() calls */
+   unsigned draws;
+   /* Draw calls actually submitted by the display driver */
+   unsigned draw_calls;
+} menu_display_draw_stats_t;
+
 
 typedef struct
 {
@@ -675,6 +688,12 @@ void menu_display_toggle_set_reason(enum menu_toggle_reason reason);
 void menu_display_blend_begin(video_frame_info_t *video_info);
 void menu_display_blend_end(video_frame_info_t *video_info);
 
+void menu_display_batch_begin(video_frame_info_t *video_info);
+void menu_display_batch_end(video_frame_info_t *video_info);
+
+void menu_display_count_draw_calls(unsigned count);
+void menu_display_get_draw_stats(menu_display_draw_stats_t *stats);
+
 void menu_display_font_free(font_data_t *font);
 
 void menu_display_coords_array_reset(void);
@@ -196,7 +196,10 @@ void menu_entry_bind_key_set(uint32_t i, int32_t value)
    struct retro_keybind *keybind = (struct retro_keybind*)
       setting_get_ptr(setting);
    if (keybind)
+   {
       keybind->key = (enum retro_key)value;
+      input_config_binds_changed();
+   }
 }
 
 void menu_entry_bind_joykey_set(uint32_t i, int32_t value)
@@ -205,7 +208,10 @@ void menu_entry_bind_joykey_set(uint32_t i, int32_t value)
    struct retro_keybind *keybind = (struct retro_keybind*)
       setting_get_ptr(setting);
    if (keybind)
+   {
       keybind->joykey = value;
+      input_config_binds_changed();
+   }
 }
 
 void menu_entry_bind_joyaxis_set(uint32_t i, int32_t value)
@@ -214,7 +220,10 @@ void menu_entry_bind_joyaxis_set(uint32_t i, int32_t value)
    struct retro_keybind *keybind = (struct retro_keybind*)
       setting_get_ptr(setting);
    if (keybind)
+   {
       keybind->joyaxis = value;
+      input_config_binds_changed();
+   }
 }
 
 void menu_entry_pathdir_selected(uint32_t i)
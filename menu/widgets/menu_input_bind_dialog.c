@@ -72,6 +72,7 @@ static bool menu_input_key_bind_custom_bind_keyboard_cb(
    settings_t     *settings = config_get_ptr();
 
    menu_input_binds.target->key = (enum retro_key)code;
+   input_config_binds_changed();
    menu_input_binds.begin++;
    menu_input_binds.target++;
 
@@ -461,6 +462,7 @@ bool menu_input_key_bind_iterate(menu_input_ctx_bind_t *bind)
          menu_input_key_bind_poll_find_trigger(&menu_input_binds, &binds))
    {
       input_driver_keyboard_mapping_set_block(false);
+      input_config_binds_changed();
 
       /* Avoid new binds triggering things right away. */
       input_driver_set_flushing_input();
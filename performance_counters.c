@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -24,6 +25,9 @@
 #endif
 
 #include <compat/strl.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+#include <streams/file_stream.h>
 
 #include "performance_counters.h"
 
@@ -36,6 +40,49 @@
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
 #endif
 
+/* Durations are kept in a log-linear histogram: values below
+ * PERF_HISTOGRAM_SUB_BUCKETS are exact, above that each power of
+ * two is split into PERF_HISTOGRAM_SUB_BUCKETS / 2 buckets, so the
+ * relative error stays below 1 / 32 whatever the magnitude. */
+#define PERF_HISTOGRAM_SUB_BITS     6
+#define PERF_HISTOGRAM_SUB_BUCKETS  (1 << PERF_HISTOGRAM_SUB_BITS)
+#define PERF_HISTOGRAM_HALF_BUCKETS (PERF_HISTOGRAM_SUB_BUCKETS >> 1)
+#define PERF_HISTOGRAM_MAX_BITS     36
+#define PERF_HISTOGRAM_BUCKETS      ((PERF_HISTOGRAM_MAX_BITS - PERF_HISTOGRAM_SUB_BITS + 2) * PERF_HISTOGRAM_HALF_BUCKETS)
+
+/* Number of most recent calls kept per section for the trace. */
+#define PERF_TRACE_EVENTS           4096
+
+struct perf_trace_event
+{
+   retro_time_t start;
+   retro_time_t duration;
+};
+
+struct perf_section_state
+{
+   retro_time_t start;
+   retro_time_t min;
+   retro_time_t max;
+   uint64_t total;
+   uint64_t count;
+   uint32_t buckets[PERF_HISTOGRAM_BUCKETS];
+   struct perf_trace_event *events;
+};
+
+static const char *perf_section_names[PERF_SECTION_LAST] = {
+   "core_run",
+   "video_frame",
+   "audio_flush",
+   "input_poll",
+   "vsync_wait",
+   "frame_time",
+};
+
+/* Unlocked, see enum perf_section. Readers take a copy of count
+ * first, so that they at least see a consistent number of calls. */
+static struct perf_section_state perf_sections[PERF_SECTION_LAST];
+
 static struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
 static struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 static unsigned perf_ptr_rarch;
@@ -89,6 +136,232 @@ void performance_counters_clear(void)
    memset(perf_counters_libretro, 0, sizeof(perf_counters_libretro));
 }
 
+static unsigned perf_histogram_index(uint64_t value)
+{
+   unsigned magnitude = 0;
+
+   if (value >= (UINT64_C(1) << PERF_HISTOGRAM_MAX_BITS))
+      value = (UINT64_C(1) << PERF_HISTOGRAM_MAX_BITS) - 1;
+
+   /* Shift until the value fits in the top half of a sub-bucket
+    * range; the shift count picks the power of two. */
+   while (value >= PERF_HISTOGRAM_SUB_BUCKETS)
+   {
+      value >>= 1;
+      magnitude++;
+   }
+
+   return magnitude * PERF_HISTOGRAM_HALF_BUCKETS + (unsigned)value;
+}
+
+static uint64_t perf_histogram_value(unsigned index)
+{
+   unsigned magnitude;
+   uint64_t value;
+
+   if (index < PERF_HISTOGRAM_SUB_BUCKETS)
+      return index;
+
+   magnitude = index / PERF_HISTOGRAM_HALF_BUCKETS - 1;
+   value     = PERF_HISTOGRAM_HALF_BUCKETS
+      + index % PERF_HISTOGRAM_HALF_BUCKETS;
+
+   /* Report the highest value that falls in the bucket. */
+   return ((value + 1) << magnitude) - 1;
+}
+
+void performance_section_add(enum perf_section section,
+      retro_time_t start, retro_time_t duration)
+{
+   struct perf_section_state *state = &perf_sections[section];
+
+   if (duration < 0)
+      duration = 0;
+
+   if (!state->count || duration < state->min)
+      state->min = duration;
+   if (duration > state->max)
+      state->max = duration;
+
+   state->buckets[perf_histogram_index(duration)]++;
+
+   if (!state->events)
+      state->events = (struct perf_trace_event*)
+         calloc(PERF_TRACE_EVENTS, sizeof(*state->events));
+
+   if (state->events)
+   {
+      struct perf_trace_event *event = &state->events[
+         state->count & (PERF_TRACE_EVENTS - 1)];
+      event->start    = start;
+      event->duration = duration;
+   }
+
+   state->total += duration;
+   state->count++;
+}
+
+void performance_section_begin(enum perf_section section)
+{
+   if (!rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL))
+      return;
+
+   perf_sections[section].start = cpu_features_get_time_usec();
+}
+
+void performance_section_end(enum perf_section section)
+{
+   struct perf_section_state *state = &perf_sections[section];
+
+   /* Counters may have been enabled in the middle of the section. */
+   if (!rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL) || !state->start)
+      return;
+
+   performance_section_add(section, state->start,
+         cpu_features_get_time_usec() - state->start);
+   state->start = 0;
+}
+
+retro_time_t performance_section_percentile(enum perf_section section,
+      double percentile)
+{
+   unsigned i;
+   uint64_t seen                          = 0;
+   const struct perf_section_state *state = &perf_sections[section];
+   uint64_t count                         = state->count;
+   uint64_t target                        = (uint64_t)
+      (count * percentile / 100.0 + 0.5);
+
+   if (!count)
+      return 0;
+
+   if (target < 1)
+      target = 1;
+
+   for (i = 0; i < PERF_HISTOGRAM_BUCKETS; i++)
+   {
+      seen += state->buckets[i];
+      if (seen >= target)
+      {
+         retro_time_t value = (retro_time_t)perf_histogram_value(i);
+         return MIN(value, state->max);
+      }
+   }
+
+   return state->max;
+}
+
+static size_t performance_section_report(char *s, size_t len,
+      enum perf_section section)
+{
+   int ret;
+   const struct perf_section_state *state = &perf_sections[section];
+   uint64_t count                         = state->count;
+
+   if (!len)
+      return 0;
+
+   ret = snprintf(s, len,
+         "%s count=%llu min=%lld mean=%lld p50=%lld p90=%lld "
+         "p99=%lld p99.9=%lld max=%lld\n",
+         perf_section_names[section],
+         (unsigned long long)count,
+         (long long)state->min,
+         (long long)(count ? state->total / count : 0),
+         (long long)performance_section_percentile(section, 50.0),
+         (long long)performance_section_percentile(section, 90.0),
+         (long long)performance_section_percentile(section, 99.0),
+         (long long)performance_section_percentile(section, 99.9),
+         (long long)state->max);
+
+   if (ret < 0)
+      return 0;
+   return MIN((size_t)ret, len - 1);
+}
+
+bool performance_sections_report(char *s, size_t len, const char *name)
+{
+   unsigned i;
+   size_t pos = 0;
+   bool found = false;
+
+   if (len)
+      *s = '\0';
+
+   for (i = 0; i < PERF_SECTION_LAST; i++)
+   {
+      if (!string_is_equal(name, "all") &&
+            !string_is_equal(name, perf_section_names[i]))
+         continue;
+
+      pos  += performance_section_report(s + pos, len - pos,
+            (enum perf_section)i);
+      found = true;
+   }
+
+   return found;
+}
+
+bool performance_sections_write_trace(const char *path)
+{
+   unsigned i;
+   bool first   = true;
+   RFILE *file  = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   filestream_printf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+   /* Every section gets its own track, sections don't always nest
+    * (vsync_wait runs on the video thread with threaded video). */
+   for (i = 0; i < PERF_SECTION_LAST; i++)
+   {
+      uint64_t j, begin;
+      const struct perf_section_state *state = &perf_sections[i];
+      uint64_t count                         = state->count;
+
+      filestream_printf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+            "\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",", i + 1, perf_section_names[i]);
+      first = false;
+
+      if (!state->events)
+         continue;
+
+      begin = count > PERF_TRACE_EVENTS
+         ? count - PERF_TRACE_EVENTS : 0;
+
+      for (j = begin; j < count; j++)
+      {
+         const struct perf_trace_event *event =
+            &state->events[j & (PERF_TRACE_EVENTS - 1)];
+
+         filestream_printf(file, ",\n{\"name\":\"%s\",\"cat\":\"retroarch\","
+               "\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u}",
+               perf_section_names[i],
+               (long long)event->start, (long long)event->duration, i + 1);
+      }
+   }
+
+   filestream_printf(file, "\n]}\n");
+   filestream_close(file);
+   return true;
+}
+
+void performance_sections_clear(void)
+{
+   unsigned i;
+
+   for (i = 0; i < PERF_SECTION_LAST; i++)
+   {
+      free(perf_sections[i].events);
+      memset(&perf_sections[i], 0, sizeof(perf_sections[i]));
+   }
+}
+
 static void log_counters(struct retro_perf_counter **counters, unsigned num)
 {
    unsigned i;
@@ -107,11 +380,25 @@ static void log_counters(struct retro_perf_counter **counters, unsigned num)
 
 void rarch_perf_log(void)
 {
+   unsigned i;
+
    if (!rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL))
       return;
 
    RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
    log_counters(perf_counters_rarch, perf_ptr_rarch);
+
+   RARCH_LOG("[PERF]: Latency in microseconds (RetroArch):\n");
+   for (i = 0; i < PERF_SECTION_LAST; i++)
+   {
+      char line[256];
+
+      if (!perf_sections[i].count)
+         continue;
+
+      performance_section_report(line, sizeof(line), (enum perf_section)i);
+      RARCH_LOG("[PERF]: %s", line);
+   }
 }
 
 void retro_perf_log(void)
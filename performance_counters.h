@@ -30,6 +30,25 @@ RETRO_BEGIN_DECLS
 #define MAX_COUNTERS 64
 #endif
 
+/* Frontend sections whose latency is kept as a histogram
+ * and in a trace of the most recent calls.
+ *
+ * Each section is only ever recorded from one thread, but not
+ * necessarily the main one (vsync_wait runs on the video thread
+ * with threaded video), and the stats are read without locking.
+ * Reports and traces taken while such a section is running are
+ * approximate: they may miss or half include the last call. */
+enum perf_section
+{
+   PERF_SECTION_CORE_RUN = 0,
+   PERF_SECTION_VIDEO_FRAME,
+   PERF_SECTION_AUDIO_FLUSH,
+   PERF_SECTION_INPUT_POLL,
+   PERF_SECTION_VSYNC_WAIT,
+   PERF_SECTION_FRAME_TIME,
+   PERF_SECTION_LAST
+};
+
 typedef struct rarch_timer
 {
    int64_t current;
@@ -89,6 +108,76 @@ void rarch_perf_register(struct retro_perf_counter *perf);
  **/
 #define performance_counter_stop_plus(is_perfcnt_enable, perf) performance_counter_stop_internal(is_perfcnt_enable, perf)
 
+/**
+ * performance_section_begin:
+ * @section            : section identifier
+ *
+ * Marks the start of a section. Does nothing unless
+ * performance counters are enabled.
+ **/
+void performance_section_begin(enum perf_section section);
+
+/**
+ * performance_section_end:
+ * @section            : section identifier
+ *
+ * Marks the end of a section started with
+ * performance_section_begin() and records its duration.
+ **/
+void performance_section_end(enum perf_section section);
+
+/**
+ * performance_section_add:
+ * @section            : section identifier
+ * @start              : start time, in microseconds
+ * @duration           : duration, in microseconds
+ *
+ * Records a section measured by the caller.
+ **/
+void performance_section_add(enum perf_section section,
+      retro_time_t start, retro_time_t duration);
+
+/**
+ * performance_section_percentile:
+ * @section            : section identifier
+ * @percentile         : percentile, between 0 and 100
+ *
+ * Returns: duration in microseconds that @percentile percent
+ * of the recorded calls did not exceed.
+ **/
+retro_time_t performance_section_percentile(enum perf_section section,
+      double percentile);
+
+/**
+ * performance_sections_report:
+ * @s                  : output buffer
+ * @len                : size of @s
+ * @name               : section name, or "all"
+ *
+ * Writes one line of latency statistics per matching section.
+ * The numbers are approximate for sections recorded on another
+ * thread, see enum perf_section.
+ *
+ * Returns: false if @name does not match any section.
+ **/
+bool performance_sections_report(char *s, size_t len, const char *name);
+
+/**
+ * performance_sections_write_trace:
+ * @path               : path of the trace file
+ *
+ * Writes the most recent calls of every section as
+ * Chrome trace event JSON (chrome://tracing, Perfetto).
+ * The last events of sections recorded on another thread
+ * may be missing or stale, see enum perf_section.
+ *
+ * Returns: true if the file was written.
+ **/
+bool performance_sections_write_trace(const char *path);
+
+/* Only call once no section can be running on another thread. */
+void performance_sections_clear(void);
+
 void rarch_timer_tick(rarch_timer_t *timer);
 
 bool rarch_timer_is_running(rarch_timer_t *timer);
@@ -488,6 +488,7 @@ fi
 
 check_lib '' STRCASESTR "$CLIB" strcasestr
 check_lib '' MMAP "$CLIB" mmap
+check_header IO_URING linux/io_uring.h
 
 check_enabled VULKAN vulkan
 
@@ -24,6 +24,7 @@
 #include <boolean.h>
 #include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
 #include <file/config_file.h>
@@ -424,6 +425,9 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 
    video->encoder = codec;
 
+   /* Scaling up to the output size is done in bands on every core. */
+   video->scaler.threads = cpu_features_get_core_amount();
+
    /* Don't use swscaler unless format is not something "in-house" scaler
     * supports.
     *
@@ -55,6 +55,9 @@ static bool recording_use_output_dir           = false;
 static const record_driver_t *recording_driver = NULL;
 void *recording_data                           = NULL;
 
+/* Number of GPU recording readbacks still in flight. */
+static unsigned recording_gpu_pending          = 0;
+
 /**
  * record_driver_find_ident:
  * @idx                : index of driver to get handle to.
@@ -186,6 +189,45 @@ bool record_driver_init_first(const record_driver_t **backend, void **data,
    return false;
 }
 
+/**
+ * recording_dump_frame_cb:
+ * @userdata           : Unused.
+ * @buffer             : Viewport contents (BGR24, bottom-up), or NULL
+ *                       if the readback failed.
+ * @width              : Width of the viewport.
+ * @height             : Height of the viewport.
+ * @pitch              : Pitch of @buffer.
+ *
+ * Completion callback for asynchronous GPU recording readbacks.
+ **/
+static void recording_dump_frame_cb(void *userdata, uint8_t *buffer,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   struct ffemu_video_data
+      ffemu_data       = {0};
+
+   if (recording_gpu_pending)
+      recording_gpu_pending--;
+
+   /* Recording might have been stopped or restarted with
+    * a different size in the meantime. */
+   if (     buffer
+         && recording_driver
+         && recording_driver->push_video
+         && width  == recording_gpu_width
+         && height == recording_gpu_height)
+   {
+      ffemu_data.width  = width;
+      ffemu_data.height = height;
+      ffemu_data.data   = buffer + (height - 1) * pitch;
+      ffemu_data.pitch  = -(int)pitch;
+
+      recording_driver->push_video(recording_data, &ffemu_data);
+   }
+
+   free(buffer);
+}
+
 void recording_dump_frame(const void *data, unsigned width,
       unsigned height, size_t pitch, bool is_idle)
 {
@@ -241,6 +283,26 @@ void recording_dump_frame(const void *data, unsigned width,
       if (!gpu_buf)
          return;
 
+      /* Let the GPU copy the frame in the background if the
+       * driver supports it. */
+      if (video_driver_read_viewport_async(recording_dump_frame_cb, NULL))
+      {
+         recording_gpu_pending++;
+         return;
+      }
+
+      /* All readback slots are busy. Don't read synchronously,
+       * that would push this frame ahead of the queued ones. */
+      if (recording_gpu_pending)
+      {
+         ffemu_data.data    = NULL;
+         ffemu_data.is_dupe = true;
+
+         if (recording_driver && recording_driver->push_video)
+            recording_driver->push_video(recording_data, &ffemu_data);
+         return;
+      }
+
       /* Big bottleneck.
        * Since we might need to do read-backs asynchronously,
        * it might take 3-4 times before this returns true. */
@@ -1834,7 +1834,9 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
             bool threaded_enable = false;
 #endif
             task_queue_deinit();
+            task_image_cache_deinit();
             task_queue_init(threaded_enable, runloop_msg_queue_push);
+            task_image_cache_init();
          }
          break;
       case RARCH_CTL_SET_CORE_SHUTDOWN:
@@ -1847,6 +1849,7 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          return runloop_shutdown_initiated;
       case RARCH_CTL_DATA_DEINIT:
          task_queue_deinit();
+         task_image_cache_deinit();
          break;
       case RARCH_CTL_IS_CORE_OPTION_UPDATED:
          if (!runloop_core_options)
@@ -3313,6 +3316,8 @@ int runloop_iterate(unsigned *sleep_ms)
    if ((settings->uints.video_frame_delay > 0) && !input_nonblock_state)
       retro_sleep(settings->uints.video_frame_delay);
 
+   performance_section_begin(PERF_SECTION_CORE_RUN);
+
 #ifdef HAVE_RUNAHEAD
    /* Run Ahead Feature replaces the call to core_run in this loop */
    if (settings->bools.run_ahead_enabled && settings->uints.run_ahead_frames > 0)
@@ -3321,6 +3326,8 @@ int runloop_iterate(unsigned *sleep_ms)
 #endif
       core_run();
 
+   performance_section_end(PERF_SECTION_CORE_RUN);
+
 #ifdef HAVE_CHEEVOS
    if (runloop_check_cheevos())
       cheevos_test();
@@ -133,6 +133,8 @@ static int setting_bind_action_start(void *data)
 
    keybind->mbutton = NO_BTN;
 
+   input_config_binds_changed();
+
    return 0;
 }
 #endif
@@ -966,6 +966,7 @@ void input_autoconfigure_reset(void)
    }
 
    input_autoconfigure_swap_override = false;
+   input_config_binds_changed();
 }
 
 bool input_is_autoconfigured(unsigned i)
@@ -1029,6 +1030,8 @@ bool input_autoconfigure_connect(
       input_autoconf_binds[state->idx][i].joyaxis_label     = NULL;
    }
 
+   input_config_binds_changed();
+
    input_autoconfigured[state->idx] = false;
 
    task->state                      = state;
@@ -43,6 +43,31 @@
 #define COLLECTION_SIZE                99999
 #endif
 
+typedef struct database_crc_cache_entry
+{
+   char *path;
+   int64_t size;
+   int64_t mtime;
+   uint32_t crc;
+   bool seen;
+} database_crc_cache_entry_t;
+
+/* CRC32 of previously scanned files, keyed by path and
+ * validated against size and modification time, so that
+ * rescans don't have to read unchanged content again.
+ * The first 'sorted' entries were loaded from disk; the
+ * entries added during the scan follow them. Both runs are
+ * kept ordered by path. */
+typedef struct database_crc_cache
+{
+   bool dirty;
+   size_t sorted;
+   size_t count;
+   size_t capacity;
+   char *path;
+   database_crc_cache_entry_t *entries;
+} database_crc_cache_t;
+
 typedef struct database_state_handle
 {
    uint32_t crc;
@@ -54,12 +79,14 @@ typedef struct database_state_handle
    char serial[4096];
    database_info_list_t *info;
    struct string_list *list;
+   database_crc_cache_t crc_cache;
 } database_state_handle_t;
 
 typedef struct db_handle
 {
    bool is_directory;
    bool scan_started;
+   bool scan_finished;
    bool show_hidden_files;
    unsigned status;
    char *playlist_directory;
@@ -414,6 +441,344 @@ error:
    return 0;
 }
 
+static int database_crc_cache_cmp(const void *a_, const void *b_)
+{
+   const database_crc_cache_entry_t *a = (const database_crc_cache_entry_t*)a_;
+   const database_crc_cache_entry_t *b = (const database_crc_cache_entry_t*)b_;
+
+   return strcmp(a->path, b->path);
+}
+
+static database_crc_cache_entry_t *database_crc_cache_find(
+      database_crc_cache_t *cache, const char *path)
+{
+   database_crc_cache_entry_t key;
+   database_crc_cache_entry_t *entry = NULL;
+
+   key.path = (char*)path;
+
+   if (cache->sorted)
+      entry = (database_crc_cache_entry_t*)bsearch(&key,
+            cache->entries, cache->sorted,
+            sizeof(*cache->entries), database_crc_cache_cmp);
+
+   if (!entry && cache->count > cache->sorted)
+      entry = (database_crc_cache_entry_t*)bsearch(&key,
+            cache->entries + cache->sorted, cache->count - cache->sorted,
+            sizeof(*cache->entries), database_crc_cache_cmp);
+
+   return entry;
+}
+
+/* Adds @path at the end, or when @keep_sorted is set, at its
+ * place in the run of entries added since the cache was
+ * loaded. Scans mostly walk directories in order, so that
+ * is usually the end as well. */
+static database_crc_cache_entry_t *database_crc_cache_append(
+      database_crc_cache_t *cache, const char *path, bool keep_sorted)
+{
+   char *entry_path                  = NULL;
+   database_crc_cache_entry_t *entry = NULL;
+   size_t pos                        = cache->count;
+
+   if (cache->count == cache->capacity)
+   {
+      size_t new_capacity                = cache->capacity ?
+         cache->capacity * 2 : 256;
+      database_crc_cache_entry_t *entries = (database_crc_cache_entry_t*)
+         realloc(cache->entries, new_capacity * sizeof(*entries));
+
+      if (!entries)
+         return NULL;
+
+      cache->entries  = entries;
+      cache->capacity = new_capacity;
+   }
+
+   if (!(entry_path = strdup(path)))
+      return NULL;
+
+   if (keep_sorted)
+   {
+      while (pos > cache->sorted
+            && strcmp(cache->entries[pos - 1].path, entry_path) > 0)
+         pos--;
+
+      memmove(&cache->entries[pos + 1], &cache->entries[pos],
+            (cache->count - pos) * sizeof(*cache->entries));
+   }
+
+   entry        = &cache->entries[pos];
+   entry->path  = entry_path;
+   entry->seen  = false;
+
+   cache->count++;
+   return entry;
+}
+
+static void database_crc_cache_load(database_crc_cache_t *cache,
+      const char *playlist_directory)
+{
+   char *path      = NULL;
+   char *data      = NULL;
+   char *line      = NULL;
+   int64_t len     = 0;
+
+   if (string_is_empty(playlist_directory))
+      return;
+
+   path            = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
+   if (!path)
+      return;
+
+   path[0]         = '\0';
+
+   fill_pathname_join(path, playlist_directory,
+         file_path_str(FILE_PATH_CONTENT_CRC_CACHE),
+         PATH_MAX_LENGTH * sizeof(char));
+
+   cache->path     = path;
+
+   if (!filestream_exists(path)
+         || !filestream_read_file(path, (void**)&data, &len))
+      return;
+
+   /* Each line holds: CRC32 size mtime path */
+   for (line = data; line && *line; )
+   {
+      char *next                        = strchr(line, '\n');
+      char *end                         = NULL;
+      database_crc_cache_entry_t *entry = NULL;
+      uint32_t crc                      = 0;
+      int64_t size                      = 0;
+      int64_t mtime                     = 0;
+
+      if (next)
+         *next++ = '\0';
+
+      crc   = (uint32_t)strtoul(line, &end, 16);
+      if (end != line && *end == ' ')
+      {
+         line  = end + 1;
+         size  = strtoll(line, &end, 10);
+      }
+      if (end != line && *end == ' ')
+      {
+         line  = end + 1;
+         mtime = strtoll(line, &end, 10);
+      }
+
+      if (end != line && *end == ' ' && end[1] != '\0'
+            && (entry = database_crc_cache_append(cache, end + 1, false)))
+      {
+         entry->size  = size;
+         entry->mtime = mtime;
+         entry->crc   = crc;
+      }
+
+      line = next;
+   }
+
+   free(data);
+
+   qsort(cache->entries, cache->count,
+         sizeof(*cache->entries), database_crc_cache_cmp);
+
+   /* Drop duplicate paths written by earlier versions. */
+   if (cache->count > 1)
+   {
+      size_t i;
+      size_t out = 0;
+
+      for (i = 1; i < cache->count; i++)
+      {
+         if (string_is_equal(cache->entries[out].path,
+                  cache->entries[i].path))
+         {
+            free(cache->entries[out].path);
+            cache->dirty = true;
+         }
+         else
+            out++;
+         cache->entries[out] = cache->entries[i];
+      }
+
+      cache->count = out + 1;
+   }
+
+   cache->sorted = cache->count;
+}
+
+/* Whether @path lies somewhere below directory @dir. */
+static bool database_crc_cache_in_dir(const char *path,
+      const char *dir, size_t dir_len)
+{
+   if (!dir_len || strncmp(path, dir, dir_len))
+      return false;
+   return path_char_is_slash(dir[dir_len - 1])
+      || path_char_is_slash(path[dir_len]);
+}
+
+/**
+ * database_crc_cache_save:
+ * @cache              : CRC cache.
+ * @scanned_dir        : Directory that was scanned all the way
+ *                       through, or NULL.
+ *
+ * Writes @cache back if anything changed. Entries under
+ * @scanned_dir that the scan didn't come across are dropped,
+ * as those files are gone; entries anywhere else are kept
+ * as they are, whether or not the files are reachable now.
+ *
+ * The cache is written to a temporary file first and moved
+ * over the old one, so an interrupted save leaves the
+ * previous cache intact.
+ **/
+static void database_crc_cache_save(database_crc_cache_t *cache,
+      const char *scanned_dir)
+{
+   size_t i;
+   bool failed    = false;
+   char *tmp_path = NULL;
+   RFILE *file    = NULL;
+
+   if (string_is_empty(cache->path))
+      return;
+
+   if (!string_is_empty(scanned_dir))
+   {
+      size_t dir_len = strlen(scanned_dir);
+
+      for (i = 0; i < cache->count; )
+      {
+         if (     !cache->entries[i].seen
+               && database_crc_cache_in_dir(cache->entries[i].path,
+                  scanned_dir, dir_len))
+         {
+            free(cache->entries[i].path);
+            cache->entries[i] = cache->entries[--cache->count];
+            cache->dirty      = true;
+         }
+         else
+            i++;
+      }
+   }
+
+   if (!cache->dirty)
+      return;
+
+   tmp_path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
+   if (!tmp_path)
+      return;
+
+   strlcpy(tmp_path, cache->path, PATH_MAX_LENGTH * sizeof(char));
+   strlcat(tmp_path, ".tmp", PATH_MAX_LENGTH * sizeof(char));
+
+   file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+   {
+      free(tmp_path);
+      return;
+   }
+
+   qsort(cache->entries, cache->count,
+         sizeof(*cache->entries), database_crc_cache_cmp);
+
+   for (i = 0; i < cache->count && !failed; i++)
+      failed = filestream_printf(file, "%08X %lld %lld %s\n",
+            cache->entries[i].crc,
+            (long long)cache->entries[i].size,
+            (long long)cache->entries[i].mtime,
+            cache->entries[i].path) < 0;
+
+   if (filestream_error(file))
+      failed = true;
+   if (filestream_close(file) != 0)
+      failed = true;
+
+   /* rename() doesn't replace an existing file on Windows. */
+   if (     !failed
+         && filestream_rename(tmp_path, cache->path) != 0
+         && (filestream_delete(cache->path) != 0
+            || filestream_rename(tmp_path, cache->path) != 0))
+      failed = true;
+
+   if (failed)
+   {
+      RARCH_WARN("Could not save CRC cache to \"%s\".\n", cache->path);
+      filestream_delete(tmp_path);
+   }
+   else
+      cache->dirty = false;
+
+   free(tmp_path);
+
+   cache->sorted = cache->count;
+}
+
+static void database_crc_cache_free(database_crc_cache_t *cache)
+{
+   size_t i;
+
+   for (i = 0; i < cache->count; i++)
+      free(cache->entries[i].path);
+
+   free(cache->entries);
+   free(cache->path);
+
+   memset(cache, 0, sizeof(*cache));
+}
+
+/* Same as intfstream_file_get_crc() over the whole file,
+ * but served from the CRC cache when the file hasn't
+ * changed since it was last scanned. */
+static int task_database_get_file_crc(database_crc_cache_t *cache,
+      const char *name, uint32_t *crc)
+{
+   int rv;
+   database_crc_cache_entry_t *entry = NULL;
+   int64_t size                      = 0;
+   int64_t mtime                     = 0;
+
+   if (     !cache->path
+         || strchr(name, '\n')
+         || !path_get_size_mtime(name, &size, &mtime))
+      return intfstream_file_get_crc(name, 0, SIZE_MAX, crc);
+
+   entry = database_crc_cache_find(cache, name);
+
+   if (entry)
+      entry->seen = true;
+
+   if (entry && entry->size == size && entry->mtime == mtime)
+   {
+      *crc = entry->crc;
+      return 1;
+   }
+
+   rv = intfstream_file_get_crc(name, 0, SIZE_MAX, crc);
+
+   if (rv != 1)
+      return rv;
+
+   if (!entry && (entry = database_crc_cache_append(cache, name, true)))
+      entry->seen  = true;
+
+   if (entry)
+   {
+      entry->size  = size;
+      entry->mtime = mtime;
+      entry->crc   = *crc;
+      cache->dirty = true;
+   }
+
+   return rv;
+}
+
 static int task_database_cue_get_crc(const char *name, uint32_t *crc)
 {
    char *track_path = (char *)malloc(PATH_MAX_LENGTH);
@@ -618,8 +983,8 @@ static int task_database_iterate_playlist(
 #ifdef HAVE_COMPRESSION
          database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
          /* first check crc of archive itself */
-         return intfstream_file_get_crc(name,
-               0, SIZE_MAX, &db_state->archive_crc);
+         return task_database_get_file_crc(&db_state->crc_cache,
+               name, &db_state->archive_crc);
 #else
          break;
 #endif
@@ -669,7 +1034,8 @@ static int task_database_iterate_playlist(
          break;
       default:
          database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         return task_database_get_file_crc(&db_state->crc_cache,
+               name, &db_state->crc);
    }
 
    return 1;
@@ -1181,6 +1547,10 @@ static void task_database_handler(retro_task_t *task)
    switch (dbinfo->status)
    {
       case DATABASE_STATUS_ITERATE_BEGIN:
+         if (dbstate && !dbstate->crc_cache.path)
+            database_crc_cache_load(&dbstate->crc_cache,
+                  db->playlist_directory);
+
          if (dbstate && !dbstate->list)
          {
             if (!string_is_empty(db->content_database_path))
@@ -1265,6 +1635,7 @@ static void task_database_handler(retro_task_t *task)
             fprintf(stderr, "msg: %s\n", msg);
 #endif
             ui_companion_driver_notify_refresh();
+            db->scan_finished = true;
             goto task_finished;
          }
          break;
@@ -1283,6 +1654,10 @@ task_finished:
    {
       if (dbstate->list)
          dir_list_free(dbstate->list);
+
+      database_crc_cache_save(&dbstate->crc_cache,
+            db->is_directory && db->scan_finished ? db->fullpath : NULL);
+      database_crc_cache_free(&dbstate->crc_cache);
    }
 
    if (db)
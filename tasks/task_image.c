@@ -18,12 +18,22 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <gfx/scaler/scaler.h>
 #include <retro_miscellaneous.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "../gfx/video_driver.h"
 #include "../file_path_special.h"
 #include "../verbosity.h"
@@ -52,8 +62,428 @@ struct nbio_image_handle
    void *handle;
    transfer_cb_t  cb;
    struct texture_image ti;
+   /* Thumbnails are scaled down to fit these, 0 keeps full size */
+   unsigned max_width;
+   unsigned max_height;
+   /* Only decode into the cache, nobody waits for the result */
+   bool is_prefetch;
+   bool is_cacheable;
+   int64_t file_size;
+   int64_t file_mtime;
 };
 
+/* Scaled down thumbnails are kept in memory, so scrolling back
+ * and forth over a playlist does not read and decode the same
+ * files again. Entries are keyed by path, size and mtime. */
+#define IMAGE_CACHE_MAX_BYTES (24 * 1024 * 1024)
+
+typedef struct image_cache_key
+{
+   char *path;
+   int64_t file_size;
+   int64_t file_mtime;
+   unsigned max_width;
+   unsigned max_height;
+   bool supports_rgba;
+} image_cache_key_t;
+
+typedef struct image_cache_entry
+{
+   image_cache_key_t key;
+   struct texture_image ti;
+   struct image_cache_entry *prev;
+   struct image_cache_entry *next;
+} image_cache_entry_t;
+
+/* A cacheable load that has been pushed but not inserted yet,
+ * so that a prefetch and a load of the same image only decode
+ * it once. */
+typedef struct image_cache_inflight
+{
+   /* The path is the task's own copy, which outlives this. */
+   image_cache_key_t key;
+   struct nbio_image_handle *image;
+   retro_task_t *task;
+   struct image_cache_inflight *next;
+} image_cache_inflight_t;
+
+/* Most recently used first. */
+static image_cache_entry_t *image_cache          = NULL;
+static image_cache_entry_t *image_cache_tail     = NULL;
+static image_cache_inflight_t *image_cache_loads = NULL;
+static size_t image_cache_bytes                  = 0;
+#ifdef HAVE_THREADS
+static slock_t *image_cache_lock                 = NULL;
+#endif
+
+static void image_cache_lock_acquire(void)
+{
+#ifdef HAVE_THREADS
+   if (image_cache_lock)
+      slock_lock(image_cache_lock);
+#endif
+}
+
+static void image_cache_lock_release(void)
+{
+#ifdef HAVE_THREADS
+   if (image_cache_lock)
+      slock_unlock(image_cache_lock);
+#endif
+}
+
+static bool image_cache_key_equal(const image_cache_key_t *a,
+      const image_cache_key_t *b)
+{
+   return   a->file_size     == b->file_size
+         && a->file_mtime    == b->file_mtime
+         && a->max_width     == b->max_width
+         && a->max_height    == b->max_height
+         && a->supports_rgba == b->supports_rgba
+         && string_is_equal(a->path, b->path);
+}
+
+static size_t image_cache_entry_bytes(const image_cache_entry_t *entry)
+{
+   return entry->ti.width * entry->ti.height * sizeof(uint32_t);
+}
+
+static void image_cache_entry_free(image_cache_entry_t *entry)
+{
+   free(entry->key.path);
+   free(entry->ti.pixels);
+   free(entry);
+}
+
+static void image_cache_unlink(image_cache_entry_t *entry)
+{
+   if (entry->prev)
+      entry->prev->next = entry->next;
+   else
+      image_cache       = entry->next;
+
+   if (entry->next)
+      entry->next->prev = entry->prev;
+   else
+      image_cache_tail  = entry->prev;
+
+   entry->prev          = NULL;
+   entry->next          = NULL;
+}
+
+static void image_cache_push_front(image_cache_entry_t *entry)
+{
+   entry->prev          = NULL;
+   entry->next          = image_cache;
+
+   if (image_cache)
+      image_cache->prev = entry;
+   else
+      image_cache_tail  = entry;
+
+   image_cache          = entry;
+}
+
+static image_cache_entry_t *image_cache_find(const image_cache_key_t *key)
+{
+   image_cache_entry_t *entry = NULL;
+
+   for (entry = image_cache; entry; entry = entry->next)
+      if (image_cache_key_equal(&entry->key, key))
+         return entry;
+
+   return NULL;
+}
+
+static image_cache_inflight_t *image_cache_inflight_find(
+      const image_cache_key_t *key)
+{
+   image_cache_inflight_t *load = NULL;
+
+   for (load = image_cache_loads; load; load = load->next)
+      if (image_cache_key_equal(&load->key, key))
+         return load;
+
+   return NULL;
+}
+
+/* Called with the cache lock held. */
+static void image_cache_inflight_remove(
+      const struct nbio_image_handle *image)
+{
+   image_cache_inflight_t **link = &image_cache_loads;
+
+   while (*link)
+   {
+      if ((*link)->image == image)
+      {
+         image_cache_inflight_t *load = *link;
+         *link = load->next;
+         free(load);
+         return;
+      }
+      link = &(*link)->next;
+   }
+}
+
+static bool image_texture_copy(struct texture_image *dst,
+      const struct texture_image *src)
+{
+   size_t bytes       = src->width * src->height * sizeof(uint32_t);
+
+   dst->pixels        = (uint32_t*)malloc(bytes);
+   if (!dst->pixels)
+      return false;
+
+   memcpy(dst->pixels, src->pixels, bytes);
+   dst->width         = src->width;
+   dst->height        = src->height;
+   dst->supports_rgba = src->supports_rgba;
+
+   return true;
+}
+
+/* Returns a copy of the cached image, or NULL on a miss. */
+static struct texture_image *image_cache_lookup(const image_cache_key_t *key)
+{
+   image_cache_entry_t *entry = NULL;
+   struct texture_image *img  = NULL;
+
+   image_cache_lock_acquire();
+
+   if ((entry = image_cache_find(key)))
+   {
+      image_cache_unlink(entry);
+      image_cache_push_front(entry);
+
+      img = (struct texture_image*)malloc(sizeof(*img));
+      if (img && !image_texture_copy(img, &entry->ti))
+      {
+         free(img);
+         img = NULL;
+      }
+   }
+
+   image_cache_lock_release();
+
+   return img;
+}
+
+/* Inserts the finished image and drops its in-flight record
+ * under one lock, so a concurrent push sees one or the other.
+ *
+ * Returns: whether the image is still only a prefetch. */
+static bool image_cache_insert(const char *path,
+      struct nbio_image_handle *image, bool supports_rgba)
+{
+   bool is_prefetch           = false;
+   image_cache_entry_t *entry = NULL;
+   size_t bytes               = 0;
+
+   if (image->ti.pixels
+         && (entry = (image_cache_entry_t*)calloc(1, sizeof(*entry))))
+   {
+      entry->key.path          = strdup(path);
+      entry->key.file_size     = image->file_size;
+      entry->key.file_mtime    = image->file_mtime;
+      entry->key.max_width     = image->max_width;
+      entry->key.max_height    = image->max_height;
+      entry->key.supports_rgba = supports_rgba;
+
+      if (     !entry->key.path
+            || !image_texture_copy(&entry->ti, &image->ti)
+            || (bytes = image_cache_entry_bytes(entry))
+               > IMAGE_CACHE_MAX_BYTES)
+      {
+         image_cache_entry_free(entry);
+         entry = NULL;
+      }
+   }
+
+   image_cache_lock_acquire();
+
+   image_cache_inflight_remove(image);
+   is_prefetch = image->is_prefetch;
+
+   /* A load that raced an older one for the same key. */
+   if (entry && image_cache_find(&entry->key))
+   {
+      image_cache_entry_free(entry);
+      entry = NULL;
+   }
+
+   if (entry)
+   {
+      image_cache_push_front(entry);
+      image_cache_bytes += bytes;
+
+      /* Evict from the back until we are within budget again. */
+      while (image_cache_bytes > IMAGE_CACHE_MAX_BYTES)
+      {
+         image_cache_entry_t *oldest = image_cache_tail;
+
+         image_cache_unlink(oldest);
+         image_cache_bytes -= image_cache_entry_bytes(oldest);
+         image_cache_entry_free(oldest);
+      }
+   }
+
+   image_cache_lock_release();
+
+   return is_prefetch;
+}
+
+void task_image_cache_clear(void)
+{
+   image_cache_lock_acquire();
+
+   while (image_cache)
+   {
+      image_cache_entry_t *entry = image_cache;
+      image_cache_unlink(entry);
+      image_cache_entry_free(entry);
+   }
+
+   image_cache_bytes = 0;
+
+   image_cache_lock_release();
+}
+
+/**
+ * task_image_cache_init:
+ *
+ * Sets up the thumbnail cache lock. Called with the task
+ * queue, before any task can touch the cache.
+ **/
+void task_image_cache_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!image_cache_lock)
+      image_cache_lock = slock_new();
+#endif
+}
+
+/**
+ * task_image_cache_deinit:
+ *
+ * Empties the thumbnail cache and frees its lock. Called after
+ * the task queue has been torn down.
+ **/
+void task_image_cache_deinit(void)
+{
+   task_image_cache_clear();
+
+   /* Tasks were freed along with the queue. */
+   while (image_cache_loads)
+   {
+      image_cache_inflight_t *next = image_cache_loads->next;
+      free(image_cache_loads);
+      image_cache_loads = next;
+   }
+
+#ifdef HAVE_THREADS
+   if (image_cache_lock)
+      slock_free(image_cache_lock);
+   image_cache_lock = NULL;
+#endif
+}
+
+/* Halves both dimensions in place, averaging 2x2 blocks. */
+static void task_image_halve(struct texture_image *ti)
+{
+   unsigned x, y, c;
+   unsigned out_width  = ti->width  / 2;
+   unsigned out_height = ti->height / 2;
+   const uint8_t *in   = (const uint8_t*)ti->pixels;
+   uint8_t *out        = (uint8_t*)ti->pixels;
+   size_t in_pitch     = ti->width * sizeof(uint32_t);
+
+   for (y = 0; y < out_height; y++)
+   {
+      const uint8_t *row0 = in + 2 * y * in_pitch;
+      const uint8_t *row1 = row0 + in_pitch;
+
+      for (x = 0; x < out_width; x++, row0 += 8, row1 += 8)
+         for (c = 0; c < 4; c++)
+            *out++ = (row0[c] + row0[c + 4] + row1[c] + row1[c + 4] + 2) >> 2;
+   }
+
+   ti->width  = out_width;
+   ti->height = out_height;
+}
+
+/**
+ * task_image_downscale:
+ * @ti                    : Decoded image.
+ * @max_width             : Maximum width.
+ * @max_height            : Maximum height.
+ *
+ * Scales @ti down to fit within @max_width x @max_height,
+ * keeping its aspect ratio. Images that already fit are left alone.
+ **/
+static void task_image_downscale(struct texture_image *ti,
+      unsigned max_width, unsigned max_height)
+{
+   struct scaler_ctx scaler;
+   uint32_t *out       = NULL;
+   unsigned out_width  = 0;
+   unsigned out_height = 0;
+
+   if (!ti->pixels || !max_width || !max_height)
+      return;
+
+   if (ti->width <= max_width && ti->height <= max_height)
+      return;
+
+   if ((uint64_t)ti->width * max_height > (uint64_t)ti->height * max_width)
+   {
+      out_width  = max_width;
+      out_height = (unsigned)((uint64_t)ti->height * max_width / ti->width);
+   }
+   else
+   {
+      out_height = max_height;
+      out_width  = (unsigned)((uint64_t)ti->width * max_height / ti->height);
+   }
+
+   out_width  = MAX(out_width,  1);
+   out_height = MAX(out_height, 1);
+
+   /* Bilinear filtering alone skips source pixels on large
+    * reductions, so box filter down to within 2x first. */
+   while (ti->width >= out_width * 2 && ti->height >= out_height * 2)
+      task_image_halve(ti);
+
+   if (ti->width == out_width && ti->height == out_height)
+      return;
+
+   memset(&scaler, 0, sizeof(scaler));
+   scaler.in_width    = ti->width;
+   scaler.in_height   = ti->height;
+   scaler.in_stride   = ti->width * sizeof(uint32_t);
+   scaler.out_width   = out_width;
+   scaler.out_height  = out_height;
+   scaler.out_stride  = out_width * sizeof(uint32_t);
+   scaler.in_fmt      = SCALER_FMT_ARGB8888;
+   scaler.out_fmt     = SCALER_FMT_ARGB8888;
+   scaler.scaler_type = SCALER_TYPE_BILINEAR;
+
+   out = (uint32_t*)malloc(out_width * out_height * sizeof(uint32_t));
+
+   if (out && scaler_ctx_gen_filter(&scaler))
+   {
+      scaler_ctx_scale(&scaler, out, ti->pixels);
+      free(ti->pixels);
+      ti->pixels = out;
+      ti->width  = out_width;
+      ti->height = out_height;
+      out        = NULL;
+   }
+
+   scaler_ctx_gen_reset(&scaler);
+   free(out);
+}
+
 static int cb_image_menu_upload_generic(void *data, size_t len)
 {
    unsigned r_shift, g_shift, b_shift, a_shift;
@@ -174,6 +604,16 @@ static void task_image_load_free(retro_task_t *task)
 
    if (nbio)
    {
+      struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+
+      /* Loads that failed or were cancelled never got inserted. */
+      if (image && image->is_cacheable)
+      {
+         image_cache_lock_acquire();
+         image_cache_inflight_remove(image);
+         image_cache_lock_release();
+      }
+
       task_image_cleanup(nbio);
       free(nbio);
    }
@@ -268,7 +708,20 @@ bool task_image_load_handler(retro_task_t *task)
          && (image && image->is_finished )
          && (!task_get_cancelled(task)))
    {
-      struct texture_image *img = (struct texture_image*)malloc(sizeof(struct texture_image));
+      struct texture_image *img = NULL;
+
+      task_image_downscale(&image->ti, image->max_width, image->max_height);
+
+      if (image->is_cacheable
+            && image_cache_insert(nbio->path, image,
+               BIT32_GET(nbio->status_flags, NBIO_FLAG_IMAGE_SUPPORTS_RGBA)))
+      {
+         free(image->ti.pixels);
+         image->ti.pixels = NULL;
+         return false;
+      }
+
+      img = (struct texture_image*)malloc(sizeof(struct texture_image));
 
       if (img)
       {
@@ -286,12 +739,120 @@ bool task_image_load_handler(retro_task_t *task)
    return true;
 }
 
-bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *user_data)
+static void task_image_cache_handler(retro_task_t *task)
+{
+   task_set_data(task, task->state);
+   task->state = NULL;
+   task_set_finished(task, true);
+}
+
+static void task_image_cache_free(retro_task_t *task)
+{
+   struct texture_image *img = task ? (struct texture_image*)task->state : NULL;
+
+   if (img)
+   {
+      image_texture_free(img);
+      free(img);
+   }
+}
+
+/* Serves a cache hit through the task queue, so callers still
+ * get their callback asynchronously like for a regular load. */
+static bool task_push_image_cached(struct texture_image *img,
+      retro_task_callback_t cb, void *user_data)
+{
+   retro_task_t *t = (retro_task_t*)calloc(1, sizeof(*t));
+
+   if (!t)
+      return false;
+
+   t->state     = img;
+   t->handler   = task_image_cache_handler;
+   t->cleanup   = task_image_cache_free;
+   t->callback  = cb;
+   t->user_data = user_data;
+
+   task_queue_push(t);
+
+   return true;
+}
+
+static bool task_push_image_load_internal(const char *fullpath,
+      unsigned max_width, unsigned max_height, bool is_prefetch,
+      retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
    struct nbio_image_handle   *image = NULL;
-   retro_task_t                   *t = (retro_task_t*)calloc(1, sizeof(*t));
+   retro_task_t                   *t = NULL;
+   bool supports_rgba                = video_driver_supports_rgba();
+   bool is_cacheable                 = false;
+   image_cache_inflight_t *load      = NULL;
+   image_cache_key_t key;
+
+   key.path                          = (char*)fullpath;
+   key.file_size                     = 0;
+   key.file_mtime                    = 0;
+   key.max_width                     = max_width;
+   key.max_height                    = max_height;
+   key.supports_rgba                 = supports_rgba;
+
+   if (max_width && max_height)
+      is_cacheable = path_get_size_mtime(fullpath,
+            &key.file_size, &key.file_mtime);
+
+   if (!is_cacheable && is_prefetch)
+      return false;
+
+   if (is_cacheable)
+   {
+      struct texture_image *img = NULL;
+
+      if (is_prefetch)
+      {
+         bool found;
+
+         /* Nothing to decode if it is cached or on its way. */
+         image_cache_lock_acquire();
+         found = image_cache_find(&key) || image_cache_inflight_find(&key);
+         image_cache_lock_release();
+
+         return found;
+      }
+
+      if ((img = image_cache_lookup(&key)))
+      {
+         if (task_push_image_cached(img, cb, user_data))
+            return true;
 
+         image_texture_free(img);
+         free(img);
+      }
+
+      /* A prefetch of the same image is still decoding: have it
+       * deliver to this caller instead of decoding it twice.
+       * Callbacks only run on this thread, and the task thread
+       * reads is_prefetch under the lock. */
+      image_cache_lock_acquire();
+      load = image_cache_inflight_find(&key);
+      if (load && load->image->is_prefetch)
+      {
+         load->image->is_prefetch = false;
+         load->task->callback     = cb;
+         load->task->user_data    = user_data;
+      }
+      else
+         load = NULL;
+      image_cache_lock_release();
+
+      if (load)
+         return true;
+
+      if (!(load = (image_cache_inflight_t*)calloc(1, sizeof(*load))))
+         is_cacheable = false;
+   }
+
+   t = (retro_task_t*)calloc(1, sizeof(*t));
    if (!t)
       goto error_msg;
 
@@ -311,7 +872,7 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    nbio->msg_queue     = NULL;
    nbio->cb            = &cb_nbio_image_menu_thumbnail;
 
-   if (video_driver_supports_rgba())
+   if (supports_rgba)
       BIT32_SET(nbio->status_flags, NBIO_FLAG_IMAGE_SUPPORTS_RGBA);
 
    image              = (struct nbio_image_handle*)malloc(sizeof(*image));
@@ -334,6 +895,13 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    image->ti.pixels                  = NULL;
    image->ti.supports_rgba           = false;
 
+   image->max_width                  = max_width;
+   image->max_height                 = max_height;
+   image->is_prefetch                = is_prefetch;
+   image->is_cacheable               = is_cacheable;
+   image->file_size                  = key.file_size;
+   image->file_mtime                 = key.file_mtime;
+
    if (strstr(fullpath, file_path_str(FILE_PATH_PNG_EXTENSION)))
    {
       nbio->type       = NBIO_TYPE_PNG;
@@ -364,6 +932,19 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    t->callback        = cb;
    t->user_data       = user_data;
 
+   if (load)
+   {
+      load->key       = key;
+      load->key.path  = nbio->path;
+      load->image     = image;
+      load->task      = t;
+
+      image_cache_lock_acquire();
+      load->next        = image_cache_loads;
+      image_cache_loads = load;
+      image_cache_lock_release();
+   }
+
    task_queue_push(t);
 
    return true;
@@ -379,8 +960,30 @@ error:
    }
 
 error_msg:
+   free(load);
    RARCH_ERR("[image load] Failed to open '%s': %s.\n",
          fullpath, strerror(errno));
 
    return false;
 }
+
+bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_internal(fullpath, 0, 0, false,
+         cb, user_data);
+}
+
+bool task_push_image_load_thumbnail(const char *fullpath,
+      unsigned max_width, unsigned max_height,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_internal(fullpath, max_width, max_height,
+         false, cb, user_data);
+}
+
+bool task_push_image_prefetch(const char *fullpath,
+      unsigned max_width, unsigned max_height)
+{
+   return task_push_image_load_internal(fullpath, max_width, max_height,
+         true, NULL, NULL);
+}
@@ -31,6 +31,10 @@
 
 #include <encodings/crc32.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "../msg_hash.h"
 #include "../verbosity.h"
 
@@ -96,12 +100,61 @@ struct ups_data
 typedef enum patch_error (*patch_func_t)(const uint8_t*, uint64_t,
       const uint8_t*, uint64_t, uint8_t*, uint64_t*);
 
+/* Checksum of a buffer that stays untouched while a patch
+ * is applied (source content, patch file). Large ones get
+ * hashed on a separate thread while the patch is applied. */
+struct patch_crc_job
+{
+   const uint8_t *data;
+   size_t length;
+   uint32_t crc;
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+#endif
+};
+
+#ifdef HAVE_THREADS
+#define PATCH_CRC_THREAD_THRESHOLD (1 << 20)
+#endif
+
+static void patch_crc_job_run(void *userdata)
+{
+   struct patch_crc_job *job = (struct patch_crc_job*)userdata;
+   job->crc                  = encoding_crc32(0, job->data, job->length);
+}
+
+static void patch_crc_job_start(struct patch_crc_job *job,
+      const uint8_t *data, size_t length)
+{
+   job->data   = data;
+   job->length = length;
+   job->crc    = 0;
+#ifdef HAVE_THREADS
+   job->thread = NULL;
+   if (length >= PATCH_CRC_THREAD_THRESHOLD)
+      job->thread = sthread_create(patch_crc_job_run, job);
+#endif
+}
+
+static uint32_t patch_crc_job_finish(struct patch_crc_job *job)
+{
+#ifdef HAVE_THREADS
+   if (job->thread)
+   {
+      sthread_join(job->thread);
+      job->thread = NULL;
+      return job->crc;
+   }
+#endif
+   patch_crc_job_run(job);
+   return job->crc;
+}
+
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data         = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = ~(encoding_crc32(
-         ~bps->modify_checksum, &data, 1));
-   return data;
+   if (bps->modify_offset < bps->modify_length)
+      return bps->modify_data[bps->modify_offset++];
+   return 0x00;
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
@@ -121,12 +174,6 @@ static uint64_t bps_decode(struct bps_data *bps)
    return data;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
-{
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = ~(encoding_crc32(~bps->target_checksum, &data, 1));
-}
-
 static enum patch_error bps_apply_patch(
       const uint8_t *modify_data, uint64_t modify_length,
       const uint8_t *source_data, uint64_t source_length,
@@ -138,6 +185,9 @@ static enum patch_error bps_apply_patch(
    size_t modify_target_size;
    size_t modify_markup_size;
    struct bps_data bps;
+   struct patch_crc_job source_job;
+   struct patch_crc_job modify_job;
+   enum patch_error err            = PATCH_SUCCESS;
    uint32_t modify_source_checksum = 0;
    uint32_t modify_target_checksum = 0;
    uint32_t modify_modify_checksum = 0;
@@ -154,9 +204,9 @@ static enum patch_error bps_apply_patch(
    bps.modify_offset          = 0;
    bps.source_offset          = 0;
    bps.target_offset          = 0;
-   bps.modify_checksum        = ~0;
+   bps.modify_checksum        = 0;
    bps.source_checksum        = 0;
-   bps.target_checksum        = ~0;
+   bps.target_checksum        = 0;
    bps.source_relative_offset = 0;
    bps.target_relative_offset = 0;
    bps.output_offset          = 0;
@@ -171,14 +221,21 @@ static enum patch_error bps_apply_patch(
    modify_target_size  = bps_decode(&bps);
    modify_markup_size  = bps_decode(&bps);
 
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+   if (modify_markup_size > bps.modify_length - bps.modify_offset)
+      return PATCH_PATCH_INVALID;
+
+   bps.modify_offset  += modify_markup_size;
 
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
    if (modify_target_size > bps.target_length)
       return PATCH_TARGET_TOO_SMALL;
 
+   /* Neither input changes from here on, so both can be
+    * checksummed while the patch is being applied. */
+   patch_crc_job_start(&source_job, bps.source_data, bps.source_length);
+   patch_crc_job_start(&modify_job, bps.modify_data, bps.modify_length - 4);
+
    while (bps.modify_offset < bps.modify_length - 12)
    {
       size_t length = bps_decode(&bps);
@@ -186,16 +243,35 @@ static enum patch_error bps_apply_patch(
 
       length = (length >> 2) + 1;
 
+      if (length > bps.target_length - bps.output_offset)
+      {
+         err = PATCH_TARGET_TOO_SMALL;
+         break;
+      }
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (bps.output_offset + length > bps.source_length)
+            {
+               err = PATCH_SOURCE_TOO_SMALL;
+               break;
+            }
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.source_data + bps.output_offset, length);
+            bps.output_offset += length;
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (length > bps.modify_length - bps.modify_offset)
+            {
+               err = PATCH_PATCH_INVALID;
+               break;
+            }
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.modify_data + bps.modify_offset, length);
+            bps.modify_offset += length;
+            bps.output_offset += length;
             break;
 
          case SOURCE_COPY:
@@ -212,33 +288,69 @@ static enum patch_error bps_apply_patch(
             if (mode == SOURCE_COPY)
             {
                bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
+               if (     bps.source_offset > bps.source_length
+                     || length > bps.source_length - bps.source_offset)
+               {
+                  err = PATCH_SOURCE_TOO_SMALL;
+                  break;
+               }
+               memcpy(bps.target_data + bps.output_offset,
+                     bps.source_data + bps.source_offset, length);
+               bps.source_offset += length;
+               bps.output_offset += length;
             }
             else
             {
                bps.target_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+               if (bps.target_offset >= bps.output_offset)
+               {
+                  err = PATCH_PATCH_INVALID;
+                  break;
+               }
+
+               /* Runs overlapping the output repeat
+                * themselves, so only disjoint ones can
+                * be copied in bulk. */
+               if (bps.target_offset + length <= bps.output_offset)
+               {
+                  memcpy(bps.target_data + bps.output_offset,
+                        bps.target_data + bps.target_offset, length);
+                  bps.target_offset += length;
+                  bps.output_offset += length;
+               }
+               else
+                  while (length--)
+                     bps.target_data[bps.output_offset++] =
+                        bps.target_data[bps.target_offset++];
             }
             break;
          }
       }
+
+      if (err != PATCH_SUCCESS)
+         break;
    }
 
+   bps.source_checksum = patch_crc_job_finish(&source_job);
+   checksum            = patch_crc_job_finish(&modify_job);
+
+   if (err != PATCH_SUCCESS)
+      return err;
+
    for (i = 0; i < 32; i += 8)
-      modify_source_checksum |= bps_read(&bps) << i;
+      modify_source_checksum |= (uint32_t)bps_read(&bps) << i;
    for (i = 0; i < 32; i += 8)
-      modify_target_checksum |= bps_read(&bps) << i;
+      modify_target_checksum |= (uint32_t)bps_read(&bps) << i;
+
+   /* The patch checksum covers everything up to itself. */
+   if (bps.modify_offset != bps.modify_length - 4)
+      checksum = encoding_crc32(0, bps.modify_data, bps.modify_offset);
 
-   checksum = ~bps.modify_checksum;
    for (i = 0; i < 32; i += 8)
-      modify_modify_checksum |= bps_read(&bps) << i;
+      modify_modify_checksum |= (uint32_t)bps_read(&bps) << i;
 
-   bps.source_checksum = encoding_crc32(0,
-         bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
+   bps.target_checksum = encoding_crc32(0,
+         bps.target_data, bps.output_offset);
 
    if (bps.source_checksum != modify_source_checksum)
       return PATCH_SOURCE_CHECKSUM_INVALID;
@@ -257,41 +369,50 @@ static enum patch_error bps_apply_patch(
 static uint8_t ups_patch_read(struct ups_data *data)
 {
    if (data && data->patch_offset < data->patch_length)
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum =
-         ~(encoding_crc32(~data->patch_checksum, &n, 1));
-      return n;
-   }
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
 static uint8_t ups_source_read(struct ups_data *data)
 {
    if (data && data->source_offset < data->source_length)
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum =
-         ~(encoding_crc32(~data->source_checksum, &n, 1));
-      return n;
-   }
+      return data->source_data[data->source_offset++];
    return 0x00;
 }
 
 static void ups_target_write(struct ups_data *data, uint8_t n)
 {
-
    if (data && data->target_offset < data->target_length)
-   {
       data->target_data[data->target_offset] = n;
-      data->target_checksum =
-         ~(encoding_crc32(~data->target_checksum, &n, 1));
-   }
 
    if (data)
       data->target_offset++;
 }
 
+/* Equivalent to @length ups_target_write(ups_source_read())
+ * calls, with the part where both buffers have room done
+ * in bulk. */
+static void ups_copy_source(struct ups_data *data, unsigned length)
+{
+   if (     data->source_offset < data->source_length
+         && data->target_offset < data->target_length)
+   {
+      unsigned bulk = MIN(length, MIN(
+               data->source_length - data->source_offset,
+               data->target_length - data->target_offset));
+
+      memcpy(data->target_data + data->target_offset,
+            data->source_data + data->source_offset, bulk);
+
+      data->source_offset += bulk;
+      data->target_offset += bulk;
+      length              -= bulk;
+   }
+
+   while (length--)
+      ups_target_write(data, ups_source_read(data));
+}
+
 static uint64_t ups_decode(struct ups_data *data)
 {
    uint64_t offset = 0, shift = 1;
@@ -315,6 +436,8 @@ static enum patch_error ups_apply_patch(
 {
    size_t i;
    struct ups_data data;
+   struct patch_crc_job source_job;
+   struct patch_crc_job patch_job;
    unsigned source_read_length;
    unsigned target_read_length;
    uint32_t patch_result_checksum;
@@ -331,9 +454,9 @@ static enum patch_error ups_apply_patch(
    data.patch_offset    = 0;
    data.source_offset   = 0;
    data.target_offset   = 0;
-   data.patch_checksum  = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
+   data.patch_checksum  = 0;
+   data.source_checksum = 0;
+   data.target_checksum = 0;
 
    if (data.patch_length < 18)
       return PATCH_PATCH_INVALID;
@@ -361,11 +484,15 @@ static enum patch_error ups_apply_patch(
 
    data.target_length = (unsigned)*targetlength;
 
+   /* The whole source ends up being read below, and the
+    * patch itself is never modified. */
+   patch_crc_job_start(&source_job, data.source_data, data.source_length);
+   patch_crc_job_start(&patch_job, data.patch_data, data.patch_length - 4);
+
    while (data.patch_offset < data.patch_length - 12)
    {
       unsigned length = (unsigned)ups_decode(&data);
-      while (length--)
-         ups_target_write(&data, ups_source_read(&data));
+      ups_copy_source(&data, length);
       while (true)
       {
          uint8_t patch_xor = ups_patch_read(&data);
@@ -375,23 +502,29 @@ static enum patch_error ups_apply_patch(
       }
    }
 
-   while (data.source_offset < data.source_length)
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length)
-      ups_target_write(&data, ups_source_read(&data));
-
+   if (data.source_offset < data.source_length)
+      ups_copy_source(&data, data.source_length - data.source_offset);
+   if (data.target_offset < data.target_length)
+      ups_copy_source(&data, data.target_length - data.target_offset);
 
    for (i = 0; i < 4; i++)
-      source_read_checksum |= ups_patch_read(&data) << (i * 8);
+      source_read_checksum |= (uint32_t)ups_patch_read(&data) << (i * 8);
    for (i = 0; i < 4; i++)
-      target_read_checksum |= ups_patch_read(&data) << (i * 8);
+      target_read_checksum |= (uint32_t)ups_patch_read(&data) << (i * 8);
+
+   data.source_checksum  = patch_crc_job_finish(&source_job);
+   patch_result_checksum = patch_crc_job_finish(&patch_job);
 
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
+   /* The patch checksum covers everything up to itself. */
+   if (data.patch_offset != data.patch_length - 4)
+      patch_result_checksum = encoding_crc32(0,
+            data.patch_data, data.patch_offset);
+
+   data.target_checksum  = encoding_crc32(0, data.target_data,
+         MIN(data.target_offset, data.target_length));
 
    for (i = 0; i < 4; i++)
-      patch_read_checksum |= ups_patch_read(&data) << (i * 8);
+      patch_read_checksum |= (uint32_t)ups_patch_read(&data) << (i * 8);
 
    if (patch_result_checksum != patch_read_checksum)
       return PATCH_PATCH_INVALID;
@@ -421,7 +554,8 @@ static enum patch_error ips_apply_patch(
       const uint8_t *sourcedata, uint64_t sourcelength,
       uint8_t *targetdata, uint64_t *targetlength)
 {
-   uint32_t offset = 5;
+   uint32_t offset   = 5;
+   uint64_t capacity = *targetlength;
 
    if (patchlen < 8 ||
          patchdata[0] != 'P' ||
@@ -431,6 +565,9 @@ static enum patch_error ips_apply_patch(
          patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
 
+   if (sourcelength > capacity)
+      return PATCH_TARGET_TOO_SMALL;
+
    memcpy(targetdata, sourcedata, (size_t)sourcelength);
 
    *targetlength = sourcelength;
@@ -472,8 +609,12 @@ static enum patch_error ips_apply_patch(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset++];
+         if (address + length > capacity)
+            return PATCH_TARGET_TOO_SMALL;
+
+         memcpy(targetdata + address, patchdata + offset, length);
+         address += length;
+         offset  += length;
       }
       else /* RLE */
       {
@@ -486,8 +627,11 @@ static enum patch_error ips_apply_patch(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset];
+         if (address + length > capacity)
+            return PATCH_TARGET_TOO_SMALL;
+
+         memset(targetdata + address, patchdata[offset], length);
+         address += length;
 
          offset++;
       }
@@ -28,6 +28,7 @@
 
 #include <file/file_path.h>
 #include <compat/strl.h>
+#include <features/features_cpu.h>
 #include <string/stdstring.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
@@ -60,6 +61,7 @@ struct screenshot_task_state
 {
    bool bgr24;
    bool silence;
+   bool savestate;
    bool is_idle;
    bool is_paused;
    bool history_list_enable;
@@ -123,12 +125,16 @@ static void task_screenshot_handler(retro_task_t *task)
 
    scaler_ctx_gen_reset(&state->scaler);
 
-   ret = rpng_save_image_bgr24(
+   /* Savestate thumbnails are written on every save and rarely
+    * looked at, so favour speed over size for those. */
+   ret = rpng_save_image_bgr24_ex(
          state->filename,
          state->out_buffer,
          state->width,
          state->height,
-         state->width * 3
+         state->width * 3,
+         state->savestate,
+         cpu_features_get_core_amount()
          );
 
    free(state->out_buffer);
@@ -206,6 +212,7 @@ static bool screenshot_dump(
    state->frame               = frame;
    state->userbuf             = userbuf;
    state->silence             = savestate;
+   state->savestate           = savestate;
    state->history_list_enable = settings->bools.history_list_enable;
    state->pixel_format_type   = video_driver_get_pixel_format();
 
@@ -250,6 +257,44 @@ static bool screenshot_dump(
 }
 
 #if !defined(VITA)
+struct screenshot_readback
+{
+   bool savestate;
+   bool is_idle;
+   bool is_paused;
+   char name_base[PATH_MAX_LENGTH];
+};
+
+/**
+ * take_screenshot_viewport_cb:
+ * @userdata               : Pending screenshot request.
+ * @buffer                 : Viewport contents (BGR24, bottom-up),
+ *                           or NULL if the readback failed.
+ * @width                  : Width of the viewport.
+ * @height                 : Height of the viewport.
+ * @pitch                  : Pitch of @buffer.
+ *
+ * Completion callback for asynchronous viewport screenshots.
+ **/
+static void take_screenshot_viewport_cb(void *userdata, uint8_t *buffer,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   struct screenshot_readback *rb = (struct screenshot_readback*)userdata;
+
+   if (!buffer || !screenshot_dump(rb->name_base,
+            buffer, width, height,
+            pitch, true, buffer, rb->savestate, rb->is_idle, rb->is_paused))
+   {
+      if (buffer)
+         free(buffer);
+      if (!rb->savestate)
+         runloop_msg_queue_push(
+               msg_hash_to_str(MSG_FAILED_TO_TAKE_SCREENSHOT), 1, 180, true);
+   }
+
+   free(rb);
+}
+
 static bool take_screenshot_viewport(const char *name_base, bool savestate,
       bool is_idle, bool is_paused)
 {
@@ -269,6 +314,28 @@ static bool take_screenshot_viewport(const char *name_base, bool savestate,
    if (!vp.width || !vp.height)
       return false;
 
+   /* While content is running, let the GPU copy the next frame
+    * in the background instead of stalling the pipeline. */
+   if (!is_idle && !is_paused)
+   {
+      struct screenshot_readback *rb = (struct screenshot_readback*)
+         calloc(1, sizeof(*rb));
+
+      if (rb)
+      {
+         rb->savestate = savestate;
+         rb->is_idle   = is_idle;
+         rb->is_paused = is_paused;
+         strlcpy(rb->name_base, name_base, sizeof(rb->name_base));
+
+         if (video_driver_read_viewport_async(
+                  take_screenshot_viewport_cb, rb))
+            return true;
+
+         free(rb);
+      }
+   }
+
    buffer = (uint8_t*)malloc(vp.width * vp.height * 3);
 
    if (!buffer)
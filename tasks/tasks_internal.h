@@ -124,6 +124,23 @@ bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port);
 bool task_push_image_load(const char *fullpath,
       retro_task_callback_t cb, void *userdata);
 
+/* Like task_push_image_load, but scales the image down to fit
+ * max_width x max_height and keeps the result in a memory cache. */
+bool task_push_image_load_thumbnail(const char *fullpath,
+      unsigned max_width, unsigned max_height,
+      retro_task_callback_t cb, void *userdata);
+
+/* Decodes a thumbnail into the cache ahead of it being shown. */
+bool task_push_image_prefetch(const char *fullpath,
+      unsigned max_width, unsigned max_height);
+
+void task_image_cache_clear(void);
+
+/* The cache lock lives as long as the task queue does. */
+void task_image_cache_init(void);
+
+void task_image_cache_deinit(void);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,